@@ -77,6 +77,8 @@ static void *client_test_loop(void *arg)
 
 		if (poll_and_process(thread) < 0)
 			break;
+
+		wait_if_idle(thread);
 	}
 
 	return NULL;
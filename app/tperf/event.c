@@ -38,6 +38,35 @@ static void process_event_queue(struct test_thread *thread)
 	}
 }
 
+static void process_event_queue_burst(struct test_thread *thread)
+{
+	struct connection *conns[BATCH_SIZE];
+	uint32_t events[BATCH_SIZE];
+	int rets[BATCH_SIZE];
+	int nr_event = thread->nr_event;
+	int nr_conn;
+	int i;
+
+	while (nr_event) {
+		for (nr_conn = 0; nr_conn < BATCH_SIZE && nr_event; nr_conn++, nr_event--) {
+			conns[nr_conn] = event_queue_pop(thread);
+			events[nr_conn] = conns[nr_conn]->events;
+			conns[nr_conn]->events = 0;
+			rets[nr_conn] = 0;
+		}
+
+		conn_on_read_burst(conns, events, rets, nr_conn);
+		conn_on_write_burst(conns, events, rets, nr_conn);
+
+		for (i = 0; i < nr_conn; i++) {
+			if (rets[i] < 0 || (events[i] & (TPA_EVENT_ERR | TPA_EVENT_HUP)) || conns[i]->to_close)
+				conn_close(conns[i]);
+			else if (rets[i])
+				event_queue_add(conns[i], rets[i]);
+		}
+	}
+}
+
 int poll_and_process(struct test_thread *thread)
 {
 	struct tpa_event events[BATCH_SIZE];
@@ -53,7 +82,29 @@ int poll_and_process(struct test_thread *thread)
 	for (i = 0; i < nr_event; i++)
 		event_queue_add(events[i].data, events[i].events);
 
-	process_event_queue(thread);
+	if (ctx.burst_io)
+		process_event_queue_burst(thread);
+	else
+		process_event_queue(thread);
 
 	return 0;
 }
+
+/*
+ * Lets the worker sleep when there is nothing to do (-w). The time
+ * slept is recorded, so that the wakeup cost could be told by comparing
+ * the rr latency with and without it.
+ */
+void wait_if_idle(struct test_thread *thread)
+{
+	uint64_t start;
+
+	if (ctx.wait_us == 0 || thread->nr_event)
+		return;
+
+	start = get_time_in_ns();
+	if (tpa_worker_wait(thread->worker, ctx.wait_us) == 1) {
+		thread->stats->nr_sleep += 1;
+		thread->stats->sleep_ns += get_time_in_ns() - start;
+	}
+}
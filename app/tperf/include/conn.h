@@ -118,5 +118,7 @@ void conn_close(struct connection *conn);
 
 int conn_on_read(struct connection *conn);
 int conn_on_write(struct connection *conn);
+void conn_on_read_burst(struct connection **conns, uint32_t *events, int *rets, int nr_conn);
+void conn_on_write_burst(struct connection **conns, uint32_t *events, int *rets, int nr_conn);
 
 #endif
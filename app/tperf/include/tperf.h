@@ -25,6 +25,9 @@
 #define TPERF_PORT			4096
 #define BATCH_SIZE			64
 
+/* the max iovs per connection for one burst I/O */
+#define BURST_NR_IOV			8
+
 enum {
 	TEST_READ,
 	TEST_WRITE,
@@ -39,6 +42,10 @@ struct thread_stats {
 
 	uint64_t nr_conn_total;
 	uint64_t nr_zero_io_conn;
+
+	/* for tpa_worker_wait */
+	uint64_t nr_sleep;
+	uint64_t sleep_ns;
 };
 
 struct test_thread {
@@ -76,6 +83,8 @@ struct ctx {
 	int enable_zwrite;
 	int port;
 	int quiet;
+	int wait_us;
+	int burst_io;
 
 	struct test_thread *threads;
 	struct thread_stats *stats;
@@ -128,6 +137,7 @@ void show_stats(void);
 
 /* event.c */
 int poll_and_process(struct test_thread *thread);
+void wait_if_idle(struct test_thread *thread);
 
 /* options.c */
 int parse_options(int argc, char **argv);
@@ -30,6 +30,10 @@ void usage(void)
 			"  -C nr_conn        specifies the connection to be created for each thread (default: 1)\n"
 			"  -W 0|1            disable/enable zero copy write (default: on)\n"
 			"  -S start_cpu      specifies the starting cpu to bind\n"
+			"  -w wait_us        sleep for at most wait_us when idle, by tpa_worker_wait\n"
+			"                    (default: 0, busy polling)\n"
+			"  -B                do the I/O of all ready connections by the burst APIs\n"
+			"                    (tpa_zreadv_burst/tpa_zwritev_burst)\n"
 			"\n"
 			"Server options:\n"
 			"  -s                run in server mode\n"
@@ -37,6 +41,8 @@ void usage(void)
 			"  -l addr           specifies local address to listen on\n"
 			"  -p port           specifies the port to listen on (default: %d)\n"
 			"  -S start_cpu      specifies the starting cpu to bind\n"
+			"  -w wait_us        sleep for at most wait_us when idle, by tpa_worker_wait\n"
+			"  -B                do the I/O by the burst APIs\n"
 			"\n"
 			"The supported test modes are:\n"
 			"  * read            read data from the server end\n"
@@ -88,7 +94,7 @@ int parse_options(int argc, char **argv)
 	ctx.start_cpu     = -4096;
 	ctx.nr_conn_per_thread = 1;
 
-	while ((opt = getopt(argc, argv, "c:C:t:d:l:m:n:p:S:W:f:z:a:isqh")) != -1) {
+	while ((opt = getopt(argc, argv, "c:C:t:d:l:m:n:p:S:W:w:f:z:a:iBsqh")) != -1) {
 		switch (opt) {
 		case 's':
 			ctx.is_client = 0;
@@ -146,6 +152,10 @@ int parse_options(int argc, char **argv)
 		case 'S':
 			PARSE_NUM(ctx.start_cpu, optarg, NUM_TYPE_NONE, "start_cpu");
 			break;
+
+		case 'w':
+			PARSE_NUM(ctx.wait_us, optarg, NUM_TYPE_NONE, "wait time");
+			break;
 		
 		case 'f':
 			PARSE_NUM(ctx.offrac_function, optarg, NUM_TYPE_NONE, "offrac function");
@@ -167,6 +177,10 @@ int parse_options(int argc, char **argv)
 			ctx.integrity_enabled = 1;
 			break;
 
+		case 'B':
+			ctx.burst_io = 1;
+			break;
+
 		case 'q':
 			ctx.quiet = 1;
 			break;
@@ -101,6 +101,8 @@ static void *server_thread_loop(void *arg)
 		accept_socks(thread);
 
 		poll_and_process(thread);
+
+		wait_if_idle(thread);
 	}
 
 	return NULL;
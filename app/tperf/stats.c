@@ -163,5 +163,11 @@ void show_stats(void)
 	for (i = 0; i < ctx.nr_thread; i++) {
 		printf("%2d nr_conn=%lu nr_zero_io_conn=%lu\n",
 			i, ctx.stats[i].nr_conn_total, ctx.stats[i].nr_zero_io_conn);
+
+		if (ctx.wait_us) {
+			printf("%2d nr_sleep=%lu avg_sleep=%.2fus\n",
+			       i, ctx.stats[i].nr_sleep,
+			       to_us(ctx.stats[i].sleep_ns / (ctx.stats[i].nr_sleep ? : 1)));
+		}
 	}
 }
@@ -182,7 +182,8 @@ static void zwrite_done(void *iov_base, void *iov_param)
 	conn_put(conn);
 }
 
-static int setup_test_data(struct test_thread *thread, struct connection *conn, struct tpa_iovec *iov)
+static int setup_test_data(struct test_thread *thread, struct connection *conn,
+			   struct tpa_iovec *iov, int max_iov)
 {
 	int budget = conn->write.budget;
 	size_t off = conn->write.off;
@@ -190,7 +191,7 @@ static int setup_test_data(struct test_thread *thread, struct connection *conn,
 	int nr_iov = 0;
 	int len;
 
-	while (off < budget) {
+	while (off < budget && nr_iov < max_iov) {
 		mbuf = mbuf_alloc(thread->mbuf_pool);
 		assert(mbuf != NULL);
 
@@ -247,7 +248,7 @@ int conn_on_write(struct connection *conn)
 			break;
 		}
 
-		nr_iov = setup_test_data(thread, conn, iov);
+		nr_iov = setup_test_data(thread, conn, iov, conn->write.budget / MBUF_SIZE + 1);
 		bytes_write = tpa_zwritev(conn->sid, iov, nr_iov);
 		if (bytes_write < 0) {
 			int err = errno;
@@ -266,3 +267,107 @@ int conn_on_write(struct connection *conn)
 
 	return 0;
 }
+
+/*
+ * The burst versions of conn_on_read and conn_on_write: the I/O of
+ * all @conns with the matching @events is done by one burst call. At
+ * most BURST_NR_IOV iovs are read or written for each connection; the
+ * events left to handle are added to @rets, or it's set to -1 on error.
+ */
+void conn_on_read_burst(struct connection **conns, uint32_t *events, int *rets, int nr_conn)
+{
+	struct tpa_iovec iov[BATCH_SIZE][BURST_NR_IOV];
+	struct tpa_sock_iov reqs[BATCH_SIZE];
+	int idx[BATCH_SIZE];
+	struct connection *conn;
+	int bytes_eaten;
+	int nr_req = 0;
+	int i;
+
+	for (i = 0; i < nr_conn; i++) {
+		if (rets[i] < 0 || !(events[i] & (TPA_EVENT_IN | TPA_EVENT_ERR | TPA_EVENT_HUP)))
+			continue;
+
+		reqs[nr_req].sid = conns[i]->sid;
+		reqs[nr_req].iov = iov[nr_req];
+		reqs[nr_req].nr_iov = BURST_NR_IOV;
+		idx[nr_req++] = i;
+	}
+
+	tpa_zreadv_burst(reqs, nr_req);
+
+	for (i = 0; i < nr_req; i++) {
+		conn = conns[idx[i]];
+
+		if (reqs[i].ret <= 0) {
+			if (reqs[i].ret == 0 || reqs[i].err != EAGAIN)
+				rets[idx[i]] = -1;
+			continue;
+		}
+
+		bytes_eaten = read_test_info(conn, iov[i], reqs[i].ret);
+		read_test_data(conn, iov[i], reqs[i].ret, bytes_eaten);
+
+		on_read_done(conn);
+
+		/* there may be more */
+		rets[idx[i]] |= TPA_EVENT_IN;
+	}
+}
+
+void conn_on_write_burst(struct connection **conns, uint32_t *events, int *rets, int nr_conn)
+{
+	struct tpa_iovec iov[BATCH_SIZE][BURST_NR_IOV];
+	struct tpa_sock_iov reqs[BATCH_SIZE];
+	int idx[BATCH_SIZE];
+	struct connection *conn;
+	size_t size;
+	int nr_req = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < nr_conn; i++) {
+		conn = conns[i];
+
+		if (rets[i] < 0 || !(events[i] & (TPA_EVENT_OUT | TPA_EVENT_ERR | TPA_EVENT_HUP)))
+			continue;
+
+		if (ctx.is_client && emit_test_info(conn) < 0) {
+			rets[i] = -1;
+			continue;
+		}
+
+		if (conn->write.budget == 0)
+			continue;
+
+		size = MIN(conn->write.budget - conn->write.off, BURST_NR_IOV * MBUF_SIZE);
+		if (mbuf_pool_free_count(conn->thread->mbuf_pool) * MBUF_SIZE < size) {
+			rets[i] |= TPA_EVENT_OUT;
+			continue;
+		}
+
+		reqs[nr_req].sid = conn->sid;
+		reqs[nr_req].iov = iov[nr_req];
+		reqs[nr_req].nr_iov = setup_test_data(conn->thread, conn, iov[nr_req], BURST_NR_IOV);
+		idx[nr_req++] = i;
+	}
+
+	tpa_zwritev_burst(reqs, nr_req);
+
+	for (i = 0; i < nr_req; i++) {
+		conn = conns[idx[i]];
+
+		if (reqs[i].ret < 0) {
+			for (j = 0; j < reqs[i].nr_iov; j++)
+				iov[i][j].iov_write_done(iov[i][j].iov_base, iov[i][j].iov_param);
+
+			if (reqs[i].err != EAGAIN)
+				rets[idx[i]] = -1;
+			continue;
+		}
+
+		on_write_done(conn, reqs[i].ret);
+		if (conn->write.budget)
+			rets[idx[i]] |= TPA_EVENT_OUT;
+	}
+}
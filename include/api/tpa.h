@@ -42,6 +42,21 @@ struct tpa_iovec {
 	};
 };
 
+/*
+ * A (sid, iov range) pair for the burst read and write below. The
+ * result, which is what tpa_zreadv or tpa_zwritev returns for the sock,
+ * is stored at @ret, with the errno at @err when it's negative.
+ */
+struct tpa_sock_iov {
+	int sid;
+	int nr_iov;
+	struct tpa_iovec *iov;
+
+	ssize_t ret;
+	int err;
+	int reserved;
+};
+
 
 /*
  * Provides extra options for socks going to be created by
@@ -73,7 +88,15 @@ struct tpa_sock_opts {
 	 * tpa_connect_to only.
 	 */
 	uint16_t local_port;
-	uint8_t reserved[128 - 18];  /* XXX: it's ugly */
+
+	/*
+	 * Specifies the congestion control algorithm, say "cubic". The
+	 * global tcp.cc is used if it's not set. Passive connections
+	 * inherit it from the listen sock.
+	 */
+	char cc[16];
+
+	uint8_t reserved[128 - 34];  /* XXX: it's ugly */
 } __attribute__((packed));
 
 struct tpa_ip {
@@ -151,6 +174,16 @@ struct tpa_worker;
 struct tpa_worker *tpa_worker_init(void);
 void tpa_worker_run(struct tpa_worker *worker);
 
+/*
+ * Puts the worker to sleep when it has nothing to do, for at most
+ * @timeout_us; it's woken up early by rx pkts, by the writes and
+ * closes from other threads, and by the next timer. It's meant to be
+ * invoked right after tpa_worker_run and the event processing.
+ *
+ * Returns 1 if it has slept, 0 if not.
+ */
+int tpa_worker_wait(struct tpa_worker *worker, uint32_t timeout_us);
+
 int tpa_connect_to(const char *server, uint16_t port, const struct tpa_sock_opts *opts);
 int tpa_listen_on(const char *local, uint16_t port, const struct tpa_sock_opts *opts);
 int tpa_accept_burst(struct tpa_worker *worker, int *sid, int nr_sid);
@@ -161,6 +194,14 @@ ssize_t tpa_zreadv(int sid, struct tpa_iovec *iov, int nr_iov);
 ssize_t tpa_zwritev(int sid, const struct tpa_iovec *iov, int nr_iov);
 ssize_t tpa_write(int sid, const void *buf, size_t count);
 
+/*
+ * The burst versions of tpa_zreadv and tpa_zwritev, for doing the
+ * I/O of many socks in one call. They return the number of socks
+ * succeeded (with @ret >= 0).
+ */
+int tpa_zreadv_burst(struct tpa_sock_iov *reqs, int nr_req);
+int tpa_zwritev_burst(struct tpa_sock_iov *reqs, int nr_req);
+
 int tpa_event_ctrl(int sid, int op, struct tpa_event *event);
 int tpa_event_poll(struct tpa_worker *worker, struct tpa_event *events, int max);
 
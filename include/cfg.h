@@ -73,6 +73,7 @@ struct tpa_cfg {
 	int nr_dpdk_port;
 
 	char *sock_file;
+	char *sock_stats_file;
 	char *sock_trace_file;
 
 	size_t nr_spec;
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _CSUM_H_
+#define _CSUM_H_
+
+#include <stdint.h>
+
+#include <rte_ip.h>
+#include <rte_mbuf.h>
+#include <rte_byteorder.h>
+
+#include "cfg.h"
+
+/*
+ * The internet checksum engine, for the paths the NIC doesn't offload:
+ * the rx csum verification, and the tx csum of the software GSO.
+ *
+ * The sums here are the raw (not complemented) 16 bit ones' complement
+ * sums, same as rte_raw_cksum; the kernels, picked by the cpu features
+ * at init, just differ in how wide they go.
+ */
+struct csum_ops {
+	const char *name;
+
+	/* returns 1 if the cpu supports it */
+	int (*supported)(void);
+
+	uint16_t (*sum)(const void *buf, uint32_t len);
+
+	/* copies @len bytes from @src to @dst, and returns the sum of them */
+	uint16_t (*copy_sum)(void *dst, const void *src, uint32_t len);
+};
+
+extern const struct csum_ops *csum_ops_list[];
+extern const int csum_ops_count;
+extern const struct csum_ops *csum_ops_default;
+
+void csum_init(void);
+const struct csum_ops *csum_ops_find(const char *name);
+int csum_ops_set(struct cfg_spec *spec, const char *val);
+int csum_ops_get(struct cfg_spec *spec, char *val);
+
+uint16_t csum_raw_mbuf(const struct rte_mbuf *m, uint32_t off, uint32_t len);
+
+static inline uint16_t csum_fold(uint64_t sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+/* the sum of a buf starting at an odd offset */
+static inline uint16_t csum_shift(uint16_t sum, uint32_t off)
+{
+	return (off & 1) ? rte_bswap16(sum) : sum;
+}
+
+static inline uint16_t csum_raw(const void *buf, uint32_t len)
+{
+	return csum_ops_default->sum(buf, len);
+}
+
+static inline uint16_t csum_copy(void *dst, const void *src, uint32_t len)
+{
+	return csum_ops_default->copy_sum(dst, src, len);
+}
+
+/* the final tcp csum; same as rte_ipv4/6_udptcp_cksum, for tcp */
+static inline uint16_t csum_l4_finish(uint64_t sum)
+{
+	return ~csum_fold(sum);
+}
+
+static inline uint16_t csum_ipv4_tcp(const struct rte_ipv4_hdr *ip, const void *l4)
+{
+	uint32_t l4_len = ntohs(ip->total_length) - (ip->version_ihl & 0xf) * 4;
+
+	return csum_l4_finish(rte_ipv4_phdr_cksum(ip, 0) + csum_raw(l4, l4_len));
+}
+
+static inline uint16_t csum_ipv6_tcp(const struct rte_ipv6_hdr *ip, const void *l4)
+{
+	uint32_t l4_len = ntohs(ip->payload_len);
+
+	return csum_l4_finish(rte_ipv6_phdr_cksum(ip, 0) + csum_raw(l4, l4_len));
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include <rte_ethdev.h>
 
 #include "ip.h"
+#include "stats.h"
 #include "pktfuzz.h"
 
 #define DEFAULT_MTU			1500
@@ -20,6 +21,7 @@
 
 #define BATCH_SIZE			64
 #define TXQ_BUF_SIZE			4096
+#define TXQ_BUF_MASK			(TXQ_BUF_SIZE - 1)
 
 #define DEV_RXQ_SIZE			NR_RX_DESC
 #define DEV_RXQ_MASK			(DEV_RXQ_SIZE - 1)
@@ -31,12 +33,43 @@ struct dev_ip {
 	struct tpa_ip ip;
 };
 
+/*
+ * When the dev txq is flushed (besides the one when there is a batch):
+ * - default: at the end of each worker loop
+ * - latency: right at the enqueue of a small pkt, say an ACK or a small
+ *            write; and at the end of each worker loop
+ * - throughput: at the end of a worker loop, only if the pkts have been
+ *               held for net.tx_flush_timeout
+ */
+enum {
+	DEV_TXQ_FLUSH_DEFAULT,
+	DEV_TXQ_FLUSH_LATENCY,
+	DEV_TXQ_FLUSH_THROUGHPUT,
+};
+
+#define DEV_TXQ_SMALL_PKT_LEN		256
+#define DEV_TXQ_FLUSH_TIMEOUT_DEFAULT	20		/* us */
+#define DEV_TXQ_FLUSH_TIMEOUT_MAX	1000
+
+/* a ring: the pkts to send start at @head */
 struct dev_txq {
+	uint16_t head;
 	uint16_t nr_pkt;
+	uint8_t  holding;
+	uint64_t hold_ts_us;
 	uint64_t nr_dropped;
+	struct hist burst_size;
 	struct packet *pkts[TXQ_BUF_SIZE];
 } __rte_cache_aligned;
 
+/* the @i-th pending pkt */
+static inline struct packet **dev_txq_slot(struct dev_txq *txq, uint16_t i)
+{
+	return &txq->pkts[(uint16_t)(txq->head + i) & TXQ_BUF_MASK];
+}
+
+#define dev_txq_pkt(txq, i)		(*dev_txq_slot(txq, i))
+
 struct dev_rxq {
 	uint32_t write;
 	uint32_t read;
@@ -74,6 +107,12 @@ struct dev_port {
 	char device_id[DEV_INFO_LEN];
 
 	struct nic_spec *nic_spec;
+
+	/* the tx offloads (PKT_TX_*) the port lacks; they are done in software */
+	uint64_t sw_tx_offload;
+
+	/* the rx queue interrupts are enabled; for tpa_worker_wait */
+	int rx_intr;
 } __rte_cache_aligned;
 
 struct net_dev {
@@ -98,6 +137,9 @@ struct net_dev {
 
 	char name[32];
 	uint16_t mtu;
+
+	int tx_flush_mode;
+	uint32_t tx_flush_timeout;
 };
 
 extern struct net_dev dev;
@@ -157,6 +199,20 @@ static inline uint16_t dev_port_id_get(void)
 	return dev.ports[0].port_id;
 }
 
+/*
+ * A burst goes up to the ring end only, as the driver takes a flat
+ * array; the wrapped part goes with the next flush.
+ */
+static inline uint16_t dev_txq_burst_count(struct dev_txq *txq)
+{
+	uint16_t count;
+
+	count = RTE_MIN(txq->nr_pkt, (uint16_t)BATCH_SIZE);
+	count = RTE_MIN(count, (uint16_t)(TXQ_BUF_SIZE - (txq->head & TXQ_BUF_MASK)));
+
+	return count;
+}
+
 static inline void dev_port_txq_flush(uint16_t port_id, uint16_t queue_id)
 {
 	struct dev_txq *txq = dev_port_txq(port_id, queue_id);
@@ -171,17 +227,20 @@ static inline void dev_port_txq_flush(uint16_t port_id, uint16_t queue_id)
 	 * It may lead to some duplication dump though, when
 	 * partial of the pkts are transmited successfully.
 	 */
-	count = RTE_MIN(txq->nr_pkt, (uint16_t)BATCH_SIZE);
+	count = dev_txq_burst_count(txq);
 
 	debug_assert(port_id < dev.nr_port);
 	if (unlikely(dev.ports[port_id].state != DEV_LINK_UP))
 		port_id = dev_port_id_get();
 
-	count = rte_eth_tx_burst(port_id, queue_id, (struct rte_mbuf **)txq->pkts, count);
+	count = rte_eth_tx_burst(port_id, queue_id, (struct rte_mbuf **)dev_txq_slot(txq, 0), count);
+	if (count)
+		hist_add(&txq->burst_size, count);
 
+	txq->head   += count;
 	txq->nr_pkt -= count;
-	if (txq->nr_pkt)
-		memmove(&txq->pkts[0], &txq->pkts[count], txq->nr_pkt * sizeof(struct packet *));
+	if (txq->nr_pkt == 0)
+		txq->holding = 0;
 }
 
 static inline void dev_txq_flush(uint16_t queue_id)
@@ -193,6 +252,43 @@ static inline void dev_txq_flush(uint16_t queue_id)
 	}
 }
 
+/*
+ * Tells whether the pkts on a non-empty txq are to be flushed at the
+ * end of a worker loop, by the tx flush mode. In the throughput mode,
+ * they are held till there is a batch, or till they have been held for
+ * net.tx_flush_timeout.
+ */
+static inline int dev_txq_flush_due(struct dev_txq *txq, uint64_t now_us)
+{
+	if (dev.tx_flush_mode != DEV_TXQ_FLUSH_THROUGHPUT || txq->nr_pkt >= BATCH_SIZE)
+		return 1;
+
+	if (!txq->holding) {
+		txq->holding = 1;
+		txq->hold_ts_us = now_us;
+	}
+
+	return now_us - txq->hold_ts_us >= dev.tx_flush_timeout;
+}
+
+/* the flush at the end of each worker loop, by the tx flush mode */
+static inline void dev_port_txq_flush_by_mode(uint16_t port_id, uint16_t queue_id,
+					      uint64_t now_us)
+{
+	struct dev_txq *txq = dev_port_txq(port_id, queue_id);
+
+	if (txq->nr_pkt && dev_txq_flush_due(txq, now_us))
+		dev_port_txq_flush(port_id, queue_id);
+}
+
+static inline void dev_txq_flush_by_mode(uint16_t queue_id, uint64_t now_us)
+{
+	uint16_t i;
+
+	for (i = 0; i < dev.nr_port; i++)
+		dev_port_txq_flush_by_mode(i, queue_id, now_us);
+}
+
 static inline void dev_port_txq_drain(uint16_t port_id, uint16_t queue_id)
 {
 	struct dev_txq *txq = dev_port_txq(port_id, queue_id);
@@ -213,23 +309,43 @@ static inline void dev_txq_drain(uint16_t queue_id)
 	}
 }
 
-static inline int dev_port_txq_enqueue(uint16_t port_id, uint16_t queue_id, struct packet *pkt)
+/* in the latency mode, a small pkt is flushed right at the enqueue */
+static inline int dev_txq_flush_now(struct packet *pkt)
+{
+	return unlikely(dev.tx_flush_mode == DEV_TXQ_FLUSH_LATENCY) &&
+	       pkt->mbuf.pkt_len <= DEV_TXQ_SMALL_PKT_LEN;
+}
+
+static inline int __dev_port_txq_enqueue(uint16_t port_id, uint16_t queue_id, struct packet *pkt)
 {
 	struct dev_txq *txq = dev_port_txq(port_id, queue_id);
+	int flush_now;
 
 	if (txq->nr_pkt >= TXQ_BUF_SIZE)
 		return -ERR_DEV_TXQ_FULL;
 
-	txq->pkts[txq->nr_pkt++] = pkt;
+	flush_now = dev_txq_flush_now(pkt);
+
+	dev_txq_pkt(txq, txq->nr_pkt++) = pkt;
 
 	pktfuzz(txq);
 
-	if (txq->nr_pkt >= BATCH_SIZE)
+	if (txq->nr_pkt >= BATCH_SIZE || flush_now)
 		dev_port_txq_flush(port_id, queue_id);
 
 	return 0;
 }
 
+int dev_port_txq_enqueue_gso(uint16_t port_id, uint16_t queue_id, struct packet *pkt);
+
+static inline int dev_port_txq_enqueue(uint16_t port_id, uint16_t queue_id, struct packet *pkt)
+{
+	if (unlikely(pkt->mbuf.ol_flags & dev.ports[port_id].sw_tx_offload))
+		return dev_port_txq_enqueue_gso(port_id, queue_id, pkt);
+
+	return __dev_port_txq_enqueue(port_id, queue_id, pkt);
+}
+
 static inline void dev_port_rxq_recv(uint16_t port_id, uint16_t queue_id)
 {
 	struct dev_rxq *rxq = dev_port_rxq(port_id, queue_id);
@@ -16,16 +16,31 @@
 
 #define ND_SKIP		-2
 
+struct neigh_entry {
+	struct tpa_ip ip;
+	struct rte_ether_addr mac;	/* protected by seq */
+	uint32_t seq;
+
+	uint64_t last_update;
+};
+
 /*
- * TODO: get rid of the count limit and use hash for search
+ * A small direct mapped neigh cache per worker. An entry is valid only
+ * if its gen matches the global neigh gen, which is bumped on each mac
+ * change.
  */
-#define MAX_NEIGH_ENTRY	512
+#define NEIGH_WCACHE_SIZE	64
 
-struct neigh_entry {
+struct neigh_wcache_entry {
 	struct tpa_ip ip;
 	struct rte_ether_addr mac;
+	uint32_t gen;
+};
 
-	uint64_t last_update;
+struct neigh_wcache {
+	uint64_t nr_hit;
+	uint64_t nr_miss;
+	struct neigh_wcache_entry entries[NEIGH_WCACHE_SIZE];
 };
 
 struct neigh_ops {
@@ -41,6 +56,7 @@ int neigh_flush(struct tpa_worker *worker);
 void neigh_update(struct tpa_ip *ip, uint8_t *mac);
 void neigh_input(struct tpa_ip *ip, uint8_t *mac);
 struct neigh_entry *neigh_find(struct tpa_ip *ip);
+void neigh_entry_read_mac(struct neigh_entry *entry, struct rte_ether_addr *mac);
 struct neigh_entry *neigh_lookup(struct tpa_worker *worker, struct tpa_ip *ip);
 int eth_lookup(struct tpa_worker *worker, struct tpa_ip *ip, struct rte_ether_hdr *eth);
 int get_neigh_cache_len(void);
@@ -6,6 +6,7 @@
 #ifndef _OFFLOAD_H_
 #define _OFFLOAD_H_
 
+#include <stdint.h>
 #include <sys/queue.h>
 
 #include <rte_flow.h>
@@ -19,20 +20,67 @@ struct offload {
 	TAILQ_ENTRY(offload) node;
 };
 
+struct offload_group;
+
 struct offload_list {
 	char *name;
 
 	TAILQ_HEAD(, offload) head;
+
+	/* set when the rules are programmed by the offload manager */
+	struct offload_group *group;
 };
 
 static inline void offload_list_init(struct offload_list *list)
 {
 	TAILQ_INIT(&list->head);
 	list->name = NULL;
+	list->group = NULL;
 }
 
+struct offload_stats {
+	uint64_t nr_submit;
+	uint64_t nr_apply;
+	uint64_t nr_apply_failure;
+	uint64_t nr_apply_retry;
+	uint64_t nr_release;
+	uint64_t nr_release_overflow;	/* the queue is full */
+	uint64_t nr_batch;
+	uint64_t nr_sync;		/* applied in place, as the queue is full */
+	uint64_t nr_cache_hit;
+	uint64_t nr_cache_evict;
+	uint64_t nr_cached;
+};
+
+extern struct offload_stats offload_stats;
+
+/*
+ * The rte_flow backend. The mock one records nothing but counts, with
+ * an optional delay per call to mimic the NIC cost, so that the offload
+ * path can be tested and benchmarked without a NIC.
+ */
+struct flow_ops {
+	struct rte_flow *(*create)(uint16_t port, const struct rte_flow_attr *attr,
+				   const struct rte_flow_item pattern[],
+				   const struct rte_flow_action actions[],
+				   struct rte_flow_error *error);
+	int (*destroy)(uint16_t port, struct rte_flow *flow, struct rte_flow_error *error);
+};
+
+struct flow_mock {
+	uint32_t delay_us;
+	uint32_t fail;			/* fail all creates when set */
+
+	uint64_t nr_flow;
+	uint64_t nr_create;
+	uint64_t nr_destroy;
+};
+
+extern struct flow_mock flow_mock;
+extern const struct flow_ops mock_flow_ops;
 
 int offload_init(void);
+int offload_async_init(void);
 
 int tsock_offload_create(struct tcp_sock *tsock);
 void tsock_offload_destroy(struct tcp_sock *tsock);
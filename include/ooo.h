@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _OOO_H_
+#define _OOO_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tcp.h"
+
+struct packet;
+
+/*
+ * The index of the out of order queue. The ooo pkts are still linked
+ * by the rcv_ooo_queue, sorted by seq; while adjacent pkts are merged
+ * into one run here, and the runs are kept in a seq sorted array:
+ *
+ * - locating a pkt is a binary search, instead of a list walk
+ * - the number of runs is the number of holes plus one, which is way
+ *   less than the number of pkts: the memmove is cheap
+ * - a run is exactly a SACK block
+ *
+ * Two runs are never adjacent: they are merged once the hole between
+ * them is filled.
+ */
+struct ooo_run {
+	uint32_t start;
+	uint32_t end;
+	struct packet *head;
+	struct packet *tail;
+};
+
+struct ooo_index {
+	uint32_t nr;
+	uint32_t size;
+	struct ooo_run *runs;
+};
+
+#define OOO_INDEX_SIZE_MIN	16
+
+/* returns the first run that ends at or after @seq */
+static inline uint32_t ooo_index_search(const struct ooo_index *idx, uint32_t seq)
+{
+	uint32_t lo = 0;
+	uint32_t hi = idx->nr;
+	uint32_t mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (seq_lt(idx->runs[mid].end, seq))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* makes sure there is room for one more run */
+static inline int ooo_index_reserve(struct ooo_index *idx)
+{
+	struct ooo_run *runs;
+	uint32_t size;
+
+	if (idx->nr < idx->size)
+		return 0;
+
+	size = idx->size ? idx->size * 2 : OOO_INDEX_SIZE_MIN;
+	runs = realloc(idx->runs, sizeof(struct ooo_run) * size);
+	if (!runs)
+		return -1;
+
+	idx->runs = runs;
+	idx->size = size;
+
+	return 0;
+}
+
+/* the caller has to make sure there is room, by ooo_index_reserve */
+static inline struct ooo_run *ooo_index_insert(struct ooo_index *idx, uint32_t i)
+{
+	memmove(&idx->runs[i + 1], &idx->runs[i], (idx->nr - i) * sizeof(struct ooo_run));
+	idx->nr += 1;
+
+	return &idx->runs[i];
+}
+
+static inline void ooo_index_remove(struct ooo_index *idx, uint32_t i)
+{
+	idx->nr -= 1;
+	memmove(&idx->runs[i], &idx->runs[i + 1], (idx->nr - i) * sizeof(struct ooo_run));
+}
+
+static inline void ooo_index_free(struct ooo_index *idx)
+{
+	free(idx->runs);
+	memset(idx, 0, sizeof(*idx));
+}
+
+#endif
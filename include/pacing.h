@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _PACING_H_
+#define _PACING_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "lib/utils.h"
+
+/*
+ * The pacing queue is a per-worker min-heap of socks, keyed by their
+ * next departure time in TSC. The timer wheel doesn't fit here: its
+ * tick (10us) is way coarser than the gap between two packets at line
+ * rate (say, 1.2us for a 1500B packet at 10Gbps).
+ *
+ * A node is queued at most once: node->idx records where it's at in
+ * the heap (starting from 1); 0 means it's not queued.
+ */
+struct pacing_node {
+	uint64_t tsc;		/* the earliest time the next packet could go */
+	uint32_t idx;
+};
+
+struct pacing_queue {
+	uint32_t nr;
+	uint32_t size;
+	struct pacing_node **heap;
+};
+
+#define pacing_node_is_queued(node)	((node)->idx != 0)
+
+static inline int pacing_queue_init(struct pacing_queue *pq, uint32_t size)
+{
+	pq->heap = malloc(sizeof(struct pacing_node *) * size);
+	if (!pq->heap)
+		return -1;
+
+	pq->nr = 0;
+	pq->size = size;
+
+	return 0;
+}
+
+static inline void pacing_queue_set(struct pacing_queue *pq, uint32_t i, struct pacing_node *node)
+{
+	pq->heap[i] = node;
+	node->idx = i + 1;
+}
+
+static inline void pacing_queue_sift_up(struct pacing_queue *pq, uint32_t i)
+{
+	struct pacing_node *node = pq->heap[i];
+	uint32_t parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (pq->heap[parent]->tsc <= node->tsc)
+			break;
+
+		pacing_queue_set(pq, i, pq->heap[parent]);
+		i = parent;
+	}
+
+	pacing_queue_set(pq, i, node);
+}
+
+static inline void pacing_queue_sift_down(struct pacing_queue *pq, uint32_t i)
+{
+	struct pacing_node *node = pq->heap[i];
+	uint32_t child;
+
+	while ((child = 2 * i + 1) < pq->nr) {
+		if (child + 1 < pq->nr && pq->heap[child + 1]->tsc < pq->heap[child]->tsc)
+			child += 1;
+
+		if (node->tsc <= pq->heap[child]->tsc)
+			break;
+
+		pacing_queue_set(pq, i, pq->heap[child]);
+		i = child;
+	}
+
+	pacing_queue_set(pq, i, node);
+}
+
+static inline int pacing_queue_push(struct pacing_queue *pq, struct pacing_node *node)
+{
+	struct pacing_node **heap;
+
+	if (pacing_node_is_queued(node)) {
+		pacing_queue_sift_up(pq, node->idx - 1);
+		pacing_queue_sift_down(pq, node->idx - 1);
+		return 0;
+	}
+
+	if (pq->nr == pq->size) {
+		heap = realloc(pq->heap, sizeof(struct pacing_node *) * pq->size * 2);
+		if (!heap)
+			return -1;
+
+		pq->heap = heap;
+		pq->size *= 2;
+	}
+
+	pq->heap[pq->nr] = node;
+	pq->nr += 1;
+	pacing_queue_sift_up(pq, pq->nr - 1);
+
+	return 0;
+}
+
+static inline void pacing_queue_remove(struct pacing_queue *pq, struct pacing_node *node)
+{
+	struct pacing_node *last;
+	uint32_t i = node->idx - 1;
+
+	if (!pacing_node_is_queued(node))
+		return;
+
+	pq->nr -= 1;
+	node->idx = 0;
+	if (i == pq->nr)
+		return;
+
+	/* fill the hole with the last one */
+	last = pq->heap[pq->nr];
+	pq->heap[i] = last;
+	pacing_queue_sift_up(pq, i);
+	pacing_queue_sift_down(pq, last->idx - 1);
+}
+
+/* pops the first node that is due by @now; NULL if none */
+static inline struct pacing_node *pacing_queue_pop_due(struct pacing_queue *pq, uint64_t now)
+{
+	struct pacing_node *node;
+
+	if (pq->nr == 0 || pq->heap[0]->tsc > now)
+		return NULL;
+
+	node = pq->heap[0];
+	pacing_queue_remove(pq, node);
+
+	return node;
+}
+
+#endif
@@ -6,6 +6,7 @@
 #ifndef _PACKET_H_
 #define _PACKET_H_
 
+#include <string.h>
 #include <sys/queue.h>
 
 #include <rte_mbuf.h>
@@ -29,6 +30,9 @@
 #define PKT_FLAG_IS_IPV6		(1u<<3)
 #define PKT_FLAG_VERIFY_CUT		(1u<<4)
 #define PKT_FLAG_STALE_NEIGH		(1u<<5)
+#define PKT_FLAG_ECN_CE			(1u<<6)
+#define PKT_FLAG_HAS_CSUM		(1u<<7)
+#define PKT_FLAG_STEERED		(1u<<8)
 
 struct packet {
 	struct rte_mbuf mbuf;
@@ -77,6 +81,7 @@ struct packet {
 	} __attribute__((packed)) tcp;
 
 	uint16_t port_id;
+	uint16_t csum;		/* the raw sum of the payload, with PKT_FLAG_HAS_CSUM */
 
 	union {
 		struct packet *tail;	/* for merge stage */
@@ -114,6 +119,17 @@ struct packet_pool {
 #define has_flag_ack(pkt)	((TCP_SEG(pkt)->flags & TCP_FLAG_ACK) != 0)
 #define has_flag_psh(pkt)	((TCP_SEG(pkt)->flags & TCP_FLAG_PSH) != 0)
 #define has_flag_fin(pkt)	((TCP_SEG(pkt)->flags & TCP_FLAG_FIN) != 0)
+#define has_flag_ece(pkt)	((TCP_SEG(pkt)->flags & TCP_FLAG_ECE) != 0)
+#define has_flag_cwr(pkt)	((TCP_SEG(pkt)->flags & TCP_FLAG_CWR) != 0)
+
+/* the ECN field (RFC 3168): the low 2 bits of IPv4 TOS and IPv6 traffic class */
+#define IP_ECN_NOT_ECT		0
+#define IP_ECN_ECT1		1
+#define IP_ECN_ECT0		2
+#define IP_ECN_CE		3
+#define IP_ECN_MASK		3
+
+#define IP6_ECN_SHIFT		20
 
 /*
  * note that it points to mbuf->mbuf_addr directly, instead of the addr with
@@ -213,6 +229,32 @@ static inline struct packet *packet_alloc(struct packet_pool *pool)
 	return pkt;
 }
 
+static inline int do_packet_alloc_bulk(struct rte_mempool *mempool,
+				       struct packet **pkts, int nr_pkt)
+{
+	int i;
+
+	if (unlikely(mempool == NULL))
+		return -1;
+
+	if (rte_pktmbuf_alloc_bulk(mempool, (struct rte_mbuf **)pkts, nr_pkt) < 0)
+		return -1;
+
+	for (i = 0; i < nr_pkt; i++)
+		packet_init(pkts[i]);
+
+	return 0;
+}
+
+/* all or nothing */
+static inline int packet_alloc_bulk(struct packet_pool *pool, struct packet **pkts, int nr_pkt)
+{
+	if (likely(do_packet_alloc_bulk(preferred_mempool(pool), pkts, nr_pkt) == 0))
+		return 0;
+
+	return do_packet_alloc_bulk(backup_mempool(pool), pkts, nr_pkt);
+}
+
 static inline void packet_free(struct packet *pkt)
 {
 	rte_pktmbuf_free(&pkt->mbuf);
@@ -226,6 +268,116 @@ static inline void packet_free_batch(struct packet **pkts, int nr_pkt)
 		packet_free(pkts[i]);
 }
 
+/*
+ * A per-worker mbuf cache over a packet pool: the tx path allocates a
+ * hdr mbuf, plus one zwrite mbuf per payload seg, for each pkt it sends.
+ * With the cache, they are got and put by an array index mostly; the
+ * mempool is touched in bulk only, on refill and flush. And it doesn't
+ * rely on the mempool per-lcore cache, which a worker thread may not
+ * have, as it's not necessarily an EAL lcore.
+ *
+ * The cache holds raw mbufs; they are reset at alloc.
+ */
+#define PACKET_CACHE_SIZE		128
+#define PACKET_CACHE_BATCH		(PACKET_CACHE_SIZE / 2)
+
+struct packet_cache {
+	struct packet_pool *pool;
+	struct rte_mempool *mempool;
+
+	uint32_t nr_pkt;
+	uint64_t nr_hit;
+	uint64_t nr_miss;
+
+	void *mbufs[PACKET_CACHE_SIZE];
+};
+
+static inline void packet_cache_init(struct packet_cache *cache, struct packet_pool *pool)
+{
+	memset(cache, 0, sizeof(*cache));
+
+	cache->pool = pool;
+	cache->mempool = packet_pool_get_mempool(pool);
+}
+
+static inline int packet_cache_refill(struct packet_cache *cache)
+{
+	if (unlikely(cache->mempool == NULL) ||
+	    cache->nr_pkt + PACKET_CACHE_BATCH > PACKET_CACHE_SIZE)
+		return -1;
+
+	if (rte_mempool_get_bulk(cache->mempool, &cache->mbufs[cache->nr_pkt],
+				 PACKET_CACHE_BATCH) < 0)
+		return -1;
+
+	cache->nr_pkt += PACKET_CACHE_BATCH;
+
+	return 0;
+}
+
+/* flushes the coldest half, which sits at the bottom, back to the mempool */
+static inline void packet_cache_flush(struct packet_cache *cache)
+{
+	rte_mempool_put_bulk(cache->mempool, cache->mbufs, PACKET_CACHE_BATCH);
+
+	cache->nr_pkt -= PACKET_CACHE_BATCH;
+	memmove(cache->mbufs, cache->mbufs + PACKET_CACHE_BATCH,
+		cache->nr_pkt * sizeof(cache->mbufs[0]));
+}
+
+static inline struct packet *packet_cache_pop(struct packet_cache *cache)
+{
+	struct packet *pkt = cache->mbufs[--cache->nr_pkt];
+
+	rte_pktmbuf_reset(&pkt->mbuf);
+	packet_init(pkt);
+
+	return pkt;
+}
+
+/* falls back to the pool (with the backup numa) when it can't refill */
+static inline struct packet *packet_cache_alloc(struct packet_cache *cache)
+{
+	if (unlikely(cache->nr_pkt == 0)) {
+		cache->nr_miss += 1;
+		if (packet_cache_refill(cache) < 0)
+			return packet_alloc(cache->pool);
+	} else {
+		cache->nr_hit += 1;
+	}
+
+	return packet_cache_pop(cache);
+}
+
+/* all or nothing */
+static inline int packet_cache_alloc_bulk(struct packet_cache *cache,
+					  struct packet **pkts, int nr_pkt)
+{
+	int i;
+
+	if (unlikely(cache->nr_pkt < nr_pkt)) {
+		cache->nr_miss += 1;
+		if (nr_pkt > PACKET_CACHE_BATCH || packet_cache_refill(cache) < 0)
+			return packet_alloc_bulk(cache->pool, pkts, nr_pkt);
+	} else {
+		cache->nr_hit += 1;
+	}
+
+	for (i = 0; i < nr_pkt; i++)
+		pkts[i] = packet_cache_pop(cache);
+
+	return 0;
+}
+
+/* @m is a raw mbuf (say, by rte_pktmbuf_prefree_seg) from the cache mempool */
+static inline void packet_cache_put(struct packet_cache *cache, struct rte_mbuf *m)
+{
+	if (unlikely(cache->nr_pkt == PACKET_CACHE_SIZE))
+		packet_cache_flush(cache);
+
+	cache->mbufs[cache->nr_pkt++] = m;
+}
+
 #define CUT_HEAD	1
 #define CUT_TAIL	0
 
@@ -346,6 +498,9 @@ static inline int parse_tcp_packet(struct packet *pkt)
 		if (unlikely(ip_is_frag(ip->fragment_offset)))
 			return -PKT_IP_FRAG;
 
+		if (unlikely((ip->type_of_service & IP_ECN_MASK) == IP_ECN_CE))
+			pkt->flags |= PKT_FLAG_ECN_CE;
+
 		csum_flags = PKT_RX_IP_CKSUM_GOOD | PKT_RX_L4_CKSUM_GOOD;
 		ip_payload_len = ntohs(ip->total_length) - IP4_HDR_LEN(ip);
 		pkt->l4_off = pkt->l3_off + IP4_HDR_LEN(ip);
@@ -356,6 +511,10 @@ static inline int parse_tcp_packet(struct packet *pkt)
 		if (unlikely(ip->proto != IPPROTO_TCP))
 			return -ERR_PKT_HAS_IPV6_OPT;
 
+		if (unlikely((ip->vtc_flow & htonl(IP_ECN_MASK << IP6_ECN_SHIFT)) ==
+			     htonl(IP_ECN_CE << IP6_ECN_SHIFT)))
+			pkt->flags |= PKT_FLAG_ECN_CE;
+
 		csum_flags = PKT_RX_L4_CKSUM_GOOD;
 		ip_payload_len = ntohs(ip->payload_len);
 		pkt->l4_off = pkt->l3_off + sizeof(struct rte_ipv6_hdr);
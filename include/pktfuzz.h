@@ -88,12 +88,25 @@ struct fuzz_delay_cfg {
 	} stats;
 };
 
+struct fuzz_ecn_cfg {
+	int enabled;
+	struct fuzz_rate rate;
+
+	struct fuzz_num count;	/* nr to mark in a row */
+	int nr_to_mark;
+
+	struct {
+		uint64_t marked;
+	} stats;
+};
+
 struct fuzz_cfg {
 	struct fuzz_drop_cfg		drop;
 	struct fuzz_reorder_cfg		reorder;
 	struct fuzz_cut_cfg		cut;
 	struct fuzz_dup_cfg		dup;
 	struct fuzz_delay_cfg		delay;
+	struct fuzz_ecn_cfg		ecn;
 };
 
 struct fuzz_opt {
@@ -203,6 +216,7 @@ extern const struct fuzzer fuzzer_cut;
 extern const struct fuzzer fuzzer_dup;
 extern const struct fuzzer fuzzer_delay;
 extern const struct fuzzer fuzzer_drop;
+extern const struct fuzzer fuzzer_ecn;
 
 extern int pktfuzz_enabled;
 extern struct fuzz_cfg fuzz_cfg;
@@ -35,6 +35,7 @@ struct port_block {
 
 int local_port_range_set(struct cfg_spec *spec, const char *val);
 int local_port_range_get(struct cfg_spec *spec, char *val);
+void port_alloc_range(uint16_t *min, uint16_t *max);
 void port_alloc_init(void);
 int port_block_offload_create(struct port_block *block);
 
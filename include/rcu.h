@@ -0,0 +1,71 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _RCU_H_
+#define _RCU_H_
+
+#include <stdint.h>
+#include <sys/queue.h>
+
+#include <rte_common.h>
+
+/*
+ * A minimal QSBR (quiescent state based reclamation) for read-mostly
+ * data shared among workers, such as the listen table.
+ *
+ * Readers access the protected data with neither lock nor atomic RMW.
+ * They just report a quiescent state (a point where they hold no
+ * reference to the protected data) from time to time: a worker does
+ * it at the beginning of each tpa_worker_run.
+ *
+ * Writers publish a new version with rcu_assign_pointer and retire the
+ * old one with rcu_call; the callback is invoked once all registered
+ * readers have reported a quiescent state since then.
+ */
+
+#define RCU_MAX_READER		512
+#define RCU_EPOCH_OFFLINE	UINT64_MAX
+
+struct rcu_reader {
+	uint64_t epoch;
+} __rte_cache_aligned;
+
+struct rcu_head;
+typedef void (*rcu_cb_t)(struct rcu_head *head);
+
+struct rcu_head {
+	TAILQ_ENTRY(rcu_head) node;
+	uint64_t epoch;
+	rcu_cb_t cb;
+};
+
+extern uint64_t rcu_epoch;
+
+#define rcu_dereference(p)		__atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+#define rcu_assign_pointer(p, v)	__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+static inline void rcu_quiescent(struct rcu_reader *reader)
+{
+	__atomic_store_n(&reader->epoch, __atomic_load_n(&rcu_epoch, __ATOMIC_ACQUIRE),
+			 __ATOMIC_RELEASE);
+}
+
+/*
+ * An offline reader never blocks reclamation. It must call
+ * rcu_quiescent before accessing any protected data again.
+ */
+static inline void rcu_offline(struct rcu_reader *reader)
+{
+	__atomic_store_n(&reader->epoch, RCU_EPOCH_OFFLINE, __ATOMIC_RELEASE);
+}
+
+int rcu_reader_register(struct rcu_reader *reader);
+void rcu_reader_unregister(struct rcu_reader *reader);
+
+void rcu_call(struct rcu_head *head, rcu_cb_t cb);
+int rcu_reclaim(void);
+void rcu_init(void);
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _SACK_H_
+#define _SACK_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "tcp.h"
+#include "tcp_queue.h"
+
+/*
+ * The SACK scoreboard: the seq ranges sacked by the peer so far, sorted
+ * and merged. Unlike the blocks of a single ACK (3 or 4 at most), it
+ * remembers all of them, which makes below cheap:
+ *
+ * - marking: only the ranges newly sacked are looked up in the txq
+ * - retrans: a sacked run is skipped at once, to the next hole
+ * - RTO: only the sacked ranges are cleared
+ *
+ * When it's full, the highest block is dropped and overflow is set.
+ * Note that the SACKED desc flag stays as the source of truth; the
+ * scoreboard is a hint only once it overflows, until it's reset.
+ */
+#define SACK_SCOREBOARD_SIZE	16
+
+struct sack_scoreboard {
+	uint16_t nr;
+	uint16_t overflow;
+	struct tcp_sack_block blks[SACK_SCOREBOARD_SIZE];
+};
+
+static inline void sack_scoreboard_reset(struct sack_scoreboard *sb)
+{
+	sb->nr = 0;
+	sb->overflow = 0;
+}
+
+/* returns the first block that ends at or after @seq */
+static inline int sack_scoreboard_search(const struct sack_scoreboard *sb, uint32_t seq)
+{
+	int lo = 0;
+	int hi = sb->nr;
+	int mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (seq_lt(sb->blks[mid].end, seq))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* returns the first seq at or after @seq that is not sacked */
+static inline uint32_t sack_scoreboard_next_hole(const struct sack_scoreboard *sb, uint32_t seq)
+{
+	int i = sack_scoreboard_search(sb, seq);
+
+	if (i < sb->nr && seq_le(sb->blks[i].start, seq))
+		return sb->blks[i].end;
+
+	return seq;
+}
+
+/*
+ * Adds [start, end) to the scoreboard. The sub-ranges that were not
+ * sacked before are stored at @news (SACK_SCOREBOARD_SIZE + 1 at most),
+ * and the block it's merged into is stored at @merged.
+ *
+ * Returns the number of new ranges.
+ */
+static inline int sack_scoreboard_add(struct sack_scoreboard *sb, uint32_t start, uint32_t end,
+				      struct tcp_sack_block *news, struct tcp_sack_block *merged)
+{
+	uint32_t seq = start;
+	int nr_new = 0;
+	int i;
+	int j;
+
+	i = sack_scoreboard_search(sb, start);
+	for (j = i; j < sb->nr && seq_le(sb->blks[j].start, end); j++) {
+		if (seq_lt(seq, sb->blks[j].start))
+			news[nr_new++] = (struct tcp_sack_block) { seq, sb->blks[j].start };
+		if (seq_gt(sb->blks[j].end, seq))
+			seq = sb->blks[j].end;
+	}
+	if (seq_lt(seq, end))
+		news[nr_new++] = (struct tcp_sack_block) { seq, end };
+
+	if (j > i) {
+		/* blocks [i, j) are merged into one */
+		if (seq_lt(sb->blks[i].start, start))
+			start = sb->blks[i].start;
+		if (seq_gt(sb->blks[j - 1].end, end))
+			end = sb->blks[j - 1].end;
+
+		memmove(&sb->blks[i + 1], &sb->blks[j],
+			(sb->nr - j) * sizeof(struct tcp_sack_block));
+		sb->nr -= j - i - 1;
+	} else {
+		if (sb->nr == SACK_SCOREBOARD_SIZE) {
+			sb->overflow = 1;
+			if (i == sb->nr)
+				goto out;
+
+			/* drop the highest one: it's the least urgent to retrans */
+			sb->nr -= 1;
+		}
+
+		memmove(&sb->blks[i + 1], &sb->blks[i],
+			(sb->nr - i) * sizeof(struct tcp_sack_block));
+		sb->nr += 1;
+	}
+
+	sb->blks[i].start = start;
+	sb->blks[i].end   = end;
+
+out:
+	merged->start = start;
+	merged->end   = end;
+
+	return nr_new;
+}
+
+/* drops what's been cumulatively acked */
+static inline void sack_scoreboard_cut(struct sack_scoreboard *sb, uint32_t una)
+{
+	int i = sack_scoreboard_search(sb, una);
+
+	if (i < sb->nr && sb->blks[i].end == una)
+		i += 1;
+
+	if (i > 0) {
+		memmove(&sb->blks[0], &sb->blks[i], (sb->nr - i) * sizeof(struct tcp_sack_block));
+		sb->nr -= i;
+	}
+
+	if (sb->nr && seq_lt(sb->blks[0].start, una))
+		sb->blks[0].start = una;
+}
+
+/*
+ * Returns the off (from @base) of the first desc that ends after @seq;
+ * it's the number of descs from @base when there is none.
+ */
+static inline uint16_t tcp_txq_search(struct tcp_txq *txq, uint16_t base, uint32_t seq)
+{
+	struct tx_desc *desc;
+	uint16_t lo = 0;
+	uint16_t hi = txq->write - base;
+	uint16_t mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		desc = txq->descs[(base + mid) & txq->mask];
+		if (seq_le(desc->seq + desc->len, seq))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+#endif
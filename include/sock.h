@@ -16,12 +16,48 @@
 #include "cfg.h"
 #include "ip.h"
 #include "sock_table.h"
+#include "steer.h"
 #include "offload.h"
 #include "flex_fifo.h"
 #include "trace.h"
+#include "tcp_cc.h"
+#include "pacing.h"
+#include "sack.h"
+#include "ooo.h"
 #include <tcp_queue.h>
 
 #define DEFAULT_NR_MAX_SOCK		32768
+/* supports upto 10 million socks as memory allows */
+#define NR_MAX_SOCK_LIMIT		(10ul << 20)
+
+/*
+ * Each worker caches some free sids in a magazine, so that sock alloc
+ * and free are O(1) and lockless in the common case. The magazine is a
+ * stack (LIFO): the sid freed last is allocated first, as its tsock is
+ * likely still cache hot.
+ *
+ * A full magazine flushes its bottom (coldest) half, in one batch, to
+ * the depot, a shared pool of such batches; it goes to the global free
+ * sid bitmap when the depot is full. An empty magazine is refilled by
+ * the latest batch in the depot first, then from the bitmap, and only
+ * when both are empty, the sock array is enlarged.
+ */
+#define SID_MAGAZINE_SIZE		64
+#define SID_MAGAZINE_BATCH		(SID_MAGAZINE_SIZE / 2)
+#define SID_DEPOT_SIZE			64	/* in batches */
+
+struct sid_magazine {
+	uint32_t nr_sid;
+	int sids[SID_MAGAZINE_SIZE];
+};
+
+/* protected by sock_ctrl->lock */
+struct sid_depot {
+	uint32_t nr_batch;
+	int batches[SID_DEPOT_SIZE][SID_MAGAZINE_BATCH];
+};
+
+extern struct sid_depot sid_depot;
 
 #define INVALID_SOCK_ID			UINT32_MAX
 #define TSOCK_SID_UNALLOCATED		-1
@@ -31,10 +67,17 @@
 #define TSOCK_RCV_OOO_LIMIT		2048
 
 #define TSOCK_RXQ_LEN_DEFAULT		2048
+#define TSOCK_RXQ_LEN_MAX		8192
 #define TSOCK_TXQ_LEN_DEFAULT		512
 
-/* XXX: a rough estamation */
-#define TSOCK_RCV_WND_DEFAULT(tsock)    ((tsock)->rxq.size * 1400)
+/*
+ * The bytes a rxq slot is good for at least: small pkts are coalesced
+ * into the last rxq pkt till it holds that many. See tsock_rcv_space.
+ */
+#define TSOCK_RCV_SLOT_BYTES		1400
+
+/* the rcv space is measured per rtt; it's used when there is no rtt sample */
+#define TSOCK_RCV_SPACE_RTT_DEFAULT	(10 * 1000)
 
 #define TSOCK_FLAG_FIN_NEEDED		TCP_FLAG_FIN
 #define TSOCK_FLAG_SYN_NEEDED		TCP_FLAG_SYN
@@ -50,6 +93,7 @@
 #define TSOCK_FLAG_ACK_NOW		(1ul<<16)
 #define TSOCK_FLAG_FIN_PENDING		(1ul<<17)
 #define TSOCK_FLAG_FIN_SENT		(1ul<<18)
+#define TSOCK_FLAG_DSACK		(1ul<<19)	/* dsack_block is to be reported */
 
 #define TSOCK_FLAG_CLOSE_PROCESSED	(1ul<<20)
 #define TSOCK_FLAG_EOF			(1ul<<21)
@@ -93,9 +137,42 @@ enum {
 	RTO,
 };
 
+/*
+ * Per-sock counters and verbose stats. They are not needed by the
+ * fast path as much as the tcp_sock fields; therefore, they are stored
+ * out of line, in the sock-stats mem file (indexed by sid).
+ */
+struct tsock_stats {
+	uint64_t stats_base[STATS_MAX];
+
+	struct vstats write_size;
+	struct vstats read_size;
+
+	struct {
+		struct vstats submit;
+		struct vstats drain;
+		struct vstats complete;
+		struct vstats last_write;
+	} read_lat;
+
+	struct {
+		struct vstats submit;
+		struct vstats xmit;
+		struct vstats complete;
+	} write_lat;
+
+	struct vstats ooo_recover_time;
+	struct hist rx_merge_size;	/* in segs */
+	struct vstats8_max rto_shift_max;
+} __rte_cache_aligned;
+
 struct tsock_trace;
 struct tpa_worker;
 struct tcp_sock {
+	/*
+	 * The first two cache lines hold the fields touched by the
+	 * per packet rx and tx path.
+	 */
 	int sid;               /* has to be first */
 
 	uint16_t state;
@@ -111,8 +188,12 @@ struct tcp_sock {
 	uint16_t passive_connection:1;
 	uint16_t listen_sock:1;
 	uint16_t closed_at_syn_rcvd:1;
-	uint16_t reserved:4;
+	uint16_t ecn_ok:1;
+	uint16_t ece_pending:1;	/* to set ECE on the ACKs */
+	uint16_t cwr_pending:1;	/* to set CWR on the next data seg */
+	uint16_t ce_state:1;	/* CE of the last data seg received */
 
+	uint32_t flags;
 	uint32_t data_seq_nxt; /* the next seq to be assigned for tcp write */
 	uint32_t snd_nxt;
 	uint32_t snd_una;
@@ -122,79 +203,114 @@ struct tcp_sock {
 	uint32_t snd_wl2;
 	uint32_t snd_ts;
 	uint32_t snd_cwnd;
-	uint32_t snd_cwnd_uncommited;
-	uint32_t snd_cwnd_orig;
-	uint64_t snd_cwnd_ts_us;
 	uint32_t snd_ssthresh;
 	uint16_t snd_mss;
 	uint8_t  snd_wscale;
-
 	uint8_t  rcv_wscale;
 	uint32_t rcv_nxt;
 	uint32_t rcv_wnd;
-	uint32_t sacked_bytes;
-
-	uint8_t  nr_sack_block;
-	uint16_t packet_id;
-	uint32_t flags;
-	struct eth_ip_hdr net_hdr;
-
-	uint16_t port_id;
-
-	uint16_t xmit_trace_ts;
-	uint32_t trace_size;
-	struct tsock_trace *trace;
-
-	struct tpa_ip remote_ip;
-	struct tpa_ip local_ip;
-	uint16_t remote_port;
-	uint16_t local_port;
-
-	uint32_t rcv_isn;
-	uint32_t snd_isn;
-	uint64_t init_ts_us;
-
-	uint8_t net_hdr_len;
-	int err;
 
+	/* 2nd cache line */
+	uint32_t ts_recent;
+	uint32_t last_ack_sent;
 	uint16_t nr_dupack;
 	uint8_t  retrans_stage;
 	uint8_t  rto_shift;
 	uint8_t  quickack;
+	uint8_t  nr_sack_block;
+	uint8_t  net_hdr_len;
 	uint8_t  close_issued;
-	struct vstats8_max rto_shift_max;
-	uint64_t rto_start_ts;
-
-	/* PAWS RFC 7323 5. */
-	uint32_t ts_recent;
-	uint32_t ts_recent_in_sec;
-	uint32_t last_ack_sent;
+	struct tcp_rxq rxq;
+	struct tcp_txq txq;
+	struct tpa_worker *worker;
 
-	uint32_t last_ack_sent_ts;
-	struct flex_fifo_node delayed_ack_node;
+	/* the rest: warm and cold fields */
+	struct tsock_stats *stats;
 
 	uint32_t rtt;
 	uint32_t srtt;
 	uint32_t rttvar;
 	uint32_t rto;
-	uint8_t  zero_wnd_probe_shift;
-	uint8_t  keepalive_shift;
 
+	uint32_t sacked_bytes;
+	uint32_t lost_bytes;	/* marked lost and not retransmitted yet */
+	uint32_t partial_ack;
+	uint32_t snd_cwnd_uncommited;
+	uint32_t snd_cwnd_orig;
+	uint32_t snd_cwr_seq;	/* no more cwnd reduction on ECE until it's acked */
+	uint64_t snd_cwnd_ts_us;
+	const struct tcp_cc_ops *cc;
+	uint64_t cc_priv[TCP_CC_PRIV_SIZE / sizeof(uint64_t)];
+
+	/* for delivery rate sampling; time is in us */
+	uint64_t delivered;		/* bytes acked or sacked so far */
+	uint64_t delivered_ts;		/* when delivered was last updated */
+	uint64_t first_tx_ts;		/* the send time of the last sampled desc */
+	uint64_t app_limited;		/* delivered at which app limited ends; 0 if not */
+	uint64_t delivery_rate;		/* the last sample, in bytes per sec */
+	uint64_t pacing_rate;		/* in bytes per sec, set by cc; 0 for not paced */
+	struct pacing_node pacing_node;	/* holds the next departure time */
+
+	/* RACK-TLP (RFC 8985); time is in us */
+	struct {
+		uint64_t xmit_ts;	/* the send time of the most recently sent desc delivered */
+		uint32_t end_seq;	/* and where it ends */
+		uint32_t rtt;		/* and its rtt */
+		uint32_t min_rtt;
+		uint32_t fack;		/* the highest seq delivered */
+		uint8_t  reordering_seen;
+		uint8_t  recovery;	/* the fast recovery is driven by RACK */
+		uint8_t  tlp_pending;	/* a probe is out, until tlp_high_seq is acked */
+		uint8_t  tlp_is_retrans;
+		uint32_t tlp_high_seq;
+	} rack;
+
+	uint16_t packet_id;
 	uint16_t nr_ooo_pkt;
+	uint32_t ts_recent_in_sec;
+	uint32_t last_ack_sent_ts;
 	uint32_t ooo_start_ts;
-	struct vstats ooo_recover_time;
 	struct packet *rx_merge_head;
-	struct vstats rx_merge_size;
-	struct tcp_rxq rxq;
+	uint32_t gro_ts;		/* when rx_merge_head is held by GRO */
 	struct packet *last_ooo_pkt;
 	struct packet_list rcv_ooo_queue;
+	struct ooo_index ooo_index;
+
+	/* for the rcv wnd auto tuning */
+	uint32_t rcv_space_bytes;	/* bytes read since rcv_space_ts */
+	uint64_t rcv_space_ts;
+
+	struct eth_ip_hdr net_hdr;
+	uint16_t port_id;
 
 	struct flex_fifo_node output_node;
-	struct tcp_txq txq;
-	uint32_t partial_ack;
+	struct flex_fifo_node delayed_ack_node;
+	struct flex_fifo_node gro_node;
+
+	struct {
+		uint32_t seq;
+		uint32_t ts_val;
+		uint16_t desc_base;
+	} retrans;
+
+	uint8_t  zero_wnd_probe_shift;
+	uint8_t  keepalive_shift;
+	uint16_t xmit_trace_ts;
+	uint32_t trace_size;
+	struct tsock_trace *trace;
+
+	struct tpa_ip remote_ip;
+	struct tpa_ip local_ip;
+	uint16_t remote_port;
+	uint16_t local_port;
+
+	uint32_t rcv_isn;
+	uint32_t snd_isn;
+	int err;
+	uint64_t init_ts_us;
+	uint64_t rto_start_ts;
 
 	struct offload_list offload_list;
-	struct tpa_worker *worker;
 
 	uint32_t interested_events;
 	uint32_t last_events;
@@ -204,33 +320,12 @@ struct tcp_sock {
 	struct timer timer_rto;
 	struct timer timer_wait;
 	struct timer timer_keepalive;
-
-	struct {
-		uint32_t seq;
-		uint32_t ts_val;
-		uint16_t desc_base;
-	} retrans;
+	struct timer timer_rack;	/* the RACK reorder timer */
+	struct timer timer_tlp;		/* the tail loss probe timer */
 
 	struct tpa_sock_opts_short opts;
 
 	uint64_t last_ts[LAST_TS_MAX];
-	uint64_t stats_base[STATS_MAX];
-
-	struct vstats write_size;
-	struct vstats read_size;
-
-	struct {
-		struct vstats submit;
-		struct vstats drain;
-		struct vstats complete;
-		struct vstats last_write;
-	} read_lat;
-
-	struct {
-		struct vstats submit;
-		struct vstats xmit;
-		struct vstats complete;
-	} write_lat;
 
 	/* for protecting the listen tsock trace only so far */
 	rte_spinlock_t lock;
@@ -238,6 +333,9 @@ struct tcp_sock {
 	struct flex_fifo_node accept_node;
 
 	struct tcp_sack_block sack_blocks[TCP_MAX_NR_SACK_BLOCK];
+	struct tcp_sack_block dsack_block;
+
+	struct sack_scoreboard sack_sb;
 
 	char reserved2[0];
 } __rte_cache_aligned;
@@ -248,11 +346,61 @@ static inline void tsock_reset_quickack(struct tcp_sock *tsock)
 	TSOCK_STATS_INC(tsock, WARN_QUICKACK_RESET);
 }
 
+/* RFC 2018: at most 3 sack blocks fit in the option space with TS */
+static inline int tsock_sack_block_max(const struct tcp_sock *tsock)
+{
+	return tsock->ts_ok ? TCP_MAX_NR_SACK_BLOCK - 1 : TCP_MAX_NR_SACK_BLOCK;
+}
+
+/* the number of sack blocks to send, with the D-SACK one included */
+static inline int tsock_nr_sack_to_send(const struct tcp_sock *tsock)
+{
+	return RTE_MIN(tsock->nr_sack_block + !!(tsock->flags & TSOCK_FLAG_DSACK), tsock_sack_block_max(tsock));
+}
+
 static inline void tsock_rearm_timer_rto(struct tcp_sock *tsock, uint64_t now)
 {
 	timer_start(&tsock->timer_rto, now, tsock->rto << tsock->rto_shift);
 }
 
+/*
+ * RFC 8985 7.2: arm the probe timeout (PTO) in about 2 srtt, so that a tail
+ * loss is recovered by a probe instead of an RTO. It's not armed if the RTO
+ * would fire before that.
+ */
+static inline void tsock_schedule_tlp(struct tcp_sock *tsock, uint64_t now)
+{
+	uint64_t rto_expire;
+	uint32_t pto;
+
+	if (!tsock->sack_ok || tsock->retrans_stage != NONE || tsock->rack.tlp_pending ||
+	    tsock->snd_una == tsock->snd_nxt || (tsock->flags & TSOCK_FLAG_FIN_SENT))
+		return;
+
+	if (tsock->srtt) {
+		pto = 2 * (tsock->srtt >> 3);
+
+		/* the ACK might be delayed if only one seg is in flight */
+		if (tsock->snd_nxt - tsock->snd_una <= tsock->snd_mss)
+			pto += tcp_cfg.delayed_ack;
+		pto = RTE_MAX(pto, (uint32_t)TCP_TLP_MIN);
+	} else {
+		pto = TCP_TLP_DEFAULT;
+	}
+
+	rto_expire = tsock->timer_rto.expire;
+	if (!timer_is_stopped(&tsock->timer_rto) && us_to_tick(now + pto) >= rto_expire)
+		return;
+
+	timer_start(&tsock->timer_tlp, now, pto);
+}
+
+/* tells whether (t1, seq1) is sent after (t2, seq2); seq breaks the tie */
+static inline int rack_sent_after(uint64_t t1, uint32_t seq1, uint64_t t2, uint32_t seq2)
+{
+	return t1 > t2 || (t1 == t2 && seq_gt(seq1, seq2));
+}
+
 static inline void tsock_rearm_timer_keepalive(struct tcp_sock *tsock, uint64_t now)
 {
 	tsock->keepalive_shift = 0;
@@ -305,6 +453,30 @@ static inline int init_net_hdr(struct eth_ip_hdr *hdr, struct rte_ether_hdr *eth
 	}
 }
 
+static inline void net_hdr_set_ecn(struct eth_ip_hdr *hdr, int is_ipv6, uint8_t ecn)
+{
+	if (!is_ipv6) {
+		hdr->ip4.type_of_service = (hdr->ip4.type_of_service & ~IP_ECN_MASK) | ecn;
+	} else {
+		hdr->ip6.vtc_flow = (hdr->ip6.vtc_flow & ~htonl(IP_ECN_MASK << IP6_ECN_SHIFT)) |
+				    htonl((uint32_t)ecn << IP6_ECN_SHIFT);
+	}
+}
+
+static inline uint8_t net_hdr_get_ecn(const struct eth_ip_hdr *hdr, int is_ipv6)
+{
+	if (!is_ipv6)
+		return hdr->ip4.type_of_service & IP_ECN_MASK;
+
+	return (ntohl(hdr->ip6.vtc_flow) >> IP6_ECN_SHIFT) & IP_ECN_MASK;
+}
+
+/* ECN is requested at SYN either by cfg, or by the cc that relies on it */
+static inline int tsock_ecn_wanted(const struct tcp_sock *tsock)
+{
+	return tcp_cfg.ecn || (tsock->cc->flags & TCP_CC_FLAG_NEEDS_ECN);
+}
+
 static inline void init_tpa_ip_from_pkt(struct packet *pkt, struct tpa_ip *src_ip,
 					   struct tpa_ip *dst_ip)
 {
@@ -358,11 +530,13 @@ struct sock_ctrl {
 	void *workers;
 
 	struct mem_file *mem_file;
+	struct mem_file *stats_mem_file;
 
 	struct tcp_sock socks[0] __rte_cache_aligned;
 };
 
 extern struct sock_ctrl *sock_ctrl;
+extern struct tsock_stats *tsock_stats;
 
 static inline struct tcp_sock *tsock_get_by_sid(int sid)
 {
@@ -399,6 +573,24 @@ static inline int parse_flow_mark(int wid, struct packet *pkt)
 	return sid;
 }
 
+/* prefetches the fast path part of the tsock */
+static inline void tsock_prefetch_by_sid(uint32_t sid)
+{
+	if (likely(sid < tcp_cfg.nr_max_sock)) {
+		rte_prefetch0(&sock_ctrl->socks[sid]);
+		rte_prefetch0((char *)&sock_ctrl->socks[sid] + RTE_CACHE_LINE_SIZE);
+	}
+}
+
+/* ditto, for the tsock the flow mark points to */
+static inline void tsock_prefetch(struct packet *pkt)
+{
+	if (unlikely((pkt->mbuf.ol_flags & PKT_RX_FDIR_ID) == 0))
+		return;
+
+	tsock_prefetch_by_sid(pkt->mbuf.hash.fdir.hi >> tpa_cfg.nr_worker_shift);
+}
+
 static inline int tuple_matches(struct tcp_sock *tsock, struct packet *pkt)
 {
 	struct tpa_ip src_ip;
@@ -456,8 +648,13 @@ static inline int tsock_lookup(struct tpa_worker *worker, int wid,
 	err = sid;
 	if (err == -WARN_MISSING_FLOW_MARK) {
 		err = tsock_lookup_slowpath(worker, pkt, tsock_ptr);
-		if (err == -ERR_NO_SOCK)
+		if (err == -ERR_NO_SOCK) {
+			/* it may belong to another worker: left to the caller to steer */
+			if (pkt_steerable(pkt))
+				return -WARN_MISSING_FLOW_MARK;
+
 			err = listen_tsock_lookup(pkt, tsock_ptr);
+		}
 	}
 
 	return err;
@@ -473,11 +670,13 @@ int tcp_connect(struct tcp_sock *tsock);
 void tsock_set_state(struct tcp_sock *tsock, int state);
 void tsock_remove_ooo_pkt(struct tcp_sock *tsock, struct packet *pkt);
 void tsock_drop_ooo_mbufs(struct tcp_sock *tsock);
+uint32_t tsock_rcv_space(struct tcp_sock *tsock);
 uint16_t calc_snd_mss(const struct tcp_sock *tsock, int has_ts,
 		      int passive, uint16_t nego_mss);
 
 uint32_t tcp_input(struct tpa_worker *worker, uint16_t port_id);
 int tcp_output(struct tpa_worker *worker);
+int tcp_gro_flush(struct tpa_worker *worker);
 void tcp_timeout(struct timer *timer);
 
 int xmit_syn(struct tpa_worker *worker, struct tcp_sock *tsock);
@@ -486,10 +685,14 @@ int xmit_flag_packet(struct tpa_worker *worker, struct tcp_sock *tsock);
 int xmit_rst_for_listen(struct tpa_worker *worker, struct tcp_sock *tsock, struct packet *pkt);
 void tcp_retrans(struct tpa_worker *worker, struct tcp_sock *tsock);
 void tcp_fast_retrans(struct tpa_worker *worker, struct tcp_sock *tsock, int budget);
+int tcp_xmit_tlp_probe(struct tpa_worker *worker, struct tcp_sock *tsock);
+void tcp_enter_fast_retrans(struct tpa_worker *worker, struct tcp_sock *tsock);
+void tcp_rack_detect_loss(struct tpa_worker *worker, struct tcp_sock *tsock);
 
 int tsock_write(struct tcp_sock *tsock, const void *buf, size_t size);
 ssize_t tsock_zreadv(struct tcp_sock *tsock, struct tpa_iovec *iov, int nr_iov);
 ssize_t tsock_zwritev(struct tcp_sock *tsock, const struct tpa_iovec *iov, int nr_iov);
+ssize_t tsock_zwritev_deferred(struct tcp_sock *tsock, const struct tpa_iovec *iov, int nr_iov);
 
 static inline int tsock_trace_is_enable(struct tcp_sock *tsock)
 {
@@ -7,8 +7,15 @@
 #define _SOCK_TABLE_H_
 
 #include <stdint.h>
-#include <sys/queue.h>
+#include <stdlib.h>
+#include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <rte_common.h>
+#include <rte_branch_prediction.h>
 #include <rte_spinlock.h>
 #include <rte_table_hash_func.h>
 
@@ -29,18 +36,45 @@ struct sock_key {
 struct sock_entry {
 	struct sock_key key;
 	struct tcp_sock *tsock;
-
-	TAILQ_ENTRY(sock_entry) node;
 };
 
-TAILQ_HEAD(sock_entry_list, sock_entry);
+/*
+ * The sock table is an open addressing hash table. Each bucket takes
+ * one cache line and holds SOCK_BUCKET_SIZE slots. A slot stores a
+ * 16 bit tag (derived from the hash; 0 means empty) and an index to
+ * the entry array, where the full key is stored. Lookup compares all
+ * tags of a bucket at once and touches the entry array only on a tag
+ * hit.
+ *
+ * On collision, we probe the next bucket (linearly). Each bucket keeps
+ * a count of entries that hash to it (or to a bucket before it) but are
+ * stored beyond it, so that a lookup miss normally stops at the very
+ * first bucket. Therefore, no tombstone is needed on delete.
+ *
+ * All entries are preallocated; the table is doubled when it's 3/4 full.
+ */
+#define SOCK_BUCKET_SIZE		8
+#define SOCK_TABLE_DEFAULT_SIZE		4096
 
-#define SOCK_TABLE_SIZE		4096
+struct sock_bucket {
+	uint16_t tags[SOCK_BUCKET_SIZE];
+	uint32_t idx[SOCK_BUCKET_SIZE];
+	uint32_t nr_overflow;
+} __rte_cache_aligned;
 
 struct sock_table {
 	rte_spinlock_t lock;
 
-	struct sock_entry_list lists[SOCK_TABLE_SIZE];
+	uint32_t nr_bucket;
+	uint32_t mask;
+	uint32_t nr_entry;
+	uint32_t max_entry;
+	uint32_t nr_free;
+	uint32_t nr_grow;
+
+	struct sock_bucket *buckets;
+	struct sock_entry *entries;
+	uint32_t *free_idx;
 };
 
 static inline void sock_key_init(struct sock_key *key,
@@ -61,77 +95,279 @@ static inline int sock_key_equal(struct sock_key *a, struct sock_key *b)
 	       a->port == b->port;
 }
 
-static inline uint32_t sock_hash_idx(struct sock_key *key)
+static inline uint32_t sock_hash(struct sock_key *key)
 {
-	uint64_t hash;
-
 	/* we ignore local ip here as it does not change */
-	hash = rte_crc32_u64(key->remote_ip.u64[0] | (uint64_t)key->local_port,
+	return rte_crc32_u64(key->remote_ip.u64[0] | (uint64_t)key->local_port,
 			     key->remote_ip.u64[1] | (uint64_t)key->remote_port);
+}
+
+/*
+ * The low bits of the hash pick the bucket; mix all bits for the tag
+ * so that it still differs among entries of the same bucket.
+ */
+static inline uint16_t sock_hash_tag(uint32_t hash)
+{
+	uint16_t tag = (uint16_t)(((uint64_t)hash * 0x9e3779b97f4a7c15ull) >> 48);
 
-	RTE_BUILD_BUG_ON((SOCK_TABLE_SIZE & (SOCK_TABLE_SIZE - 1)) != 0);
-	return hash & (SOCK_TABLE_SIZE - 1);
+	return tag ? tag : 1;
 }
 
-static inline struct tcp_sock *sock_table_lookup(struct sock_table *table, struct sock_key *key)
+/* returns a bitmask of the slots whose tag equals the given one */
+static inline uint32_t sock_bucket_match(struct sock_bucket *bucket, uint16_t tag)
+{
+#ifdef __SSE2__
+	__m128i tags = _mm_load_si128((const __m128i *)bucket->tags);
+	__m128i cmp  = _mm_cmpeq_epi16(tags, _mm_set1_epi16(tag));
+
+	return _mm_movemask_epi8(_mm_packs_epi16(cmp, _mm_setzero_si128()));
+#else
+	uint32_t mask = 0;
+	int i;
+
+	for (i = 0; i < SOCK_BUCKET_SIZE; i++) {
+		if (bucket->tags[i] == tag)
+			mask |= 1u << i;
+	}
+
+	return mask;
+#endif
+}
+
+static inline struct sock_entry *sock_table_find(struct sock_table *table, struct sock_key *key,
+						 uint32_t hash, uint32_t *bucket_idx, int *slot)
 {
-	struct sock_entry_list *list = &table->lists[sock_hash_idx(key)];
+	uint16_t tag = sock_hash_tag(hash);
+	uint32_t idx = hash & table->mask;
+	struct sock_bucket *bucket;
 	struct sock_entry *entry;
+	uint32_t hits;
+	int i;
+
+	while (1) {
+		bucket = &table->buckets[idx];
 
-	TAILQ_FOREACH(entry, list, node) {
-		if (sock_key_equal(&entry->key, key))
-			return entry->tsock;
+		hits = sock_bucket_match(bucket, tag);
+		while (hits) {
+			i = __builtin_ctz(hits);
+			entry = &table->entries[bucket->idx[i]];
+			if (likely(sock_key_equal(&entry->key, key))) {
+				*bucket_idx = idx;
+				*slot = i;
+				return entry;
+			}
+
+			hits &= hits - 1;
+		}
+
+		if (likely(bucket->nr_overflow == 0))
+			return NULL;
+
+		idx = (idx + 1) & table->mask;
 	}
+}
+
+static inline struct tcp_sock *sock_table_lookup(struct sock_table *table, struct sock_key *key)
+{
+	struct sock_entry *entry;
+	uint32_t bucket_idx;
+	int slot;
+
+	entry = sock_table_find(table, key, sock_hash(key), &bucket_idx, &slot);
+	if (entry)
+		return entry->tsock;
 
 	return NULL;
 }
 
+static inline void sock_table_insert(struct sock_bucket *buckets, uint32_t mask,
+				     uint32_t hash, uint32_t entry_idx)
+{
+	uint32_t idx = hash & mask;
+	struct sock_bucket *bucket;
+	uint32_t empty;
+	int i;
+
+	while (1) {
+		bucket = &buckets[idx];
+
+		empty = sock_bucket_match(bucket, 0);
+		if (empty) {
+			i = __builtin_ctz(empty);
+			bucket->tags[i] = sock_hash_tag(hash);
+			bucket->idx[i] = entry_idx;
+			return;
+		}
+
+		bucket->nr_overflow += 1;
+		idx = (idx + 1) & mask;
+	}
+}
+
+static inline int sock_table_alloc(struct sock_table *table, uint32_t nr_bucket)
+{
+	struct sock_bucket *buckets;
+	struct sock_entry *entries;
+	uint32_t *free_idx;
+	uint32_t max_entry;
+	uint32_t i;
+
+	max_entry = nr_bucket * SOCK_BUCKET_SIZE / 4 * 3;
+
+	if (posix_memalign((void **)&buckets, RTE_CACHE_LINE_SIZE,
+			   nr_bucket * sizeof(struct sock_bucket)) != 0)
+		return -1;
+	memset(buckets, 0, nr_bucket * sizeof(struct sock_bucket));
+
+	/* entries are addressed by index; realloc keeps them valid */
+	entries = realloc(table->entries, max_entry * sizeof(struct sock_entry));
+	if (!entries)
+		goto err;
+	table->entries = entries;
+
+	free_idx = realloc(table->free_idx, max_entry * sizeof(uint32_t));
+	if (!free_idx)
+		goto err;
+	table->free_idx = free_idx;
+
+	/* rehash the existing entries, if any */
+	for (i = 0; i < table->nr_bucket * SOCK_BUCKET_SIZE; i++) {
+		struct sock_bucket *bucket = &table->buckets[i / SOCK_BUCKET_SIZE];
+		int slot = i % SOCK_BUCKET_SIZE;
+
+		if (bucket->tags[slot] == 0)
+			continue;
+
+		sock_table_insert(buckets, nr_bucket - 1,
+				  sock_hash(&entries[bucket->idx[slot]].key), bucket->idx[slot]);
+	}
+
+	/* push the newly available entries in reverse order, so that low idx goes first */
+	for (i = max_entry; i > table->max_entry; i--)
+		table->free_idx[table->nr_free++] = i - 1;
+
+	free(table->buckets);
+	table->buckets   = buckets;
+	table->nr_bucket = nr_bucket;
+	table->mask      = nr_bucket - 1;
+	table->max_entry = max_entry;
+
+	return 0;
+
+err:
+	free(buckets);
+	return -1;
+}
+
+static inline int sock_table_grow(struct sock_table *table)
+{
+	if (sock_table_alloc(table, table->nr_bucket * 2) < 0)
+		return -1;
+
+	table->nr_grow += 1;
+	return 0;
+}
+
 static inline int sock_table_add(struct sock_table *table, struct sock_key *key, struct tcp_sock *tsock)
 {
-	struct sock_entry_list *list = &table->lists[sock_hash_idx(key)];
 	struct sock_entry *entry;
+	uint32_t bucket_idx;
+	uint32_t entry_idx;
+	uint32_t hash;
+	int slot;
 
-	if (sock_table_lookup(table, key))
+	hash = sock_hash(key);
+	if (sock_table_find(table, key, hash, &bucket_idx, &slot))
 		return -1;
 
-	entry = malloc(sizeof(struct sock_entry));
-	if (!entry)
-		return -1;
+	if (unlikely(table->nr_entry >= table->max_entry)) {
+		if (sock_table_grow(table) < 0)
+			return -1;
+	}
 
+	entry_idx = table->free_idx[--table->nr_free];
+	entry = &table->entries[entry_idx];
 	entry->key = *key;
 	entry->tsock = tsock;
-	TAILQ_INSERT_TAIL(list, entry, node);
+
+	sock_table_insert(table->buckets, table->mask, hash, entry_idx);
+	table->nr_entry += 1;
 
 	return 0;
 }
 
 static inline int sock_table_del(struct sock_table *table, struct sock_key *key)
 {
-	struct sock_entry_list *list = &table->lists[sock_hash_idx(key)];
-	struct sock_entry *entry;
+	struct sock_bucket *bucket;
+	uint32_t bucket_idx;
+	uint32_t hash;
+	uint32_t idx;
+	int slot;
+
+	hash = sock_hash(key);
+	if (!sock_table_find(table, key, hash, &bucket_idx, &slot))
+		return -1;
 
-	TAILQ_FOREACH(entry, list, node) {
-		if (sock_key_equal(&entry->key, key)) {
-			TAILQ_REMOVE(list, entry, node);
-			free(entry);
+	bucket = &table->buckets[bucket_idx];
+	table->free_idx[table->nr_free++] = bucket->idx[slot];
+	bucket->tags[slot] = 0;
+	table->nr_entry -= 1;
 
-			return 0;
-		}
-	}
+	/* undo the overflow accounting made at insert */
+	for (idx = hash & table->mask; idx != bucket_idx; idx = (idx + 1) & table->mask)
+		table->buckets[idx].nr_overflow -= 1;
 
-	return -1;
+	return 0;
 }
 
-static inline void sock_table_init(struct sock_table *table)
+/*
+ * The size is a hint of the number of entries expected; the table
+ * grows on demand anyway.
+ */
+static inline int sock_table_init_with_size(struct sock_table *table, uint32_t size)
 {
-	int i;
+	uint32_t nr_bucket = 1;
 
+	memset(table, 0, sizeof(*table));
 	rte_spinlock_init(&table->lock);
 
-	for (i = 0; i < SOCK_TABLE_SIZE; i++)
-		TAILQ_INIT(&table->lists[i]);
+	while (nr_bucket * SOCK_BUCKET_SIZE / 4 * 3 < size)
+		nr_bucket <<= 1;
+
+	return sock_table_alloc(table, nr_bucket);
+}
+
+static inline int sock_table_init(struct sock_table *table)
+{
+	return sock_table_init_with_size(table, SOCK_TABLE_DEFAULT_SIZE);
 }
 
+static inline void sock_table_destroy(struct sock_table *table)
+{
+	free(table->buckets);
+	free(table->entries);
+	free(table->free_idx);
+
+	memset(table, 0, sizeof(*table));
+}
+
+static inline struct sock_entry *sock_table_slot_entry(struct sock_table *table, uint32_t i)
+{
+	struct sock_bucket *bucket = &table->buckets[i / SOCK_BUCKET_SIZE];
+	int slot = i % SOCK_BUCKET_SIZE;
+
+	if (bucket->tags[slot] == 0)
+		return NULL;
+
+	return &table->entries[bucket->idx[slot]];
+}
+
+#define sock_table_nr_slot(table)	((table)->nr_bucket * SOCK_BUCKET_SIZE)
+
+#define SOCK_TABLE_FOREACH(table, i, entry)				\
+	for ((i) = 0; (i) < sock_table_nr_slot(table); (i)++)		\
+		if (((entry) = sock_table_slot_entry((table), (i))) != NULL)
+
 /*
  * here goes the lock version
  */
@@ -6,6 +6,7 @@
 #ifndef _STATS_H_
 #define _STATS_H_
 
+#include <stdio.h>
 #include <stdint.h>
 
 #include "lib/utils.h"
@@ -30,9 +31,9 @@ static inline int stats_code_check(int stats)
 	(base)[stats_code_check(stats)] += n;		\
 } while (0)
 
-#define TSOCK_STATS_INC(tsock, stats)		STATS_ADD((tsock)->stats_base, stats, 1)
-#define TSOCK_STATS_ADD(tsock, stats, n)	STATS_ADD((tsock)->stats_base, stats, n)
-#define TSOCK_STATS_DEC(tsock, stats, n)	STATS_ADD((tsock)->stats_base, stats, -n)
+#define TSOCK_STATS_INC(tsock, stats)		STATS_ADD((tsock)->stats->stats_base, stats, 1)
+#define TSOCK_STATS_ADD(tsock, stats, n)	STATS_ADD((tsock)->stats->stats_base, stats, n)
+#define TSOCK_STATS_DEC(tsock, stats, n)	STATS_ADD((tsock)->stats->stats_base, stats, -n)
 
 #define WORKER_STATS_INC(worker, stats)		STATS_ADD((worker)->stats_base, stats, 1)
 #define WORKER_STATS_ADD(worker, stats, n)	STATS_ADD((worker)->stats_base, stats, n)
@@ -60,9 +61,9 @@ static inline int stats_code_check(int stats)
 	__sync_fetch_and_add_8(&(base)[stats_code_check(stats)], n);	\
 } while (0)
 
-#define TSOCK_STATS_INC_ATOMIC(tsock, stats)		STATS_ADD_ATOMIC((tsock)->stats_base, stats, 1)
-#define TSOCK_STATS_ADD_ATOMIC(tsock, stats, n)		STATS_ADD_ATOMIC((tsock)->stats_base, stats, n)
-#define TSOCK_STATS_DEC_ATOMIC(tsock, stats, n)		STATS_ADD_ATOMIC((tsock)->stats_base, stats, -n)
+#define TSOCK_STATS_INC_ATOMIC(tsock, stats)		STATS_ADD_ATOMIC((tsock)->stats->stats_base, stats, 1)
+#define TSOCK_STATS_ADD_ATOMIC(tsock, stats, n)		STATS_ADD_ATOMIC((tsock)->stats->stats_base, stats, n)
+#define TSOCK_STATS_DEC_ATOMIC(tsock, stats, n)		STATS_ADD_ATOMIC((tsock)->stats->stats_base, stats, -n)
 
 #define WORKER_STATS_INC_ATOMIC(worker, stats)		STATS_ADD_ATOMIC((worker)->stats_base, stats, 1)
 #define WORKER_STATS_ADD_ATOMIC(worker, stats, n)	STATS_ADD_ATOMIC((worker)->stats_base, stats, n)
@@ -154,6 +155,49 @@ static inline uint8_t vstats8_max_get(struct vstats8_max *vstats)
 	return vstats->max;
 }
 
+/*
+ * A log2 histogram: bucket i counts the values in [2^i, 2^(i+1)),
+ * and the last bucket counts all the larger ones as well.
+ */
+#define HIST_NR_BUCKET		8
+
+struct hist {
+	uint8_t  reset_seq;
+	uint32_t buckets[HIST_NR_BUCKET];
+};
+
+static inline void hist_add(struct hist *hist, uint32_t val)
+{
+	int i = 0;
+
+	if (hist->reset_seq != vstats_reset_seq) {
+		memset(hist->buckets, 0, sizeof(hist->buckets));
+		hist->reset_seq = vstats_reset_seq;
+	}
+
+	if (val)
+		i = 31 - __builtin_clz(val);
+	if (i >= HIST_NR_BUCKET)
+		i = HIST_NR_BUCKET - 1;
+
+	hist->buckets[i] += 1;
+}
+
+/* formats it like "1:n 2:n 4:n ...", by the lower bound of each bucket */
+static inline char *hist_fmt(const struct hist *hist, char *buf, int size)
+{
+	int len = 0;
+	int i;
+
+	buf[0] = '\0';
+	for (i = 0; i < HIST_NR_BUCKET && len < size; i++) {
+		len += snprintf(buf + len, size - len, "%s%u:%u",
+				i ? " " : "", 1u << i, hist->buckets[i]);
+	}
+
+	return buf;
+}
+
 const char *stats_name(int stats);
 const char *stats_desc(int stats);
 
@@ -29,6 +29,7 @@ STATS(ERR_TCP_RXQ_ENQUEUE_FAIL,   "tcp rxq is full")
 STATS(ERR_TCP_RCV_INVALID_STATE,  "invalid tcp state on receiving data")
 STATS(ERR_TCP_RCV_OOO_LIMIT,  "too many out of order packets received")
 STATS(ERR_TCP_RCV_OOO_DUP,  "out of order duplicated packets received")
+STATS(ERR_TCP_RCV_OOO_NO_MEM,  "failed to grow the out of order index")
 STATS(ERR_INVALID_STATE_FOR_FIN, "got a FIN pkt while the state is invalid")
 
 STATS(WARN_HALF_OPEN_DETECTED, "number of half open status detected")
@@ -68,6 +69,9 @@ STATS(PKT_RECV_AFTER_CLOSE, "packets received after close")
 
 STATS(PKT_XMIT,   "packets transmitted")
 STATS(BYTE_XMIT,  "bytes transmitted")
+STATS(PKT_XMIT_GSO,      "super segments split by the software GSO")
+STATS(PKT_XMIT_GSO_SEG,  "segments produced by the software GSO")
+STATS(PKT_XMIT_SW_CSUM,  "packets checksummed in software")
 
 STATS(BYTE_FAST_RE_XMIT,    "bytes retransmitted triggered by fast retransmit")
 STATS(BYTE_RE_XMIT,         "bytes retransmitted, with fast retrans included")
@@ -88,6 +92,21 @@ STATS(FIN_XMIT, "FIN packets transmitted")
 STATS(RST_XMIT, "RST packets transmitted")
 STATS(SIMULTANEOUS_CONNECT, "simultaneous connect")
 
+STATS(ECN_CE_RCV,      "data packets received with CE marked")
+STATS(ECN_CWND_REDUCE, "number of times cwnd is reduced on ECE")
+
+STATS(PACING_DEFER,      "number of times a sock is deferred by pacing")
+STATS(PKT_PACED,         "packets transmitted with pacing")
+STATS(ERR_PACING_ENQUEUE, "number of times we failed to enqueue a sock to the pacing queue")
+
+STATS(RACK_LOST,    "number of descs marked lost by RACK")
+STATS(TLP_PROBE,    "number of tail loss probes sent")
+STATS(TLP_RECOVERY, "number of tail losses repaired by the loss probe")
+STATS(TLP_SPURIOUS, "number of loss probes found unnecessary by D-SACK")
+
+STATS(DSACK_SENT,   "number of D-SACK blocks reported for duplicate data")
+STATS(DSACK_RCV,    "number of D-SACK blocks received")
+
 STATS(WRITE_EAGAIN, "number of times EAGAIN returned in write path")
 STATS(READ_EAGAIN,  "number of times EAGAIN returned in read path")
 
@@ -115,6 +134,10 @@ STATS(ERR_PKT_HAS_IPV6_OPT, "number of pkts have ipv6 options")
 
 STATS(ZERO_WND_PROBE, "number of zero wnd probe sent")
 STATS(WND_UPDATE, "number of wnd update")
+STATS(RCV_WND_HELD, "number of times the rcv wnd is not reopened at read as the rxq is short of room")
+STATS(RXQ_GROW, "number of times the rxq is grown by the rcv wnd auto tuning")
+STATS(RXQ_SHRINK, "number of times the rxq is shrunk due to the mbuf pressure")
+STATS(RXQ_COALESCE, "number of small pkts coalesced into the last rxq pkt")
 
 STATS(SOCK_OFFLOAD_FAILURE, "failed to offload a connection")
 
@@ -133,3 +156,11 @@ STATS(PORT_BLOCK_OFFLOAD_FAILURE, "failed to offload a port block")
 
 STATS(OOO_MBUF_DROPPED, "number of out of order mbuf segments dropped")
 STATS(ERR_TCP_SACK_INTERSECT, "number of tcp sack opts that have sack intersection")
+
+STATS(WORKER_SLEEP,       "number of times the worker sleeps in tpa_worker_wait")
+STATS(WORKER_WAKEUP_KICK, "number of times a sleeping worker is woken up by other threads")
+STATS(WORKER_WAKEUP_RX,   "number of times a sleeping worker is woken up by rx interrupts")
+
+STATS(PKT_STEER,          "pkts without flow mark forwarded to the owner worker")
+STATS(PKT_STEER_RECV,     "pkts forwarded from other workers")
+STATS(ERR_PKT_STEER_DROP, "pkts dropped as the steer ring or the dev rxq is full")
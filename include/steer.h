@@ -0,0 +1,72 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _STEER_H_
+#define _STEER_H_
+
+#include <stdint.h>
+
+#include <rte_ring.h>
+
+#include "cfg.h"
+#include "packet.h"
+#include "ip.h"
+#include "sock_table.h"
+
+/*
+ * Software flow steering, for the pkts without a flow mark that land
+ * on a worker other than the owner: say, on a NIC with plain RSS, or
+ * before the flow rule is programmed.
+ *
+ * The owner is found from the steer index, a shared tuple to tsock
+ * table for all active socks. The pkts are then forwarded in batches
+ * through a SPSC ring per worker pair, and the owner picks them up
+ * to its own dev rxq before the next tcp_input.
+ */
+#define STEER_RING_SIZE		1024
+
+struct tpa_worker;
+
+struct steer_buf {
+	uint32_t nr_pkt;
+	struct packet *pkts[BATCH_SIZE];
+};
+
+struct steer_ctrl {
+	uint32_t enable;		/* offload.sw_steering */
+	uint32_t active;		/* enabled, and more than one worker */
+
+	struct sock_table index;	/* protected by index.lock */
+
+	struct rte_ring **rings;	/* [src * nr_worker + dst] */
+};
+
+extern struct steer_ctrl steer_ctrl;
+
+static inline struct rte_ring *steer_ring(uint32_t src, uint32_t dst)
+{
+	return steer_ctrl.rings[src * tpa_cfg.nr_worker + dst];
+}
+
+/*
+ * A pkt is steered at most once; a pure SYN goes to the listen sock
+ * of the worker it lands on.
+ */
+static inline int pkt_steerable(struct packet *pkt)
+{
+	if (!steer_ctrl.active || (pkt->flags & PKT_FLAG_STEERED))
+		return 0;
+
+	return !has_flag_syn(pkt) || has_flag_ack(pkt);
+}
+
+int steer_init(void);
+void steer_index_add(struct sock_key *key, struct tcp_sock *tsock);
+void steer_index_del(struct sock_key *key);
+uint32_t steer_pkts(struct tpa_worker *worker, struct packet **pkts, uint32_t nr_pkt);
+uint32_t steer_recv(struct tpa_worker *worker);
+int steer_pending(struct tpa_worker *worker);
+
+#endif
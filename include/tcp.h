@@ -33,6 +33,10 @@
 #define TCP_KEEPALIVE_DEFAULT		TCP_RTO_MAX
 #define TCP_KEEPALIVE_MIN		(500 * 1000)        /* 500ms */
 #define TCP_DELAYED_ACK_DEFAULT		(1   * 1000)
+#define TCP_GRO_TIMEOUT_DEFAULT		20		    /* us; a few rx bursts, far below delayed ack */
+#define TCP_GRO_TIMEOUT_MAX		TCP_DELAYED_ACK_DEFAULT
+#define TCP_TLP_MIN			(2   * 1000)
+#define TCP_TLP_DEFAULT			(1000 * 1000)	    /* 1s, when there is no rtt sample */
 
 #define TCP_RTT_MAX			(400 * 1000)
 
@@ -70,6 +74,8 @@ enum {
 #define TCP_FLAG_PSH		(1 << 3)
 #define TCP_FLAG_ACK		(1 << 4)
 #define TCP_FLAG_URG		(1 << 5)
+#define TCP_FLAG_ECE		(1 << 6)
+#define TCP_FLAG_CWR		(1 << 7)
 
 static inline int seq_lt(uint32_t a, uint32_t b)
 {
@@ -144,7 +150,11 @@ struct tcp_opt {
 	};
 } __attribute__((__packed__));
 
-#define TCP_MAX_NR_SACK_BLOCK	3
+/*
+ * 4 blocks fit in the 40 bytes option space; it's 3 when TS is also
+ * there. See tsock_sack_block_max.
+ */
+#define TCP_MAX_NR_SACK_BLOCK	4
 
 struct tcp_sack_block {
 	uint32_t start;
@@ -191,10 +201,12 @@ struct tcp_cfg {
 	uint32_t enable_sack;
 	uint32_t enable_rx_merge;
 	uint32_t rcv_queue_size;
+	uint32_t rcv_queue_size_max;
 	uint32_t snd_queue_size;
 	uint32_t time_wait;
 	uint32_t keepalive;
 	uint32_t delayed_ack;
+	uint32_t gro_timeout;
 	uint32_t cwnd_init;
 	uint32_t cwnd_max;
 	uint32_t drop_ooo_threshold;
@@ -207,6 +219,8 @@ struct tcp_cfg {
 	uint32_t retries;
 	uint32_t syn_retries;
 	uint32_t write_chunk_size;
+	uint32_t ecn;
+	uint32_t pacing;
 };
 
 extern struct tcp_cfg tcp_cfg;
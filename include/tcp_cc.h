@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#ifndef _TCP_CC_H_
+#define _TCP_CC_H_
+
+#include <stdint.h>
+
+#include "cfg.h"
+
+#define TCP_CC_NAME_SIZE	16
+
+/* the per sock private space for the congestion control algorithm */
+#define TCP_CC_PRIV_SIZE	64
+
+/* the cc requires ECN; it's requested at SYN even if tcp.ecn is off */
+#define TCP_CC_FLAG_NEEDS_ECN		(1u << 0)
+
+/*
+ * Echo the CE state of each data seg (RFC 8257 3.2), instead of
+ * latching ECE until CWR is received (RFC 3168).
+ */
+#define TCP_CC_FLAG_ECN_ECHO_CE		(1u << 1)
+
+struct tcp_sock;
+
+/*
+ * A delivery rate sample, generated at each ack that delivers new data
+ * (draft-cheng-iccrg-delivery-rate-estimation).
+ */
+struct tcp_rate_sample {
+	uint64_t prior_delivered;	/* tsock->delivered when the desc was sent */
+	uint64_t prior_ts;		/* and the time it was delivered; 0 for no sample */
+	uint32_t send_elapsed;		/* in us */
+	uint32_t interval_us;		/* 0 for an invalid sample */
+	uint32_t delivered;		/* bytes delivered during interval_us */
+	uint32_t acked_sacked;		/* bytes newly delivered by this ack */
+	uint32_t rtt_us;		/* 0 if no valid rtt sample */
+	uint8_t  is_app_limited;
+	uint8_t  is_retrans;
+};
+
+/*
+ * The congestion control interface. The hooks just tell the new cwnd
+ * or ssthresh to go with; it's the tcp core that applies them. Time is
+ * given in us.
+ */
+struct tcp_cc_ops {
+	const char *name;
+	uint32_t flags;
+
+	/* invoked when the connection is established; optional */
+	void (*init)(struct tcp_sock *tsock, uint64_t now);
+
+	/*
+	 * Invoked at each rtt interval with the bytes acked during it,
+	 * when we are cwnd limited. Returns the new cwnd.
+	 */
+	uint32_t (*on_ack)(struct tcp_sock *tsock, uint32_t acked, uint64_t now);
+
+	/*
+	 * Invoked at each ack that delivers new data, with the rate sample,
+	 * unless we are in fast recovery. It takes the place of on_ack,
+	 * returning the new cwnd. The cc may also set tsock->pacing_rate
+	 * here. Optional.
+	 */
+	uint32_t (*cong_control)(struct tcp_sock *tsock, const struct tcp_rate_sample *rs,
+				 uint64_t now);
+
+	/*
+	 * Invoked at each ack that advances snd_una, with @ece telling
+	 * whether it echoes congestion experienced; optional.
+	 */
+	void (*in_ack)(struct tcp_sock *tsock, uint32_t acked, int ece, uint64_t now);
+
+	/*
+	 * Invoked at ECE, once per window at most; returns the new ssthresh,
+	 * which is also the new cwnd. Optional; on_loss is used if not set.
+	 */
+	uint32_t (*on_ecn)(struct tcp_sock *tsock, uint64_t now);
+
+	/* invoked at entering fast recovery; returns the new ssthresh */
+	uint32_t (*on_loss)(struct tcp_sock *tsock, uint64_t now);
+
+	/* invoked at RTO timeout; returns the new ssthresh */
+	uint32_t (*on_rto)(struct tcp_sock *tsock, uint64_t now);
+
+	/* invoked when fast recovery is done; returns the new cwnd */
+	uint32_t (*on_recovery_exit)(struct tcp_sock *tsock, uint64_t now);
+};
+
+extern const struct tcp_cc_ops tcp_cc_reno;
+extern const struct tcp_cc_ops tcp_cc_cubic;
+extern const struct tcp_cc_ops tcp_cc_dctcp;
+extern const struct tcp_cc_ops tcp_cc_bbr;
+extern const struct tcp_cc_ops *tcp_cc_default;
+
+#define TSOCK_CC_PRIV(tsock)		((void *)(tsock)->cc_priv)
+
+const struct tcp_cc_ops *tcp_cc_find(const char *name);
+
+int tcp_cc_set(struct cfg_spec *spec, const char *val);
+int tcp_cc_get(struct cfg_spec *spec, char *val);
+
+#endif
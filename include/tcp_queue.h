@@ -186,10 +186,37 @@ static inline void *tcp_rxq_peek_unread(struct tcp_rxq *rxq, uint16_t off)
 	return rxq->objs[(rxq->unread + off) & rxq->mask];
 }
 
+/* the last readable obj, or NULL if there is none */
+static inline void *tcp_rxq_peek_last(struct tcp_rxq *rxq)
+{
+	if (rxq->max == rxq->unread)
+		return NULL;
+
+	return rxq->objs[(rxq->max - 1) & rxq->mask];
+}
+
 static inline void tcp_rxq_update_unread(struct tcp_rxq *rxq, uint16_t count)
 {
 	debug_assert(count <= (uint16_t)(rxq->max - rxq->unread));
 	rxq->unread += count;
 }
 
+/*
+ * Moves the unread objs to @objs, a new ring of @size. The caller has
+ * to make sure they fit, and free the old ring.
+ */
+static inline void tcp_rxq_migrate(struct tcp_rxq *rxq, void **objs, uint16_t size)
+{
+	uint16_t nr_obj = tcp_rxq_readable_count(rxq);
+	uint16_t i;
+
+	debug_assert(nr_obj <= size);
+	for (i = 0; i < nr_obj; i++)
+		objs[i] = rxq->objs[(rxq->unread + i) & rxq->mask];
+
+	rxq->objs = objs;
+	tcp_rxq_init(rxq, size);
+	rxq->max = nr_obj;
+}
+
 #endif /* _TCP_QUEUE_ */
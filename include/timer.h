@@ -13,20 +13,34 @@
 #include "lib/utils.h"
 
 /*
- * A simple timer implementation with one timer wheel. It has granularity
- * of 100 ms and 2048 slots. That means the max timeout we support is 204.8s.
- * It should be pretty enough for the TCP case.
+ * A hierarchical timer wheel with NR_TIMER_LEVEL levels and 128 slots
+ * per level. The level 0 slot covers one tick (10us); each upper level
+ * slot covers a whole lower level: that is 10us / 1.28ms / 163.84ms /
+ * 20.97s per slot. Therefore, the max timeout we support is about 44
+ * minutes; a longer one is clamped.
  *
- * TODO: make it multiple wheel.
+ * A timer is queued at the lowest level that could hold it, at the slot
+ * indexed by its (absolute) expire tick. When the clock enters an upper
+ * level slot, the timers there are cascaded to the lower levels. Each
+ * level keeps a bitmap of non-empty slots, so that we could jump over
+ * the empty ticks in timer_process directly, instead of ticking them
+ * one by one.
  */
-#define NR_SLOT			2048
-#define SLOT_MASK		(NR_SLOT - 1)
-#define GRAGNULARITY		(100 * 1000)	/* us */
+#define TIMER_TICK_US		10
+#define TIMER_LEVEL_BITS	7
+#define TIMER_LEVEL_SIZE	(1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVEL_MASK	(TIMER_LEVEL_SIZE - 1)
+#define NR_TIMER_LEVEL		4
+#define NR_SLOT			(NR_TIMER_LEVEL * TIMER_LEVEL_SIZE)
+#define TIMER_MAX_TICK		((1ull << (NR_TIMER_LEVEL * TIMER_LEVEL_BITS)) - 1)
+
+#define TIMER_BITMAP_WORDS	(TIMER_LEVEL_SIZE / 64)
 
 struct timer {
 	TAILQ_ENTRY(timer) node;
 	struct timer_ctrl *timer_ctrl;
 
+	uint64_t expire;	/* in ticks */
 	uint32_t slot_idx;
 	uint16_t active;
 	uint16_t closed;
@@ -38,20 +52,121 @@ struct timer {
 TAILQ_HEAD(timer_slot, timer);
 
 struct timer_ctrl {
-	uint64_t next_run;
-	uint64_t last_run;
-	uint32_t curr_slot_idx;
+	uint64_t clock;		/* the next tick to process */
+	uint64_t next_run;	/* nothing to do before this tick */
+	uint64_t bitmap[NR_SLOT / 64];	/* non-empty slots */
 	struct timer_slot slots[NR_SLOT];
 };
 
 #define timer_is_stopped(timer)		((timer)->active == 0)
 
+static inline uint64_t us_to_tick(uint64_t us)
+{
+	return us / TIMER_TICK_US;
+}
+
+static inline void timer_bitmap_set(struct timer_ctrl *timer_ctrl, uint32_t slot_idx)
+{
+	timer_ctrl->bitmap[slot_idx / 64] |= 1ull << (slot_idx % 64);
+}
+
+static inline void timer_bitmap_clear(struct timer_ctrl *timer_ctrl, uint32_t slot_idx)
+{
+	timer_ctrl->bitmap[slot_idx / 64] &= ~(1ull << (slot_idx % 64));
+}
+
+/*
+ * Returns the distance from @pos to the first non-empty slot of the
+ * given level, in circular order; -1 is returned if the level is empty.
+ */
+static inline int timer_level_find(const uint64_t *bitmap, uint32_t pos)
+{
+	uint64_t bits;
+	uint32_t w;
+	int i;
+
+	for (i = 0; i <= TIMER_BITMAP_WORDS; i++) {
+		w = (pos / 64 + i) % TIMER_BITMAP_WORDS;
+		bits = bitmap[w];
+
+		if (i == 0)
+			bits &= ~0ull << (pos % 64);
+		else if (i == TIMER_BITMAP_WORDS)
+			bits &= (1ull << (pos % 64)) - 1;
+
+		if (bits)
+			return (w * 64 + __builtin_ctzll(bits) - pos) & TIMER_LEVEL_MASK;
+	}
+
+	return -1;
+}
+
+/*
+ * Returns the first tick (starting from the clock) that has something
+ * to do: either some timers expire, or some timers need be cascaded.
+ */
+static inline uint64_t timer_next_event(struct timer_ctrl *timer_ctrl)
+{
+	uint64_t next = UINT64_MAX;
+	uint64_t start;
+	int shift;
+	int level;
+	int off;
+
+	for (level = 0; level < NR_TIMER_LEVEL; level++) {
+		shift = level * TIMER_LEVEL_BITS;
+
+		/* an upper level slot is cascaded once the clock enters it */
+		start = timer_ctrl->clock >> shift;
+		if (timer_ctrl->clock & ((1ull << shift) - 1))
+			start += 1;
+
+		off = timer_level_find(&timer_ctrl->bitmap[level * TIMER_BITMAP_WORDS],
+				       start & TIMER_LEVEL_MASK);
+		if (off >= 0 && ((start + off) << shift) < next)
+			next = (start + off) << shift;
+	}
+
+	return next;
+}
+
+static inline void timer_enqueue(struct timer_ctrl *timer_ctrl, struct timer *timer)
+{
+	uint64_t delta = timer->expire - timer_ctrl->clock;
+	uint64_t event;
+	int level;
+	int shift;
+
+	for (level = 0; level < NR_TIMER_LEVEL - 1; level++) {
+		if (delta < (1ull << ((level + 1) * TIMER_LEVEL_BITS)))
+			break;
+	}
+
+	shift = level * TIMER_LEVEL_BITS;
+	timer->slot_idx = level * TIMER_LEVEL_SIZE + ((timer->expire >> shift) & TIMER_LEVEL_MASK);
+	TAILQ_INSERT_TAIL(&timer_ctrl->slots[timer->slot_idx], timer, node);
+	timer_bitmap_set(timer_ctrl, timer->slot_idx);
+
+	event = (timer->expire >> shift) << shift;
+	if (event < timer_ctrl->next_run)
+		timer_ctrl->next_run = event;
+}
+
+static inline void timer_dequeue(struct timer_ctrl *timer_ctrl, struct timer *timer)
+{
+	struct timer_slot *slot = &timer_ctrl->slots[timer->slot_idx];
+
+	TAILQ_REMOVE(slot, timer, node);
+	if (TAILQ_EMPTY(slot))
+		timer_bitmap_clear(timer_ctrl, timer->slot_idx);
+}
+
 static inline void timer_stop(struct timer *timer)
 {
 	if (timer_is_stopped(timer))
 		return;
 
-	TAILQ_REMOVE(&timer->timer_ctrl->slots[timer->slot_idx], timer, node);
+	timer_dequeue(timer->timer_ctrl, timer);
 	timer->active = 0;
 }
 
@@ -64,24 +179,25 @@ static inline void timer_close(struct timer *timer, uint64_t now)
 static inline void timer_start(struct timer *timer, uint64_t now, uint64_t expire)
 {
 	struct timer_ctrl *timer_ctrl = timer->timer_ctrl;
-	int slot_off;
-	int slot_idx;
+	uint64_t tick;
 
 	if (expire == 0)
 		expire = 1;
 
-	slot_off = (now + expire - timer_ctrl->last_run + GRAGNULARITY - 1) / GRAGNULARITY;
-	if (slot_off > NR_SLOT)
-		slot_off = NR_SLOT;
-	slot_idx = slot_off + timer_ctrl->curr_slot_idx;
+	/* never fires before the given timeout */
+	tick = us_to_tick(now + expire + TIMER_TICK_US - 1);
+	if (tick < timer_ctrl->clock)
+		tick = timer_ctrl->clock;
+	if (tick - timer_ctrl->clock > TIMER_MAX_TICK)
+		tick = timer_ctrl->clock + TIMER_MAX_TICK;
 
-	if (!timer_is_stopped(timer) && (slot_idx & SLOT_MASK) == timer->slot_idx)
+	if (!timer_is_stopped(timer) && tick == timer->expire)
 		return;
 
 	timer_stop(timer);
 
-	TAILQ_INSERT_TAIL(&timer_ctrl->slots[slot_idx & SLOT_MASK], timer, node);
-	timer->slot_idx = slot_idx & SLOT_MASK;
+	timer->expire = tick;
+	timer_enqueue(timer_ctrl, timer);
 	timer->active = 1;
 }
 
@@ -95,32 +211,64 @@ static inline void timer_init(struct timer *timer, struct timer_ctrl *timer_ctrl
 	timer->arg = arg;
 }
 
+static inline void timer_cascade(struct timer_ctrl *timer_ctrl)
+{
+	struct timer_slot *slot;
+	struct timer *timer;
+	int level;
+
+	/* find the highest level the clock just entered a slot of */
+	for (level = 1; level < NR_TIMER_LEVEL; level++) {
+		if (timer_ctrl->clock & ((1ull << (level * TIMER_LEVEL_BITS)) - 1))
+			break;
+	}
+
+	while (--level > 0) {
+		slot = &timer_ctrl->slots[level * TIMER_LEVEL_SIZE +
+				((timer_ctrl->clock >> (level * TIMER_LEVEL_BITS)) & TIMER_LEVEL_MASK)];
+
+		while ((timer = TAILQ_FIRST(slot)) != NULL) {
+			timer_dequeue(timer_ctrl, timer);
+			timer_enqueue(timer_ctrl, timer);
+		}
+	}
+}
+
 static inline int timer_process(struct timer_ctrl *timer_ctrl, uint64_t now)
 {
+	uint64_t now_tick = us_to_tick(now);
+	struct timer_slot *slot;
 	struct timer *timer;
 	int nr_timeout = 0;
 
-	while (now >= timer_ctrl->next_run) {
-		timer_ctrl->last_run += GRAGNULARITY;
-		timer_ctrl->next_run += GRAGNULARITY;
-		timer_ctrl->curr_slot_idx += 1;
+	while (now_tick >= timer_ctrl->next_run) {
+		timer_ctrl->clock = timer_ctrl->next_run;
+		timer_cascade(timer_ctrl);
 
+		slot = &timer_ctrl->slots[timer_ctrl->clock & TIMER_LEVEL_MASK];
 		while (1) {
-			timer = TAILQ_FIRST(&timer_ctrl->slots[timer_ctrl->curr_slot_idx & SLOT_MASK]);
+			timer = TAILQ_FIRST(slot);
 			if (!timer)
 				break;
 
 			debug_assert(timer->active == 1);
 			debug_assert(timer->closed == 0);
-			debug_assert(timer->slot_idx < NR_SLOT);
+			debug_assert(timer->expire == timer_ctrl->clock);
 
 			timer_stop(timer);
 			timer->cb(timer);
 
 			nr_timeout += 1;
 		}
+
+		timer_ctrl->clock += 1;
+		timer_ctrl->next_run = timer_next_event(timer_ctrl);
 	}
 
+	/* nothing happens till now; just move the clock forward */
+	if (now_tick >= timer_ctrl->clock)
+		timer_ctrl->clock = now_tick + 1;
+
 	return nr_timeout;
 }
 
@@ -133,8 +281,8 @@ static inline void timer_ctrl_init(struct timer_ctrl *timer_ctrl, uint64_t now)
 	for (i = 0; i < NR_SLOT; i++)
 		TAILQ_INIT(&timer_ctrl->slots[i]);
 
-	timer_ctrl->last_run = now;
-	timer_ctrl->next_run = now + GRAGNULARITY;
+	timer_ctrl->clock = us_to_tick(now) + 1;
+	timer_ctrl->next_run = UINT64_MAX;
 }
 
 #endif
@@ -31,6 +31,7 @@ enum {
 	SACK_UPDATE,
 	SACK_REGULATE,
 	SACK_RCV,
+	SACK_DSACK,
 };
 
 #ifdef TRACE_TOOL
@@ -100,6 +101,9 @@ static inline const char *sack_type_to_str(int type)
 
 	case SACK_RCV:
 		return "rcv";
+
+	case SACK_DSACK:
+		return "dsack";
 	}
 
 	return "unknown";
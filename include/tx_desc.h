@@ -16,6 +16,10 @@
 #define TX_DESC_FLAG_MEASURE_LATENCY		(1<<1)
 #define TX_DESC_FLAG_RETRANS			(1<<2)
 #define TX_DESC_FLAG_SACKED			(1<<3)
+#define TX_DESC_FLAG_DELIVERED			(1<<4)
+#define TX_DESC_FLAG_APP_LIMITED		(1<<5)
+#define TX_DESC_FLAG_LOST			(1<<6)
+#define TX_DESC_FLAG_HAS_CSUM			(1<<7)
 
 struct tx_desc {
 	void *addr;
@@ -27,7 +31,8 @@ struct tx_desc {
 	void *param;
 
 	uint32_t seq;
-	uint32_t reserved;
+	uint16_t csum;		/* the raw sum of the data, with TX_DESC_FLAG_HAS_CSUM */
+	uint16_t reserved;
 	uint64_t ts_us;
 
 	/* cacheline 2 */
@@ -37,11 +42,16 @@ struct tx_desc {
 
 	/* for none zero copy write */
 	void *pkt;
+
+	/* the tsock delivery states when it's sent; for rate sampling */
+	uint64_t delivered;
+	uint64_t delivered_ts;
+	uint64_t first_tx_ts;
 } __attribute__((__aligned__(64)));
 
 #define tx_desc_done(desc, worker)		do {		\
 	if ((desc)->flags & TX_DESC_FLAG_MEM_FROM_MBUF) {	\
-		packet_free(desc->pkt);				\
+		tx_packet_free(worker, desc->pkt);		\
 		worker->nr_write_mbuf -= 1;			\
 	}							\
 	if ((desc)->write_done)					\
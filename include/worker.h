@@ -16,6 +16,8 @@
 #include "dev.h"
 #include "port_alloc.h"
 #include "tx_desc.h"
+#include "rcu.h"
+#include "pacing.h"
 
 struct cycles {
 	uint64_t start;
@@ -24,6 +26,7 @@ struct cycles {
 	uint64_t busy;
 	uint64_t outside_worker;
 	uint64_t last_poll;
+	uint64_t sleep;		/* spent in tpa_worker_wait sleeping */
 };
 
 #define TX_DESC_COUNT_PER_WORKER		(128 * 1024)
@@ -47,6 +50,8 @@ struct tpa_worker {
 
 	struct packet_pool zwrite_pkt_pool;
 	struct packet_pool hdr_pkt_pool;
+	struct packet_cache zwrite_pkt_cache;
+	struct packet_cache hdr_pkt_cache;
 	struct flex_fifo *event_queue;
 
 	struct tcp_sock *tsocks[BATCH_SIZE];
@@ -55,19 +60,63 @@ struct tpa_worker {
 
 	struct flex_fifo *output;
 	struct flex_fifo *delayed_ack;
+	struct flex_fifo *gro;		/* the tsocks with a held rx_merge_head */
+	struct hist rx_merge_size;
 	struct flex_fifo *accept;
 
 	struct flex_fifo *neigh_flush_queue;
+	struct neigh_wcache *neigh_wcache;
+
+	struct pacing_queue pacing_queue;
+	struct vstats pacing_lag;	/* how late a paced sock is released, in cycles */
 
 	int nr_port_block;
 	struct port_block *port_blocks[MAX_PORT_BLOCK_PER_WORKER];
+	uint32_t port_cursor;
 	struct sock_table sock_table;
+	struct sid_magazine sid_magazine;
+	struct steer_buf *steer_bufs;	/* per dst worker */
 
 	uint64_t stats_base[STATS_MAX];
 
+	struct rcu_reader rcu;
+
+	/* for tpa_worker_wait */
+	int busy;			/* the last tpa_worker_run did something */
+	uint32_t sleeping;		/* read by the other threads to kick it */
+	uint32_t spin_us;
+	uint64_t idle_since_us;
+	struct worker_wait *wait;
+
 	pid_t tid;
 } __rte_cache_aligned;
 
+extern struct tpa_worker *workers;
+extern __thread struct tpa_worker *tls_worker;
+
+void worker_wakeup(struct tpa_worker *worker);
+
+/*
+ * Wakes up @worker if it's sleeping in tpa_worker_wait. It's for the
+ * work handed over by other threads through a thread safe queue, like
+ * the neigh flush queue. The sock APIs are invoked at the worker thread
+ * only, so are the tsock queues (say, the output queue): they need no
+ * kick.
+ *
+ * It must be invoked after the work is queued: the fence pairs with the
+ * one in the sleep path, so that either we see it sleeping, or it sees
+ * the work before going to sleep.
+ */
+static inline void worker_kick(struct tpa_worker *worker)
+{
+	if (likely(tls_worker == worker))
+		return;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&worker->sleeping, __ATOMIC_RELAXED))
+		worker_wakeup(worker);
+}
+
 static inline void tsock_update_last_ts(struct tcp_sock *tsock, int type)
 {
 	tsock->last_ts[type] = tsock->worker->cycles.start;
@@ -110,6 +159,41 @@ static inline uint32_t output_tsock_dequeue(struct tpa_worker *worker)
 	return i;
 }
 
+/*
+ * Frees a tx pkt (chain): the segs from the worker pools go back to the
+ * worker caches; others go to their mempool.
+ */
+static inline void tx_packet_free(struct tpa_worker *worker, struct packet *pkt)
+{
+	struct rte_mbuf *m = &pkt->mbuf;
+	struct rte_mbuf *next;
+
+	do {
+		next = m->next;
+
+		m = rte_pktmbuf_prefree_seg(m);
+		if (likely(m != NULL)) {
+			if (m->pool == worker->hdr_pkt_cache.mempool)
+				packet_cache_put(&worker->hdr_pkt_cache, m);
+			else if (m->pool == worker->zwrite_pkt_cache.mempool)
+				packet_cache_put(&worker->zwrite_pkt_cache, m);
+			else
+				rte_mbuf_raw_free(m);
+		}
+
+		m = next;
+	} while (m);
+}
+
+static inline void tx_packet_free_batch(struct tpa_worker *worker,
+					struct packet **pkts, int nr_pkt)
+{
+	int i;
+
+	for (i = 0; i < nr_pkt; i++)
+		tx_packet_free(worker, pkts[i]);
+}
+
 static inline void accept_tsock_enqueue(struct tpa_worker *worker, struct tcp_sock *tsock)
 {
 	flex_fifo_push(worker->accept, &tsock->accept_node);
@@ -150,11 +234,9 @@ static inline int too_many_used_mbufs(struct tpa_worker *worker)
 	return nr_used_mbuf > tcp_cfg.drop_ooo_threshold;
 }
 
-extern struct tpa_worker *workers;
-extern __thread struct tpa_worker *tls_worker;
-
 int worker_init(uint32_t nr_worker);
 struct tpa_worker *tpa_worker_init(void);
 void tpa_worker_run(struct tpa_worker *worker);
+int tpa_worker_wait(struct tpa_worker *worker, uint32_t timeout_us);
 
 #endif
@@ -708,7 +708,7 @@ static int cfg_spec_get_num(struct cfg_spec *spec, char *val)
 		else if (num % 1000 == 0)
 			tpa_snprintf(val, VAL_SIZE, "%ums", num / 1000);
 		else
-			tpa_snprintf(val, VAL_SIZE, "%uus", num / 1000);
+			tpa_snprintf(val, VAL_SIZE, "%uus", num);
 
 		return 0;
 	}
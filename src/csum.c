@@ -0,0 +1,271 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_memcpy.h>
+#include <rte_cpuflags.h>
+
+#ifdef RTE_ARCH_X86
+#include <immintrin.h>
+#endif
+
+#include "tpa.h"
+#include "log.h"
+#include "csum.h"
+
+/*
+ * The tail which is less than a vector; the last odd byte (if any) is
+ * summed as the first byte of a 16 bit word, as rte_raw_cksum does.
+ */
+static inline uint64_t csum_tail(const uint8_t *p, uint32_t len)
+{
+	uint64_t sum = 0;
+	uint16_t left = 0;
+
+	for (; len >= 2; len -= 2, p += 2)
+		sum += *(const uint16_t *)p;
+
+	if (len) {
+		*(uint8_t *)&left = *p;
+		sum += left;
+	}
+
+	return sum;
+}
+
+static int csum_scalar_supported(void)
+{
+	return 1;
+}
+
+static uint16_t csum_scalar_sum(const void *buf, uint32_t len)
+{
+	return rte_raw_cksum(buf, len);
+}
+
+static uint16_t csum_scalar_copy_sum(void *dst, const void *src, uint32_t len)
+{
+	rte_memcpy(dst, src, len);
+
+	return rte_raw_cksum(dst, len);
+}
+
+static const struct csum_ops csum_scalar = {
+	.name		= "scalar",
+	.supported	= csum_scalar_supported,
+	.sum		= csum_scalar_sum,
+	.copy_sum	= csum_scalar_copy_sum,
+};
+
+#ifdef RTE_ARCH_X86
+/*
+ * The vector kernels sum the 16 bit words into 32 bit lanes: the low
+ * and high half of each lane are added separately. A lane takes 2 words
+ * per iteration, therefore, it's folded into the 64 bit sum at every
+ * CSUM_VEC_BATCH iterations, way before it could overflow.
+ */
+#define CSUM_VEC_BATCH		16384
+
+#define DEFINE_CSUM_VEC(name, isa, vec_t, VEC_SIZE, vload, vstore, vset1, vand, vsrli, vadd, vzero)	\
+static inline uint64_t __attribute__((target(isa)))				\
+name##_hsum(vec_t acc)									\
+{											\
+	uint32_t lanes[VEC_SIZE / 4];							\
+	uint64_t sum = 0;								\
+	int i;										\
+											\
+	vstore((vec_t *)lanes, acc);							\
+	for (i = 0; i < VEC_SIZE / 4; i++)						\
+		sum += lanes[i];							\
+											\
+	return sum;									\
+}											\
+											\
+static inline uint16_t __attribute__((target(isa)))				\
+name##_do_sum(void *dst, const void *src, uint32_t len, int copy)			\
+{											\
+	const uint8_t *p = src;								\
+	uint8_t *d = dst;								\
+	vec_t mask = vset1(0xffff);							\
+	vec_t acc;									\
+	vec_t v;									\
+	uint64_t sum = 0;								\
+	uint32_t n;									\
+											\
+	while (len >= VEC_SIZE) {							\
+		n = RTE_MIN(len / VEC_SIZE, CSUM_VEC_BATCH);				\
+		len -= n * VEC_SIZE;							\
+											\
+		acc = vzero();								\
+		while (n--) {								\
+			v = vload((const vec_t *)p);					\
+			if (copy) {							\
+				vstore((vec_t *)d, v);					\
+				d += VEC_SIZE;						\
+			}								\
+			acc = vadd(acc, vand(v, mask));					\
+			acc = vadd(acc, vsrli(v, 16));					\
+			p += VEC_SIZE;							\
+		}								\
+		sum += name##_hsum(acc);						\
+	}										\
+											\
+	if (copy && len)								\
+		memcpy(d, p, len);							\
+	sum += csum_tail(p, len);							\
+											\
+	return csum_fold(sum);								\
+}											\
+											\
+static uint16_t __attribute__((target(isa)))					\
+name##_sum(const void *buf, uint32_t len)						\
+{											\
+	return name##_do_sum(NULL, buf, len, 0);					\
+}											\
+											\
+static uint16_t __attribute__((target(isa)))					\
+name##_copy_sum(void *dst, const void *src, uint32_t len)				\
+{											\
+	return name##_do_sum(dst, src, len, 1);						\
+}
+
+DEFINE_CSUM_VEC(csum_sse, "sse4.2", __m128i, 16,
+		_mm_loadu_si128, _mm_storeu_si128, _mm_set1_epi32,
+		_mm_and_si128, _mm_srli_epi32, _mm_add_epi32, _mm_setzero_si128)
+
+DEFINE_CSUM_VEC(csum_avx2, "avx2", __m256i, 32,
+		_mm256_loadu_si256, _mm256_storeu_si256, _mm256_set1_epi32,
+		_mm256_and_si256, _mm256_srli_epi32, _mm256_add_epi32, _mm256_setzero_si256)
+
+#define _mm512_loadu(p)			_mm512_loadu_si512((const void *)(p))
+#define _mm512_storeu(p, v)		_mm512_storeu_si512((void *)(p), v)
+
+DEFINE_CSUM_VEC(csum_avx512, "avx512f", __m512i, 64,
+		_mm512_loadu, _mm512_storeu, _mm512_set1_epi32,
+		_mm512_and_si512, _mm512_srli_epi32, _mm512_add_epi32, _mm512_setzero_si512)
+
+static int csum_sse_supported(void)
+{
+	return rte_cpu_get_flag_enabled(RTE_CPUFLAG_SSE4_2) > 0;
+}
+
+static int csum_avx2_supported(void)
+{
+	return rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2) > 0;
+}
+
+static int csum_avx512_supported(void)
+{
+	return rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) > 0;
+}
+
+static const struct csum_ops csum_sse = {
+	.name		= "sse4.2",
+	.supported	= csum_sse_supported,
+	.sum		= csum_sse_sum,
+	.copy_sum	= csum_sse_copy_sum,
+};
+
+static const struct csum_ops csum_avx2 = {
+	.name		= "avx2",
+	.supported	= csum_avx2_supported,
+	.sum		= csum_avx2_sum,
+	.copy_sum	= csum_avx2_copy_sum,
+};
+
+static const struct csum_ops csum_avx512 = {
+	.name		= "avx512",
+	.supported	= csum_avx512_supported,
+	.sum		= csum_avx512_sum,
+	.copy_sum	= csum_avx512_copy_sum,
+};
+#endif
+
+/* sorted by preference, from the lowest to the highest */
+const struct csum_ops *csum_ops_list[] = {
+	&csum_scalar,
+#ifdef RTE_ARCH_X86
+	&csum_sse,
+	&csum_avx2,
+	&csum_avx512,
+#endif
+};
+
+const int csum_ops_count = RTE_DIM(csum_ops_list);
+
+const struct csum_ops *csum_ops_default = &csum_scalar;
+
+/* picks the widest one the cpu supports */
+void csum_init(void)
+{
+	int i;
+
+	for (i = 0; i < csum_ops_count; i++) {
+		if (csum_ops_list[i]->supported())
+			csum_ops_default = csum_ops_list[i];
+	}
+
+	LOG("csum engine: %s", csum_ops_default->name);
+}
+
+const struct csum_ops *csum_ops_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < csum_ops_count; i++) {
+		if (strcmp(csum_ops_list[i]->name, name) == 0)
+			return csum_ops_list[i];
+	}
+
+	return NULL;
+}
+
+int csum_ops_set(struct cfg_spec *spec, const char *val)
+{
+	const struct csum_ops *ops;
+
+	ops = csum_ops_find(val);
+	if (!ops || !ops->supported()) {
+		LOG_WARN("unknown or unsupported csum engine: %s", val);
+		return -1;
+	}
+
+	csum_ops_default = ops;
+
+	return 0;
+}
+
+int csum_ops_get(struct cfg_spec *spec, char *val)
+{
+	tpa_snprintf(val, VAL_SIZE, "%s", csum_ops_default->name);
+
+	return 0;
+}
+
+/* same as rte_raw_cksum_mbuf, with the engine above */
+uint16_t csum_raw_mbuf(const struct rte_mbuf *m, uint32_t off, uint32_t len)
+{
+	uint64_t sum = 0;
+	uint32_t done = 0;
+	uint32_t seg_len;
+
+	while (m && off >= m->data_len) {
+		off -= m->data_len;
+		m = m->next;
+	}
+
+	for (; m && len; m = m->next, off = 0) {
+		seg_len = RTE_MIN((uint32_t)m->data_len - off, len);
+
+		sum += csum_shift(csum_raw(rte_pktmbuf_mtod_offset(m, const void *, off), seg_len), done);
+
+		done += seg_len;
+		len  -= seg_len;
+	}
+
+	return csum_fold(sum);
+}
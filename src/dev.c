@@ -18,9 +18,38 @@
 #include "dev.h"
 #include "ip.h"
 #include "ctrl.h"
+#include "csum.h"
 
 struct net_dev dev;
 
+static const char *tx_flush_modes[] = {
+	[DEV_TXQ_FLUSH_DEFAULT]    = "default",
+	[DEV_TXQ_FLUSH_LATENCY]    = "latency",
+	[DEV_TXQ_FLUSH_THROUGHPUT] = "throughput",
+};
+
+static int tx_flush_mode_set(struct cfg_spec *spec, const char *val)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tx_flush_modes); i++) {
+		if (strcmp(tx_flush_modes[i], val) == 0) {
+			dev.tx_flush_mode = i;
+			return 0;
+		}
+	}
+
+	LOG_WARN("unknown tx flush mode: %s", val);
+	return -1;
+}
+
+static int tx_flush_mode_get(struct cfg_spec *spec, char *val)
+{
+	tpa_snprintf(val, VAL_SIZE, "%s", tx_flush_modes[dev.tx_flush_mode]);
+
+	return 0;
+}
+
 static char bonding_info[PATH_MAX];
 static struct cfg_spec net_cfg_specs[] = {
 	{
@@ -66,6 +95,22 @@ static struct cfg_spec net_cfg_specs[] = {
 		.data   = bonding_info,
 		.data_len = sizeof(bonding_info),
 		.flags  = CFG_FLAG_RDONLY,
+	}, {
+		.name   = "net.csum",
+		.type   = CFG_TYPE_STR,
+		.set    = csum_ops_set,
+		.get    = csum_ops_get,
+	}, {
+		.name   = "net.tx_flush",
+		.type   = CFG_TYPE_STR,
+		.set    = tx_flush_mode_set,
+		.get    = tx_flush_mode_get,
+	}, {
+		.name   = "net.tx_flush_timeout",
+		.type   = CFG_TYPE_TIME,
+		.data   = &dev.tx_flush_timeout,
+		.flags  = CFG_FLAG_HAS_MAX,
+		.max    = DEV_TXQ_FLUSH_TIMEOUT_MAX,
 	}
 };
 
@@ -117,6 +162,11 @@ def:
 int net_dev_init_early(void)
 {
 	memset(&dev, 0, sizeof(dev));
+	dev.tx_flush_mode    = DEV_TXQ_FLUSH_DEFAULT;
+	dev.tx_flush_timeout = DEV_TXQ_FLUSH_TIMEOUT_DEFAULT;
+
+	/* before the cfg parse, so that net.csum could override it */
+	csum_init();
 
 	cfg_spec_register(net_cfg_specs, ARRAY_SIZE(net_cfg_specs));
 	cfg_section_parse("net");
@@ -298,6 +348,29 @@ struct nic_spec *nic_spec_find_by_type(int type)
 	return &nic_unknow;
 }
 
+/*
+ * The tx offloads the port lacks, which are then done in software, by
+ * dev_port_txq_enqueue_gso. Note that TSO relies on the csum offload.
+ */
+static uint64_t dev_port_sw_tx_offload(uint16_t port_id)
+{
+	struct rte_eth_dev_info dev_info;
+	uint64_t offload = 0;
+
+	/* assume a full offload when it's unknown; say, in unit test */
+	if (rte_eth_dev_info_get(port_id, &dev_info) < 0)
+		return 0;
+
+	if (!(dev_info.tx_offload_capa & DEV_TX_OFFLOAD_TCP_TSO))
+		offload |= PKT_TX_TCP_SEG;
+
+	if (!(dev_info.tx_offload_capa & DEV_TX_OFFLOAD_TCP_CKSUM) ||
+	    !(dev_info.tx_offload_capa & DEV_TX_OFFLOAD_IPV4_CKSUM))
+		offload |= PKT_TX_TCP_SEG | PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM;
+
+	return offload;
+}
+
 int dev_port_init(void)
 {
 	uint16_t i;
@@ -333,6 +406,12 @@ int dev_port_init(void)
 		rte_eth_dev_get_name_by_port(i, dev.ports[i].device_id);
 		LOG("detected dpdk port %hu: %s, drv_name %s",
 		    i, dev.ports[i].device_id, nic_spec->name);
+
+		dev.ports[i].sw_tx_offload = dev_port_sw_tx_offload(i);
+		if (dev.ports[i].sw_tx_offload) {
+			LOG_WARN("dpdk port %hu: no full tso/csum offload; fallback to software GSO%s", i,
+				 (dev.ports[i].sw_tx_offload & PKT_TX_TCP_CKSUM) ? " and csum" : "");
+		}
 	}
 
 	if (dev.nr_port == 2)
@@ -43,6 +43,7 @@ struct dpdk_cfg {
 	uint32_t mbuf_mem_size;
 	uint32_t mbuf_cache_size;
 	uint32_t huge_unlink;
+	uint32_t rx_intr;
 };
 
 static struct dpdk_cfg dpdk_cfg = {
@@ -212,12 +213,22 @@ static void dpdk_port_init(uint16_t port, int nr_queue)
 	port_conf.txmode.offloads = TX_OFFLOAD & dev_info.tx_offload_capa;
 	port_conf.lpbk_mode = 1;
 
-	LOG("init port %hu: nr_queue=%hu rx_offload=%lu tx_offload=%lu",
-	    port, nr_queue, port_conf.rxmode.offloads, port_conf.txmode.offloads);
+	port_conf.intr_conf.rxq = !!dpdk_cfg.rx_intr;
+
+	LOG("init port %hu: nr_queue=%hu rx_offload=%lu tx_offload=%lu rx_intr=%d",
+	    port, nr_queue, port_conf.rxmode.offloads, port_conf.txmode.offloads,
+	    port_conf.intr_conf.rxq);
 
 	ret = rte_eth_dev_configure(port, nr_queue, nr_queue, &port_conf);
+	if (ret != 0 && port_conf.intr_conf.rxq) {
+		/* not all PMDs support it; tpa_worker_wait then relies on the eventfd */
+		LOG_WARN("port %hu: failed to enable rx interrupt: %d; fallback to polling", port, ret);
+		port_conf.intr_conf.rxq = 0;
+		ret = rte_eth_dev_configure(port, nr_queue, nr_queue, &port_conf);
+	}
 	if (ret != 0)
 		rte_panic("failed to configure device: %d", ret);
+	dev.ports[port].rx_intr = port_conf.intr_conf.rxq;
 
 	ret = rte_eth_dev_adjust_nb_rx_tx_desc(port, &nr_rx_desc, &nr_tx_desc);
 	if (ret < 0)
@@ -454,6 +465,11 @@ static struct cfg_spec dpdk_cfg_specs[] = {
 		.type     = CFG_TYPE_UINT,
 		.data     = &dpdk_cfg.huge_unlink,
 		.flags	  = CFG_FLAG_RDONLY,
+	}, {
+		.name	  = "dpdk.rx_intr",
+		.type     = CFG_TYPE_UINT,
+		.data     = &dpdk_cfg.rx_intr,
+		.flags	  = CFG_FLAG_RDONLY,
 	},
 };
 
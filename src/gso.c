@@ -0,0 +1,325 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include <rte_ip.h>
+#include <rte_memcpy.h>
+
+#include "tpa.h"
+#include "sock.h"
+#include "dev.h"
+#include "worker.h"
+#include "csum.h"
+
+/*
+ * The software GSO, for ports lacking the TSO (or the csum) offload.
+ *
+ * The tcp stack still builds super segments as if TSO is there: a hdr
+ * pkt followed by a chain of zero copy payload pkts. They are split here,
+ * right before being queued to the dev txq:
+ *
+ * - the hdr pkts and the split pieces are allocated in bulk
+ * - the header is built once by the tcp stack; it's copied as a template
+ * - the payload is not copied at all: the chain is just re-linked, while
+ *   a payload pkt crossing the mss boundary is split by attaching the
+ *   remaining part to a new pkt
+ * - the tcp csum (when it's not offloaded) is calculated incrementally:
+ *   the sum of the header template is calculated once; only the seq and
+ *   the flags differ per segment. And the payload sum is taken from the
+ *   write path when it's there, where it's summed while being copied.
+ */
+struct gso_ctx {
+	uint16_t hdr_len;
+	uint16_t l3_len;
+	uint16_t l4_len;
+	uint16_t mss;
+	uint16_t packet_id;
+	uint8_t  tcp_flags;
+	uint8_t  is_ipv6;
+	uint8_t  sw_csum;
+	uint32_t seq;
+	uint32_t hdr_sum;	/* the tcp hdr, with seq, flags and cksum zeroed */
+};
+
+static inline uint16_t tcp_flags_word(struct rte_tcp_hdr *tcp)
+{
+	return *(uint16_t *)&tcp->data_off;
+}
+
+static void gso_ctx_init(struct gso_ctx *ctx, struct packet *pkt, uint64_t sw_tx_offload)
+{
+	struct rte_mbuf *m = &pkt->mbuf;
+	uint8_t buf[PKT_MAX_HDR_LEN];
+	struct rte_tcp_hdr *tcp;
+
+	ctx->hdr_len = pkt->hdr_len;
+	ctx->l3_len  = m->l3_len;
+	ctx->l4_len  = m->l4_len;
+	ctx->is_ipv6 = !!(m->ol_flags & PKT_TX_IPV6);
+	ctx->sw_csum = !!(sw_tx_offload & PKT_TX_TCP_CKSUM);
+
+	ctx->mss = m->tso_segsz;
+	if (!(m->ol_flags & PKT_TX_TCP_SEG) || ctx->mss == 0)
+		ctx->mss = UINT16_MAX;
+
+	tcp = packet_tcp_hdr(pkt);
+	ctx->seq = ntohl(tcp->sent_seq);
+	ctx->tcp_flags = tcp->tcp_flags;
+	if (!ctx->is_ipv6)
+		ctx->packet_id = ntohs(packet_ip_hdr(pkt)->packet_id);
+
+	if (ctx->sw_csum) {
+		tcp = (struct rte_tcp_hdr *)buf;
+		memcpy(tcp, packet_tcp_hdr(pkt), ctx->l4_len);
+		tcp->sent_seq = 0;
+		tcp->data_off = 0;
+		tcp->tcp_flags = 0;
+		tcp->cksum = 0;
+
+		ctx->hdr_sum = csum_raw(tcp, ctx->l4_len);
+	}
+}
+
+/* the payload pkts summed by the write path are not summed again */
+static inline uint64_t gso_payload_sum(struct gso_ctx *ctx, struct packet *seg)
+{
+	struct rte_mbuf *m = &seg->mbuf;
+	uint32_t off = ctx->hdr_len;
+	uint32_t done = 0;
+	uint64_t sum = 0;
+	uint16_t len;
+
+	for (; m; m = m->next, off = 0) {
+		len = m->data_len - off;
+		if (len == 0)
+			continue;
+
+		if (off == 0 && (((struct packet *)m)->flags & PKT_FLAG_HAS_CSUM))
+			sum += csum_shift(((struct packet *)m)->csum, done);
+		else
+			sum += csum_shift(csum_raw(rte_pktmbuf_mtod_offset(m, void *, off), len), done);
+		done += len;
+	}
+
+	return sum;
+}
+
+static inline void gso_tcp_cksum(struct gso_ctx *ctx, struct packet *seg,
+				 struct rte_tcp_hdr *tcp)
+{
+	uint32_t seq = tcp->sent_seq;
+	uint64_t sum;
+
+	sum  = ctx->hdr_sum + (seq & 0xffff) + (seq >> 16) + tcp_flags_word(tcp);
+	sum += gso_payload_sum(ctx, seg);
+	if (!ctx->is_ipv6)
+		sum += rte_ipv4_phdr_cksum(packet_ip_hdr(seg), 0);
+	else
+		sum += rte_ipv6_phdr_cksum(packet_ip6_hdr(seg), 0);
+
+	tcp->cksum = csum_l4_finish(sum);
+}
+
+/* fixes up the headers of the @idx th seg, with payload of @len */
+static void gso_seg_fixup(struct gso_ctx *ctx, struct packet *seg, int idx, int nr_seg,
+			  uint16_t len)
+{
+	struct rte_mbuf *m = &seg->mbuf;
+	struct rte_tcp_hdr *tcp = packet_tcp_hdr(seg);
+	uint8_t tcp_flags = ctx->tcp_flags;
+	struct rte_ipv4_hdr *ip = NULL;
+
+	/* CWR goes with the first seg only, while FIN and PSH the last one */
+	if (idx > 0)
+		tcp_flags &= ~TCP_FLAG_CWR;
+	if (idx < nr_seg - 1)
+		tcp_flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+
+	tcp->sent_seq = htonl(ctx->seq);
+	tcp->tcp_flags = tcp_flags;
+
+	TCP_SEG(seg)->seq = ctx->seq;
+	TCP_SEG(seg)->len = len;
+	TCP_SEG(seg)->flags = tcp_flags;
+	ctx->seq += len;
+
+	m->ol_flags &= ~PKT_TX_TCP_SEG;
+	m->tso_segsz = 0;
+
+	if (!ctx->is_ipv6) {
+		ip = packet_ip_hdr(seg);
+		ip->total_length = htons(ctx->l3_len + ctx->l4_len + len);
+		ip->packet_id = htons(ctx->packet_id + idx);
+		ip->hdr_checksum = 0;
+	} else {
+		packet_ip6_hdr(seg)->payload_len = htons(ctx->l4_len + len);
+	}
+
+	if (ctx->sw_csum) {
+		if (!ctx->is_ipv6)
+			ip->hdr_checksum = rte_ipv4_cksum(ip);
+		gso_tcp_cksum(ctx, seg, tcp);
+		m->ol_flags &= ~(PKT_TX_IP_CKSUM | PKT_TX_TCP_CKSUM);
+	} else {
+	#ifndef NIC_MLNX
+		if (!ctx->is_ipv6)
+			tcp->cksum = rte_ipv4_phdr_cksum(ip, m->ol_flags);
+		else
+			tcp->cksum = rte_ipv6_phdr_cksum(packet_ip6_hdr(seg), m->ol_flags);
+	#endif
+	}
+}
+
+static void gso_hdr_copy(struct packet *seg, struct packet *pkt, void *hdr_template)
+{
+	struct rte_mbuf *m = &seg->mbuf;
+	void *hdr;
+
+	hdr = rte_pktmbuf_prepend(m, pkt->hdr_len);
+	rte_memcpy(hdr, hdr_template, pkt->hdr_len);
+
+	m->tx_offload  = pkt->mbuf.tx_offload;
+	m->ol_flags    = pkt->mbuf.ol_flags;
+	m->packet_type = pkt->mbuf.packet_type;
+
+	seg->l2_off  = m->data_off;
+	seg->l3_off  = seg->l2_off + (pkt->l3_off - pkt->l2_off);
+	seg->l4_off  = seg->l2_off + (pkt->l4_off - pkt->l2_off);
+	seg->hdr_len = pkt->hdr_len;
+	seg->flags   = pkt->flags;
+	seg->tsock   = pkt->tsock;
+	seg->port_id = pkt->port_id;
+	TCP_SEG(seg)->ack    = TCP_SEG(pkt)->ack;
+	TCP_SEG(seg)->ts_raw = TCP_SEG(pkt)->ts_raw;
+	TCP_SEG(seg)->wnd    = TCP_SEG(pkt)->wnd;
+}
+
+/*
+ * Re-links the payload chain starting at *@cur to @seg, with @len bytes.
+ * The payload pkt crossing the boundary is split, with the remaining
+ * part attached to a new pkt from @pieces.
+ */
+static void gso_seg_link(struct packet *seg, struct rte_mbuf **cur, uint16_t len,
+			 struct packet **pieces, int *nr_piece)
+{
+	struct rte_mbuf *tail = &seg->mbuf;
+	struct rte_mbuf *m = *cur;
+	struct packet *piece;
+	uint16_t off;
+
+	seg->mbuf.nb_segs = 1;
+	seg->mbuf.pkt_len = seg->mbuf.data_len + len;
+
+	while (len) {
+		if (m->data_len > len) {
+			off = len;
+			piece = pieces[(*nr_piece)++];
+
+			packet_attach_extbuf(piece, rte_pktmbuf_mtod_offset(m, void *, off),
+					     m->buf_iova + m->data_off + off, m->data_len - off);
+			TCP_SEG(piece)->seq = TCP_SEG((struct packet *)m)->seq + off;
+			TCP_SEG(piece)->len = m->data_len - off;
+			piece->mbuf.next = m->next;
+
+			m->data_len = off;
+			m->pkt_len  = off;
+			TCP_SEG((struct packet *)m)->len = off;
+			((struct packet *)m)->flags &= ~PKT_FLAG_HAS_CSUM;
+			m->next = &piece->mbuf;
+		}
+
+		tail->next = m;
+		tail = m;
+		seg->mbuf.nb_segs += 1;
+
+		len -= m->data_len;
+		m = m->next;
+	}
+
+	tail->next = NULL;
+	*cur = m;
+}
+
+/*
+ * Note that on error, the pkt is left untouched and it's the caller's
+ * job to free it, just like __dev_port_txq_enqueue.
+ */
+int dev_port_txq_enqueue_gso(uint16_t port_id, uint16_t queue_id, struct packet *pkt)
+{
+	uint64_t sw_tx_offload = dev.ports[port_id].sw_tx_offload;
+	struct tpa_worker *worker = &workers[queue_id];
+	struct tcp_sock *tsock = pkt->tsock;
+	uint32_t payload_len;
+	struct gso_ctx ctx;
+	struct rte_mbuf *cur;
+	int nr_piece = 0;
+	uint16_t len;
+	int nr_seg;
+	int i;
+
+	gso_ctx_init(&ctx, pkt, sw_tx_offload);
+
+	payload_len = pkt->mbuf.pkt_len - ctx.hdr_len;
+	nr_seg = RTE_MAX((payload_len + ctx.mss - 1) / ctx.mss, 1u);
+
+	if (nr_seg == 1) {
+		gso_seg_fixup(&ctx, pkt, 0, 1, payload_len);
+		if (ctx.sw_csum)
+			WORKER_TSOCK_STATS_INC(worker, tsock, PKT_XMIT_SW_CSUM);
+
+		return __dev_port_txq_enqueue(port_id, queue_id, pkt);
+	}
+
+	/* the hdr pkt carries the header only; see xmit_one_packet */
+	debug_assert(pkt->mbuf.data_len == ctx.hdr_len);
+
+	if (dev_port_txq_free_count(port_id, queue_id) < nr_seg)
+		return -ERR_DEV_TXQ_FULL;
+
+	{
+		/* a seg boundary splits one payload pkt at most */
+		struct packet *segs[nr_seg];
+		struct packet *pieces[nr_seg - 1];
+
+		segs[0] = pkt;
+		if (packet_cache_alloc_bulk(&worker->hdr_pkt_cache, &segs[1], nr_seg - 1) < 0)
+			return -ERR_PKT_ALLOC_FAIL;
+
+		if (packet_cache_alloc_bulk(&worker->zwrite_pkt_cache, pieces, nr_seg - 1) < 0) {
+			tx_packet_free_batch(worker, &segs[1], nr_seg - 1);
+			return -ERR_PKT_ALLOC_FAIL;
+		}
+
+		cur = pkt->mbuf.next;
+		for (i = 0; i < nr_seg; i++) {
+			if (i > 0)
+				gso_hdr_copy(segs[i], pkt, rte_pktmbuf_mtod(&pkt->mbuf, void *));
+
+			len = RTE_MIN(payload_len, ctx.mss);
+			payload_len -= len;
+
+			gso_seg_link(segs[i], &cur, len, pieces, &nr_piece);
+		}
+
+		/* the header template is consumed only after the copies above */
+		for (i = 0; i < nr_seg; i++) {
+			gso_seg_fixup(&ctx, segs[i], i, nr_seg, segs[i]->mbuf.pkt_len - ctx.hdr_len);
+			__dev_port_txq_enqueue(port_id, queue_id, segs[i]);
+		}
+
+		tx_packet_free_batch(worker, &pieces[nr_piece], nr_seg - 1 - nr_piece);
+	}
+
+	if (tsock)
+		tsock->packet_id += nr_seg - 1;
+
+	WORKER_TSOCK_STATS_INC(worker, tsock, PKT_XMIT_GSO);
+	WORKER_TSOCK_STATS_ADD(worker, tsock, PKT_XMIT_GSO_SEG, nr_seg);
+	if (ctx.sw_csum)
+		WORKER_TSOCK_STATS_ADD(worker, tsock, PKT_XMIT_SW_CSUM, nr_seg);
+
+	return 0;
+}
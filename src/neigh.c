@@ -5,6 +5,7 @@
  * Author: Kai Xiong <xiongkai.123@bytedance.com>
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <netinet/if_ether.h>
 #include <sys/socket.h>
@@ -13,6 +14,7 @@
 #include <rte_ethdev.h>
 #include <rte_ether.h>
 #include <rte_ip.h>
+#include <rte_malloc.h>
 
 #include "tpa.h"
 #include "lib/utils.h"
@@ -23,18 +25,37 @@
 #include "neigh.h"
 #include "ctrl.h"
 
+/*
+ * The neigh table is an open addressing hash table of entry pointers,
+ * kept at most half full. It's only modified with the lock held, and
+ * an entry is never moved nor freed once added: a slot is published
+ * after the entry is fully initialized, and a grown table replaces
+ * the old one by RCU. Therefore, workers look it up with no lock.
+ *
+ * The entry mac is protected by a seqlock, and each mac change bumps
+ * the neigh generation, which invalidates all worker neigh caches at
+ * once.
+ */
+#define NEIGH_TABLE_MIN_SIZE	256
+
+struct neigh_table {
+	uint32_t mask;
+	struct rcu_head rcu;
+	struct neigh_entry *slots[0];
+};
+
 struct neigh_cache {
 	int nr_neigh;
 	int accept_garp;
-	struct neigh_entry *gw_neigh;
-	struct neigh_entry *gw6_neigh;
-	struct neigh_entry neigh_entries[MAX_NEIGH_ENTRY];
+	uint32_t gen;
+	struct neigh_table *table;
 
 	struct rte_ring *neigh_waiting_queue;
 	rte_spinlock_t lock;
 };
 
 static struct neigh_cache neigh_cache = {
+	.gen  = 1,
 	.lock = RTE_SPINLOCK_INITIALIZER,
 };
 
@@ -60,21 +81,82 @@ int get_neigh_cache_len(void)
 	return neigh_cache.nr_neigh;
 }
 
-static struct neigh_entry *neigh_find_locked(struct tpa_ip *ip)
+static inline uint32_t neigh_hash(const struct tpa_ip *ip)
 {
-	struct neigh_entry *entry;
-	int i;
+	return (uint32_t)(((ip->u64[0] ^ ip->u64[1]) * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+static struct neigh_table *neigh_table_create(uint32_t size)
+{
+	struct neigh_table *table;
+
+	table = calloc(1, sizeof(struct neigh_table) + sizeof(struct neigh_entry *) * size);
+	if (!table)
+		return NULL;
+
+	table->mask = size - 1;
+
+	return table;
+}
+
+static void neigh_table_free(struct rcu_head *head)
+{
+	free(container_of(head, struct neigh_table, rcu));
+}
+
+static void neigh_table_insert(struct neigh_table *table, struct neigh_entry *entry)
+{
+	uint32_t idx = neigh_hash(&entry->ip) & table->mask;
 
-	for (i = 0; i < neigh_cache.nr_neigh; i++) {
-		entry = &neigh_cache.neigh_entries[i];
+	while (table->slots[idx])
+		idx = (idx + 1) & table->mask;
+
+	rcu_assign_pointer(table->slots[idx], entry);
+}
+
+static struct neigh_entry *neigh_table_find(struct neigh_table *table, struct tpa_ip *ip)
+{
+	struct neigh_entry *entry;
+	uint32_t idx = neigh_hash(ip) & table->mask;
 
+	while ((entry = rcu_dereference(table->slots[idx])) != NULL) {
 		if (tpa_ip_equal(&entry->ip, ip))
 			return entry;
+
+		idx = (idx + 1) & table->mask;
 	}
 
 	return NULL;
 }
 
+/* lock required */
+static int neigh_table_grow(void)
+{
+	struct neigh_table *old = neigh_cache.table;
+	struct neigh_table *new;
+	uint32_t i;
+
+	new = neigh_table_create((old->mask + 1) * 2);
+	if (!new)
+		return -1;
+
+	for (i = 0; i <= old->mask; i++) {
+		if (old->slots[i])
+			neigh_table_insert(new, old->slots[i]);
+	}
+
+	rcu_assign_pointer(neigh_cache.table, new);
+	rcu_call(&old->rcu, neigh_table_free);
+
+	return 0;
+}
+
+#define neigh_find_locked(ip)	neigh_table_find(neigh_cache.table, ip)
+
+/*
+ * For the non-worker threads. It's the table that the lock protects
+ * here; the entry returned stays valid after the unlock.
+ */
 struct neigh_entry *neigh_find(struct tpa_ip *ip)
 {
 	struct neigh_entry *entry;
@@ -86,36 +168,55 @@ struct neigh_entry *neigh_find(struct tpa_ip *ip)
 	return entry;
 }
 
-/* lock required */
-static int neigh_evict(struct neigh_entry *evicted)
+/* for workers only: they are the RCU readers */
+static inline struct neigh_entry *neigh_find_rcu(struct tpa_ip *ip)
 {
-	struct neigh_entry *entry;
-	int idx;
+	return neigh_table_find(rcu_dereference(neigh_cache.table), ip);
+}
+
+void neigh_entry_read_mac(struct neigh_entry *entry, struct rte_ether_addr *mac)
+{
+	uint32_t seq;
 
 	do {
-		idx = rand() % neigh_cache.nr_neigh;
-		entry = &neigh_cache.neigh_entries[idx];
-	} while (entry == neigh_cache.gw_neigh || entry == neigh_cache.gw6_neigh);
+		seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+		rte_ether_addr_copy(&entry->mac, mac);
+		rte_smp_rmb();
+	} while ((seq & 1) || seq != __atomic_load_n(&entry->seq, __ATOMIC_RELAXED));
+}
 
-	*evicted = *entry;
+/* lock required */
+static void neigh_entry_set_mac(struct neigh_entry *entry, uint8_t *mac)
+{
+	__atomic_store_n(&entry->seq, entry->seq + 1, __ATOMIC_RELAXED);
+	rte_smp_wmb();
+	memcpy(entry->mac.addr_bytes, mac, RTE_ETHER_ADDR_LEN);
+	__atomic_store_n(&entry->seq, entry->seq + 1, __ATOMIC_RELEASE);
 
-	return idx;
+	entry->last_update = rte_rdtsc();
 }
 
 /* lock required */
-static void neigh_add(struct tpa_ip *ip, uint8_t *mac, struct neigh_entry *evicted)
+static struct neigh_entry *neigh_add(struct tpa_ip *ip, uint8_t *mac)
 {
-	int idx = neigh_cache.nr_neigh;
+	struct neigh_entry *entry;
+
+	if ((neigh_cache.nr_neigh + 1) * 2 > neigh_cache.table->mask + 1 &&
+	    neigh_table_grow() < 0)
+		return NULL;
 
-	if (idx == MAX_NEIGH_ENTRY)
-		idx = neigh_evict(evicted);
+	entry = calloc(1, sizeof(struct neigh_entry));
+	if (!entry)
+		return NULL;
+
+	entry->ip = *ip;
+	memcpy(entry->mac.addr_bytes, mac, RTE_ETHER_ADDR_LEN);
+	entry->last_update = rte_rdtsc();
 
-	neigh_cache.neigh_entries[idx].ip = *ip;
-	memcpy(neigh_cache.neigh_entries[idx].mac.addr_bytes, mac, RTE_ETHER_ADDR_LEN);
-	neigh_cache.neigh_entries[idx].last_update = rte_rdtsc();
+	neigh_table_insert(neigh_cache.table, entry);
+	neigh_cache.nr_neigh += 1;
 
-	if (neigh_cache.nr_neigh < MAX_NEIGH_ENTRY)
-		neigh_cache.nr_neigh += 1;
+	return entry;
 }
 
 enum {
@@ -127,7 +228,6 @@ enum {
 void neigh_update(struct tpa_ip *ip, uint8_t *mac)
 {
 	struct neigh_entry *entry;
-	struct neigh_entry evicted;
 	char ip_str[INET6_ADDRSTRLEN];
 	int op = NEIGH_NONE;
 
@@ -137,46 +237,41 @@ void neigh_update(struct tpa_ip *ip, uint8_t *mac)
 		return;
 	}
 
-	memset(&evicted, 0, sizeof(evicted));
 	rte_spinlock_lock(&neigh_cache.lock);
 	entry = neigh_find_locked(ip);
 	if (!entry) {
-		neigh_add(ip, mac, &evicted);
+		entry = neigh_add(ip, mac);
 		op = NEIGH_ADD;
 	} else {
 		if (memcmp(entry->mac.addr_bytes, mac, RTE_ETHER_ADDR_LEN) != 0) {
-			memcpy(entry->mac.addr_bytes, mac, RTE_ETHER_ADDR_LEN);
+			int cached = !rte_is_zero_ether_addr(&entry->mac);
+
+			neigh_entry_set_mac(entry, mac);
+
+			/*
+			 * Bump the gen after the mac is set: a worker loads
+			 * the gen before reading the mac, thus it never caches
+			 * the old mac with the new gen. And a placeholder (zero
+			 * mac) is never cached.
+			 */
+			if (cached)
+				__atomic_add_fetch(&neigh_cache.gen, 1, __ATOMIC_RELEASE);
 			op = NEIGH_UPDATE;
-			entry->last_update = rte_rdtsc();
 		}
 	}
 	rte_spinlock_unlock(&neigh_cache.lock);
 
-	if (tpa_ip_is_ipv4(ip)) {
-		if (tpa_ip_get_ipv4(ip) == dev.gw4)
-			neigh_cache.gw_neigh = entry;
-	} else {
-		if (tpa_ip_equal(ip, &dev.gw6.ip))
-			neigh_cache.gw6_neigh = entry;
-	}
-
 	if (op == NEIGH_NONE)
 		return;
 
+	if (!entry) {
+		LOG_ERR("NEIGH failed to add %s: out of memory", ip_str);
+		return;
+	}
+
 	/* do log outside spin lock */
 	LOG("NEIGH %s: %s\t"MAC_FMT, op == NEIGH_ADD ? "add" : "update",
 	    ip_str, MAC_ARGS(mac));
-
-	if (evicted.ip.u64[0] | evicted.ip.u64[1]) {
-		LOG("NEIGH evict: %s\t"MAC_FMT,
-		    tpa_ip_to_str(&evicted.ip, ip_str, sizeof(ip_str)),
-		    MAC_ARGS(mac));
-	}
-}
-
-static inline int invalid_entry(struct neigh_entry *entry)
-{
-	return entry == NULL || rte_is_zero_ether_addr(&entry->mac);
 }
 
 static struct tpa_ip neigh_target_ip(struct tpa_ip *ip)
@@ -198,39 +293,42 @@ static struct tpa_ip neigh_target_ip(struct tpa_ip *ip)
 	return ret;
 }
 
-static struct neigh_entry *do_neigh_lookup(struct tpa_worker *worker, struct tpa_ip *ip)
+/*
+ * Returns the entry, with its mac copied to @mac, if it's resolved.
+ * Otherwise, a placeholder is added on miss, which is the only case
+ * a worker takes the lock.
+ */
+static struct neigh_entry *neigh_resolve(struct tpa_worker *worker, struct tpa_ip *ip,
+					 struct rte_ether_addr *mac)
 {
-	struct neigh_entry *entry = NULL;
-	struct neigh_entry evicted;
-	uint8_t mac[6] = { 0, };
-
-	entry = neigh_find(ip);
-	if (invalid_entry(entry)) {
-		if (!entry) {
-			rte_spinlock_lock(&neigh_cache.lock);
-			neigh_add(ip, mac, &evicted);
-			rte_spinlock_unlock(&neigh_cache.lock);
-		}
+	uint8_t zero_mac[6] = { 0, };
+	struct neigh_entry *entry;
 
-		return NULL;
+	entry = worker ? neigh_find_rcu(ip) : neigh_find(ip);
+	if (entry) {
+		neigh_entry_read_mac(entry, mac);
+		return rte_is_zero_ether_addr(mac) ? NULL : entry;
 	}
 
-	return entry;
+	rte_spinlock_lock(&neigh_cache.lock);
+	if (!neigh_find_locked(ip))
+		neigh_add(ip, zero_mac);
+	rte_spinlock_unlock(&neigh_cache.lock);
+
+	return NULL;
 }
 
-struct neigh_entry *neigh_lookup(struct tpa_worker *worker, struct tpa_ip *ip)
+static struct neigh_entry *do_neigh_lookup(struct tpa_worker *worker, struct tpa_ip *target_ip,
+					   struct rte_ether_addr *mac)
 {
 	struct neigh_entry *entry;
-	struct tpa_ip target_ip;
-
-	target_ip = neigh_target_ip(ip);
 
-	entry = do_neigh_lookup(worker, &target_ip);
+	entry = neigh_resolve(worker, target_ip, mac);
 	if (!entry) {
-		struct neigh_impl *impl = &neigh_impl[!tpa_ip_is_ipv4(&target_ip)];
+		struct neigh_impl *impl = &neigh_impl[!tpa_ip_is_ipv4(target_ip)];
 		int ret;
 
-		ret = impl->ops->nd_solicit(&target_ip, worker);
+		ret = impl->ops->nd_solicit(target_ip, worker);
 		if (ret == 0) {
 			WORKER_STATS_INC(worker, impl->stats_code);
 		} else {
@@ -242,16 +340,47 @@ struct neigh_entry *neigh_lookup(struct tpa_worker *worker, struct tpa_ip *ip)
 	return entry;
 }
 
+struct neigh_entry *neigh_lookup(struct tpa_worker *worker, struct tpa_ip *ip)
+{
+	struct rte_ether_addr mac;
+	struct tpa_ip target_ip;
+
+	target_ip = neigh_target_ip(ip);
+
+	return do_neigh_lookup(worker, &target_ip, &mac);
+}
+
+static inline struct neigh_wcache_entry *neigh_wcache_entry(struct tpa_worker *worker,
+							    struct tpa_ip *ip)
+{
+	return &worker->neigh_wcache->entries[neigh_hash(ip) & (NEIGH_WCACHE_SIZE - 1)];
+}
+
 int eth_lookup(struct tpa_worker *worker, struct tpa_ip *ip, struct rte_ether_hdr *eth)
 {
-	struct neigh_entry *entry;
+	struct neigh_wcache_entry *cached;
+	struct tpa_ip target_ip;
+	uint32_t gen;
 
 	rte_ether_addr_copy(&dev.mac, ETH_SRC_ADDR(eth));
 	eth->ether_type = htons(tpa_ip_is_ipv4(ip) ? RTE_ETHER_TYPE_IPV4 : RTE_ETHER_TYPE_IPV6);
 
-	entry = neigh_lookup(worker, ip);
-	if (entry) {
-		rte_ether_addr_copy(&entry->mac, ETH_DST_ADDR(eth));
+	target_ip = neigh_target_ip(ip);
+	cached = neigh_wcache_entry(worker, &target_ip);
+
+	/* load the gen before the mac; see neigh_update */
+	gen = __atomic_load_n(&neigh_cache.gen, __ATOMIC_ACQUIRE);
+	if (cached->gen == gen && tpa_ip_equal(&cached->ip, &target_ip)) {
+		rte_ether_addr_copy(&cached->mac, ETH_DST_ADDR(eth));
+		worker->neigh_wcache->nr_hit += 1;
+		return 0;
+	}
+
+	worker->neigh_wcache->nr_miss += 1;
+	if (do_neigh_lookup(worker, &target_ip, ETH_DST_ADDR(eth))) {
+		cached->ip  = target_ip;
+		cached->gen = gen;
+		rte_ether_addr_copy(ETH_DST_ADDR(eth), &cached->mac);
 		return 0;
 	}
 
@@ -336,7 +465,7 @@ int neigh_flush(struct tpa_worker *worker)
  */
 static void check_neigh_wait_queue(void)
 {
-	struct neigh_entry *entry;
+	struct rte_ether_addr mac;
 	struct tcp_sock *tsock;
 	struct packet *pkts[NEIGH_QUEUE_LEN];
 	struct tpa_ip ip;
@@ -360,18 +489,18 @@ static void check_neigh_wait_queue(void)
 		}
 
 		ip = neigh_target_ip(&tsock->remote_ip);
-		entry = do_neigh_lookup(NULL, &ip);
-		if (invalid_entry(entry)) {
+		if (!neigh_resolve(NULL, &ip, &mac)) {
 			/* enqueue it back */
 			do_neigh_wait_enqueue(pkts[i]);
 			continue;
 		}
 
-		rte_ether_addr_copy(&entry->mac, rte_pktmbuf_mtod(&pkts[i]->mbuf, struct rte_ether_addr *));
-		rte_ether_addr_copy(&entry->mac, ETH_DST_ADDR(&tsock->net_hdr.eth));
+		rte_ether_addr_copy(&mac, rte_pktmbuf_mtod(&pkts[i]->mbuf, struct rte_ether_addr *));
+		rte_ether_addr_copy(&mac, ETH_DST_ADDR(&tsock->net_hdr.eth));
 
 	push:
 		flex_fifo_push(tsock->worker->neigh_flush_queue, &pkts[i]->neigh_node);
+		worker_kick(tsock->worker);
 	}
 }
 
@@ -433,16 +562,28 @@ static void *neigh_solicit(struct ctrl_event *event)
 {
 	struct neigh_entry *entry;
 	struct neigh_impl *impl;
+	struct neigh_table *table;
+	struct tpa_ip *ips;
 	uint64_t now = rte_rdtsc();
-	int i;
+	int nr_ip = 0;
+	uint32_t i;
 
-	for (i = 0; i < neigh_cache.nr_neigh; i++) {
-		entry = &neigh_cache.neigh_entries[i];
-		if (TSC_TO_US(now - entry->last_update) > SOLICIT_TIMEOUT * 1000000) {
-			impl = &neigh_impl[!tpa_ip_is_ipv4(&entry->ip)];
-			impl->ops->nd_solicit_by_socket(impl->fd, &entry->ip);
-		}
+	/* collect them first, to not solicit with the lock held */
+	rte_spinlock_lock(&neigh_cache.lock);
+	table = neigh_cache.table;
+	ips = malloc(sizeof(struct tpa_ip) * (neigh_cache.nr_neigh + 1));
+	for (i = 0; ips && i <= table->mask; i++) {
+		entry = table->slots[i];
+		if (entry && TSC_TO_US(now - entry->last_update) > SOLICIT_TIMEOUT * 1000000)
+			ips[nr_ip++] = entry->ip;
+	}
+	rte_spinlock_unlock(&neigh_cache.lock);
+
+	while (--nr_ip >= 0) {
+		impl = &neigh_impl[!tpa_ip_is_ipv4(&ips[nr_ip])];
+		impl->ops->nd_solicit_by_socket(impl->fd, &ips[nr_ip]);
 	}
+	free(ips);
 
 	return NULL;
 }
@@ -494,15 +635,19 @@ void neigh_dump(struct shell_buf *reply)
 {
 	struct neigh_entry *entry;
 	char buf[INET6_ADDRSTRLEN];
-	size_t i;
+	uint32_t i;
 
-	for(i = 0; i < neigh_cache.nr_neigh; i++) {
-		entry = &neigh_cache.neigh_entries[i];
+	rte_spinlock_lock(&neigh_cache.lock);
+	for (i = 0; i <= neigh_cache.table->mask; i++) {
+		entry = neigh_cache.table->slots[i];
+		if (!entry)
+			continue;
 
 		shell_append_reply(reply, "%s\t" MAC_FMT "\n",
 				   tpa_ip_to_str(&entry->ip, buf, sizeof(buf)),
 				   MAC_ARGS(entry->mac.addr_bytes));
 	}
+	rte_spinlock_unlock(&neigh_cache.lock);
 }
 
 static int cmd_neigh(struct shell_cmd_info *cmd)
@@ -510,12 +655,27 @@ static int cmd_neigh(struct shell_cmd_info *cmd)
 	neigh_dump(cmd->reply);
 
 	if (cmd->argc == 1 && strcmp(cmd->argv[0], "-s") == 0) {
+		uint64_t nr_hit = 0;
+		uint64_t nr_miss = 0;
+		uint32_t i;
+
+		for (i = 0; i < tpa_cfg.nr_worker; i++) {
+			nr_hit  += workers[i].neigh_wcache->nr_hit;
+			nr_miss += workers[i].neigh_wcache->nr_miss;
+		}
+
 		shell_append_reply(cmd->reply,
 				   "---\n"
 				   "ARP.rx_pkts: %lu\n"
-				   "NDP.rx_pkts: %lu\n",
+				   "NDP.rx_pkts: %lu\n"
+				   "nr_neigh: %d\n"
+				   "gen: %u\n"
+				   "worker_cache.hit: %lu\n"
+				   "worker_cache.miss: %lu\n",
 				   neigh_impl[0].rx_pkts,
-				   neigh_impl[1].rx_pkts);
+				   neigh_impl[1].rx_pkts,
+				   neigh_cache.nr_neigh, neigh_cache.gen,
+				   nr_hit, nr_miss);
 	}
 
 	return 0;
@@ -528,6 +688,16 @@ static const struct shell_cmd neigh = {
 
 void neigh_init(void)
 {
+	uint32_t i;
+
+	neigh_cache.table = neigh_table_create(NEIGH_TABLE_MIN_SIZE);
+	PANIC_ON(neigh_cache.table == NULL, "failed to create neigh table");
+
+	for (i = 0; i < tpa_cfg.nr_worker; i++) {
+		workers[i].neigh_wcache = rte_zmalloc(NULL, sizeof(struct neigh_wcache), 64);
+		PANIC_ON(workers[i].neigh_wcache == NULL, "failed to allocate worker neigh cache");
+	}
+
 	neigh_queue_init();
 	shell_register_cmd(&neigh);
 
@@ -7,8 +7,13 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include <rte_flow.h>
+#include <rte_ring.h>
+#include <rte_spinlock.h>
+#include <rte_pause.h>
 
 #include "lib/utils.h"
 #include "log.h"
@@ -16,6 +21,9 @@
 #include "worker.h"
 #include "cfg.h"
 #include "offload.h"
+#include "port_alloc.h"
+#include "shell.h"
+#include "ctrl.h"
 
 /*
  * XXX: note that we do not support ip fragments.
@@ -104,12 +112,16 @@ struct offload_cfg {
 	uint32_t enable_flow_mark;
 	uint32_t enable_sock_offload;
 	uint32_t enable_port_block_offload;
+	uint32_t async;
+	uint32_t flow_mock;
 };
 
 static struct offload_cfg offload_cfg = {
 	.enable_flow_mark = 1,
 	.enable_sock_offload = 0,
 	.enable_port_block_offload = 1,
+	.async = 0,
+	.flow_mock = 0,
 };
 
 static struct cfg_spec offload_cfg_specs[] = {
@@ -127,6 +139,25 @@ static struct cfg_spec offload_cfg_specs[] = {
 		.type     = CFG_TYPE_UINT,
 		.data     = &offload_cfg.enable_port_block_offload,
 		.flags    = CFG_FLAG_RDONLY,
+	}, {
+		.name	  = "offload.sw_steering",
+		.type     = CFG_TYPE_UINT,
+		.data     = &steer_ctrl.enable,
+		.flags    = CFG_FLAG_RDONLY,
+	}, {
+		.name	  = "offload.async",
+		.type     = CFG_TYPE_UINT,
+		.data     = &offload_cfg.async,
+		.flags    = CFG_FLAG_RDONLY,
+	}, {
+		.name	  = "offload.flow_mock",
+		.type     = CFG_TYPE_UINT,
+		.data     = &offload_cfg.flow_mock,
+		.flags    = CFG_FLAG_RDONLY,
+	}, {
+		.name	  = "offload.flow_mock_delay",
+		.type     = CFG_TYPE_UINT,
+		.data     = &flow_mock.delay_us,
 	},
 };
 
@@ -442,16 +473,30 @@ static void offload_translate(struct offload_rule *rule, struct offload_ctx *ctx
 	add_flow_action(&ctx->actions, RTE_FLOW_ACTION_TYPE_END, NULL);
 }
 
+static const struct flow_ops dpdk_flow_ops = {
+	.create  = rte_flow_create,
+	.destroy = rte_flow_destroy,
+};
+
+static const struct flow_ops *flow_ops = &dpdk_flow_ops;
+
+static inline int offload_nr_port(void)
+{
+	if (offload_cfg.flow_mock)
+		return RTE_MAX(dev.nr_port, 1);
+
+	return dev.nr_port;
+}
+
+/* dev.mutex held */
 static struct rte_flow *flow_create(struct offload_ctx *ctx, int port)
 {
 	struct rte_flow *flow;
 
 	dump_flow(ctx, port);
 
-	pthread_mutex_lock(&dev.mutex);
-	flow = rte_flow_create(port, &ctx->attr, ctx->patterns.items,
-			       ctx->actions.actions, &ctx->error);
-	pthread_mutex_unlock(&dev.mutex);
+	flow = flow_ops->create(port, &ctx->attr, ctx->patterns.items,
+				ctx->actions.actions, &ctx->error);
 	if (!flow) {
 		LOG_ERR("failed to create rte flow: %d, %s on port %d",
 			ctx->error.type, ctx->error.message, port);
@@ -483,7 +528,8 @@ static void offload_set_name(struct offload_list *list, const char *fmt, ...)
 	list->name = name;
 }
 
-static int offload_destroy(struct offload_list *list)
+/* dev.mutex held */
+static int offload_destroy_locked(struct offload_list *list)
 {
 	struct rte_flow_error error;
 	struct offload *offload;
@@ -502,10 +548,7 @@ static int offload_destroy(struct offload_list *list)
 	while (offload) {
 		next = TAILQ_NEXT(offload, node);
 
-		pthread_mutex_lock(&dev.mutex);
-		ret = rte_flow_destroy(offload->port, offload->flow, &error);
-		pthread_mutex_unlock(&dev.mutex);
-
+		ret = flow_ops->destroy(offload->port, offload->flow, &error);
 		if (ret != 0) {
 			LOG("failed to destroy sub-offload %s, %s on port %d",
 			    list->name, error.message, offload->port);
@@ -524,7 +567,8 @@ static int offload_destroy(struct offload_list *list)
 	return failed ? -1 : 0;
 }
 
-static int offload_create(struct offload_list *list, struct offload_rule *rule, int priority)
+/* dev.mutex held */
+static int offload_create_locked(struct offload_list *list, struct offload_rule *rule, int priority)
 {
 	struct offload *offload;
 	struct rte_flow *flow;
@@ -535,7 +579,7 @@ static int offload_create(struct offload_list *list, struct offload_rule *rule,
 
 	offload_translate(rule, &ctx);
 
-	for (i = 0; i < dev.nr_port; i++) {
+	for (i = 0; i < offload_nr_port(); i++) {
 		offload = malloc(sizeof(struct offload));
 		if (!offload)
 			goto fail;
@@ -555,11 +599,471 @@ static int offload_create(struct offload_list *list, struct offload_rule *rule,
 
 fail:
 	LOG_WARN("failed to offload %s", list->name);
-	offload_destroy(list);
+	offload_destroy_locked(list);
 
 	return -1;
 }
 
+/*
+ * The offload manager: the rules of active socks and port blocks are
+ * not programmed in the connect path, but queued to the ctrl thread,
+ * which applies them in batches, with one dev.mutex hold per batch.
+ *
+ * The pkts arriving before the rule is live are caught by the catch-all
+ * rules (with the lowest priority) on the local port range: they are
+ * spread by RSS, and then forwarded to the owner worker by software
+ * steering.
+ *
+ * A released rule is not destroyed right away, but parked in the rule
+ * cache for a while. A later request for the very same rule (say, the
+ * same port block allocated again) takes it back, with no NIC access.
+ *
+ * A group failed to apply is retried every second, a few times. The
+ * sock (or port block) keeps working meanwhile, and after that, too:
+ * its pkts just keep going through the catch-all rules and steering.
+ */
+#define OFFLOAD_QUEUE_SIZE	4096
+#define OFFLOAD_BATCH		64
+#define OFFLOAD_MAX_RULE	2
+#define OFFLOAD_CACHE_SIZE	64
+#define OFFLOAD_CACHE_TIMEOUT	10	/* in seconds */
+#define OFFLOAD_MAX_RETRY	3
+
+/* the low bit of a queued group marks a release request */
+#define OFFLOAD_OP_RELEASE	1ul
+
+enum {
+	OFFLOAD_PENDING,
+	OFFLOAD_LIVE,
+	OFFLOAD_RETRY,		/* at the retry list */
+	OFFLOAD_FAILED,
+};
+
+struct offload_group {
+	struct offload_list list;	/* the flows, once applied */
+	char name[OFFLOAD_NAME_SIZE];	/* list.name is gone on failure */
+
+	int state;
+	int nr_retry;
+	int priority;
+	int nr_rule;
+	struct offload_rule rules[OFFLOAD_MAX_RULE];
+
+	uint64_t cached_at;
+	TAILQ_ENTRY(offload_group) node;	/* at the cache or the retry list */
+	TAILQ_ENTRY(offload_group) release_node;
+};
+
+TAILQ_HEAD(offload_group_list, offload_group);
+
+struct offload_mgr {
+	int active;
+	int efd;
+	uint32_t kicked;
+	struct rte_ring *queue;
+
+	rte_spinlock_t cache_lock;
+	struct offload_group_list cache;	/* the oldest first */
+
+	/* the release requests that don't fit in the queue */
+	rte_spinlock_t release_lock;
+	struct offload_group_list release_overflow;
+
+	struct offload_group_list retry;	/* ctrl thread only */
+
+	struct offload_list catch_all;
+};
+
+static struct offload_mgr offload_mgr = {
+	.efd = -1,
+	.cache_lock = RTE_SPINLOCK_INITIALIZER,
+	.cache = TAILQ_HEAD_INITIALIZER(offload_mgr.cache),
+	.release_lock = RTE_SPINLOCK_INITIALIZER,
+	.release_overflow = TAILQ_HEAD_INITIALIZER(offload_mgr.release_overflow),
+	.retry = TAILQ_HEAD_INITIALIZER(offload_mgr.retry),
+};
+
+struct offload_stats offload_stats;
+
+#define OFFLOAD_STATS_ADD(field, n)	__atomic_add_fetch(&offload_stats.field, (n), __ATOMIC_RELAXED)
+
+static int offload_group_begin(struct offload_list *list, const char *name)
+{
+	struct offload_group *group;
+
+	group = calloc(1, sizeof(struct offload_group));
+	if (!group)
+		return -1;
+
+	tpa_snprintf(group->name, sizeof(group->name), "%s", name);
+	offload_list_init(&group->list);
+	offload_set_name(&group->list, "%s", group->name);
+	if (!group->list.name) {
+		free(group);
+		return -1;
+	}
+
+	list->group = group;
+
+	return 0;
+}
+
+static int offload_group_add_rule(struct offload_group *group, struct offload_rule *rule, int priority)
+{
+	if (group->nr_rule == OFFLOAD_MAX_RULE)
+		return -1;
+
+	group->rules[group->nr_rule++] = *rule;
+	group->priority = priority;
+
+	return 0;
+}
+
+static inline int offload_group_equal(struct offload_group *a, struct offload_group *b)
+{
+	return a->priority == b->priority && a->nr_rule == b->nr_rule &&
+	       memcmp(a->rules, b->rules, sizeof(struct offload_rule) * a->nr_rule) == 0;
+}
+
+/* dev.mutex held */
+static void offload_group_free(struct offload_group *group)
+{
+	offload_destroy_locked(&group->list);
+	free(group);
+}
+
+/* takes the live flows of the same rules from the cache, if any */
+static int offload_cache_take(struct offload_group *group)
+{
+	struct offload_group *cached;
+
+	if (__atomic_load_n(&offload_stats.nr_cached, __ATOMIC_RELAXED) == 0)
+		return -1;
+
+	rte_spinlock_lock(&offload_mgr.cache_lock);
+	TAILQ_FOREACH(cached, &offload_mgr.cache, node) {
+		if (offload_group_equal(cached, group)) {
+			TAILQ_REMOVE(&offload_mgr.cache, cached, node);
+			OFFLOAD_STATS_ADD(nr_cached, -1);
+			break;
+		}
+	}
+	rte_spinlock_unlock(&offload_mgr.cache_lock);
+
+	if (!cached)
+		return -1;
+
+	TAILQ_CONCAT(&group->list.head, &cached->list.head, node);
+	free(cached->list.name);
+	free(cached);
+
+	group->state = OFFLOAD_LIVE;
+	OFFLOAD_STATS_ADD(nr_cache_hit, 1);
+
+	return 0;
+}
+
+/* dev.mutex held */
+static void offload_group_apply(struct offload_group *group)
+{
+	int i;
+
+	/* a failed apply destroys the list, along with its name */
+	if (!group->list.name) {
+		offload_set_name(&group->list, "%s", group->name);
+		if (!group->list.name) {
+			group->state = OFFLOAD_FAILED;
+			OFFLOAD_STATS_ADD(nr_apply_failure, 1);
+			return;
+		}
+	}
+
+	if (offload_cache_take(group) == 0)
+		return;
+
+	for (i = 0; i < group->nr_rule; i++) {
+		if (offload_create_locked(&group->list, &group->rules[i], group->priority) < 0) {
+			group->state = OFFLOAD_FAILED;
+			OFFLOAD_STATS_ADD(nr_apply_failure, 1);
+			return;
+		}
+	}
+
+	group->state = OFFLOAD_LIVE;
+	OFFLOAD_STATS_ADD(nr_apply, 1);
+}
+
+/* ctrl thread; puts a group failed to apply to the retry list */
+static void offload_group_apply_failed(struct offload_group *group)
+{
+	if (group->nr_retry == OFFLOAD_MAX_RETRY) {
+		LOG_ERR("failed to apply offload %s after %d retries; "
+			"its pkts are left to the catch-all rules and steering",
+			group->name, OFFLOAD_MAX_RETRY);
+		return;
+	}
+
+	group->nr_retry += 1;
+	LOG_WARN("failed to apply offload %s; retry %d/%d later",
+		 group->name, group->nr_retry, OFFLOAD_MAX_RETRY);
+
+	group->state = OFFLOAD_RETRY;
+	TAILQ_INSERT_TAIL(&offload_mgr.retry, group, node);
+}
+
+/* dev.mutex held */
+static void offload_group_retire(struct offload_group *group)
+{
+	struct offload_group *evicted = NULL;
+
+	if (group->state != OFFLOAD_LIVE) {
+		if (group->state == OFFLOAD_RETRY)
+			TAILQ_REMOVE(&offload_mgr.retry, group, node);
+
+		offload_group_free(group);
+		return;
+	}
+
+	group->cached_at = rte_rdtsc();
+
+	rte_spinlock_lock(&offload_mgr.cache_lock);
+	TAILQ_INSERT_TAIL(&offload_mgr.cache, group, node);
+	if (OFFLOAD_STATS_ADD(nr_cached, 1) > OFFLOAD_CACHE_SIZE) {
+		evicted = TAILQ_FIRST(&offload_mgr.cache);
+		TAILQ_REMOVE(&offload_mgr.cache, evicted, node);
+		OFFLOAD_STATS_ADD(nr_cached, -1);
+	}
+	rte_spinlock_unlock(&offload_mgr.cache_lock);
+
+	if (evicted) {
+		offload_group_free(evicted);
+		OFFLOAD_STATS_ADD(nr_cache_evict, 1);
+	}
+}
+
+static void offload_kick(void)
+{
+	uint64_t val = 1;
+
+	if (__atomic_exchange_n(&offload_mgr.kicked, 1, __ATOMIC_ACQ_REL) == 0) {
+		if (write(offload_mgr.efd, &val, sizeof(val)) != sizeof(val))
+			LOG_ERR("failed to kick the offload manager: %s", strerror(errno));
+	}
+}
+
+static int offload_enqueue(struct offload_group *group, unsigned long op)
+{
+	if (rte_ring_mp_enqueue(offload_mgr.queue, (void *)((uintptr_t)group | op)) != 0)
+		return -1;
+
+	offload_kick();
+
+	return 0;
+}
+
+static int offload_group_submit(struct offload_list *list)
+{
+	struct offload_group *group = list->group;
+
+	OFFLOAD_STATS_ADD(nr_submit, 1);
+
+	if (offload_cache_take(group) == 0)
+		return 0;
+
+	group->state = OFFLOAD_PENDING;
+	if (offload_enqueue(group, 0) == 0)
+		return 0;
+
+	/* the queue is full: apply it in place */
+	OFFLOAD_STATS_ADD(nr_sync, 1);
+	pthread_mutex_lock(&dev.mutex);
+	offload_group_apply(group);
+	pthread_mutex_unlock(&dev.mutex);
+
+	if (group->state == OFFLOAD_LIVE)
+		return 0;
+
+	pthread_mutex_lock(&dev.mutex);
+	offload_group_free(group);
+	pthread_mutex_unlock(&dev.mutex);
+	list->group = NULL;
+
+	return -1;
+}
+
+static void offload_group_release(struct offload_list *list)
+{
+	struct offload_group *group = list->group;
+
+	list->group = NULL;
+	OFFLOAD_STATS_ADD(nr_release, 1);
+
+	if (offload_enqueue(group, OFFLOAD_OP_RELEASE) == 0)
+		return;
+
+	/*
+	 * Unlike the submit, it can't be done in place: the creation may
+	 * still be queued. Leave it to the overflow list instead.
+	 */
+	OFFLOAD_STATS_ADD(nr_release_overflow, 1);
+	rte_spinlock_lock(&offload_mgr.release_lock);
+	TAILQ_INSERT_TAIL(&offload_mgr.release_overflow, group, release_node);
+	rte_spinlock_unlock(&offload_mgr.release_lock);
+
+	offload_kick();
+}
+
+/*
+ * The requests of one group are applied in order, as they are queued
+ * in order by the owner; a release never goes before its creation.
+ *
+ * The overflowed releases are taken before draining the queue, and
+ * are handled after that: their creations were queued before them,
+ * hence have been applied by then.
+ */
+static void offload_process(void)
+{
+	struct offload_group_list overflow = TAILQ_HEAD_INITIALIZER(overflow);
+	void *reqs[OFFLOAD_BATCH];
+	struct offload_group *group;
+	uint32_t nr_req;
+	uint32_t i;
+
+	rte_spinlock_lock(&offload_mgr.release_lock);
+	TAILQ_CONCAT(&overflow, &offload_mgr.release_overflow, release_node);
+	rte_spinlock_unlock(&offload_mgr.release_lock);
+
+	while (1) {
+		nr_req = rte_ring_sc_dequeue_burst(offload_mgr.queue, reqs, OFFLOAD_BATCH, NULL);
+		if (nr_req == 0)
+			break;
+
+		pthread_mutex_lock(&dev.mutex);
+		for (i = 0; i < nr_req; i++) {
+			group = (struct offload_group *)((uintptr_t)reqs[i] & ~OFFLOAD_OP_RELEASE);
+
+			if ((uintptr_t)reqs[i] & OFFLOAD_OP_RELEASE) {
+				offload_group_retire(group);
+				continue;
+			}
+
+			offload_group_apply(group);
+			if (group->state != OFFLOAD_LIVE)
+				offload_group_apply_failed(group);
+		}
+		pthread_mutex_unlock(&dev.mutex);
+
+		OFFLOAD_STATS_ADD(nr_batch, 1);
+	}
+
+	if (TAILQ_EMPTY(&overflow))
+		return;
+
+	pthread_mutex_lock(&dev.mutex);
+	while ((group = TAILQ_FIRST(&overflow)) != NULL) {
+		TAILQ_REMOVE(&overflow, group, release_node);
+		offload_group_retire(group);
+	}
+	pthread_mutex_unlock(&dev.mutex);
+}
+
+static void *offload_retry(struct ctrl_event *event)
+{
+	struct offload_group_list list = TAILQ_HEAD_INITIALIZER(list);
+	struct offload_group *group;
+
+	if (TAILQ_EMPTY(&offload_mgr.retry))
+		return NULL;
+
+	TAILQ_CONCAT(&list, &offload_mgr.retry, node);
+
+	pthread_mutex_lock(&dev.mutex);
+	while ((group = TAILQ_FIRST(&list)) != NULL) {
+		TAILQ_REMOVE(&list, group, node);
+		OFFLOAD_STATS_ADD(nr_apply_retry, 1);
+
+		offload_group_apply(group);
+		if (group->state != OFFLOAD_LIVE)
+			offload_group_apply_failed(group);
+	}
+	pthread_mutex_unlock(&dev.mutex);
+
+	return NULL;
+}
+
+static void *offload_event(struct ctrl_event *event)
+{
+	uint64_t val;
+
+	if (read(offload_mgr.efd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		LOG_ERR("failed to read offload eventfd: %s", strerror(errno));
+
+	/* pairs with the exchange in offload_kick */
+	__atomic_exchange_n(&offload_mgr.kicked, 0, __ATOMIC_ACQ_REL);
+	offload_process();
+
+	return NULL;
+}
+
+static void *offload_cache_age(struct ctrl_event *event)
+{
+	struct offload_group *group;
+	uint64_t now = rte_rdtsc();
+
+	while (1) {
+		rte_spinlock_lock(&offload_mgr.cache_lock);
+		group = TAILQ_FIRST(&offload_mgr.cache);
+		if (group && TSC_TO_US(now - group->cached_at) > OFFLOAD_CACHE_TIMEOUT * 1000000) {
+			TAILQ_REMOVE(&offload_mgr.cache, group, node);
+			OFFLOAD_STATS_ADD(nr_cached, -1);
+		} else {
+			group = NULL;
+		}
+		rte_spinlock_unlock(&offload_mgr.cache_lock);
+
+		if (!group)
+			break;
+
+		pthread_mutex_lock(&dev.mutex);
+		offload_group_free(group);
+		pthread_mutex_unlock(&dev.mutex);
+		OFFLOAD_STATS_ADD(nr_cache_evict, 1);
+	}
+
+	return NULL;
+}
+
+static int offload_destroy(struct offload_list *list)
+{
+	int ret;
+
+	if (list->group) {
+		offload_group_release(list);
+		return 0;
+	}
+
+	pthread_mutex_lock(&dev.mutex);
+	ret = offload_destroy_locked(list);
+	pthread_mutex_unlock(&dev.mutex);
+
+	return ret;
+}
+
+static int offload_create(struct offload_list *list, struct offload_rule *rule, int priority)
+{
+	int ret;
+
+	/* just collect it; it's submitted as a whole */
+	if (list->group)
+		return offload_group_add_rule(list->group, rule, priority);
+
+	pthread_mutex_lock(&dev.mutex);
+	ret = offload_create_locked(list, rule, priority);
+	pthread_mutex_unlock(&dev.mutex);
+
+	return ret;
+}
+
 static int tsock_offload_do_create(struct tcp_sock *tsock, int ipv6)
 {
 	struct offload_rule rule;
@@ -608,7 +1112,7 @@ int tsock_offload_create(struct tcp_sock *tsock)
 	 * it will always return failure in test. In order to
 	 * pass test cases, a hack is made here.
 	 */
-	if (unlikely(tpa_cfg.nr_dpdk_port == 0))
+	if (unlikely(tpa_cfg.nr_dpdk_port == 0 && !offload_cfg.flow_mock))
 		return 0;
 
 	/*
@@ -619,7 +1123,17 @@ int tsock_offload_create(struct tcp_sock *tsock)
 		return 0;
 
 	get_flow_name(tsock, name, sizeof(name));
-	offload_set_name(&tsock->offload_list, "%s", name);
+
+	/*
+	 * The listen rule is still programmed right away: there is no
+	 * catch-all rule for the listen port.
+	 */
+	if (tsock->state != TCP_STATE_LISTEN && offload_mgr.active) {
+		if (offload_group_begin(&tsock->offload_list, name) < 0)
+			goto fail;
+	} else {
+		offload_set_name(&tsock->offload_list, "%s", name);
+	}
 
 	if (dev.ip4 && (is_ip6_any(ip) || tpa_ip_is_ipv4(ip))) {
 		if (tsock_offload_do_create(tsock, 0) < 0)
@@ -631,6 +1145,9 @@ int tsock_offload_create(struct tcp_sock *tsock)
 			goto fail;
 	}
 
+	if (tsock->offload_list.group && offload_group_submit(&tsock->offload_list) < 0)
+		goto fail;
+
 	return 0;
 
 fail:
@@ -651,14 +1168,22 @@ int port_block_offload_create(struct port_block *block)
 	int i;
 
 	/* ditto */
-	if (unlikely(tpa_cfg.nr_dpdk_port == 0))
+	if (unlikely(tpa_cfg.nr_dpdk_port == 0 && !offload_cfg.flow_mock))
 		return 0;
 
 	if (!offload_cfg.enable_port_block_offload)
 		return 0;
 
-	offload_set_name(&block->offload_list, "port block %hu-%hu",
-			 block->start, block->end);
+	if (offload_mgr.active) {
+		char name[64];
+
+		tpa_snprintf(name, sizeof(name), "port block %hu-%hu", block->start, block->end);
+		if (offload_group_begin(&block->offload_list, name) < 0)
+			goto fail;
+	} else {
+		offload_set_name(&block->offload_list, "port block %hu-%hu",
+				 block->start, block->end);
+	}
 
 	memset(&rule, 0, sizeof(rule));
 
@@ -678,6 +1203,9 @@ int port_block_offload_create(struct port_block *block)
 			goto fail;
 	}
 
+	if (block->offload_list.group && offload_group_submit(&block->offload_list) < 0)
+		goto fail;
+
 	return 0;
 
 fail:
@@ -690,11 +1218,135 @@ void port_block_offload_destroy(struct port_block *block)
 	offload_destroy(&block->offload_list);
 }
 
+/*
+ * Covers [min, max) with the fewest masked port rules, spreading the
+ * pkts by RSS.
+ */
+static int offload_catch_all_create(uint16_t min, uint16_t max)
+{
+	struct offload_list *list = &offload_mgr.catch_all;
+	struct offload_rule rule;
+	struct tpa_ip local_ips[2];
+	uint32_t start = min;
+	uint32_t size;
+	int nr_ip = 0;
+	int i;
+
+	offload_list_init(list);
+	offload_set_name(list, "catch-all %hu-%hu", min, max);
+
+	if (dev.ip4)
+		tpa_ip_set_ipv4(&local_ips[nr_ip++], dev.ip4);
+	if (!is_ip6_any(&dev.ip6.ip))
+		local_ips[nr_ip++] = dev.ip6.ip;
+
+	while (start < max) {
+		size = start ? (start & -start) : (1u << 16);
+		while (start + size > max)
+			size >>= 1;
+
+		memset(&rule, 0, sizeof(rule));
+		OFFLOAD_SET(&rule, dst_port, htons(start));
+		OFFLOAD_SET(&rule, dst_port_mask, htons(0xffff & ~(size - 1)));
+		rule.has_rss = 1;
+
+		for (i = 0; i < nr_ip; i++) {
+			OFFLOAD_SET(&rule, dst_ip, local_ips[i]);
+			if (offload_create(list, &rule, 2) < 0)
+				return -1;
+		}
+
+		start += size;
+	}
+
+	return 0;
+}
+
+static int cmd_offload(struct shell_cmd_info *cmd)
+{
+	shell_append_reply(cmd->reply, "async: %d\n", offload_mgr.active);
+	shell_append_reply(cmd->reply, "nr_submit: %lu\n", offload_stats.nr_submit);
+	shell_append_reply(cmd->reply, "nr_apply: %lu\n", offload_stats.nr_apply);
+	shell_append_reply(cmd->reply, "nr_apply_failure: %lu\n", offload_stats.nr_apply_failure);
+	shell_append_reply(cmd->reply, "nr_apply_retry: %lu\n", offload_stats.nr_apply_retry);
+	shell_append_reply(cmd->reply, "nr_release: %lu\n", offload_stats.nr_release);
+	shell_append_reply(cmd->reply, "nr_release_overflow: %lu\n", offload_stats.nr_release_overflow);
+	shell_append_reply(cmd->reply, "nr_batch: %lu\n", offload_stats.nr_batch);
+	shell_append_reply(cmd->reply, "nr_sync: %lu\n", offload_stats.nr_sync);
+	shell_append_reply(cmd->reply, "nr_cache_hit: %lu\n", offload_stats.nr_cache_hit);
+	shell_append_reply(cmd->reply, "nr_cache_evict: %lu\n", offload_stats.nr_cache_evict);
+	shell_append_reply(cmd->reply, "nr_cached: %lu\n", offload_stats.nr_cached);
+
+	return 0;
+}
+
+static const struct shell_cmd offload_cmd = {
+	.name    = "offload",
+	.handler = cmd_offload,
+};
+
+/*
+ * It's invoked after the sock and steering init, as it depends on the
+ * local port range and software steering.
+ */
+int offload_async_init(void)
+{
+	char name[RTE_RING_NAMESIZE];
+	uint16_t min;
+	uint16_t max;
+
+	shell_register_cmd(&offload_cmd);
+
+	if (!offload_cfg.async)
+		return 0;
+
+	if (tpa_cfg.nr_dpdk_port == 0 && !offload_cfg.flow_mock)
+		return 0;
+
+	if (tpa_cfg.nr_worker > 1 && !steer_ctrl.active) {
+		LOG_WARN("async offload requires sw steering; disabled");
+		return -1;
+	}
+
+	tpa_snprintf(name, sizeof(name), "offload-queue");
+	offload_mgr.queue = rte_ring_create(name, OFFLOAD_QUEUE_SIZE, rte_socket_id(), RING_F_SC_DEQ);
+	if (!offload_mgr.queue)
+		goto fail;
+
+	offload_mgr.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (offload_mgr.efd < 0)
+		goto fail;
+
+	port_alloc_range(&min, &max);
+	if (offload_catch_all_create(min, max) < 0)
+		goto fail;
+
+	if (!ctrl_event_create(offload_mgr.efd, offload_event, NULL, "offload") ||
+	    !ctrl_timeout_event_create(1, offload_cache_age, NULL, "offload-cache") ||
+	    !ctrl_timeout_event_create(1, offload_retry, NULL, "offload-retry"))
+		goto fail;
+
+	offload_mgr.active = 1;
+	LOG("init: async offload, with catch-all rules on ports %hu-%hu", min, max);
+
+	return 0;
+
+fail:
+	/* it's not fatal: the rules are just programmed in place */
+	LOG_ERR("failed to init async offload; disabled");
+	offload_destroy(&offload_mgr.catch_all);
+
+	return -1;
+}
+
 int offload_init(void)
 {
 	cfg_spec_register(offload_cfg_specs, ARRAY_SIZE(offload_cfg_specs));
 	cfg_section_parse("offload");
 
+	if (offload_cfg.flow_mock)
+		flow_ops = &mock_flow_ops;
+
 	if (offload_cfg.enable_sock_offload == 0 && offload_cfg.enable_port_block_offload == 0) {
 		LOG_WARN("none offload enabled; forcing sock offload on");
 		offload_cfg.enable_sock_offload = 1;
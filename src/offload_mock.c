@@ -0,0 +1,66 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <rte_cycles.h>
+#include <rte_flow.h>
+
+#include "offload.h"
+
+struct flow_mock flow_mock;
+
+struct mock_flow {
+	uint16_t port;
+	uint64_t id;
+};
+
+static struct rte_flow *mock_flow_create(uint16_t port, const struct rte_flow_attr *attr,
+					 const struct rte_flow_item pattern[],
+					 const struct rte_flow_action actions[],
+					 struct rte_flow_error *error)
+{
+	struct mock_flow *flow;
+
+	if (flow_mock.delay_us)
+		rte_delay_us_block(flow_mock.delay_us);
+
+	if (flow_mock.fail) {
+		rte_flow_error_set(error, ENOSPC, RTE_FLOW_ERROR_TYPE_UNSPECIFIED,
+				   NULL, "mock failure");
+		return NULL;
+	}
+
+	flow = malloc(sizeof(struct mock_flow));
+	if (!flow) {
+		rte_flow_error_set(error, ENOMEM, RTE_FLOW_ERROR_TYPE_UNSPECIFIED,
+				   NULL, "no memory");
+		return NULL;
+	}
+
+	flow->port = port;
+	flow->id = __atomic_add_fetch(&flow_mock.nr_create, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&flow_mock.nr_flow, 1, __ATOMIC_RELAXED);
+
+	return (struct rte_flow *)flow;
+}
+
+static int mock_flow_destroy(uint16_t port, struct rte_flow *flow, struct rte_flow_error *error)
+{
+	if (flow_mock.delay_us)
+		rte_delay_us_block(flow_mock.delay_us);
+
+	free(flow);
+	__atomic_add_fetch(&flow_mock.nr_destroy, 1, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&flow_mock.nr_flow, 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+const struct flow_ops mock_flow_ops = {
+	.create  = mock_flow_create,
+	.destroy = mock_flow_destroy,
+};
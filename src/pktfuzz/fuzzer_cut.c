@@ -162,7 +162,7 @@ static void cut_tail(struct packet *pkt, int size)
 
 static inline void do_cut(struct dev_txq *txq, struct fuzz_cut_cfg *cut, int payload_len)
 {
-	struct packet *pkt = pktfuzz_packet_copy(txq->pkts[txq->nr_pkt - 1]);
+	struct packet *pkt = pktfuzz_packet_copy(dev_txq_pkt(txq, txq->nr_pkt - 1));
 	int size;
 
 	if (!pkt)
@@ -178,8 +178,8 @@ static inline void do_cut(struct dev_txq *txq, struct fuzz_cut_cfg *cut, int pay
 
 	pktfuzz_update_csum_offload(pkt);
 
-	packet_free(txq->pkts[txq->nr_pkt - 1]);
-	txq->pkts[txq->nr_pkt - 1] = pkt;
+	packet_free(dev_txq_pkt(txq, txq->nr_pkt - 1));
+	dev_txq_pkt(txq, txq->nr_pkt - 1) = pkt;
 	cut->stats.total += 1;
 }
 
@@ -194,7 +194,7 @@ static void cut_fuzz(struct dev_txq *txq)
 	if (!cut->enabled || txq->nr_pkt == 0)
 		return;
 
-	pkt = txq->pkts[txq->nr_pkt - 1];
+	pkt = dev_txq_pkt(txq, txq->nr_pkt - 1);
 	payload_len =  pkt->mbuf.pkt_len - pkt->hdr_len;
 	if (payload_len == 0)
 		return;
@@ -35,7 +35,7 @@ static inline void do_delay(struct dev_txq *txq, struct fuzz_delay_cfg *delay)
 	 * need do copy here as we chain delayed pkts, which could not
 	 * handle pkt retrans well.
 	 */
-	struct packet *pkt = pktfuzz_packet_copy(txq->pkts[txq->nr_pkt - 1]);
+	struct packet *pkt = pktfuzz_packet_copy(dev_txq_pkt(txq, txq->nr_pkt - 1));
 	int delay_usec;
 
 	if (!pkt)
@@ -45,7 +45,7 @@ static inline void do_delay(struct dev_txq *txq, struct fuzz_delay_cfg *delay)
 	pkt->_tx_at = TSC_TO_US(rte_rdtsc()) + delay_usec;
 	TAILQ_INSERT_TAIL(&delayed_pkts, pkt, node);
 
-	packet_free(txq->pkts[--txq->nr_pkt]);
+	packet_free(dev_txq_pkt(txq, --txq->nr_pkt));
 	delay->stats.total += 1;
 }
 
@@ -77,7 +77,7 @@ static void delay_run(struct dev_txq *txq)
 			break;
 
 		TAILQ_REMOVE(&delayed_pkts, pkt, node);
-		txq->pkts[txq->nr_pkt++] = pkt;
+		dev_txq_pkt(txq, txq->nr_pkt++) = pkt;
 	}
 }
 
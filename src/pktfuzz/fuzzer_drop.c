@@ -22,17 +22,16 @@ static inline int drop_pkts_match_port(struct dev_txq *txq, int port)
 {
 	struct packet *pkt;
 	struct rte_tcp_hdr *tcp;
-	struct packet **pkts_to_keep = txq->pkts;
 	int nr_kept = 0;
 	int nr_drop;
 	int i;
 
 	for (i = 0; i < txq->nr_pkt; i++) {
-		pkt = txq->pkts[i];
+		pkt = dev_txq_pkt(txq, i);
 		tcp = packet_tcp_hdr(pkt);
 
 		if (ntohs(tcp->src_port) != port && ntohs(tcp->dst_port) != port)
-			pkts_to_keep[nr_kept++] = pkt;
+			dev_txq_pkt(txq, nr_kept++) = pkt;
 		else
 			packet_free(pkt);
 	}
@@ -46,6 +45,7 @@ static inline int drop_pkts_match_port(struct dev_txq *txq, int port)
 static inline void do_drop(struct dev_txq *txq, struct fuzz_drop_cfg *drop)
 {
 	int nr_to_drop;
+	int i;
 
 	if (drop->port) {
 		drop->stats.dropped += drop_pkts_match_port(txq, drop->port);
@@ -54,12 +54,14 @@ static inline void do_drop(struct dev_txq *txq, struct fuzz_drop_cfg *drop)
 
 	nr_to_drop = get_drop_count(&drop->count, txq->nr_pkt);
 	if (drop->head) {
-		packet_free_batch(&txq->pkts[0], nr_to_drop);
+		for (i = 0; i < nr_to_drop; i++)
+			packet_free(dev_txq_pkt(txq, i));
+		txq->head   += nr_to_drop;
 		txq->nr_pkt -= nr_to_drop;
-		memmove(&txq->pkts[0], &txq->pkts[nr_to_drop], txq->nr_pkt * sizeof(struct packet *));
 	} else {
 		txq->nr_pkt -= nr_to_drop;
-		packet_free_batch(&txq->pkts[txq->nr_pkt], nr_to_drop);
+		for (i = 0; i < nr_to_drop; i++)
+			packet_free(dev_txq_pkt(txq, txq->nr_pkt + i));
 	}
 
 	drop->stats.dropped += nr_to_drop;
@@ -21,7 +21,7 @@ static inline int get_dup_count(struct fuzz_num *nr_pkt, int max)
 
 static inline void do_dup(struct dev_txq *txq, struct fuzz_dup_cfg *dup)
 {
-	struct packet *pkt = txq->pkts[txq->nr_pkt - 1];
+	struct packet *pkt = dev_txq_pkt(txq, txq->nr_pkt - 1);
 	struct rte_tcp_hdr *tcp = packet_tcp_hdr(pkt);
 	int dup_count;
 	int i;
@@ -31,7 +31,7 @@ static inline void do_dup(struct dev_txq *txq, struct fuzz_dup_cfg *dup)
 
 	dup_count = get_dup_count(&dup->nr_pkt, TXQ_BUF_SIZE - txq->nr_pkt);
 	for (i = 0; i < dup_count; i++)
-		txq->pkts[txq->nr_pkt++] = pktfuzz_packet_copy(pkt);
+		dev_txq_pkt(txq, txq->nr_pkt++) = pktfuzz_packet_copy(pkt);
 
 	dup->stats.total += dup_count;
 }
@@ -0,0 +1,131 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <rte_cycles.h>
+
+#include "pktfuzz.h"
+#include "worker.h"
+
+static inline int get_mark_count(struct fuzz_num *count)
+{
+	if (count->random)
+		return (rte_rdtsc() / 3) % 64 + 1;
+
+	return count->num;
+}
+
+/* mark the pkt just enqueued with CE, as a congested switch would do */
+static inline void do_mark(struct dev_txq *txq, struct fuzz_ecn_cfg *ecn)
+{
+	struct packet *pkt = dev_txq_pkt(txq, txq->nr_pkt - 1);
+	struct eth_ip_hdr *hdr;
+	int is_ipv6;
+
+	hdr = rte_pktmbuf_mtod(&pkt->mbuf, struct eth_ip_hdr *);
+	if (hdr->eth.ether_type == htons(RTE_ETHER_TYPE_IPV4))
+		is_ipv6 = 0;
+	else if (hdr->eth.ether_type == htons(RTE_ETHER_TYPE_IPV6))
+		is_ipv6 = 1;
+	else
+		return;
+
+	/* a not-ECT pkt would be dropped instead; leave it to the drop fuzzer */
+	if (net_hdr_get_ecn(hdr, is_ipv6) == IP_ECN_NOT_ECT)
+		return;
+
+	if (ecn->nr_to_mark == 0) {
+		if (!meet_rate(&ecn->rate))
+			return;
+
+		ecn->nr_to_mark = get_mark_count(&ecn->count);
+	}
+
+	/* the ip csum is offloaded; and CE is not covered by the tcp csum */
+	net_hdr_set_ecn(hdr, is_ipv6, IP_ECN_CE);
+	ecn->nr_to_mark -= 1;
+	ecn->stats.marked += 1;
+}
+
+static void ecn_fuzz(struct dev_txq *txq)
+{
+	struct fuzz_ecn_cfg *ecn = &fuzz_cfg.ecn;
+
+	if (!ecn->enabled)
+		return;
+
+	do_mark(txq, ecn);
+}
+
+static void ecn_stats(struct shell_buf *reply, struct fuzz_cfg *fuzz_cfg)
+{
+	struct fuzz_ecn_cfg *ecn = &fuzz_cfg->ecn;
+
+	shell_append_reply(reply,
+			   "ecn:\n"
+			   "\tenabled: %d\n"
+			   RATE_FMT
+			   "\tcount: %s\n"
+			   "\tmarked: %lu\n",
+			   ecn->enabled,
+			   RATE_ARGS(&ecn->rate),
+			   num_to_str(&ecn->count),
+			   ecn->stats.marked);
+}
+
+static void ecn_help(struct shell_buf *reply, struct fuzz_cfg *fuzz_cfg)
+{
+	shell_append_reply(reply,
+			  "ecn           mark ECN capable packets with CE\n"
+			  "  -r rate     specify the marking rate\n"
+			  "  -n num      specify the nubmer of packets to mark in a row\n");
+}
+
+static int ecn_parse(struct fuzz_opt *opts)
+{
+	struct fuzz_ecn_cfg *ecn = &opts->fuzz_cfg->ecn;
+	int enabled = 0;
+	int opt;
+
+	memset(ecn, 0, sizeof(*ecn));
+
+	while ((opt = getopt(opts->argc, opts->argv, "r:n:")) != -1) {
+		switch (opt) {
+		case 'r':
+			parse_rate(&ecn->rate, optarg);
+			enabled = 1;
+			break;
+
+		case 'n':
+			if (parse_num(&ecn->count, optarg, NUM_TYPE_NONE) < 0) {
+				shell_append_reply(opts->reply, "invalid num: %s\n", optarg);
+				return -1;
+			}
+			break;
+
+		default:
+			shell_append_reply(opts->reply, "invalid arg: %c\n", opt);
+			return -1;
+		}
+	}
+
+	if (!num_given(&ecn->count))
+		ecn->count.num = 1;
+
+	ecn->enabled = enabled;
+
+	return 0;
+}
+
+const struct fuzzer fuzzer_ecn = {
+	.name   = "ecn",
+	.fuzz   = ecn_fuzz,
+	.parse  = ecn_parse,
+	.stats  = ecn_stats,
+	.help   = ecn_help,
+};
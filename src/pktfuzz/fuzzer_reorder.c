@@ -23,7 +23,7 @@ static inline void do_reorder(struct dev_txq *txq, struct fuzz_reorder_cfg *reor
 	if (txq->nr_pkt < 2)
 		return;
 
-	swap_packet(&txq->pkts[0], &txq->pkts[txq->nr_pkt - 1]);
+	swap_packet(dev_txq_slot(txq, 0), dev_txq_slot(txq, txq->nr_pkt - 1));
 	reorder->stats.reordered += 1;
 }
 
@@ -12,6 +12,8 @@
 #include "log.h"
 
 static const struct fuzzer *fuzzers[] = {
+	/* it works on the pkt just enqueued; put it before any reorder */
+	&fuzzer_ecn,
 	&fuzzer_reorder,
 	&fuzzer_cut,
 	&fuzzer_dup,
@@ -179,7 +181,8 @@ static int cmd_fuzz_help(struct fuzz_opt *opts)
 			   "\n"
 			   "examples:\n"
 			   "    tpa pktfuzz egress drop -r 0.1\n"
-			   "    tpa pktfuzz egress cut -r 0.1%% -n 10 -h\n");
+			   "    tpa pktfuzz egress cut -r 0.1%% -n 10 -h\n"
+			   "    tpa pktfuzz egress ecn -r 5 -n 8\n");
 
 	return 0;
 }
@@ -7,7 +7,6 @@
 #include <sys/queue.h>
 
 #include <rte_cycles.h>
-#include <rte_spinlock.h>
 
 #include "port_alloc.h"
 #include "log.h"
@@ -22,9 +21,22 @@
 
 #define PORT_FREED		-1
 
+/*
+ * A port is reserved at two levels:
+ *
+ * - in this instance, by setting its bit in the port bitmap, with no
+ *   lock. A port block takes exactly one bitmap word, thus it's
+ *   reserved with one CAS, and the workers don't serialize on it.
+ *
+ * - on the host, by binding each port of it with a kernel socket, which
+ *   is kept for the block lifetime. It keeps off both the kernel stack
+ *   apps and the other libtpa instances, for every port of the block.
+ *
+ * The binds are paid once per block though, not per connection: with
+ * the ports shared among remote ends (see port_bind_on_random_port),
+ * a worker seldom needs a new block.
+ */
 struct port_alloc_ctrl {
-	rte_spinlock_t lock;
-
 	/*
 	 * below specifies the local port range for this instance, while
 	 * PORT_MIN and PORT_MAX specifies the port range for libtpa
@@ -32,6 +44,9 @@ struct port_alloc_ctrl {
 	uint16_t min;
 	uint16_t max;
 
+	/* where the port block search starts from, for worker 0 */
+	uint32_t block_seed;
+
 	uint64_t nr_port_allocated;
 	uint64_t nr_port_allocated_total;
 	uint64_t nr_socket_failure;
@@ -39,7 +54,8 @@ struct port_alloc_ctrl {
 
 	uint64_t nr_port_block;
 
-	int port_map[1<<16];
+	uint64_t port_bitmap[(1<<16) / 64];
+	int port_fds[1<<16];
 };
 
 static struct port_alloc_ctrl pac = {
@@ -47,23 +63,55 @@ static struct port_alloc_ctrl pac = {
 	.max = PORT_MAX,
 };
 
+#define PAC_STATS_ADD(field, n)		__atomic_add_fetch(&pac.field, (n), __ATOMIC_RELAXED)
+
 static inline int port_allocated(uint16_t port)
 {
-	return pac.port_map[port] >= 0;
+	return !!(__atomic_load_n(&pac.port_bitmap[port / 64], __ATOMIC_RELAXED) &
+		  (1ull << (port & 63)));
+}
+
+/* a range never crosses a bitmap word */
+static inline uint64_t port_range_mask(uint16_t start, uint16_t size)
+{
+	debug_assert(size >= 1 && (start & 63) + size <= 64);
+
+	if (size == 64)
+		return UINT64_MAX;
+
+	return ((1ull << size) - 1) << (start & 63);
+}
+
+static int port_range_mark(uint16_t start, uint16_t size)
+{
+	uint64_t *word = &pac.port_bitmap[start / 64];
+	uint64_t mask = port_range_mask(start, size);
+	uint64_t old = __atomic_load_n(word, __ATOMIC_RELAXED);
+
+	do {
+		if (old & mask)
+			return -1;
+	} while (!__atomic_compare_exchange_n(word, &old, old | mask, 0,
+					      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+	return 0;
 }
 
-static inline int do_port_alloc(uint16_t port)
+static void port_range_unmark(uint16_t start, uint16_t size)
+{
+	__atomic_and_fetch(&pac.port_bitmap[start / 64], ~port_range_mask(start, size),
+			   __ATOMIC_RELEASE);
+}
+
+static int port_kernel_bind(uint16_t port)
 {
 	struct sockaddr_in6 addr;
 	int fd;
 
-	if (port_allocated(port))
-		return 0;
-
 	fd = socket(AF_INET6, SOCK_STREAM, 0);
 	if (fd == -1) {
-		pac.nr_socket_failure += 1;
-		return 0;
+		PAC_STATS_ADD(nr_socket_failure, 1);
+		return -1;
 	}
 
 	memset(&addr, 0, sizeof(addr));
@@ -71,17 +119,54 @@ static inline int do_port_alloc(uint16_t port)
 	addr.sin6_addr = in6addr_any;
 	addr.sin6_port = htons(port);
 	if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr))) < 0) {
-		pac.nr_bind_failure += 1;
+		PAC_STATS_ADD(nr_bind_failure, 1);
 		close(fd);
-		return 0;
+		return -1;
 	}
 
-	pac.port_map[port] = fd;
+	return fd;
+}
 
-	pac.nr_port_allocated += 1;
-	pac.nr_port_allocated_total += 1;
+static void do_port_range_release(uint16_t start, uint16_t size)
+{
+	uint32_t port;
 
-	return port;
+	for (port = start; port < start + size; port++) {
+		if (pac.port_fds[port] >= 0) {
+			close(pac.port_fds[port]);
+			pac.port_fds[port] = PORT_FREED;
+		}
+	}
+
+	port_range_unmark(start, size);
+}
+
+/* reserves [start, start + size): it's claimed in the bitmap first, then bound */
+static int port_range_reserve(uint16_t start, uint16_t size)
+{
+	uint32_t port;
+
+	if (port_range_mark(start, size) < 0)
+		return -1;
+
+	for (port = start; port < start + size; port++) {
+		pac.port_fds[port] = port_kernel_bind(port);
+		if (pac.port_fds[port] < 0) {
+			do_port_range_release(start, size);
+			return -1;
+		}
+	}
+
+	PAC_STATS_ADD(nr_port_allocated, size);
+	PAC_STATS_ADD(nr_port_allocated_total, size);
+
+	return 0;
+}
+
+static void port_range_release(uint16_t start, uint16_t size)
+{
+	do_port_range_release(start, size);
+	PAC_STATS_ADD(nr_port_allocated, -(uint64_t)size);
 }
 
 uint16_t port_alloc(uint16_t port)
@@ -89,11 +174,11 @@ uint16_t port_alloc(uint16_t port)
 	int nr_try = 0;
 
 	if (port)
-		return do_port_alloc(port);
+		return port_range_reserve(port, 1) == 0 ? port : 0;
 
 	port = (rte_rdtsc() % PORT_COUNT) + pac.min;
 	while (nr_try++ < PORT_COUNT) {
-		if (do_port_alloc(port) > 0)
+		if (port_range_reserve(port, 1) == 0)
 			return port;
 
 		port += 1;
@@ -106,16 +191,12 @@ uint16_t port_alloc(uint16_t port)
 
 int port_free(uint16_t port)
 {
-	int fd = pac.port_map[port];
-
-	if (fd >= 0) {
-		pac.nr_port_allocated -= 1;
-		close(fd);
-	}
+	if (!port_allocated(port))
+		return -1;
 
-	pac.port_map[port] = PORT_FREED;
+	port_range_release(port, 1);
 
-	return fd >= 0 ? 0 : - 1;
+	return 0;
 }
 
 static inline void port_block_get(struct port_block *block)
@@ -155,14 +236,11 @@ static void worker_drop_port_block(struct tpa_worker *worker, struct port_block
 
 static void port_block_free(struct port_block *block)
 {
-	uint16_t port;
-
 	LOG("freeing port block %hu-%hu", block->start, block->end);
 
 	debug_assert(block->refcnt == 0);
 
-	for (port = block->start; port < block->end; port++)
-		port_free(port);
+	port_range_release(block->start, block->size);
 
 	port_block_offload_destroy(block);
 	worker_drop_port_block(block->worker, block);
@@ -194,38 +272,21 @@ static struct port_block *port_block_find(struct port_block **blocks, int nr_blo
 	return NULL;
 }
 
-static inline int port_range_is_free(uint16_t start, uint16_t size)
-{
-	uint16_t i;
-
-	for (i = 0; i < size; i++)
-		if (pac.port_map[start + i] >= 0)
-			return 0;
-
-	return 1;
-}
-
 static struct port_block *do_port_block_alloc(struct tpa_worker *worker, uint16_t start, uint16_t size)
 {
 	struct port_block *block;
-	uint16_t ports[DEFAULT_PORT_BLOCK_SIZE];
-	uint16_t i;
 
+	errno = 0;
 	if (size & ~size)
 		return NULL;
 
-	/* do a quick check whether the range is free in this libtpa instance */
-	if (!port_range_is_free(start, size))
+	if (port_range_reserve(start, size) < 0)
 		return NULL;
 
 	block = malloc(sizeof(struct port_block));
-	if (!block)
+	if (!block) {
+		port_range_release(start, size);
 		return NULL;
-
-	for (i = 0; i < size; i++) {
-		ports[i] = port_alloc(start + i);
-		if (ports[i] == 0)
-			goto fail;
 	}
 
 	block->start = start;
@@ -242,32 +303,26 @@ static struct port_block *do_port_block_alloc(struct tpa_worker *worker, uint16_
 	errno = 0;
 	if (port_block_offload_create(block) < 0) {
 		/* FIXME: choose a better error code? */
+		port_range_release(start, size);
+		free(block);
 		errno = EBUSY;
-		goto fail;
+		return NULL;
 	}
 
-	pac.nr_port_block += 1;
+	PAC_STATS_ADD(nr_port_block, 1);
 
 	return block;
-
-fail:
-	free(block);
-	while (i-- > 0)
-		port_free(ports[i]);
-
-	return NULL;
 }
 
 static struct port_block *port_block_alloc(struct tpa_worker *worker, uint16_t port)
 {
 	struct port_block *block = NULL;
-	uint16_t start;
-	int nr_retry = 0;
+	uint32_t nr_block;
+	uint32_t idx;
+	uint32_t nr_retry = 0;
 	uint16_t min;
 	uint16_t max;
 
-	rte_spinlock_lock(&pac.lock);
-
 	if (port) {
 		block = do_port_block_alloc(worker, port & ~DEFAULT_PORT_BLOCK_MASK, DEFAULT_PORT_BLOCK_SIZE);
 		goto out;
@@ -275,22 +330,23 @@ static struct port_block *port_block_alloc(struct tpa_worker *worker, uint16_t p
 
 	min = (pac.min + DEFAULT_PORT_BLOCK_MASK) & ~DEFAULT_PORT_BLOCK_MASK;
 	max = (pac.max & ~DEFAULT_PORT_BLOCK_MASK);
-	start = (((rte_rdtsc() >> 2) % PORT_COUNT) + min) & ~DEFAULT_PORT_BLOCK_MASK;
-	while (nr_retry++ < (max - min) / DEFAULT_PORT_BLOCK_SIZE) {
-		if (start >= max)
-			start = min;
+	if (max <= min)
+		return NULL;
 
-		debug_assert(start + DEFAULT_PORT_BLOCK_SIZE <= pac.max);
-		block = do_port_block_alloc(worker, start, DEFAULT_PORT_BLOCK_SIZE);
+	/* each worker starts from its own slice, to not race with the others */
+	nr_block = (max - min) / DEFAULT_PORT_BLOCK_SIZE;
+	idx = (pac.block_seed + worker->id * nr_block / tpa_cfg.nr_worker) % nr_block;
+	while (nr_retry++ < nr_block) {
+		block = do_port_block_alloc(worker, min + idx * DEFAULT_PORT_BLOCK_SIZE,
+					    DEFAULT_PORT_BLOCK_SIZE);
 		if (block || errno == EBUSY)
 			break;
 
-		start += DEFAULT_PORT_BLOCK_SIZE;
+		if (++idx == nr_block)
+			idx = 0;
 	}
 
 out:
-	rte_spinlock_unlock(&pac.lock);
-
 	if (block)
 		LOG("allocated port block %hu-%hu", block->start, block->end);
 
@@ -372,6 +428,12 @@ int local_port_range_get(struct cfg_spec *spec, char *val)
 	return 0;
 }
 
+void port_alloc_range(uint16_t *min, uint16_t *max)
+{
+	*min = pac.min;
+	*max = pac.max;
+}
+
 static void list_port(struct shell_buf *reply)
 {
 	uint16_t start = 0;
@@ -428,8 +490,8 @@ void port_alloc_init(void)
 {
 	reserve_local_port();
 
-	memset(pac.port_map, PORT_FREED, sizeof(pac.port_map));
-	rte_spinlock_init(&pac.lock);
+	memset(pac.port_fds, PORT_FREED, sizeof(pac.port_fds));
+	pac.block_seed = rte_rdtsc() >> 2;
 
 	shell_register_cmd(&port_alloc_cmd);
 }
@@ -506,25 +568,43 @@ static uint16_t port_bind_on_given_port(struct tpa_worker *worker, struct sock_k
 	return port;
 }
 
+static inline uint32_t port_hash(struct sock_key *key)
+{
+	uint64_t v = key->remote_ip.u64[0] ^ key->remote_ip.u64[1] ^ key->remote_port;
+
+	return (uint32_t)((v * 0x9e3779b97f4a7c15ull) >> 32);
+}
+
+/*
+ * The ports of all blocks are walked in order, starting from an offset
+ * derived from the remote end plus a per worker cursor (RFC 6056,
+ * algorithm 3). Since the sock table is keyed by the 4-tuple, a local
+ * port serves different remote ends at the same time, while for a
+ * given remote end, a port is reused as late as possible.
+ */
 static uint16_t port_bind_on_random_port(struct tpa_worker *worker, struct sock_key *key,
 					 struct tcp_sock *tsock)
 {
+	uint32_t nr_port = worker->nr_port_block * DEFAULT_PORT_BLOCK_SIZE;
 	struct port_block *block;
 	uint16_t port;
-	int nr_try = 0;
-	int idx;
+	uint32_t idx;
+	uint32_t i;
 
-	if (worker->nr_port_block == 0)
+	if (nr_port == 0)
 		goto alloc;
 
-	idx = (rte_rdtsc() >> 2) % worker->nr_port_block;
-	while (nr_try++ < worker->nr_port_block) {
-		port = bind_from_port_block(worker->port_blocks[idx], worker, key, tsock);
-		if (port > 0)
-			return port;
+	idx = (port_hash(key) + worker->port_cursor) % nr_port;
+	for (i = 0; i < nr_port; i++) {
+		block = worker->port_blocks[idx / DEFAULT_PORT_BLOCK_SIZE];
+		key->local_port = block->start + (idx & DEFAULT_PORT_BLOCK_MASK);
+		if (sock_table_add(&worker->sock_table, key, tsock) == 0) {
+			worker->port_cursor += i + 1;
+			port_block_get(block);
+			return key->local_port;
+		}
 
-		idx += 1;
-		if (idx >= worker->nr_port_block)
+		if (++idx == nr_port)
 			idx = 0;
 	}
 
@@ -0,0 +1,150 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <errno.h>
+
+#include <rte_spinlock.h>
+
+#include "rcu.h"
+#include "ctrl.h"
+#include "log.h"
+
+/* in seconds */
+#define RCU_RECLAIM_INTERVAL		1
+
+uint64_t rcu_epoch;
+
+TAILQ_HEAD(rcu_head_list, rcu_head);
+
+static struct {
+	rte_spinlock_t lock;
+
+	int nr_reader;
+	struct rcu_reader *readers[RCU_MAX_READER];
+
+	struct rcu_head_list pending;
+} rcu_ctrl = {
+	.lock    = RTE_SPINLOCK_INITIALIZER,
+	.pending = TAILQ_HEAD_INITIALIZER(rcu_ctrl.pending),
+};
+
+int rcu_reader_register(struct rcu_reader *reader)
+{
+	int ret = 0;
+
+	rte_spinlock_lock(&rcu_ctrl.lock);
+	if (rcu_ctrl.nr_reader >= RCU_MAX_READER) {
+		errno = ENOSPC;
+		ret = -1;
+	} else {
+		rcu_quiescent(reader);
+		rcu_ctrl.readers[rcu_ctrl.nr_reader++] = reader;
+	}
+	rte_spinlock_unlock(&rcu_ctrl.lock);
+
+	return ret;
+}
+
+void rcu_reader_unregister(struct rcu_reader *reader)
+{
+	int i;
+
+	rte_spinlock_lock(&rcu_ctrl.lock);
+	for (i = 0; i < rcu_ctrl.nr_reader; i++) {
+		if (rcu_ctrl.readers[i] == reader) {
+			rcu_ctrl.readers[i] = rcu_ctrl.readers[--rcu_ctrl.nr_reader];
+			break;
+		}
+	}
+	rte_spinlock_unlock(&rcu_ctrl.lock);
+}
+
+static uint64_t min_reader_epoch(void)
+{
+	uint64_t min = RCU_EPOCH_OFFLINE;
+	uint64_t epoch;
+	int i;
+
+	for (i = 0; i < rcu_ctrl.nr_reader; i++) {
+		epoch = __atomic_load_n(&rcu_ctrl.readers[i]->epoch, __ATOMIC_ACQUIRE);
+		if (epoch < min)
+			min = epoch;
+	}
+
+	return min;
+}
+
+static int do_rcu_reclaim(void)
+{
+	struct rcu_head *head;
+	uint64_t min;
+	int nr_reclaimed = 0;
+
+	if (TAILQ_EMPTY(&rcu_ctrl.pending))
+		return 0;
+
+	min = min_reader_epoch();
+
+	/* the pending list is sorted by epoch */
+	while ((head = TAILQ_FIRST(&rcu_ctrl.pending)) != NULL) {
+		if (head->epoch > min)
+			break;
+
+		TAILQ_REMOVE(&rcu_ctrl.pending, head, node);
+		head->cb(head);
+		nr_reclaimed += 1;
+	}
+
+	return nr_reclaimed;
+}
+
+int rcu_reclaim(void)
+{
+	int ret;
+
+	rte_spinlock_lock(&rcu_ctrl.lock);
+	ret = do_rcu_reclaim();
+	rte_spinlock_unlock(&rcu_ctrl.lock);
+
+	return ret;
+}
+
+void rcu_call(struct rcu_head *head, rcu_cb_t cb)
+{
+	head->cb = cb;
+
+	rte_spinlock_lock(&rcu_ctrl.lock);
+
+	/*
+	 * Any reader reporting this (or a later) epoch has done so after
+	 * the new version is published, thus it can't see the old one.
+	 */
+	head->epoch = __atomic_add_fetch(&rcu_epoch, 1, __ATOMIC_SEQ_CST);
+	TAILQ_INSERT_TAIL(&rcu_ctrl.pending, head, node);
+
+	do_rcu_reclaim();
+
+	rte_spinlock_unlock(&rcu_ctrl.lock);
+}
+
+/*
+ * rcu_call reclaims what it could at the time, which leaves the last
+ * pending one (or more) behind until the next update. Reclaim it
+ * periodically at the ctrl thread, so that it's not held forever.
+ */
+static void *rcu_reclaim_timeout(struct ctrl_event *event)
+{
+	rcu_reclaim();
+
+	return NULL;
+}
+
+void rcu_init(void)
+{
+	if (!ctrl_timeout_event_create(RCU_RECLAIM_INTERVAL, rcu_reclaim_timeout,
+				       NULL, "rcu-reclaim"))
+		LOG_WARN("failed to create rcu reclaim event");
+}
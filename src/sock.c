@@ -21,8 +21,21 @@
 #include "archive.h"
 #include "neigh.h"
 #include "port_alloc.h"
+#include "rcu.h"
+#include "tcp_cc.h"
 
-static struct sock_table listen_sock_table;
+/*
+ * The listen table is looked up by all workers on every SYN, while it
+ * is updated at listen and close only. Therefore, it's RCU protected:
+ * lookup takes no lock; update builds a new table and publishes it.
+ */
+struct listen_table {
+	struct sock_table table;
+	struct rcu_head rcu;
+};
+
+static struct listen_table *listen_table;
+static rte_spinlock_t listen_table_lock = RTE_SPINLOCK_INITIALIZER;
 
 struct tcp_cfg tcp_cfg = {
 	.enable_tso		= 1,
@@ -34,10 +47,12 @@ struct tcp_cfg tcp_cfg = {
 	.measure_latency	= 0,
 	.usr_snd_mss		= 0,
 	.rcv_queue_size		= TSOCK_RXQ_LEN_DEFAULT,
+	.rcv_queue_size_max	= TSOCK_RXQ_LEN_MAX,
 	.snd_queue_size		= TSOCK_TXQ_LEN_DEFAULT,
 	.time_wait		= TCP_TIME_WAIT_DEFAULT,
 	.keepalive		= TCP_KEEPALIVE_DEFAULT,
 	.delayed_ack		= TCP_DELAYED_ACK_DEFAULT,
+	.gro_timeout		= TCP_GRO_TIMEOUT_DEFAULT,
 	.cwnd_init		= TCP_CWND_DEFAULT,
 	.cwnd_max		= TCP_CWND_MAX,
 	.rcv_ooo_limit		= TSOCK_RCV_OOO_LIMIT,
@@ -47,6 +62,8 @@ struct tcp_cfg tcp_cfg = {
 	.retries		= TCP_RETRIES_MAX,
 	.syn_retries		= TCP_SYN_RETRIES_MAX,
 	.write_chunk_size	= WRITE_CHUNK_SIZE,
+	.ecn			= 0,
+	.pacing			= 0,
 };
 
 static struct cfg_spec tcp_cfg_specs[] = {
@@ -87,6 +104,12 @@ static struct cfg_spec tcp_cfg_specs[] = {
 		.data   = &tcp_cfg.delayed_ack,
 		.flags  = CFG_FLAG_HAS_MAX,
 		.max    = 500 * 1000, /* rfc1122 4.2.3.2 (page 96) */
+	}, {
+		.name	= "tcp.gro_timeout",
+		.type   = CFG_TYPE_TIME,
+		.data   = &tcp_cfg.gro_timeout,
+		.flags  = CFG_FLAG_HAS_MAX,
+		.max    = TCP_GRO_TIMEOUT_MAX,
 	}, {
 		.name   = "tcp.tso",
 		.type   = CFG_TYPE_UINT,
@@ -107,6 +130,14 @@ static struct cfg_spec tcp_cfg_specs[] = {
 		.name   = "tcp.opt_sack",
 		.type   = CFG_TYPE_UINT,
 		.data   = &tcp_cfg.enable_sack,
+	}, {
+		.name   = "tcp.ecn",
+		.type   = CFG_TYPE_UINT,
+		.data   = &tcp_cfg.ecn,
+	}, {
+		.name   = "tcp.pacing",
+		.type   = CFG_TYPE_UINT,
+		.data   = &tcp_cfg.pacing,
 	}, {
 		.name	= "tcp.retries",
 		.type   = CFG_TYPE_UINT,
@@ -125,6 +156,12 @@ static struct cfg_spec tcp_cfg_specs[] = {
 		.data   = &tcp_cfg.rcv_queue_size,
 		.flags  = CFG_FLAG_HAS_MAX,
 		.max    = 1<<15,
+	}, {
+		.name	= "tcp.rcv_queue_size_max",
+		.type   = CFG_TYPE_UINT,
+		.data   = &tcp_cfg.rcv_queue_size_max,
+		.flags  = CFG_FLAG_HAS_MAX,
+		.max    = 1<<15,
 	}, {
 		.name	= "tcp.snd_queue_size",
 		.type   = CFG_TYPE_UINT,
@@ -160,7 +197,7 @@ static struct cfg_spec tcp_cfg_specs[] = {
 		.type   = CFG_TYPE_TIME,
 		.data   = &tcp_cfg.tcp_rto_min,
 		.flags  = CFG_FLAG_HAS_MIN | CFG_FLAG_HAS_MAX,
-		.min    = 10000, /* 10ms */
+		.min    = 100, /* 100us */
 		.max    = TCP_RTO_MAX,
 	}, {
 		.name	= "tcp.write_chunk_size",
@@ -174,10 +211,16 @@ static struct cfg_spec tcp_cfg_specs[] = {
 		.type   = CFG_TYPE_STR, /* XXX: a new type? */
 		.set    = local_port_range_set,
 		.get    = local_port_range_get,
+	}, {
+		.name   = "tcp.cc",
+		.type   = CFG_TYPE_STR,
+		.set    = tcp_cc_set,
+		.get    = tcp_cc_get,
 	},
 };
 
 struct sock_ctrl *sock_ctrl;
+struct tsock_stats *tsock_stats;
 struct tsock_trace_ctrl tsock_trace_ctrl;
 
 /*
@@ -359,9 +402,18 @@ static int tsock_init(struct tcp_sock *tsock, int sid, const struct tpa_sock_opt
 
 	memset((uint8_t *)tsock + sizeof(tsock->sid), 0, sizeof(*tsock) - sizeof(tsock->sid));
 
-	if (opts)
+	tsock->stats = &tsock_stats[sid];
+	memset(tsock->stats, 0, sizeof(struct tsock_stats));
+
+	tsock->cc = tcp_cc_default;
+	if (opts) {
 		convert_sock_opts(opts, &tsock->opts);
 
+		/* it's been validated by sock_opts_check */
+		if (opts->cc[0])
+			tsock->cc = tcp_cc_find(opts->cc);
+	}
+
 	__sync_fetch_and_add_4(&worker->nr_tsock, 1);
 	__sync_fetch_and_add_8(&worker->nr_tsock_total, 1);
 
@@ -374,6 +426,8 @@ static int tsock_init(struct tcp_sock *tsock, int sid, const struct tpa_sock_opt
 	timer_init(&tsock->timer_rto,  &worker->timer_ctrl, tcp_timeout, tsock, now);
 	timer_init(&tsock->timer_wait, &worker->timer_ctrl, tcp_timeout, tsock, now);
 	timer_init(&tsock->timer_keepalive, &worker->timer_ctrl, tcp_timeout, tsock, now);
+	timer_init(&tsock->timer_rack, &worker->timer_ctrl, tcp_timeout, tsock, now);
+	timer_init(&tsock->timer_tlp,  &worker->timer_ctrl, tcp_timeout, tsock, now);
 
 	/* TODO: we don't have to re-alloc it when the rxq or txq size are the same */
 	tsock->rxq.objs = malloc(tcp_cfg.rcv_queue_size * sizeof(void *));
@@ -391,7 +445,8 @@ static int tsock_init(struct tcp_sock *tsock, int sid, const struct tpa_sock_opt
 	tsock_trace_init(tsock, sid);
 
 	tsock->worker = worker;
-	tsock->rcv_wnd = TSOCK_RCV_WND_DEFAULT(tsock);
+	tsock->rcv_wnd = tsock_rcv_space(tsock);
+	tsock->rcv_space_ts = now;
 	tsock->quickack = TSOCK_QUICKACK_COUNT;
 	tsock->listen_sock = 0;
 	rte_spinlock_init(&tsock->lock);
@@ -459,6 +514,16 @@ static void reclaim_rcv_ooo_queue(struct tcp_sock *tsock)
 	}
 
 	debug_assert(tsock->nr_ooo_pkt == 0);
+	ooo_index_free(&tsock->ooo_index);
+}
+
+/* it might be held by GRO */
+static void reclaim_rx_merge_head(struct tcp_sock *tsock)
+{
+	if (tsock->rx_merge_head) {
+		packet_free(tsock->rx_merge_head);
+		tsock->rx_merge_head = NULL;
+	}
 }
 
 static int tsock_unbind(struct tcp_sock *tsock)
@@ -467,6 +532,8 @@ static int tsock_unbind(struct tcp_sock *tsock)
 
 	sock_key_init(&key, &tsock->remote_ip, ntohs(tsock->remote_port),
 		      &tsock->local_ip, ntohs(tsock->local_port));
+	steer_index_del(&key);
+
 	return port_unbind(tsock->worker, &key);
 }
 
@@ -476,9 +543,79 @@ static int remove_passive_sock(struct tcp_sock *tsock)
 
 	sock_key_init(&key, &tsock->remote_ip, ntohs(tsock->remote_port),
 		      &tsock->local_ip, ntohs(tsock->local_port));
+	steer_index_del(&key);
+
 	return sock_table_del(&tsock->worker->sock_table, &key);
 }
 
+static void listen_table_free(struct rcu_head *head)
+{
+	struct listen_table *lt = container_of(head, struct listen_table, rcu);
+
+	sock_table_destroy(&lt->table);
+	free(lt);
+}
+
+static struct listen_table *listen_table_clone(struct listen_table *old, uint32_t nr_extra)
+{
+	struct listen_table *lt;
+	struct sock_entry *entry;
+	uint32_t i;
+
+	lt = malloc(sizeof(struct listen_table));
+	if (!lt)
+		return NULL;
+
+	if (sock_table_init_with_size(&lt->table, (old ? old->table.nr_entry : 0) + nr_extra) < 0) {
+		free(lt);
+		return NULL;
+	}
+
+	if (old) {
+		SOCK_TABLE_FOREACH(&old->table, i, entry) {
+			sock_table_add(&lt->table, &entry->key, entry->tsock);
+		}
+	}
+
+	return lt;
+}
+
+/* a NULL tsock means to delete */
+static int listen_table_update(struct sock_key *key, struct tcp_sock *tsock)
+{
+	struct listen_table *old;
+	struct listen_table *new;
+	int ret;
+
+	rte_spinlock_lock(&listen_table_lock);
+
+	old = listen_table;
+	new = listen_table_clone(old, 1);
+	if (!new) {
+		rte_spinlock_unlock(&listen_table_lock);
+		return -1;
+	}
+
+	if (tsock)
+		ret = sock_table_add(&new->table, key, tsock);
+	else
+		ret = sock_table_del(&new->table, key);
+
+	if (ret < 0) {
+		rte_spinlock_unlock(&listen_table_lock);
+		listen_table_free(&new->rcu);
+		return -1;
+	}
+
+	rcu_assign_pointer(listen_table, new);
+	rte_spinlock_unlock(&listen_table_lock);
+
+	if (old)
+		rcu_call(&old->rcu, listen_table_free);
+
+	return 0;
+}
+
 static int add_listen_sock(struct tcp_sock *tsock)
 {
 	struct sock_key key;
@@ -486,7 +623,7 @@ static int add_listen_sock(struct tcp_sock *tsock)
 	memset(&key, 0, sizeof(key));
 	key.local_port = ntohs(tsock->local_port);
 
-	return sock_table_add_lock(&listen_sock_table, &key, tsock);
+	return listen_table_update(&key, tsock);
 }
 
 static int remove_listen_sock(struct tcp_sock *tsock)
@@ -496,9 +633,11 @@ static int remove_listen_sock(struct tcp_sock *tsock)
 	memset(&key, 0, sizeof(key));
 	key.local_port = ntohs(tsock->local_port);
 
-	return sock_table_del_lock(&listen_sock_table, &key);
+	return listen_table_update(&key, NULL);
 }
 
+static void sid_put(int sid);
+
 int tsock_free(struct tcp_sock *tsock)
 {
 	struct tpa_worker *worker = tsock->worker;
@@ -507,6 +646,7 @@ int tsock_free(struct tcp_sock *tsock)
 	 * more specifically, so far, tsock_trace_uninit might change it.
 	 */
 	int err = errno;
+	int sid;
 
 	trace_tcp_release(tsock, err);
 
@@ -528,20 +668,27 @@ int tsock_free(struct tcp_sock *tsock)
 	timer_close(&tsock->timer_rto,  TSC_TO_US(rte_rdtsc()));
 	timer_close(&tsock->timer_wait, TSC_TO_US(rte_rdtsc()));
 	timer_close(&tsock->timer_keepalive, TSC_TO_US(rte_rdtsc()));
+	timer_close(&tsock->timer_rack, TSC_TO_US(rte_rdtsc()));
+	timer_close(&tsock->timer_tlp,  TSC_TO_US(rte_rdtsc()));
 
 	reclaim_rxq(tsock);
 	reclaim_txq(tsock);
 	reclaim_rcv_ooo_queue(tsock);
+	reclaim_rx_merge_head(tsock);
 
 	flex_fifo_remove(worker->output, &tsock->output_node);
 	flex_fifo_remove(worker->delayed_ack, &tsock->delayed_ack_node);
+	flex_fifo_remove(worker->gro, &tsock->gro_node);
 	flex_fifo_remove(worker->event_queue, &tsock->event_node);
 	flex_fifo_remove(worker->accept, &tsock->accept_node);
+	pacing_queue_remove(&worker->pacing_queue, &tsock->pacing_node);
 
 	tsock_trace_uninit(tsock);
 
+	sid = tsock->sid;
 	rte_smp_wmb();
 	tsock->sid = TSOCK_SID_FREEED;
+	sid_put(sid);
 
 	rte_atomic32_dec(&sock_ctrl->nr_sock);
 
@@ -565,6 +712,26 @@ int tsock_try_update_eth_hdr(struct tpa_worker *worker, struct tcp_sock *tsock)
 	return 0;
 }
 
+/*
+ * The global free sid bitmap: a set bit means the sid is free. It's
+ * sized for the max sock count limit, so that it never moves.
+ */
+static uint64_t *sid_bitmap;
+static uint32_t sid_bitmap_hint;
+
+static inline void sid_bitmap_set_free(int sid)
+{
+	sid_bitmap[sid / 64] |= 1ull << (sid % 64);
+}
+
+static void sid_bitmap_set_free_range(uint32_t start, uint32_t end)
+{
+	uint32_t sid;
+
+	for (sid = start; sid < end; sid++)
+		sid_bitmap_set_free(sid);
+}
+
 static int enlarge_sock_count(void)
 {
 	/* double the max sock count */
@@ -574,6 +741,12 @@ static int enlarge_sock_count(void)
 	if (sock_ctrl->expand_failed)
 		return -1;
 
+	if (mem_file_expand(sock_ctrl->stats_mem_file,
+			    tcp_cfg.nr_max_sock * sizeof(struct tsock_stats)) < 0) {
+		sock_ctrl->expand_failed = 1;
+		return -1;
+	}
+
 	if (mem_file_expand(sock_ctrl->mem_file, to_add) < 0) {
 		sock_ctrl->expand_failed = 1;
 		return -1;
@@ -582,6 +755,8 @@ static int enlarge_sock_count(void)
 	/* mark those newly allocated socks free */
 	for (i = tcp_cfg.nr_max_sock; i < tcp_cfg.nr_max_sock * 2; i++)
 		sock_ctrl->socks[i].sid = TSOCK_SID_UNALLOCATED;
+	sid_bitmap_set_free_range(tcp_cfg.nr_max_sock, tcp_cfg.nr_max_sock * 2);
+	sid_bitmap_hint = tcp_cfg.nr_max_sock / 64;
 
 	tcp_cfg.nr_max_sock *= 2;
 	sock_ctrl->nr_max_sock = tcp_cfg.nr_max_sock;
@@ -590,35 +765,124 @@ static int enlarge_sock_count(void)
 	return 0;
 }
 
-static struct tcp_sock *sock_alloc(const struct tpa_sock_opts *opts)
+/* grabs up to @n free sids from the bitmap; has to be invoked with lock held */
+static uint32_t sid_bitmap_get_bulk(int *sids, uint32_t n)
 {
-	struct tcp_sock *tsock = NULL;
-	static uint32_t next_sock;
+	uint32_t nr_word = (tcp_cfg.nr_max_sock + 63) / 64;
+	uint32_t nr_got = 0;
 	uint32_t i;
-	int sid;
+	uint32_t w;
+	int bit;
 
-	rte_spinlock_lock(&sock_ctrl->lock);
+	for (i = 0; i < nr_word && nr_got < n; i++) {
+		w = (sid_bitmap_hint + i) % nr_word;
 
-again:
-	for (i = 0; i < tcp_cfg.nr_max_sock; i++) {
-		sid = (next_sock + i) & (tcp_cfg.nr_max_sock - 1);
-		if (sock_ctrl->socks[sid].sid < 0) {
-			tsock = &sock_ctrl->socks[sid];
-			next_sock += i + 1;
-			break;
+		while (sid_bitmap[w] && nr_got < n) {
+			bit = __builtin_ctzll(sid_bitmap[w]);
+			sid_bitmap[w] &= ~(1ull << bit);
+			sids[nr_got++] = w * 64 + bit;
 		}
+
+		sid_bitmap_hint = w;
 	}
 
-	if (tsock == NULL && enlarge_sock_count() == 0) {
-		next_sock = tcp_cfg.nr_max_sock / 2;
-		goto again;
+	return nr_got;
+}
+
+struct sid_depot sid_depot;
+
+static int sid_magazine_refill(struct sid_magazine *mag)
+{
+	rte_spinlock_lock(&sock_ctrl->lock);
+
+	if (sid_depot.nr_batch) {
+		sid_depot.nr_batch -= 1;
+		memcpy(mag->sids, sid_depot.batches[sid_depot.nr_batch], sizeof(sid_depot.batches[0]));
+		mag->nr_sid = SID_MAGAZINE_BATCH;
+	} else {
+		do {
+			mag->nr_sid = sid_bitmap_get_bulk(mag->sids, SID_MAGAZINE_BATCH);
+		} while (mag->nr_sid == 0 && enlarge_sock_count() == 0);
 	}
 
-	if (tsock && tsock_init(tsock, sid, opts) < 0)
-		tsock = NULL;
+	rte_spinlock_unlock(&sock_ctrl->lock);
+
+	return mag->nr_sid;
+}
+
+/*
+ * Flushes the coldest half, which sits at the bottom, to the depot;
+ * or back to the bitmap when the depot is full.
+ */
+static void sid_magazine_flush(struct sid_magazine *mag)
+{
+	uint32_t i;
 
+	rte_spinlock_lock(&sock_ctrl->lock);
+	if (sid_depot.nr_batch < SID_DEPOT_SIZE) {
+		memcpy(sid_depot.batches[sid_depot.nr_batch], mag->sids, sizeof(sid_depot.batches[0]));
+		sid_depot.nr_batch += 1;
+	} else {
+		for (i = 0; i < SID_MAGAZINE_BATCH; i++)
+			sid_bitmap_set_free(mag->sids[i]);
+	}
 	rte_spinlock_unlock(&sock_ctrl->lock);
 
+	mag->nr_sid -= SID_MAGAZINE_BATCH;
+	memmove(mag->sids, mag->sids + SID_MAGAZINE_BATCH, mag->nr_sid * sizeof(mag->sids[0]));
+}
+
+static int sid_get(struct tpa_worker *worker)
+{
+	struct sid_magazine *mag = &worker->sid_magazine;
+
+	if (unlikely(mag->nr_sid == 0) && sid_magazine_refill(mag) == 0)
+		return -1;
+
+	return mag->sids[--mag->nr_sid];
+}
+
+static void sid_put(int sid)
+{
+	struct tpa_worker *worker = tls_worker;
+	struct sid_magazine *mag;
+
+	if (unlikely(!worker)) {
+		rte_spinlock_lock(&sock_ctrl->lock);
+		sid_bitmap_set_free(sid);
+		rte_spinlock_unlock(&sock_ctrl->lock);
+		return;
+	}
+
+	mag = &worker->sid_magazine;
+	if (unlikely(mag->nr_sid == SID_MAGAZINE_SIZE))
+		sid_magazine_flush(mag);
+
+	mag->sids[mag->nr_sid++] = sid;
+}
+
+static struct tcp_sock *sock_alloc(const struct tpa_sock_opts *opts)
+{
+	struct tcp_sock *tsock;
+	int sid;
+
+	if (!tls_worker) {
+		LOG_ERR("trying to create sock in none-worker thread");
+		return NULL;
+	}
+
+	sid = sid_get(tls_worker);
+	if (sid < 0)
+		return NULL;
+
+	tsock = &sock_ctrl->socks[sid];
+	debug_assert(tsock->sid < 0);
+
+	if (tsock_init(tsock, sid, opts) < 0) {
+		sid_put(sid);
+		return NULL;
+	}
+
 	return tsock;
 }
 
@@ -662,6 +926,10 @@ static int tsock_bind(struct tcp_sock *tsock, struct tpa_ip *remote_ip, uint16_t
 	tsock->remote_port = htons(remote_port);
 	tsock->local_port = htons(local_port);
 
+	/* before the flow rule, so that the pkts meanwhile could be steered */
+	key.local_port = local_port;
+	steer_index_add(&key, tsock);
+
 	tsock->err = 0;
 	tsock_trace_base_init(tsock);
 	if (tsock_offload_create(tsock) < 0) {
@@ -704,6 +972,24 @@ err:
 	return -1;
 }
 
+static int sock_opts_check(const struct tpa_sock_opts *opts)
+{
+	if (!opts)
+		return 0;
+
+	if (opts->cc[0]) {
+		if (strnlen(opts->cc, sizeof(opts->cc)) == sizeof(opts->cc) ||
+		    !tcp_cc_find(opts->cc)) {
+			LOG_ERR("unknown congestion control algorithm: %.*s",
+				(int)sizeof(opts->cc), opts->cc);
+			errno = ENOENT;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 int tpa_connect_to(const char *server, uint16_t port, const struct tpa_sock_opts *opts)
 {
 	struct tcp_sock *tsock;
@@ -725,6 +1011,9 @@ int tpa_connect_to(const char *server, uint16_t port, const struct tpa_sock_opts
 		return -1;
 	}
 
+	if (sock_opts_check(opts) < 0)
+		return -1;
+
 	tsock = sock_create(opts, !tpa_ip_is_ipv4(&remote_ip));
 	if (!tsock)
 		return -1;
@@ -794,6 +1083,9 @@ int tpa_listen_on(const char *local, uint16_t port, const struct tpa_sock_opts *
 		return -1;
 	}
 
+	if (sock_opts_check(opts) < 0)
+		return -1;
+
 	memset(&remote_ip, 0, sizeof(remote_ip));
 	if (port_alloc(port) == 0) {
 		errno = EADDRINUSE;
@@ -926,6 +1218,124 @@ ssize_t tpa_zwritev(int sid, const struct tpa_iovec *iov, int nr_iov)
 	return ret;
 }
 
+/* the tsock of the req this many slots ahead is prefetched */
+#define SOCK_BURST_PREFETCH	4
+
+static inline void sock_burst_prefetch(struct tpa_sock_iov *reqs, int nr_req, int i)
+{
+	if (i + SOCK_BURST_PREFETCH < nr_req)
+		tsock_prefetch_by_sid(reqs[i + SOCK_BURST_PREFETCH].sid);
+}
+
+static inline void sock_burst_prefetch_init(struct tpa_sock_iov *reqs, int nr_req)
+{
+	int i;
+
+	for (i = 0; i < RTE_MIN(nr_req, SOCK_BURST_PREFETCH); i++)
+		tsock_prefetch_by_sid(reqs[i].sid);
+}
+
+int tpa_zreadv_burst(struct tpa_sock_iov *reqs, int nr_req)
+{
+	struct tcp_sock *tsock;
+	int nr_done = 0;
+	int i;
+
+	sock_burst_prefetch_init(reqs, nr_req);
+
+	for (i = 0; i < nr_req; i++) {
+		sock_burst_prefetch(reqs, nr_req, i);
+
+		tsock = tsock_get_by_sid(reqs[i].sid);
+		if (unlikely(!tsock || reqs[i].nr_iov < 0)) {
+			reqs[i].ret = -1;
+			reqs[i].err = EINVAL;
+			continue;
+		}
+
+		reqs[i].err = 0;
+		if (unlikely(reqs[i].nr_iov == 0)) {
+			reqs[i].ret = 0;
+			nr_done += 1;
+			continue;
+		}
+
+		tsock_update_last_ts(tsock, LAST_TS_READ);
+		reqs[i].ret = tsock_zreadv(tsock, reqs[i].iov, reqs[i].nr_iov);
+		if (reqs[i].ret < 0) {
+			reqs[i].err = errno;
+			if (errno == EAGAIN)
+				TSOCK_STATS_INC(tsock, READ_EAGAIN);
+			continue;
+		}
+		nr_done += 1;
+	}
+
+	return nr_done;
+}
+
+/*
+ * Queues the written tsocks for output, after all the writes are done.
+ * They all belong to the worker of the caller thread, as the sock APIs
+ * are invoked at the worker thread only; therefore, no kick is needed.
+ */
+static void output_tsock_enqueue_burst(struct tcp_sock **tsocks, int nr_tsock)
+{
+	int i;
+
+	for (i = 0; i < nr_tsock; i++)
+		output_tsock_enqueue(tsocks[i]->worker, tsocks[i]);
+}
+
+int tpa_zwritev_burst(struct tpa_sock_iov *reqs, int nr_req)
+{
+	struct tcp_sock *tsocks[BATCH_SIZE];
+	struct tcp_sock *tsock;
+	int nr_tsock = 0;
+	int nr_done = 0;
+	int i;
+
+	sock_burst_prefetch_init(reqs, nr_req);
+
+	for (i = 0; i < nr_req; i++) {
+		sock_burst_prefetch(reqs, nr_req, i);
+
+		tsock = tsock_get_by_sid(reqs[i].sid);
+		if (unlikely(!tsock || reqs[i].nr_iov < 0)) {
+			reqs[i].ret = -1;
+			reqs[i].err = EINVAL;
+			continue;
+		}
+
+		reqs[i].err = 0;
+		if (unlikely(reqs[i].nr_iov == 0)) {
+			reqs[i].ret = 0;
+			nr_done += 1;
+			continue;
+		}
+
+		tsock_update_last_ts(tsock, LAST_TS_WRITE);
+		reqs[i].ret = tsock_zwritev_deferred(tsock, reqs[i].iov, reqs[i].nr_iov);
+		if (reqs[i].ret < 0) {
+			reqs[i].err = errno;
+			if (errno == EAGAIN)
+				TSOCK_STATS_INC(tsock, WRITE_EAGAIN);
+			continue;
+		}
+		nr_done += 1;
+
+		tsocks[nr_tsock++] = tsock;
+		if (nr_tsock == BATCH_SIZE) {
+			output_tsock_enqueue_burst(tsocks, nr_tsock);
+			nr_tsock = 0;
+		}
+	}
+
+	output_tsock_enqueue_burst(tsocks, nr_tsock);
+
+	return nr_done;
+}
+
 void tpa_close(int sid)
 {
 	struct tcp_sock *tsock;
@@ -982,7 +1392,7 @@ int listen_tsock_lookup(struct packet *pkt, struct tcp_sock **tsock_ptr)
 	memset(&key, 0, sizeof(key));
 	key.local_port = ntohs(pkt->dst_port);
 
-	tsock = sock_table_lookup_lock(&listen_sock_table, &key);
+	tsock = sock_table_lookup(&rcu_dereference(listen_table)->table, &key);
 	if (!tsock)
 		return -ERR_NO_SOCK;
 
@@ -1027,6 +1437,9 @@ int sock_init_early(void)
 
 	RTE_BUILD_BUG_ON((offsetof(struct sock_ctrl, socks) & 63) != 0);
 
+	/* make sure the fast path fields fit in the first two cache lines */
+	RTE_BUILD_BUG_ON(offsetof(struct tcp_sock, stats) > 128);
+
 	/* it may cfg tcp_cfg.nr_max_sock: need be done earlier */
 	cfg_spec_register(tcp_cfg_specs, ARRAY_SIZE(tcp_cfg_specs));
 	cfg_section_parse("tcp");
@@ -1041,15 +1454,30 @@ int sock_init_early(void)
 	tpa_snprintf(path, sizeof(path), "%s/%s", tpa_root_get(), "socks");
 	tpa_cfg.sock_file = strdup(path);
 
-	/* supports upto 10 million socks as memory allows */
 	mem_file = mem_file_create_expandable(path, size, "sock-list",
-					      sizeof(struct tcp_sock) * (10ul << 20));
+					      sizeof(struct tcp_sock) * NR_MAX_SOCK_LIMIT);
 	if (!mem_file)
 		return -1;
 
 	sock_ctrl = mem_file_data(mem_file);
 	sock_ctrl->mem_file = mem_file;
 
+	/*
+	 * the per-sock stats are stored in a standalone file, so that
+	 * both could be expanded. Note that sock-list locates the stats
+	 * of a sock by its index in the socks file.
+	 */
+	tpa_snprintf(path, sizeof(path), "%s/%s", tpa_root_get(), "sock-stats");
+	tpa_cfg.sock_stats_file = strdup(path);
+
+	mem_file = mem_file_create_expandable(path, sizeof(struct tsock_stats) * tcp_cfg.nr_max_sock,
+					      NULL, sizeof(struct tsock_stats) * NR_MAX_SOCK_LIMIT);
+	if (!mem_file)
+		return -1;
+
+	tsock_stats = mem_file_data(mem_file);
+	sock_ctrl->stats_mem_file = mem_file;
+
 	map_tsock_trace_file();
 
 	return 0;
@@ -1073,7 +1501,8 @@ int sock_init(void)
 
 	port_alloc_init();
 
-	sock_table_init(&listen_sock_table);
+	listen_table = listen_table_clone(NULL, 0);
+	PANIC_ON(listen_table == NULL, "failed to init listen sock table");
 
 	rte_spinlock_init(&sock_ctrl->lock);
 	sock_ctrl->nr_max_sock = tcp_cfg.nr_max_sock;
@@ -1084,6 +1513,10 @@ int sock_init(void)
 	for (i = 0; i < tcp_cfg.nr_max_sock; i++)
 		sock_ctrl->socks[i].sid = TSOCK_SID_UNALLOCATED;
 
+	sid_bitmap = calloc(NR_MAX_SOCK_LIMIT / 64, sizeof(uint64_t));
+	PANIC_ON(sid_bitmap == NULL, "failed to allocate sid bitmap");
+	sid_bitmap_set_free_range(0, tcp_cfg.nr_max_sock);
+
 	tsock_trace_ctrl_init();
 
 	set_drop_ooo_threshold();
@@ -0,0 +1,192 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include <rte_malloc.h>
+#include <rte_ring.h>
+
+#include "tpa.h"
+#include "log.h"
+#include "worker.h"
+#include "steer.h"
+
+struct steer_ctrl steer_ctrl = {
+	.enable = 1,
+};
+
+int steer_init(void)
+{
+	char name[RTE_RING_NAMESIZE];
+	uint32_t nr_worker = tpa_cfg.nr_worker;
+	uint32_t src;
+	uint32_t dst;
+
+	if (!steer_ctrl.enable || nr_worker <= 1)
+		return 0;
+
+	if (sock_table_init(&steer_ctrl.index) < 0)
+		goto fail;
+
+	steer_ctrl.rings = rte_zmalloc(NULL, sizeof(struct rte_ring *) * nr_worker * nr_worker, 64);
+	if (!steer_ctrl.rings)
+		goto fail;
+
+	for (src = 0; src < nr_worker; src++) {
+		workers[src].steer_bufs = rte_zmalloc(NULL, sizeof(struct steer_buf) * nr_worker, 64);
+		if (!workers[src].steer_bufs)
+			goto fail;
+
+		for (dst = 0; dst < nr_worker; dst++) {
+			if (src == dst)
+				continue;
+
+			tpa_snprintf(name, sizeof(name), "steer-%u-%u", src, dst);
+			steer_ctrl.rings[src * nr_worker + dst] =
+				rte_ring_create(name, STEER_RING_SIZE, rte_socket_id(),
+						RING_F_SP_ENQ | RING_F_SC_DEQ);
+			if (!steer_ctrl.rings[src * nr_worker + dst])
+				goto fail;
+		}
+	}
+
+	steer_ctrl.active = 1;
+	LOG("init: sw steering among %u workers", nr_worker);
+
+	return 0;
+
+fail:
+	/* it's not fatal: pkts without flow mark are just not steered */
+	LOG_ERR("failed to init sw steering; disabled");
+	return -1;
+}
+
+void steer_index_add(struct sock_key *key, struct tcp_sock *tsock)
+{
+	if (steer_ctrl.active)
+		sock_table_add_lock(&steer_ctrl.index, key, tsock);
+}
+
+void steer_index_del(struct sock_key *key)
+{
+	if (steer_ctrl.active)
+		sock_table_del_lock(&steer_ctrl.index, key);
+}
+
+static void steer_flush(struct tpa_worker *worker)
+{
+	struct steer_buf *buf;
+	uint32_t nr_pkt;
+	uint32_t dst;
+
+	for (dst = 0; dst < tpa_cfg.nr_worker; dst++) {
+		buf = &worker->steer_bufs[dst];
+		if (buf->nr_pkt == 0)
+			continue;
+
+		nr_pkt = rte_ring_enqueue_burst(steer_ring(worker->id, dst), (void **)buf->pkts,
+						buf->nr_pkt, NULL);
+		WORKER_STATS_ADD(worker, PKT_STEER, nr_pkt);
+
+		if (unlikely(nr_pkt < buf->nr_pkt)) {
+			WORKER_STATS_ADD(worker, ERR_PKT_STEER_DROP, buf->nr_pkt - nr_pkt);
+			packet_free_batch(buf->pkts + nr_pkt, buf->nr_pkt - nr_pkt);
+		}
+		buf->nr_pkt = 0;
+
+		if (nr_pkt)
+			worker_kick(&workers[dst]);
+	}
+}
+
+/*
+ * Forwards the pkts owned by other workers, with one index lock for
+ * the whole batch. The ones left (not owned by any other worker) are
+ * moved to the front of @pkts; the count is returned.
+ */
+uint32_t steer_pkts(struct tpa_worker *worker, struct packet **pkts, uint32_t nr_pkt)
+{
+	struct steer_buf *buf;
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	struct sock_key key;
+	uint32_t nr_left = 0;
+	uint32_t i;
+
+	rte_spinlock_lock(&steer_ctrl.index.lock);
+	for (i = 0; i < nr_pkt; i++) {
+		pkt = pkts[i];
+
+		init_tpa_ip_from_pkt(pkt, &key.remote_ip, &key.local_ip);
+		key.local_port  = ntohs(pkt->dst_port);
+		key.remote_port = ntohs(pkt->src_port);
+
+		tsock = sock_table_lookup(&steer_ctrl.index, &key);
+		if (!tsock || tsock->worker == worker) {
+			pkts[nr_left++] = pkt;
+			continue;
+		}
+
+		pkt->flags |= PKT_FLAG_STEERED;
+		buf = &worker->steer_bufs[tsock->worker->id];
+		buf->pkts[buf->nr_pkt++] = pkt;
+	}
+	rte_spinlock_unlock(&steer_ctrl.index.lock);
+
+	if (nr_left < nr_pkt)
+		steer_flush(worker);
+
+	return nr_left;
+}
+
+/* moves the pkts steered to us to our dev rxqs */
+uint32_t steer_recv(struct tpa_worker *worker)
+{
+	struct packet *pkts[BATCH_SIZE];
+	struct dev_rxq *rxq;
+	uint32_t nr_recv = 0;
+	uint32_t nr_pkt;
+	uint32_t src;
+	uint32_t i;
+
+	for (src = 0; src < tpa_cfg.nr_worker; src++) {
+		if (src == worker->id)
+			continue;
+
+		nr_pkt = rte_ring_dequeue_burst(steer_ring(src, worker->id), (void **)pkts,
+						BATCH_SIZE, NULL);
+		for (i = 0; i < nr_pkt; i++) {
+			rxq = dev_port_rxq(pkts[i]->port_id, worker->queue);
+			if (unlikely(rxq->write - rxq->read >= DEV_RXQ_SIZE)) {
+				WORKER_STATS_INC(worker, ERR_PKT_STEER_DROP);
+				packet_free(pkts[i]);
+				continue;
+			}
+
+			rxq->pkts[(rxq->write++) & DEV_RXQ_MASK] = pkts[i];
+		}
+
+		nr_recv += nr_pkt;
+	}
+
+	WORKER_STATS_ADD(worker, PKT_STEER_RECV, nr_recv);
+
+	return nr_recv;
+}
+
+int steer_pending(struct tpa_worker *worker)
+{
+	uint32_t src;
+
+	if (!steer_ctrl.active)
+		return 0;
+
+	for (src = 0; src < tpa_cfg.nr_worker; src++) {
+		if (src != worker->id && !rte_ring_empty(steer_ring(src, worker->id)))
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,436 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tpa.h"
+#include "tcp.h"
+#include "sock.h"
+#include "tcp_cc.h"
+
+/*
+ * A BBR (v1) style congestion control. It builds a model of the path
+ * from the delivery rate samples:
+ *
+ *     BtlBw:  the max delivery rate seen in the last 10 rounds
+ *     RTprop: the min rtt seen in the last 10 seconds
+ *
+ * It then paces at BtlBw * pacing_gain, and caps the inflight at
+ * BtlBw * RTprop * cwnd_gain, so that the queue at the bottleneck is
+ * kept short. The gains vary with the mode:
+ *
+ *     STARTUP:    ramps up exponentially until BtlBw stops growing
+ *     DRAIN:      drains the queue built at STARTUP
+ *     PROBE_BW:   cycles the pacing gain to probe for more bandwidth
+ *     PROBE_RTT:  cuts the inflight to 4 segs for 200ms to refresh RTprop
+ *
+ * Losses are left to the tcp core: the cwnd is kept at entering fast
+ * recovery, and restored when it's done.
+ */
+enum {
+	BBR_STARTUP,
+	BBR_DRAIN,
+	BBR_PROBE_BW,
+	BBR_PROBE_RTT,
+};
+
+/* the gains are scaled by BBR_UNIT */
+#define BBR_SCALE		8
+#define BBR_UNIT		(1 << BBR_SCALE)
+
+/* the bw is in bytes per us, scaled by 1 << BBR_BW_SCALE */
+#define BBR_BW_SCALE		16
+
+#define BBR_HIGH_GAIN		(BBR_UNIT * 2885 / 1000 + 1)	/* 2/ln(2) */
+#define BBR_DRAIN_GAIN		(BBR_UNIT * 1000 / 2885)
+#define BBR_CWND_GAIN		(BBR_UNIT * 2)
+
+#define BBR_CYCLE_LEN		8
+static const uint16_t bbr_cycle_gain[BBR_CYCLE_LEN] = {
+	BBR_UNIT * 5 / 4, BBR_UNIT * 3 / 4,
+	BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT,
+};
+
+#define BBR_BW_RTTS		10		/* the BtlBw window, in rounds */
+#define BBR_MIN_RTT_WIN		10000		/* the RTprop window, in ms */
+#define BBR_PROBE_RTT_TIME	200		/* ms */
+
+/* BtlBw is taken as reached when it grows less than 25% in 3 rounds */
+#define BBR_FULL_BW_THRESH	(BBR_UNIT * 5 / 4)
+#define BBR_FULL_BW_CNT		3
+
+#define BBR_MIN_CWND(tsock)	(4 * (tsock)->snd_mss)
+
+struct bbr_sample {
+	uint32_t round;
+	uint32_t bw;
+};
+
+struct bbr {
+	struct bbr_sample bw[3];	/* see bbr_max_filter */
+	uint32_t min_rtt_us;
+	uint32_t min_rtt_stamp;		/* in ms */
+	uint32_t probe_rtt_done_stamp;	/* in ms; 0 if not started yet */
+	uint32_t cycle_stamp;		/* in us */
+	uint32_t next_rtt_delivered;	/* where the current round ends */
+	uint32_t round_count;
+	uint32_t full_bw;
+	uint32_t prior_cwnd;		/* the cwnd before recovery or PROBE_RTT */
+	uint8_t  mode;
+	uint8_t  cycle_idx;
+	uint8_t  full_bw_cnt;
+	uint8_t  round_start:1;
+	uint8_t  full_bw_reached:1;
+	uint8_t  probe_rtt_round_done:1;
+};
+
+/*
+ * A windowed max filter, by Kathleen Nichols' algorithm: it tracks the
+ * best, 2nd best and 3rd best samples, each being more recent than the
+ * former one, so that the max of the last @win rounds is given in O(1)
+ * time and space.
+ */
+static uint32_t bbr_max_filter(struct bbr_sample *s, uint32_t win, uint32_t round, uint32_t bw)
+{
+	struct bbr_sample new = { .round = round, .bw = bw };
+	uint32_t age;
+
+	/* a new max, or nothing in the window: start over */
+	if (bw >= s[0].bw || round - s[2].round > win) {
+		s[0] = s[1] = s[2] = new;
+		return bw;
+	}
+
+	if (bw >= s[1].bw)
+		s[1] = s[2] = new;
+	else if (bw >= s[2].bw)
+		s[2] = new;
+
+	age = round - s[0].round;
+	if (age > win) {
+		/* the best has expired; promote the others */
+		s[0] = s[1];
+		s[1] = s[2];
+		s[2] = new;
+		if (round - s[0].round > win) {
+			s[0] = s[1];
+			s[1] = s[2];
+		}
+	} else if (s[1].round == s[0].round && age > win / 4) {
+		/* keep the 2nd and 3rd best from the later parts of the window */
+		s[1] = s[2] = new;
+	} else if (s[2].round == s[1].round && age > win / 2) {
+		s[2] = new;
+	}
+
+	return s[0].bw;
+}
+
+static inline uint32_t bbr_max_bw(struct bbr *ca)
+{
+	return ca->bw[0].bw;
+}
+
+static inline uint32_t now_in_ms(uint64_t now)
+{
+	return now / 1000;
+}
+
+/* the bytes to fill the pipe, with the given gain */
+static uint32_t bbr_bdp(struct tcp_sock *tsock, struct bbr *ca, uint32_t bw, uint32_t gain)
+{
+	uint64_t bdp;
+
+	/* no rtt sample yet */
+	if (unlikely(ca->min_rtt_us == UINT32_MAX))
+		return tcp_cfg.cwnd_init;
+
+	bdp = ((uint64_t)bw * ca->min_rtt_us) >> BBR_BW_SCALE;
+	bdp = (bdp * gain) >> BBR_SCALE;
+
+	return RTE_MIN(bdp, (uint64_t)UINT32_MAX);
+}
+
+static inline uint32_t tsock_inflight(struct tcp_sock *tsock)
+{
+	return tsock->snd_nxt - tsock->snd_una;
+}
+
+static uint32_t bbr_pacing_gain(struct bbr *ca)
+{
+	switch (ca->mode) {
+	case BBR_STARTUP:
+		return BBR_HIGH_GAIN;
+	case BBR_DRAIN:
+		return BBR_DRAIN_GAIN;
+	case BBR_PROBE_BW:
+		return bbr_cycle_gain[ca->cycle_idx];
+	}
+
+	return BBR_UNIT;
+}
+
+static uint32_t bbr_cwnd_gain(struct bbr *ca)
+{
+	switch (ca->mode) {
+	case BBR_STARTUP:
+	case BBR_DRAIN:
+		return BBR_HIGH_GAIN;
+	case BBR_PROBE_BW:
+		return BBR_CWND_GAIN;
+	}
+
+	return BBR_UNIT;
+}
+
+static void bbr_save_cwnd(struct tcp_sock *tsock, struct bbr *ca)
+{
+	if (tsock->retrans_stage == NONE && ca->mode != BBR_PROBE_RTT)
+		ca->prior_cwnd = tsock->snd_cwnd;
+	else
+		ca->prior_cwnd = RTE_MAX(ca->prior_cwnd, tsock->snd_cwnd);
+}
+
+static void bbr_enter_probe_bw(struct bbr *ca, uint64_t now)
+{
+	ca->mode = BBR_PROBE_BW;
+
+	/* start at a random phase other than the draining one */
+	ca->cycle_idx = (BBR_CYCLE_LEN - rand() % (BBR_CYCLE_LEN - 1)) % BBR_CYCLE_LEN;
+	ca->cycle_stamp = now;
+}
+
+static void bbr_update_bw(struct tcp_sock *tsock, struct bbr *ca,
+			  const struct tcp_rate_sample *rs)
+{
+	uint32_t bw;
+
+	ca->round_start = 0;
+	if (rs->interval_us == 0)
+		return;
+
+	/* a round ends when the data sent at its start is delivered */
+	if ((int32_t)((uint32_t)rs->prior_delivered - ca->next_rtt_delivered) >= 0) {
+		ca->next_rtt_delivered = tsock->delivered;
+		ca->round_count += 1;
+		ca->round_start = 1;
+	}
+
+	/* too short an interval is most likely due to ack compression */
+	if (ca->min_rtt_us != UINT32_MAX && rs->interval_us < ca->min_rtt_us)
+		return;
+
+	bw = RTE_MIN(((uint64_t)rs->delivered << BBR_BW_SCALE) / rs->interval_us,
+		     (uint64_t)UINT32_MAX);
+
+	/* an app limited sample is taken only if it's no less than the model */
+	if (!rs->is_app_limited || bw >= bbr_max_bw(ca))
+		bbr_max_filter(ca->bw, BBR_BW_RTTS, ca->round_count, bw);
+}
+
+static void bbr_update_cycle_phase(struct tcp_sock *tsock, struct bbr *ca, uint64_t now)
+{
+	uint32_t gain = bbr_cycle_gain[ca->cycle_idx];
+	uint32_t inflight = tsock_inflight(tsock);
+	int full_length;
+
+	if (ca->mode != BBR_PROBE_BW)
+		return;
+
+	full_length = (uint32_t)now - ca->cycle_stamp > ca->min_rtt_us;
+
+	/*
+	 * Probe until the inflight reaches the probing target; drain until
+	 * the inflight falls back to the BDP, or for one rtt at most.
+	 */
+	if (gain > BBR_UNIT) {
+		if (!full_length || inflight < bbr_bdp(tsock, ca, bbr_max_bw(ca), gain))
+			return;
+	} else if (gain < BBR_UNIT) {
+		if (!full_length && inflight > bbr_bdp(tsock, ca, bbr_max_bw(ca), BBR_UNIT))
+			return;
+	} else if (!full_length) {
+		return;
+	}
+
+	ca->cycle_idx = (ca->cycle_idx + 1) % BBR_CYCLE_LEN;
+	ca->cycle_stamp = now;
+}
+
+static void bbr_check_full_bw_reached(struct bbr *ca, const struct tcp_rate_sample *rs)
+{
+	if (ca->full_bw_reached || !ca->round_start || rs->is_app_limited)
+		return;
+
+	if ((uint64_t)bbr_max_bw(ca) * BBR_UNIT >= (uint64_t)ca->full_bw * BBR_FULL_BW_THRESH) {
+		ca->full_bw = bbr_max_bw(ca);
+		ca->full_bw_cnt = 0;
+		return;
+	}
+
+	ca->full_bw_cnt += 1;
+	ca->full_bw_reached = ca->full_bw_cnt >= BBR_FULL_BW_CNT;
+}
+
+static void bbr_check_drain(struct tcp_sock *tsock, struct bbr *ca, uint64_t now)
+{
+	if (ca->mode == BBR_STARTUP && ca->full_bw_reached)
+		ca->mode = BBR_DRAIN;
+
+	if (ca->mode == BBR_DRAIN &&
+	    tsock_inflight(tsock) <= bbr_bdp(tsock, ca, bbr_max_bw(ca), BBR_UNIT))
+		bbr_enter_probe_bw(ca, now);
+}
+
+static void bbr_update_min_rtt(struct tcp_sock *tsock, struct bbr *ca,
+			       const struct tcp_rate_sample *rs, uint64_t now)
+{
+	uint32_t now_ms = now_in_ms(now);
+	int expired;
+
+	expired = now_ms - ca->min_rtt_stamp > BBR_MIN_RTT_WIN;
+	if (rs->rtt_us && (rs->rtt_us <= ca->min_rtt_us || expired)) {
+		ca->min_rtt_us = rs->rtt_us;
+		ca->min_rtt_stamp = now_ms;
+	}
+
+	if (expired && ca->mode != BBR_PROBE_RTT) {
+		bbr_save_cwnd(tsock, ca);
+		ca->mode = BBR_PROBE_RTT;
+		ca->probe_rtt_done_stamp = 0;
+	}
+
+	if (ca->mode != BBR_PROBE_RTT)
+		return;
+
+	/* the low rate samples at PROBE_RTT tell nothing about BtlBw */
+	tsock->app_limited = RTE_MAX(tsock->delivered + tsock_inflight(tsock), 1);
+
+	if (ca->probe_rtt_done_stamp == 0) {
+		/* hold for 200ms and one round, once the inflight is drained */
+		if (tsock_inflight(tsock) <= BBR_MIN_CWND(tsock)) {
+			ca->probe_rtt_done_stamp = RTE_MAX(now_ms + BBR_PROBE_RTT_TIME, 1u);
+			ca->probe_rtt_round_done = 0;
+			ca->next_rtt_delivered = tsock->delivered;
+		}
+		return;
+	}
+
+	if (ca->round_start)
+		ca->probe_rtt_round_done = 1;
+
+	if (ca->probe_rtt_round_done && (int32_t)(now_ms - ca->probe_rtt_done_stamp) >= 0) {
+		ca->min_rtt_stamp = now_ms;
+		if (ca->full_bw_reached)
+			bbr_enter_probe_bw(ca, now);
+		else
+			ca->mode = BBR_STARTUP;
+	}
+}
+
+static uint32_t bbr_set_cwnd(struct tcp_sock *tsock, struct bbr *ca,
+			     const struct tcp_rate_sample *rs, uint32_t prior_mode)
+{
+	uint32_t cwnd = tsock->snd_cwnd;
+	uint32_t target;
+
+	/* restore the cwnd after PROBE_RTT */
+	if (prior_mode == BBR_PROBE_RTT && ca->mode != BBR_PROBE_RTT)
+		cwnd = RTE_MAX(cwnd, ca->prior_cwnd);
+
+	/* leave some room for the delayed and stretched acks */
+	target = bbr_bdp(tsock, ca, bbr_max_bw(ca), bbr_cwnd_gain(ca));
+	target += 3 * tsock->snd_mss;
+
+	if (ca->full_bw_reached)
+		cwnd = RTE_MIN(cwnd + rs->acked_sacked, target);
+	else if (cwnd < target || tsock->delivered < tcp_cfg.cwnd_init)
+		cwnd = cwnd + rs->acked_sacked;
+
+	cwnd = RTE_MAX(cwnd, BBR_MIN_CWND(tsock));
+	if (ca->mode == BBR_PROBE_RTT)
+		cwnd = RTE_MIN(cwnd, BBR_MIN_CWND(tsock));
+
+	return cwnd;
+}
+
+static void bbr_set_pacing_rate(struct tcp_sock *tsock, struct bbr *ca)
+{
+	uint64_t rate;
+
+	if (bbr_max_bw(ca) == 0)
+		return;
+
+	rate = ((uint64_t)bbr_max_bw(ca) * bbr_pacing_gain(ca)) >> BBR_SCALE;
+	rate = (rate * 1000000) >> BBR_BW_SCALE;
+
+	/* don't slow down at STARTUP, before the pipe is known to be full */
+	if (ca->full_bw_reached || rate > tsock->pacing_rate)
+		tsock->pacing_rate = rate;
+}
+
+static uint32_t bbr_cong_control(struct tcp_sock *tsock, const struct tcp_rate_sample *rs,
+				 uint64_t now)
+{
+	struct bbr *ca = TSOCK_CC_PRIV(tsock);
+	uint32_t prior_mode = ca->mode;
+
+	bbr_update_bw(tsock, ca, rs);
+	bbr_update_cycle_phase(tsock, ca, now);
+	bbr_check_full_bw_reached(ca, rs);
+	bbr_check_drain(tsock, ca, now);
+	bbr_update_min_rtt(tsock, ca, rs, now);
+
+	bbr_set_pacing_rate(tsock, ca);
+
+	return bbr_set_cwnd(tsock, ca, rs, prior_mode);
+}
+
+static void bbr_init(struct tcp_sock *tsock, uint64_t now)
+{
+	struct bbr *ca = TSOCK_CC_PRIV(tsock);
+	uint32_t srtt = tsock->srtt >> 3;
+
+	RTE_BUILD_BUG_ON(sizeof(struct bbr) > TCP_CC_PRIV_SIZE);
+
+	memset(ca, 0, sizeof(*ca));
+	ca->mode = BBR_STARTUP;
+	ca->min_rtt_us = srtt ? srtt : UINT32_MAX;
+	ca->min_rtt_stamp = now_in_ms(now);
+	ca->next_rtt_delivered = tsock->delivered;
+
+	/* pace the initial cwnd over the handshake rtt, with high gain */
+	tsock->pacing_rate = 0;
+	if (srtt) {
+		tsock->pacing_rate = (uint64_t)tsock->snd_cwnd * 1000000 / srtt;
+		tsock->pacing_rate = (tsock->pacing_rate * BBR_HIGH_GAIN) >> BBR_SCALE;
+	}
+}
+
+/* BBR does not back off on loss; the core does the packet conservation */
+static uint32_t bbr_on_loss(struct tcp_sock *tsock, uint64_t now)
+{
+	bbr_save_cwnd(tsock, TSOCK_CC_PRIV(tsock));
+
+	return tsock->snd_cwnd;
+}
+
+static uint32_t bbr_on_recovery_exit(struct tcp_sock *tsock, uint64_t now)
+{
+	struct bbr *ca = TSOCK_CC_PRIV(tsock);
+
+	return RTE_MAX(ca->prior_cwnd, BBR_MIN_CWND(tsock));
+}
+
+const struct tcp_cc_ops tcp_cc_bbr = {
+	.name			= "bbr",
+	.init			= bbr_init,
+	.cong_control		= bbr_cong_control,
+	.on_loss		= bbr_on_loss,
+	.on_rto			= bbr_on_loss,
+	.on_recovery_exit	= bbr_on_recovery_exit,
+};
@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "tpa.h"
+#include "log.h"
+#include "tcp.h"
+#include "sock.h"
+#include "tcp_cc.h"
+
+static uint32_t reno_on_ack(struct tcp_sock *tsock, uint32_t acked, uint64_t now)
+{
+	uint32_t add_up;
+
+	/* TODO: add option to disable abc */
+	if (tsock->snd_cwnd < tsock->snd_ssthresh)
+		return tsock->snd_cwnd + acked;
+
+	/* basically increase cwnd by one mss each rtt */
+	add_up = (uint64_t)acked * tsock->snd_mss / tsock->snd_cwnd;
+
+	return tsock->snd_cwnd + RTE_MAX(1, add_up);
+}
+
+static uint32_t reno_ssthresh(struct tcp_sock *tsock, uint64_t now)
+{
+	return RTE_MAX(tsock->snd_cwnd / 2, (uint32_t)(2 * tsock->snd_mss));
+}
+
+static uint32_t reno_on_recovery_exit(struct tcp_sock *tsock, uint64_t now)
+{
+	return tsock->snd_ssthresh;
+}
+
+const struct tcp_cc_ops tcp_cc_reno = {
+	.name			= "reno",
+	.on_ack			= reno_on_ack,
+	.on_loss		= reno_ssthresh,
+	.on_rto			= reno_ssthresh,
+	.on_recovery_exit	= reno_on_recovery_exit,
+};
+
+static const struct tcp_cc_ops *tcp_cc_list[] = {
+	&tcp_cc_reno,
+	&tcp_cc_cubic,
+	&tcp_cc_dctcp,
+	&tcp_cc_bbr,
+};
+
+const struct tcp_cc_ops *tcp_cc_default = &tcp_cc_reno;
+
+const struct tcp_cc_ops *tcp_cc_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < RTE_DIM(tcp_cc_list); i++) {
+		if (strcmp(tcp_cc_list[i]->name, name) == 0)
+			return tcp_cc_list[i];
+	}
+
+	return NULL;
+}
+
+int tcp_cc_set(struct cfg_spec *spec, const char *val)
+{
+	const struct tcp_cc_ops *cc;
+
+	cc = tcp_cc_find(val);
+	if (!cc) {
+		LOG_WARN("unknown congestion control algorithm: %s", val);
+		return -1;
+	}
+
+	tcp_cc_default = cc;
+
+	return 0;
+}
+
+int tcp_cc_get(struct cfg_spec *spec, char *val)
+{
+	tpa_snprintf(val, VAL_SIZE, "%s", tcp_cc_default->name);
+
+	return 0;
+}
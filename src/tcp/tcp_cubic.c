@@ -0,0 +1,181 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "tpa.h"
+#include "tcp.h"
+#include "sock.h"
+#include "tcp_cc.h"
+
+/*
+ * CUBIC (RFC 8312), in integer math as the Linux one does:
+ *
+ *     W(t) = C * (t - K)^3 + W_max,  K = cbrt(W_max * (1 - beta) / C)
+ *
+ * where C = 0.4 and beta = 0.7; W is in segments and t is in seconds.
+ * Here time is scaled to 1/1024 second, hence
+ *
+ *     C * t^3 = t^3 * CUBE_RTT_SCALE >> CUBE_SHIFT
+ */
+#define CUBE_TIME_SHIFT		10
+#define CUBE_SHIFT		(10 + 3 * CUBE_TIME_SHIFT)
+#define CUBE_RTT_SCALE		410	/* 0.4 * 1024 */
+#define CUBE_FACTOR		((1ull << CUBE_SHIFT) / CUBE_RTT_SCALE)
+
+/* to avoid overflow; W(t) goes far beyond cwnd_max anyway */
+#define CUBE_TIME_MAX		(1u << 16)
+
+/* an ack gap longer than that is taken as idle */
+#define CUBIC_IDLE_MIN		1000	/* us */
+
+/* beta = 0.7; and (1 + beta) / 2 for fast convergence */
+#define CUBIC_BETA(x)		((uint64_t)(x) * 7 / 10)
+#define CUBIC_BETA_FC(x)	((uint64_t)(x) * 17 / 20)
+
+struct cubic {
+	uint64_t epoch_start;
+	uint64_t last_ack_ts;
+	uint32_t w_max;		/* in bytes, so as below */
+	uint32_t origin;
+	uint32_t w_est;		/* the reno friendly cwnd */
+	uint32_t k;		/* in 1/1024 second */
+};
+
+static uint32_t cubic_root(uint64_t x)
+{
+	uint64_t y = 0;
+	uint64_t b;
+	int s;
+
+	for (s = 63; s >= 0; s -= 3) {
+		y = 2 * y;
+		b = 3 * y * (y + 1) + 1;
+		if ((x >> s) >= b) {
+			x -= b << s;
+			y += 1;
+		}
+	}
+
+	return y;
+}
+
+static void cubic_reset(struct cubic *ca)
+{
+	memset(ca, 0, sizeof(*ca));
+}
+
+static void cubic_init(struct tcp_sock *tsock, uint64_t now)
+{
+	RTE_BUILD_BUG_ON(sizeof(struct cubic) > TCP_CC_PRIV_SIZE);
+
+	cubic_reset(TSOCK_CC_PRIV(tsock));
+}
+
+static void cubic_epoch_start(struct tcp_sock *tsock, struct cubic *ca, uint64_t now)
+{
+	uint32_t cwnd = tsock->snd_cwnd;
+
+	ca->epoch_start = now;
+	ca->w_est = cwnd;
+
+	if (cwnd < ca->w_max) {
+		ca->k = cubic_root(CUBE_FACTOR * ((ca->w_max - cwnd) / tsock->snd_mss));
+		ca->origin = ca->w_max;
+	} else {
+		ca->k = 0;
+		ca->origin = cwnd;
+	}
+}
+
+static uint32_t cubic_target(struct tcp_sock *tsock, struct cubic *ca, uint64_t now)
+{
+	uint64_t delta;
+	uint64_t offs;
+	uint64_t t;
+
+	/* where the curve goes one rtt later */
+	t = ((now - ca->epoch_start + (tsock->srtt >> 3)) << CUBE_TIME_SHIFT) / 1000000;
+	offs = t > ca->k ? t - ca->k : ca->k - t;
+	offs = RTE_MIN(offs, (uint64_t)CUBE_TIME_MAX);
+
+	delta = ((CUBE_RTT_SCALE * offs * offs * offs) >> CUBE_SHIFT) * tsock->snd_mss;
+	if (t > ca->k)
+		return RTE_MIN(ca->origin + delta, (uint64_t)UINT32_MAX);
+
+	return ca->origin > delta ? ca->origin - delta : 0;
+}
+
+static uint32_t cubic_on_ack(struct tcp_sock *tsock, uint32_t acked, uint64_t now)
+{
+	struct cubic *ca = TSOCK_CC_PRIV(tsock);
+	uint32_t cwnd = tsock->snd_cwnd;
+	uint32_t target;
+	uint32_t idle;
+
+	if (cwnd < tsock->snd_ssthresh)
+		return cwnd + acked;
+
+	/*
+	 * on_ack is invoked only when we are cwnd limited. Don't let
+	 * the curve grow while the cwnd is not fully used.
+	 */
+	idle = now - ca->last_ack_ts;
+	if (ca->epoch_start && idle > RTE_MAX(2 * (tsock->srtt >> 3), CUBIC_IDLE_MIN))
+		ca->epoch_start += idle - (tsock->srtt >> 3);
+	ca->last_ack_ts = now;
+
+	if (ca->epoch_start == 0)
+		cubic_epoch_start(tsock, ca, now);
+
+	target = cubic_target(tsock, ca, now);
+
+	/* stay no slower than reno, which grows by 3(1-beta)/(1+beta) mss per rtt */
+	ca->w_est += (uint64_t)acked * tsock->snd_mss * 9 / 17 / cwnd;
+	target = RTE_MAX(target, ca->w_est);
+
+	return RTE_MIN(RTE_MAX(target, cwnd), cwnd + cwnd / 2);
+}
+
+static uint32_t cubic_on_loss(struct tcp_sock *tsock, uint64_t now)
+{
+	struct cubic *ca = TSOCK_CC_PRIV(tsock);
+	uint32_t cwnd = tsock->snd_cwnd;
+
+	ca->epoch_start = 0;
+
+	/* fast convergence: release some bandwidth to the new flows */
+	if (cwnd < ca->w_max)
+		ca->w_max = CUBIC_BETA_FC(cwnd);
+	else
+		ca->w_max = cwnd;
+
+	return RTE_MAX(CUBIC_BETA(cwnd), 2ull * tsock->snd_mss);
+}
+
+static uint32_t cubic_on_rto(struct tcp_sock *tsock, uint64_t now)
+{
+	uint32_t ssthresh = RTE_MAX(CUBIC_BETA(tsock->snd_cwnd), 2ull * tsock->snd_mss);
+
+	/* the network might have changed a lot; start over */
+	cubic_reset(TSOCK_CC_PRIV(tsock));
+
+	return ssthresh;
+}
+
+static uint32_t cubic_on_recovery_exit(struct tcp_sock *tsock, uint64_t now)
+{
+	return tsock->snd_ssthresh;
+}
+
+const struct tcp_cc_ops tcp_cc_cubic = {
+	.name			= "cubic",
+	.init			= cubic_init,
+	.on_ack			= cubic_on_ack,
+	.on_loss		= cubic_on_loss,
+	.on_rto			= cubic_on_rto,
+	.on_recovery_exit	= cubic_on_recovery_exit,
+};
@@ -0,0 +1,120 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "tpa.h"
+#include "tcp.h"
+#include "sock.h"
+#include "tcp_cc.h"
+
+/*
+ * DCTCP (RFC 8257). The fraction of CE marked bytes is sampled each
+ * window, and smoothed into alpha:
+ *
+ *     alpha = (1 - g) * alpha + g * F
+ *
+ * On ECE, the cwnd is cut by alpha / 2 instead of by half. Otherwise,
+ * it behaves just like reno.
+ */
+#define DCTCP_ALPHA_SHIFT	10
+#define DCTCP_ALPHA_MAX		(1u << DCTCP_ALPHA_SHIFT)
+
+/* g = 1/16 */
+#define DCTCP_G_SHIFT		4
+
+struct dctcp {
+	uint32_t alpha;		/* scaled by DCTCP_ALPHA_MAX */
+	uint32_t next_seq;	/* where the current window ends */
+	uint32_t acked_bytes;
+	uint32_t ce_bytes;
+};
+
+static void dctcp_reset_window(struct tcp_sock *tsock, struct dctcp *ca)
+{
+	ca->next_seq = tsock->snd_nxt;
+	ca->acked_bytes = 0;
+	ca->ce_bytes = 0;
+}
+
+static void dctcp_init(struct tcp_sock *tsock, uint64_t now)
+{
+	struct dctcp *ca = TSOCK_CC_PRIV(tsock);
+
+	RTE_BUILD_BUG_ON(sizeof(struct dctcp) > TCP_CC_PRIV_SIZE);
+
+	/* be conservative before we know anything; as Linux does */
+	ca->alpha = DCTCP_ALPHA_MAX;
+	dctcp_reset_window(tsock, ca);
+}
+
+static void dctcp_in_ack(struct tcp_sock *tsock, uint32_t acked, int ece, uint64_t now)
+{
+	struct dctcp *ca = TSOCK_CC_PRIV(tsock);
+	uint32_t delta;
+
+	ca->acked_bytes += acked;
+	if (ece)
+		ca->ce_bytes += acked;
+
+	if (seq_lt(tsock->snd_una, ca->next_seq))
+		return;
+
+	/* make sure alpha decays to zero eventually */
+	delta = ca->alpha >> DCTCP_G_SHIFT;
+	ca->alpha -= delta ? delta : ca->alpha;
+
+	if (ca->ce_bytes) {
+		ca->alpha += ((uint64_t)ca->ce_bytes << (DCTCP_ALPHA_SHIFT - DCTCP_G_SHIFT)) /
+			     ca->acked_bytes;
+		ca->alpha = RTE_MIN(ca->alpha, DCTCP_ALPHA_MAX);
+	}
+
+	dctcp_reset_window(tsock, ca);
+}
+
+static uint32_t dctcp_on_ecn(struct tcp_sock *tsock, uint64_t now)
+{
+	struct dctcp *ca = TSOCK_CC_PRIV(tsock);
+	uint32_t cwnd = tsock->snd_cwnd;
+
+	cwnd -= ((uint64_t)cwnd * ca->alpha) >> (DCTCP_ALPHA_SHIFT + 1);
+
+	return RTE_MAX(cwnd, 2u * tsock->snd_mss);
+}
+
+/* RFC 8257 3.3: react to loss just like the standard TCP does */
+static uint32_t dctcp_on_ack(struct tcp_sock *tsock, uint32_t acked, uint64_t now)
+{
+	return tcp_cc_reno.on_ack(tsock, acked, now);
+}
+
+static uint32_t dctcp_on_loss(struct tcp_sock *tsock, uint64_t now)
+{
+	return tcp_cc_reno.on_loss(tsock, now);
+}
+
+static uint32_t dctcp_on_rto(struct tcp_sock *tsock, uint64_t now)
+{
+	return tcp_cc_reno.on_rto(tsock, now);
+}
+
+static uint32_t dctcp_on_recovery_exit(struct tcp_sock *tsock, uint64_t now)
+{
+	return tcp_cc_reno.on_recovery_exit(tsock, now);
+}
+
+const struct tcp_cc_ops tcp_cc_dctcp = {
+	.name			= "dctcp",
+	.flags			= TCP_CC_FLAG_NEEDS_ECN | TCP_CC_FLAG_ECN_ECHO_CE,
+	.init			= dctcp_init,
+	.in_ack			= dctcp_in_ack,
+	.on_ecn			= dctcp_on_ecn,
+	.on_ack			= dctcp_on_ack,
+	.on_loss		= dctcp_on_loss,
+	.on_rto			= dctcp_on_rto,
+	.on_recovery_exit	= dctcp_on_recovery_exit,
+};
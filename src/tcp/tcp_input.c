@@ -18,6 +18,7 @@
 #include "worker.h"
 #include "tsock_trace.h"
 #include "log.h"
+#include "csum.h"
 
 struct iov_ctx {
 	uint32_t nr_iov;
@@ -29,10 +30,10 @@ struct iov_ctx {
 
 static inline void tsock_read_latency_update(struct tcp_sock *tsock, struct packet *pkt)
 {
-	vstats_add(&tsock->read_lat.submit, pkt->read_tsc.submit - pkt->read_tsc.start);
-	vstats_add(&tsock->read_lat.drain, pkt->read_tsc.drain - pkt->read_tsc.start);
-	vstats_add(&tsock->read_lat.complete, rte_rdtsc() - pkt->read_tsc.start);
-	vstats_add(&tsock->read_lat.last_write, rte_rdtsc() - tsock->last_ts[LAST_TS_WRITE]);
+	vstats_add(&tsock->stats->read_lat.submit, pkt->read_tsc.submit - pkt->read_tsc.start);
+	vstats_add(&tsock->stats->read_lat.drain, pkt->read_tsc.drain - pkt->read_tsc.start);
+	vstats_add(&tsock->stats->read_lat.complete, rte_rdtsc() - pkt->read_tsc.start);
+	vstats_add(&tsock->stats->read_lat.last_write, rte_rdtsc() - tsock->last_ts[LAST_TS_WRITE]);
 }
 
 static void iov_buf_free(void *addr, void *param)
@@ -77,7 +78,9 @@ static inline int pkt_to_iov(struct iov_ctx *ctx, struct packet *pkt)
 	struct tpa_iovec *iov = ctx->iov;
 
 	while (TCP_SEG(pkt)->len && ctx->idx < ctx->nr_iov) {
-		ctx->size += pkt_to_iov_one_seg(&iov[ctx->idx++], pkt, to_read);
+		/* the segs cut off from a pkt chained by tcp_rcv_coalesce */
+		if (likely(to_read->l5_len))
+			ctx->size += pkt_to_iov_one_seg(&iov[ctx->idx++], pkt, to_read);
 		to_read = (struct packet *)(to_read->mbuf.next);
 	}
 
@@ -107,6 +110,104 @@ static inline int pkt_to_iov(struct iov_ctx *ctx, struct packet *pkt)
 	}								\
 } while (0)
 
+/*
+ * How many bytes we could hold for sure. It's bounded by the free rxq
+ * slots rather than bytes, as a slot holds a pkt (chain) of any size.
+ * Small pkts are coalesced into the last rxq pkt till it holds
+ * TSOCK_RCV_SLOT_BYTES (see tcp_rcv_coalesce); thus every free slot is
+ * good for that many bytes, no matter how the peer segments the data.
+ * It's what lets the wnd advertised here be a promise the rxq keeps.
+ *
+ * The ooo pkts take rxq slots once drained, while the data they hold
+ * is always counted in.
+ */
+uint32_t tsock_rcv_space(struct tcp_sock *tsock)
+{
+	struct ooo_index *idx = &tsock->ooo_index;
+	uint64_t space = 0;
+	int nr_free;
+
+	nr_free = tcp_rxq_free_count(&tsock->rxq) - tsock->nr_ooo_pkt;
+	if (nr_free > 0)
+		space = (uint64_t)nr_free * TSOCK_RCV_SLOT_BYTES;
+
+	if (idx->nr)
+		space = RTE_MAX(space, (uint64_t)(idx->runs[idx->nr - 1].end - tsock->rcv_nxt));
+
+	return RTE_MIN(space, TCP_WINDOW_MAX - 1);
+}
+
+static int tsock_rxq_resize(struct tcp_sock *tsock, uint16_t size)
+{
+	void **objs;
+
+	objs = malloc(size * sizeof(void *));
+	if (!objs)
+		return -1;
+
+	free(tsock->rxq.objs);
+	tcp_rxq_migrate(&tsock->rxq, objs, size);
+
+	return 0;
+}
+
+/* the rxq is never shrunk below what it takes to hold the advertised wnd */
+static int tsock_rxq_could_shrink(struct tcp_sock *tsock)
+{
+	struct tcp_rxq *rxq = &tsock->rxq;
+	int nr_free;
+
+	if (rxq->size <= tcp_cfg.rcv_queue_size)
+		return 0;
+
+	nr_free = rxq->size / 2 - tcp_rxq_readable_count(rxq) - tsock->nr_ooo_pkt;
+	if (nr_free <= 0)
+		return 0;
+
+	return (uint64_t)nr_free * TSOCK_RCV_SLOT_BYTES >= tsock->rcv_wnd;
+}
+
+/*
+ * The rcv wnd auto tuning. The bytes the app reads in an rtt tell the
+ * BDP: the rxq is grown (up to tcp.rcv_queue_size_max) once it can't
+ * hold 2 times of that, so that the wnd doesn't limit the peer. On the
+ * other hand, it's shrunk back under mbuf pressure.
+ */
+static void tcp_rcv_space_adjust(struct tcp_sock *tsock, uint32_t size)
+{
+	struct tpa_worker *worker = tsock->worker;
+	struct tcp_rxq *rxq = &tsock->rxq;
+	uint32_t rtt;
+
+	if (unlikely(too_many_used_mbufs(worker))) {
+		if (tsock_rxq_could_shrink(tsock) &&
+		    tsock_rxq_resize(tsock, rxq->size / 2) == 0)
+			WORKER_TSOCK_STATS_INC(worker, tsock, RXQ_SHRINK);
+
+		tsock->rcv_space_bytes = 0;
+		tsock->rcv_space_ts = worker->ts_us;
+		return;
+	}
+
+	tsock->rcv_space_bytes += size;
+
+	rtt = tsock->srtt >> 3;
+	if (rtt == 0)
+		rtt = TSOCK_RCV_SPACE_RTT_DEFAULT;
+	if (worker->ts_us - tsock->rcv_space_ts < rtt)
+		return;
+
+	if (2 * (uint64_t)tsock->rcv_space_bytes > (uint64_t)rxq->size * TSOCK_RCV_SLOT_BYTES &&
+	    rxq->size * 2 <= tcp_cfg.rcv_queue_size_max &&
+	    tsock_rxq_resize(tsock, rxq->size * 2) == 0)
+		WORKER_TSOCK_STATS_INC(worker, tsock, RXQ_GROW);
+
+	tsock->rcv_space_bytes = 0;
+	tsock->rcv_space_ts = worker->ts_us;
+}
+
+static void tcp_gro_flush_on_read(struct tcp_sock *tsock);
+
 ssize_t tsock_zreadv(struct tcp_sock *tsock, struct tpa_iovec *iov, int nr_iov)
 {
 	struct tcp_rxq *rxq = &tsock->rxq;
@@ -118,9 +219,14 @@ ssize_t tsock_zreadv(struct tcp_sock *tsock, struct tpa_iovec *iov, int nr_iov)
 	};
 	struct packet *pkt;
 	uint32_t nr_pkt = 0;
+	uint32_t wnd;
 
 	TSOCK_READ_CHECK(tsock);
 
+	/* don't make the reader wait for GRO */
+	if (tsock->rx_merge_head)
+		tcp_gro_flush_on_read(tsock);
+
 	while (1) {
 		pkt = tcp_rxq_peek_unread(rxq, nr_pkt);
 		if (!pkt)
@@ -149,14 +255,27 @@ ssize_t tsock_zreadv(struct tcp_sock *tsock, struct tpa_iovec *iov, int nr_iov)
 		return -1;
 	}
 	tcp_rxq_update_unread(rxq, nr_pkt);
-	vstats_add(&tsock->read_size, ctx.size);
+	vstats_add(&tsock->stats->read_size, ctx.size);
+
+	tcp_rcv_space_adjust(tsock, ctx.size);
 
-	if (unlikely(tsock->rcv_wnd == 0)) {
-		tsock->flags |= TSOCK_FLAG_ACK_NEEDED;
-		output_tsock_enqueue(tsock->worker, tsock);
-		WORKER_TSOCK_STATS_INC(tsock->worker, tsock, WND_UPDATE);
+	/*
+	 * The window is only ever reopened here, and never beyond what
+	 * the rxq could hold: a rxq running short of room is turned into
+	 * back-pressure by holding the right edge where it is, instead of
+	 * retracting an edge we have already advertised (RFC 9293 3.8.6).
+	 */
+	wnd = tsock_rcv_space(tsock);
+	if (unlikely(wnd < tsock->rcv_wnd))
+		WORKER_TSOCK_STATS_INC(tsock->worker, tsock, RCV_WND_HELD);
+	if (wnd > tsock->rcv_wnd) {
+		if (unlikely(tsock->rcv_wnd == 0)) {
+			tsock->flags |= TSOCK_FLAG_ACK_NEEDED;
+			output_tsock_enqueue(tsock->worker, tsock);
+			WORKER_TSOCK_STATS_INC(tsock->worker, tsock, WND_UPDATE);
+		}
+		tsock->rcv_wnd = wnd;
 	}
-	tsock->rcv_wnd += ctx.size;
 
 	if (unlikely(trace_cfg.more_trace))
 		trace_tcp_zreadv(tsock, ctx.size, nr_iov, ctx.idx, tcp_rxq_readable_count(&tsock->rxq));
@@ -264,29 +383,135 @@ static inline int parse_ts_opt_fast(struct packet *pkt)
 	return -1;
 }
 
+/* the seg the data of the pkt (chain) ends in */
+static inline struct packet *pkt_last_data_seg(struct packet *head)
+{
+	struct packet *pkt = head->to_read;
+	uint32_t len = TCP_SEG(head)->len;
+
+	while (len > pkt->l5_len) {
+		len -= pkt->l5_len;
+		pkt = (struct packet *)(pkt->mbuf.next);
+	}
+
+	return pkt;
+}
+
+static int tcp_rcv_coalesce_copy(struct packet *head, struct packet *last,
+				 struct packet *pkt)
+{
+	uint32_t len = TCP_SEG(pkt)->len;
+	uint32_t off = last->l5_off + last->l5_len;
+	struct packet *seg;
+	uint8_t *dst;
+	uint32_t n;
+
+	if (!RTE_MBUF_DIRECT(&last->mbuf) || rte_mbuf_refcnt_read(&last->mbuf) != 1 ||
+	    off + len > last->mbuf.buf_len)
+		return 0;
+
+	dst = packet_data(last) + off;
+	for (seg = pkt->to_read; len; seg = (struct packet *)(seg->mbuf.next)) {
+		n = RTE_MIN(len, seg->l5_len);
+		memcpy(dst, tcp_payload_addr(seg), n);
+		dst += n;
+		len -= n;
+	}
+
+	len = TCP_SEG(pkt)->len;
+	head->mbuf.pkt_len -= last->mbuf.data_len;
+	last->l5_len += len;
+	last->mbuf.data_len = off + len - last->mbuf.data_off;
+	head->mbuf.pkt_len += last->mbuf.data_len;
+	TCP_SEG(head)->len += len;
+	TCP_SEG(pkt)->len = 0;
+
+	return 1;
+}
+
+static int tcp_rcv_coalesce_chain(struct packet *head, struct packet *last,
+				  struct packet *pkt)
+{
+	struct packet *seg;
+
+	if (last->mbuf.next != NULL || TCP_SEG(head)->len + TCP_SEG(pkt)->len > UINT16_MAX ||
+	    head->nr_read_seg + pkt->nr_read_seg > (int)tcp_cfg.pkt_max_chain)
+		return 0;
+
+	for (seg = pkt; seg != pkt->to_read; seg = (struct packet *)(seg->mbuf.next))
+		seg->l5_len = 0;
+
+	last->mbuf.next = &pkt->mbuf;
+	head->mbuf.nb_segs += pkt->mbuf.nb_segs;
+	head->mbuf.pkt_len += pkt->mbuf.pkt_len;
+	head->nr_read_seg  += pkt->nr_read_seg;
+	TCP_SEG(head)->len += TCP_SEG(pkt)->len;
+
+	return 1;
+}
+
+/*
+ * Coalesces @pkt into the last rxq pkt, if that one holds less than
+ * TSOCK_RCV_SLOT_BYTES: tsock_rcv_space counts on it.
+ *
+ * @pkt is chained, so that the app reads the same iovs as it would
+ * otherwise; the segs cut off from its head are left in the chain with
+ * no data, and they are skipped at read. Tiny pkts are copied into the
+ * room left in the last mbuf instead, as they would exhaust the chain
+ * before the slot is full. Note that the last data seg is never handed
+ * to the app as long as the pkt is not fully read.
+ *
+ * A pkt coalesced by copy is left with TCP_SEG(pkt)->len being 0, and
+ * it's up to the caller to free it, just like any other pkt carries no
+ * data.
+ */
+static int tcp_rcv_coalesce(struct tcp_sock *tsock, struct packet *pkt)
+{
+	struct packet *head = tcp_rxq_peek_last(&tsock->rxq);
+	struct packet *last;
+
+	if (!head || TCP_SEG(head)->len >= TSOCK_RCV_SLOT_BYTES)
+		return 0;
+
+	last = pkt_last_data_seg(head);
+	if (TCP_SEG(pkt)->len * (tcp_cfg.pkt_max_chain - 1) < TSOCK_RCV_SLOT_BYTES)
+		return tcp_rcv_coalesce_copy(head, last, pkt) ||
+		       tcp_rcv_coalesce_chain(head, last, pkt);
+
+	return tcp_rcv_coalesce_chain(head, last, pkt) ||
+	       tcp_rcv_coalesce_copy(head, last, pkt);
+}
+
 static inline int tcp_rcv_enqueue(struct tpa_worker *worker, struct tcp_sock *tsock,
 				  struct packet *pkt)
 {
+	uint32_t len;
+
 	if (unlikely(TCP_SEG(pkt)->len > tsock->rcv_wnd))
 		tcp_packet_cut(pkt, TCP_SEG(pkt)->len - tsock->rcv_wnd, CUT_TAIL);
 
-	if (unlikely(TCP_SEG(pkt)->len == 0))
+	len = TCP_SEG(pkt)->len;
+	if (unlikely(len == 0))
 		return 0;
 
-	if (unlikely(tcp_rxq_enqueue_burst(&tsock->rxq, (void **)&pkt, 1) != 1))
-		return -ERR_TCP_RXQ_ENQUEUE_FAIL;
+	if (tcp_rcv_coalesce(tsock, pkt)) {
+		WORKER_TSOCK_STATS_INC(worker, tsock, RXQ_COALESCE);
+	} else {
+		if (unlikely(tcp_rxq_enqueue_burst(&tsock->rxq, (void **)&pkt, 1) != 1))
+			return -ERR_TCP_RXQ_ENQUEUE_FAIL;
 
-	tsock->rcv_nxt += TCP_SEG(pkt)->len;
-	tsock->rcv_wnd -= TCP_SEG(pkt)->len;
+		if (unlikely(pkt->flags & PKT_FLAG_MEASURE_READ_LATENCY))
+			pkt->read_tsc.submit = rte_rdtsc();
+	}
 
-	WORKER_TSOCK_STATS_ADD(worker, tsock, BYTE_RECV, TCP_SEG(pkt)->len);
-	tsock_event_add(tsock, TPA_EVENT_IN);
+	tsock->rcv_nxt += len;
+	tsock->rcv_wnd -= len;
 
-	if (unlikely(pkt->flags & PKT_FLAG_MEASURE_READ_LATENCY))
-		pkt->read_tsc.submit = rte_rdtsc();
+	WORKER_TSOCK_STATS_ADD(worker, tsock, BYTE_RECV, len);
+	tsock_event_add(tsock, TPA_EVENT_IN);
 
 	tsock_update_last_ts(tsock, LAST_TS_RCV_DATA);
-	trace_tcp_rcv_enqueue(tsock, tsock->rcv_nxt, TCP_SEG(pkt)->len,
+	trace_tcp_rcv_enqueue(tsock, tsock->rcv_nxt, len,
 			      tsock->rcv_wnd, tcp_rxq_readable_count(&tsock->rxq));
 
 	return 0;
@@ -354,7 +579,7 @@ static void sack_update(struct tcp_sock *tsock, uint32_t start, uint32_t len)
 	 * no sack merge happened; shift the sack blocks to right and
 	 * then put the new one in front
 	 */
-	nr_to_shift = RTE_MIN(tsock->nr_sack_block, TCP_MAX_NR_SACK_BLOCK - 1);
+	nr_to_shift = RTE_MIN(tsock->nr_sack_block, tsock_sack_block_max(tsock) - 1);
 	memmove(&tsock->sack_blocks[1], &tsock->sack_blocks[0],
 		nr_to_shift * sizeof(struct tcp_sack_block));
 	tsock->nr_sack_block = nr_to_shift + 1;
@@ -367,21 +592,66 @@ trace:
 }
 
 /*
- * Do the last regulation: remove seqs have been recv-ed.
+ * RFC 2883: reports a duplicate seg by the first sack block (D-SACK)
+ * of the next ACK, so that the sender could tell a spurious retrans.
+ * Only the latest one is reported.
+ */
+static void sack_update_dsack(struct tpa_worker *worker, struct tcp_sock *tsock,
+			      uint32_t start, uint32_t end)
+{
+	if (!tsock->sack_ok)
+		return;
+
+	tsock->flags |= TSOCK_FLAG_DSACK;
+	tsock->dsack_block.start = start;
+	tsock->dsack_block.end   = end;
+
+	WORKER_TSOCK_STATS_INC(worker, tsock, DSACK_SENT);
+	tsock_trace_sack(tsock, SACK_DSACK, &tsock->dsack_block, 1);
+}
+
+/*
+ * Do the last regulation: the sack blocks are derived from the ooo
+ * index, so that we never report seqs have been recv-ed, or the ooo
+ * pkts have been dropped (RFC 2018 page 10).
  */
 static void sack_regulate(struct tcp_sock *tsock)
 {
+	struct ooo_index *idx = &tsock->ooo_index;
 	struct tcp_sack_block *blk;
+	struct ooo_run *run;
+	int changed = 0;
 	int nr_sack = 0;
-	int i;
+	uint32_t i;
+	int j;
+	int k;
 
-	for (i = 0; i < tsock->nr_sack_block; i++) {
-		blk = &tsock->sack_blocks[i];
-		if (seq_gt(blk->start, tsock->rcv_nxt))
-			tsock->sack_blocks[nr_sack++] = *blk;
+	for (j = 0; j < tsock->nr_sack_block; j++) {
+		blk = &tsock->sack_blocks[j];
+
+		i = ooo_index_search(idx, blk->start + 1);
+		run = i < idx->nr ? &idx->runs[i] : NULL;
+		if (!run || seq_ge(run->start, blk->end) || seq_le(run->start, tsock->rcv_nxt))
+			goto drop;
+
+		/* two blocks may end up with the same run, after a drop */
+		for (k = 0; k < nr_sack; k++) {
+			if (tsock->sack_blocks[k].start == run->start)
+				goto drop;
+		}
+
+		if (blk->start != run->start || blk->end != run->end)
+			changed = 1;
+		tsock->sack_blocks[nr_sack].start = run->start;
+		tsock->sack_blocks[nr_sack].end   = run->end;
+		nr_sack += 1;
+		continue;
+
+	drop:
+		changed = 1;
 	}
 
-	if (tsock->nr_sack_block != nr_sack) {
+	if (changed) {
 		tsock->nr_sack_block = nr_sack;
 		tsock_trace_sack(tsock, SACK_REGULATE, tsock->sack_blocks, tsock->nr_sack_block);
 
@@ -389,7 +659,7 @@ static void sack_regulate(struct tcp_sock *tsock)
 	}
 }
 
-void tsock_remove_ooo_pkt(struct tcp_sock *tsock, struct packet *pkt)
+static void ooo_unlink_pkt(struct tcp_sock *tsock, struct packet *pkt)
 {
 	TAILQ_REMOVE(&tsock->rcv_ooo_queue, pkt, node);
 	tsock->nr_ooo_pkt -= 1;
@@ -400,11 +670,65 @@ void tsock_remove_ooo_pkt(struct tcp_sock *tsock, struct packet *pkt)
 }
 
 /*
- * TODO: according to the sack RFC2018 page 10, we should update the
- * sack when ooo mbufs are dropped:
- *
- *   Except for the newest segment, all SACK blocks MUST NOT report
- *   any old data which is no longer actually held by the receiver.
+ * Note that the pkt has to be either the head or the tail of the
+ * run it belongs to; it's always the case so far.
+ */
+void tsock_remove_ooo_pkt(struct tcp_sock *tsock, struct packet *pkt)
+{
+	struct ooo_index *idx = &tsock->ooo_index;
+	struct ooo_run *run;
+	struct packet *tmp;
+	uint32_t i;
+
+	/* the run ending at seq is impossible: it'd be merged */
+	i = ooo_index_search(idx, TCP_SEG(pkt)->seq + 1);
+	debug_assert(i < idx->nr);
+
+	run = &idx->runs[i];
+	if (run->head == pkt && run->tail == pkt) {
+		ooo_index_remove(idx, i);
+	} else if (run->head == pkt) {
+		tmp = TAILQ_NEXT(pkt, node);
+		run->head  = tmp;
+		run->start = TCP_SEG(tmp)->seq;
+	} else {
+		debug_assert(run->tail == pkt);
+
+		tmp = TAILQ_PREV(pkt, packet_list, node);
+		run->tail = tmp;
+		run->end  = TCP_SEG(tmp)->seq + TCP_SEG(tmp)->len;
+	}
+
+	ooo_unlink_pkt(tsock, pkt);
+}
+
+/* drops all pkts of the run @i; returns the number of pkts dropped */
+static int ooo_drop_run(struct tcp_sock *tsock, uint32_t i)
+{
+	struct ooo_run *run = &tsock->ooo_index.runs[i];
+	struct packet *pkt = run->head;
+	struct packet *next;
+	int nr_pkt = 0;
+
+	while (1) {
+		next = TAILQ_NEXT(pkt, node);
+		ooo_unlink_pkt(tsock, pkt);
+		packet_free(pkt);
+		nr_pkt += 1;
+
+		if (pkt == run->tail)
+			break;
+		pkt = next;
+	}
+
+	ooo_index_remove(&tsock->ooo_index, i);
+
+	return nr_pkt;
+}
+
+/*
+ * The ooo mbufs are dropped from the tail, where they are the least
+ * urgent for the app, and the sack blocks are regulated accordingly.
  */
 void tsock_drop_ooo_mbufs(struct tcp_sock *tsock)
 {
@@ -424,11 +748,10 @@ void tsock_drop_ooo_mbufs(struct tcp_sock *tsock)
 
 			tsock_remove_ooo_pkt(tsock, pkt);
 			packet_free(pkt);
-
-			if (tsock->last_ooo_pkt == pkt)
-				tsock->last_ooo_pkt = NULL;
 		}
 	}
+
+	sack_regulate(tsock);
 }
 
 static void ooo_queue_drain(struct tpa_worker *worker, struct tcp_sock *tsock)
@@ -457,11 +780,13 @@ static void ooo_queue_drain(struct tpa_worker *worker, struct tcp_sock *tsock)
 			 * happens.
 			 */
 			WORKER_TSOCK_STATS_INC(worker, tsock, -err);
-			return;
+			break;
 		}
 
 		next = TAILQ_NEXT(pkt, node);
 		tsock_remove_ooo_pkt(tsock, pkt);
+		if (TCP_SEG(pkt)->len == 0)
+			packet_free(pkt);
 
 		pkt = next;
 	}
@@ -472,23 +797,29 @@ static void ooo_queue_drain(struct tpa_worker *worker, struct tcp_sock *tsock)
 		uint32_t recover_time = worker->ts_us - tsock->ooo_start_ts;
 
 		debug_assert(TAILQ_EMPTY(&tsock->rcv_ooo_queue));
+		debug_assert(tsock->ooo_index.nr == 0);
+		debug_assert(tsock->nr_sack_block == 0);
 
-		vstats_add(&tsock->ooo_recover_time, recover_time);
+		vstats_add(&tsock->stats->ooo_recover_time, recover_time);
 		trace_tcp_ooo(tsock, OOO_RECOVERED, recover_time);
 		tsock_trace_archive(tsock->trace, "ooo-%.3fms",
 				    (double)recover_time / 1e3);
 		tsock->last_ooo_pkt = NULL;
-
-		/*
-		 * Ideally, nr_sack_block should go 0 here, if we update
-		 * the sack blocks when we drop ooo mbufs.
-		 */
-		tsock->nr_sack_block = 0;
 	}
 }
 
-static int ooo_queue_insert(struct tcp_sock *tsock, struct packet *prev, struct packet *pkt)
+/*
+ * Inserts the pkt right before the run @i, which is the first run
+ * that ends at or after the pkt seq. The pkt is merged into the run
+ * before and/or @i when it's adjacent.
+ */
+static int ooo_queue_insert(struct tcp_sock *tsock, uint32_t i, struct packet *pkt)
 {
+	struct ooo_index *idx = &tsock->ooo_index;
+	struct ooo_run *prev = NULL;
+	struct ooo_run *next = NULL;
+	struct ooo_run *run;
+	uint32_t end;
 	int to_cut;
 
 	to_cut = TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len - (tsock->rcv_nxt + tsock->rcv_wnd);
@@ -505,12 +836,43 @@ static int ooo_queue_insert(struct tcp_sock *tsock, struct packet *prev, struct
 		return -ERR_TCP_RCV_OOO_LIMIT;
 	}
 
-	if (prev)
-		TAILQ_INSERT_AFTER(&tsock->rcv_ooo_queue, prev, pkt, node);
+	end = TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len;
+	if (i > 0 && idx->runs[i - 1].end == TCP_SEG(pkt)->seq)
+		prev = &idx->runs[i - 1];
+	if (i < idx->nr && idx->runs[i].start == end)
+		next = &idx->runs[i];
+
+	if (!prev && !next && ooo_index_reserve(idx) < 0)
+		return -ERR_TCP_RCV_OOO_NO_MEM;
+
+	if (i > 0)
+		TAILQ_INSERT_AFTER(&tsock->rcv_ooo_queue, idx->runs[i - 1].tail, pkt, node);
 	else
 		TAILQ_INSERT_HEAD(&tsock->rcv_ooo_queue, pkt, node);
 
-	sack_update(tsock, TCP_SEG(pkt)->seq, TCP_SEG(pkt)->len);
+	if (prev && next) {
+		/* the hole is filled */
+		prev->end  = next->end;
+		prev->tail = next->tail;
+		ooo_index_remove(idx, i);
+		run = prev;
+	} else if (prev) {
+		prev->end  = end;
+		prev->tail = pkt;
+		run = prev;
+	} else if (next) {
+		next->start = TCP_SEG(pkt)->seq;
+		next->head  = pkt;
+		run = next;
+	} else {
+		run = ooo_index_insert(idx, i);
+		run->start = TCP_SEG(pkt)->seq;
+		run->end   = end;
+		run->head  = pkt;
+		run->tail  = pkt;
+	}
+
+	sack_update(tsock, run->start, run->end - run->start);
 	tsock->nr_ooo_pkt += 1;
 	tsock->worker->nr_ooo_mbuf += pkt->mbuf.nb_segs;
 	tsock->last_ooo_pkt = pkt;
@@ -522,10 +884,11 @@ static int ooo_queue_insert(struct tcp_sock *tsock, struct packet *prev, struct
 static int tcp_rcv_data_ooo(struct tpa_worker *worker, struct tcp_sock *tsock,
 			    struct packet *pkt)
 {
-	struct packet *prev = NULL;
-	struct packet *next;
-	struct packet *tmp;
+	struct ooo_index *idx = &tsock->ooo_index;
+	struct ooo_run *run;
+	uint32_t i;
 	int to_cut;
+	int nr_pkt;
 
 	WORKER_TSOCK_STATS_INC(worker, tsock, PKT_RECV_OOO);
 	if (tsock->nr_ooo_pkt == 0)
@@ -537,67 +900,65 @@ static int tcp_rcv_data_ooo(struct tpa_worker *worker, struct tcp_sock *tsock,
 
 		end_seq = TCP_SEG(tsock->last_ooo_pkt)->seq + TCP_SEG(tsock->last_ooo_pkt)->len;
 		if (end_seq == TCP_SEG(pkt)->seq) {
-			prev = tsock->last_ooo_pkt;
+			i = idx->nr;
 			WORKER_TSOCK_STATS_INC(worker, tsock, PKT_RECV_OOO_PREDICT);
 			goto insert;
 		}
 	}
 
-	TAILQ_FOREACH(next, &tsock->rcv_ooo_queue, node) {
-		debug_assert(seq_ge(TCP_SEG(next)->seq, tsock->rcv_nxt) && TCP_SEG(next)->len > 0);
-		debug_assert(prev == NULL || seq_gt(TCP_SEG(next)->seq, TCP_SEG(prev)->seq));
-		if (seq_gt(TCP_SEG(next)->seq, TCP_SEG(pkt)->seq))
-			break;
-		prev = next;
-	}
-
-	if (prev) {
-		if (TCP_SEG(pkt)->seq == TCP_SEG(prev)->seq &&
-		    TCP_SEG(pkt)->len >  TCP_SEG(prev)->len) {
-			/* this one completely overlaps the prev one; replace it */
-			trace_tcp_ooo(tsock, OOO_DROP_PREV_AND_REPLACE, TCP_SEG(prev)->len);
+	i = ooo_index_search(idx, TCP_SEG(pkt)->seq);
+	if (i < idx->nr) {
+		run = &idx->runs[i];
+		debug_assert(seq_ge(run->start, tsock->rcv_nxt));
+
+		if (TCP_SEG(pkt)->seq == run->start &&
+		    seq_gt(TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len, run->end)) {
+			/* this one completely overlaps the run; replace it */
+			trace_tcp_ooo(tsock, OOO_DROP_PREV_AND_REPLACE, run->end - run->start);
+			ooo_drop_run(tsock, i);
+		} else if (seq_le(run->start, TCP_SEG(pkt)->seq)) {
+			to_cut = run->end - TCP_SEG(pkt)->seq;
+			if (to_cut >= TCP_SEG(pkt)->len) {
+				trace_tcp_ooo(tsock, OOO_DROP_CURR, run->start);
+				sack_update_dsack(worker, tsock, TCP_SEG(pkt)->seq,
+						  TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len);
+
+				/* and the block holding it goes right after the D-SACK */
+				sack_update(tsock, run->start, run->end - run->start);
+				return -ERR_TCP_RCV_OOO_DUP;
+			}
 
-			tmp = prev;
-			prev = TAILQ_PREV(prev, packet_list, node);
-			tsock_remove_ooo_pkt(tsock, tmp);
-			packet_free(tmp);
-		} else {
-			to_cut = TCP_SEG(prev)->seq + TCP_SEG(prev)->len - TCP_SEG(pkt)->seq;
 			if (to_cut > 0) {
-				if (to_cut >= TCP_SEG(pkt)->len) {
-					trace_tcp_ooo(tsock, OOO_DROP_CURR, TCP_SEG(prev)->seq);
-					return -ERR_TCP_RCV_OOO_DUP;
-				}
-
 				trace_tcp_ooo(tsock, OOO_CUT_LEFT, to_cut);
+				sack_update_dsack(worker, tsock, TCP_SEG(pkt)->seq,
+						  TCP_SEG(pkt)->seq + to_cut);
 				tcp_packet_cut(pkt, to_cut, CUT_HEAD);
 			}
+
+			i += 1;
 		}
 	}
 
-	while (next) {
-		to_cut = TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len - TCP_SEG(next)->seq;
+	while (i < idx->nr) {
+		run = &idx->runs[i];
+
+		to_cut = TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len - run->start;
 		if (to_cut <= 0)
 			break;
 
-		if (to_cut < TCP_SEG(next)->len) {
+		if (seq_lt(TCP_SEG(pkt)->seq + TCP_SEG(pkt)->len, run->end)) {
 			trace_tcp_ooo(tsock, OOO_CUT_RIGHT, to_cut);
 			tcp_packet_cut(pkt, to_cut, CUT_TAIL);
 			break;
 		}
 
-		trace_tcp_ooo(tsock, OOO_DROP_NEXT, TCP_SEG(next)->seq);
-		WORKER_TSOCK_STATS_INC(worker, tsock, ERR_TCP_RCV_OOO_DUP);
-
-		tmp = next;
-		next = TAILQ_NEXT(next, node);
-
-		tsock_remove_ooo_pkt(tsock, tmp);
-		packet_free(tmp);
+		trace_tcp_ooo(tsock, OOO_DROP_NEXT, run->start);
+		nr_pkt = ooo_drop_run(tsock, i);
+		WORKER_TSOCK_STATS_ADD(worker, tsock, ERR_TCP_RCV_OOO_DUP, nr_pkt);
 	}
 
 insert:
-	return ooo_queue_insert(tsock, prev, pkt);
+	return ooo_queue_insert(tsock, i, pkt);
 }
 
 static inline void tsock_set_ack_flag(struct tcp_sock *tsock, int ack_now_flag)
@@ -621,10 +982,62 @@ static inline void tsock_set_ack_flag(struct tcp_sock *tsock, int ack_now_flag)
 	tsock->flags |= TSOCK_FLAG_ACK_NEEDED | ack_now_flag;
 }
 
+/*
+ * Tracks the CE marks of the data segs, to be echoed back by ECE. It's
+ * invoked only when the seg is accepted (queued in order or out of order),
+ * so that a dropped seg does not change the CE state.
+ *
+ * For RFC 3168, ECE is latched until the sender tells us it has reacted,
+ * by CWR. For DCTCP, ECE has to match the CE state of the segs being
+ * acked. Therefore, on a CE state change, the pending (delayed) ACK of
+ * the segs before this one (up to @prior_rcv_nxt) is flushed with the
+ * old state first.
+ */
+static __rte_noinline void tcp_rcv_ecn(struct tpa_worker *worker, struct tcp_sock *tsock,
+				       int ce, int cwr, uint32_t prior_rcv_nxt)
+{
+	uint32_t ack_flags;
+	uint32_t rcv_nxt;
+
+	if (ce)
+		WORKER_TSOCK_STATS_INC(worker, tsock, ECN_CE_RCV);
+
+	if (tsock->cc->flags & TCP_CC_FLAG_ECN_ECHO_CE) {
+		if (ce != tsock->ce_state && tsock->last_ack_sent != prior_rcv_nxt &&
+		    tsock_flags_to_tcp_flags(tsock->flags) == TSOCK_FLAG_ACK_NEEDED) {
+			ack_flags = tsock->flags & (TSOCK_FLAG_ACK_NEEDED | TSOCK_FLAG_ACK_NOW);
+			rcv_nxt = tsock->rcv_nxt;
+
+			tsock->rcv_nxt = prior_rcv_nxt;
+			xmit_flag_packet(worker, tsock);
+			tsock->rcv_nxt = rcv_nxt;
+
+			/* the ACK of this seg is still to be sent */
+			tsock->flags |= ack_flags;
+		}
+
+		tsock->ece_pending = ce;
+	} else {
+		if (cwr)
+			tsock->ece_pending = 0;
+
+		if (ce) {
+			tsock->ece_pending = 1;
+			tsock->flags |= TSOCK_FLAG_ACK_NOW;
+		}
+	}
+
+	tsock->ce_state = ce;
+}
+
 static inline int tcp_rcv_data(struct tpa_worker *worker, struct tcp_sock *tsock,
 			       struct packet *pkt)
 {
+	uint32_t prior_rcv_nxt = tsock->rcv_nxt;
 	uint32_t to_cut;
+	int ecn = 0;
+	int ce = 0;
+	int cwr = 0;
 	int err;
 
 	if (unlikely(TCP_SEG(pkt)->len == 0)) {
@@ -634,6 +1047,13 @@ static inline int tcp_rcv_data(struct tpa_worker *worker, struct tcp_sock *tsock
 		return 0;
 	}
 
+	if (unlikely(tsock->ecn_ok && ((pkt->flags & PKT_FLAG_ECN_CE) ||
+				       tsock->ce_state || has_flag_cwr(pkt)))) {
+		ecn = 1;
+		ce = !!(pkt->flags & PKT_FLAG_ECN_CE);
+		cwr = has_flag_cwr(pkt);
+	}
+
 	if (seq_lt(TCP_SEG(pkt)->seq, tsock->rcv_nxt)) {
 		to_cut = tsock->rcv_nxt - TCP_SEG(pkt)->seq;
 		if (to_cut >= TCP_SEG(pkt)->len) {
@@ -643,6 +1063,7 @@ static inline int tcp_rcv_data(struct tpa_worker *worker, struct tcp_sock *tsock
 			return 0;
 		}
 
+		sack_update_dsack(worker, tsock, TCP_SEG(pkt)->seq, tsock->rcv_nxt);
 		tcp_packet_cut(pkt, to_cut, CUT_HEAD);
 	}
 
@@ -653,7 +1074,11 @@ static inline int tcp_rcv_data(struct tpa_worker *worker, struct tcp_sock *tsock
 			goto ooo_rcv;
 
 		tsock_set_ack_flag(tsock, 0);
-		return tcp_rcv_enqueue(worker, tsock, pkt);
+		err = tcp_rcv_enqueue(worker, tsock, pkt);
+		if (unlikely(ecn) && tsock->rcv_nxt != prior_rcv_nxt)
+			tcp_rcv_ecn(worker, tsock, ce, cwr, prior_rcv_nxt);
+
+		return err;
 	}
 
 ooo_rcv:
@@ -661,6 +1086,8 @@ ooo_rcv:
 	tsock_set_ack_flag(tsock, TSOCK_FLAG_ACK_NOW);
 
 	err = tcp_rcv_data_ooo(worker, tsock, pkt);
+	if (unlikely(ecn) && err == 0)
+		tcp_rcv_ecn(worker, tsock, ce, cwr, prior_rcv_nxt);
 
 	/*
 	 * always try to drain the ooo queue even if tcp_rcv_data_ooo
@@ -698,18 +1125,106 @@ static inline void rtt_update(struct tpa_worker *worker, struct tcp_sock *tsock,
 	tsock->rto = (tsock->srtt >> 3) + RTE_MAX(tcp_cfg.tcp_rto_min, tsock->rttvar);
 	tsock->rto = RTE_MIN(tsock->rto, TCP_RTO_MAX);
 
+	if (tsock->rack.min_rtt == 0 || tsock->rtt < tsock->rack.min_rtt)
+		tsock->rack.min_rtt = tsock->rtt;
+
 	trace_tcp_rtt(tsock, tsock->rtt, tsock->srtt, tsock->rttvar, tsock->rto);
 }
 
 static inline void tsock_write_latency_update(struct tcp_sock *tsock, struct tx_desc *desc, uint64_t now)
 {
-	vstats_add(&tsock->write_lat.submit, desc->tsc_submit - desc->tsc_start);
-	vstats_add(&tsock->write_lat.xmit,   desc->tsc_xmit   - desc->tsc_start);
-	vstats_add(&tsock->write_lat.complete, now - desc->tsc_start);
+	vstats_add(&tsock->stats->write_lat.submit, desc->tsc_submit - desc->tsc_start);
+	vstats_add(&tsock->stats->write_lat.xmit,   desc->tsc_xmit   - desc->tsc_start);
+	vstats_add(&tsock->stats->write_lat.complete, now - desc->tsc_start);
+}
+
+static inline void tcp_rate_sample_init(struct tcp_rate_sample *rs)
+{
+	rs->prior_ts = 0;
+	rs->interval_us = 0;
+	rs->acked_sacked = 0;
+	rs->rtt_us = 0;
+}
+
+/* invoked when a desc is acked or sacked the first time */
+static inline void tcp_rate_desc_delivered(struct tcp_sock *tsock, struct tx_desc *desc,
+					   struct tcp_rate_sample *rs, uint64_t now)
+{
+	if (desc->flags & TX_DESC_FLAG_DELIVERED)
+		return;
+
+	desc->flags |= TX_DESC_FLAG_DELIVERED;
+	tsock->delivered += desc->len;
+	tsock->delivered_ts = now;
+	rs->acked_sacked += desc->len;
+
+	/* sample with the most recently sent desc */
+	if (rs->prior_ts == 0 || desc->delivered > rs->prior_delivered) {
+		rs->prior_delivered = desc->delivered;
+		rs->prior_ts = desc->delivered_ts;
+		rs->send_elapsed = desc->ts_us - desc->first_tx_ts;
+		rs->is_app_limited = !!(desc->flags & TX_DESC_FLAG_APP_LIMITED);
+		rs->is_retrans = !!(desc->flags & TX_DESC_FLAG_RETRANS);
+
+		tsock->first_tx_ts = desc->ts_us;
+	}
+}
+
+/* RFC 8985 6.1: invoked when a desc is acked or sacked the first time */
+static inline void tcp_rack_advance(struct tcp_sock *tsock, struct tx_desc *desc, uint64_t now)
+{
+	uint32_t end = desc->seq + desc->len;
+	uint32_t rtt = now - desc->ts_us;
+
+	if (tsock->rack.xmit_ts == 0 || seq_gt(end, tsock->rack.fack))
+		tsock->rack.fack = end;
+	else if (!(desc->flags & TX_DESC_FLAG_RETRANS))
+		tsock->rack.reordering_seen = 1;
+
+	/* it's likely the ACK of the original transmit, not the retrans */
+	if ((desc->flags & TX_DESC_FLAG_RETRANS) && rtt < tsock->rack.min_rtt)
+		return;
+
+	if (rack_sent_after(desc->ts_us, end, tsock->rack.xmit_ts, tsock->rack.end_seq)) {
+		tsock->rack.xmit_ts = desc->ts_us;
+		tsock->rack.end_seq = end;
+		tsock->rack.rtt = rtt;
+	}
+}
+
+static inline void tcp_rate_gen(struct tcp_sock *tsock, struct tcp_rate_sample *rs, uint64_t now)
+{
+	uint64_t ack_elapsed;
+	uint64_t rate;
+
+	if (unlikely(tsock->app_limited) && tsock->delivered > tsock->app_limited)
+		tsock->app_limited = 0;
+
+	if (rs->prior_ts == 0)
+		return;
+
+	/*
+	 * Take the longer one of the send and ack phases, so that neither
+	 * the sender burst nor the ack compression inflates the rate.
+	 */
+	ack_elapsed = now - rs->prior_ts;
+	rs->interval_us = RTE_MAX(rs->send_elapsed, ack_elapsed);
+	rs->delivered = tsock->delivered - rs->prior_delivered;
+
+	if (rs->interval_us == 0 || rs->delivered == 0) {
+		rs->interval_us = 0;
+		return;
+	}
+
+	/* an app limited sample tells the lower bound only */
+	rate = (uint64_t)rs->delivered * 1000000 / rs->interval_us;
+	if (!rs->is_app_limited || rate >= tsock->delivery_rate)
+		tsock->delivery_rate = rate;
 }
 
 static inline int ack_sent_data(struct tpa_worker *worker, struct tcp_sock *tsock,
-				struct packet *ack_pkt, uint32_t acked_len, uint32_t *rtt)
+				struct packet *ack_pkt, uint32_t acked_len, uint32_t *rtt,
+				struct tcp_rate_sample *rs)
 {
 	struct tcp_txq *txq = &tsock->txq;
 	struct tx_desc *desc;
@@ -743,11 +1258,17 @@ static inline int ack_sent_data(struct tpa_worker *worker, struct tcp_sock *tsoc
 
 		if (unlikely(desc->flags & TX_DESC_FLAG_SACKED))
 			tsock->sacked_bytes -= desc->len;
+		if (unlikely(desc->flags & TX_DESC_FLAG_LOST))
+			tsock->lost_bytes -= desc->len;
 
 		/* rtt for retransmit pkts is excluded */
 		if (*rtt == 0 && (desc->flags & TX_DESC_FLAG_RETRANS) == 0)
 			*rtt = worker->ts_us - desc->ts_us;
 
+		if (!(desc->flags & TX_DESC_FLAG_DELIVERED))
+			tcp_rack_advance(tsock, desc, worker->ts_us);
+		tcp_rate_desc_delivered(tsock, desc, rs, worker->ts_us);
+
 		if (unlikely(desc->flags & TX_DESC_FLAG_MEASURE_LATENCY)) {
 			if (!now)
 				now = rte_rdtsc();
@@ -758,6 +1279,9 @@ static inline int ack_sent_data(struct tpa_worker *worker, struct tcp_sock *tsoc
 		tx_desc_done(desc, worker);
 	} while (acked_len > 0);
 
+	if (unlikely(tsock->sack_sb.nr))
+		sack_scoreboard_cut(&tsock->sack_sb, tsock->snd_una);
+
 	/*
 	 * Before we have done the retransmit of all packets between UNA
 	 * and NXT, we might get an ACK that acks all data at (or after,
@@ -785,8 +1309,6 @@ static inline void set_cwnd(struct tcp_sock *tsock, uint32_t cwnd)
 
 static inline void update_cwnd(struct tpa_worker *worker, struct tcp_sock *tsock, uint32_t acked)
 {
-	uint32_t add_up;
-
 	tsock->snd_cwnd_uncommited += acked;
 
 	/* update snd_cwnd only at rtt interval */
@@ -797,22 +1319,52 @@ static inline void update_cwnd(struct tpa_worker *worker, struct tcp_sock *tsock
 	if (tsock->snd_cwnd_uncommited < tsock->snd_cwnd)
 		goto out;
 
-	if (tsock->snd_cwnd < tsock->snd_ssthresh) {
-		/* TODO: add option to disable abc */
-		tsock->snd_cwnd += tsock->snd_cwnd_uncommited;
-	} else {
-		/* basically increase cwnd by one mss each rtt */
-		add_up = tsock->snd_cwnd_uncommited * tsock->snd_mss / tsock->snd_cwnd;
-		tsock->snd_cwnd += RTE_MAX(1, add_up);
-	}
-
-	set_cwnd(tsock, tsock->snd_cwnd);
+	set_cwnd(tsock, tsock->cc->on_ack(tsock, tsock->snd_cwnd_uncommited, worker->ts_us));
 
 out:
 	tsock->snd_cwnd_ts_us = worker->ts_us;
 	tsock->snd_cwnd_uncommited = 0;
 }
 
+/* for the cc driving the cwnd by the delivery rate samples */
+static inline void tcp_cong_control(struct tpa_worker *worker, struct tcp_sock *tsock,
+				    struct tcp_rate_sample *rs)
+{
+	/* leave the fast recovery to the core */
+	if (rs->acked_sacked == 0 || tsock->retrans_stage == FAST_RETRANS)
+		return;
+
+	set_cwnd(tsock, tsock->cc->cong_control(tsock, rs, worker->ts_us));
+}
+
+static inline void cc_in_ack(struct tpa_worker *worker, struct tcp_sock *tsock,
+			     struct packet *pkt, uint32_t acked)
+{
+	if (tsock->cc->in_ack)
+		tsock->cc->in_ack(tsock, acked, tsock->ecn_ok && has_flag_ece(pkt), worker->ts_us);
+}
+
+/* RFC 3168 6.1.2: reduce cwnd at most once per window, and not during loss recovery */
+static __rte_noinline void tcp_rcv_ece(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	uint32_t ssthresh;
+
+	if (tsock->retrans_stage != NONE || seq_le(tsock->snd_una, tsock->snd_cwr_seq))
+		return;
+
+	if (tsock->cc->on_ecn)
+		ssthresh = tsock->cc->on_ecn(tsock, worker->ts_us);
+	else
+		ssthresh = tsock->cc->on_loss(tsock, worker->ts_us);
+
+	tsock->snd_ssthresh = ssthresh;
+	set_cwnd(tsock, ssthresh);
+
+	tsock->snd_cwr_seq = tsock->snd_nxt;
+	tsock->cwr_pending = 1;
+	WORKER_TSOCK_STATS_INC(worker, tsock, ECN_CWND_REDUCE);
+}
+
 static void leave_fast_retrans(struct tcp_sock *tsock, uint32_t cwnd, int trace_type)
 {
 	set_cwnd(tsock, cwnd);
@@ -820,45 +1372,72 @@ static void leave_fast_retrans(struct tcp_sock *tsock, uint32_t cwnd, int trace_
 
 	tsock->retrans_stage = NONE;
 	tsock->nr_dupack = 0;
+	tsock->rack.recovery = 0;
+}
+
+/* the bytes have left the network since the recovery starts */
+static inline uint32_t fast_retrans_inflation(struct tcp_sock *tsock)
+{
+	uint32_t bytes;
+
+	if (tsock->sack_ok)
+		bytes = tsock->sacked_bytes;
+	else
+		bytes = tsock->nr_dupack * tsock->snd_mss;
+
+	return RTE_MIN(bytes, tsock->snd_cwnd_orig);
+}
+
+/*
+ * The recovery is driven by RACK when there are descs marked lost;
+ * otherwise, it's the dupack counting (say, when SACK is not enabled),
+ * where the retrans goes sequentially from snd_una.
+ */
+void tcp_enter_fast_retrans(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	tsock->snd_ssthresh = tsock->cc->on_loss(tsock, worker->ts_us);
+	tsock->snd_recover = tsock->snd_nxt;
+	tsock->snd_cwnd_orig = tsock->snd_cwnd;
+	set_cwnd(tsock, tsock->snd_cwnd + fast_retrans_inflation(tsock));
+	tsock->retrans_stage = FAST_RETRANS;
+	tsock->rack.recovery = tsock->lost_bytes > 0;
+	timer_stop(&tsock->timer_tlp);
+
+	tsock_trace_fast_retrans(tsock, FAST_RETRANS_ENTERING);
+	if (!tsock->rack.recovery)
+		tcp_reset_retrans(tsock, tsock->snd_una, tsock->txq.una);
+	tcp_fast_retrans(worker, tsock, tsock->snd_mss);
+
+	if (tsock->ts_ok)
+		tsock->retrans.ts_val = us_to_tcp_ts(worker->ts_us);
 }
 
 static inline void handle_fast_retransmit(struct tpa_worker *worker, struct tcp_sock *tsock,
 					  struct packet *pkt, uint32_t acked)
 {
 	int retrans_budget = tsock->snd_mss;
-	uint32_t sacked_bytes;
 	uint32_t cwnd;
 
-	if (likely(tsock->nr_dupack < 3 && tsock->retrans_stage != FAST_RETRANS))
+	/* the dupack counting is a fallback when RACK has nothing to tell */
+	if (likely(tsock->retrans_stage != FAST_RETRANS && tsock->lost_bytes == 0 &&
+		   (tsock->nr_dupack < 3 || tsock->sacked_bytes)))
 		return;
 
 	if (tsock->retrans_stage == NONE && seq_gt(TCP_SEG(pkt)->ack, tsock->snd_recover)) {
-		tsock->snd_ssthresh = RTE_MAX(tsock->snd_cwnd / 2, (uint32_t)(2 * tsock->snd_mss));
-		tsock->snd_recover = tsock->snd_nxt;
-		tsock->snd_cwnd_orig = tsock->snd_cwnd;
-		set_cwnd(tsock, tsock->snd_cwnd + tsock->nr_dupack * tsock->snd_mss);
-		tsock->retrans_stage = FAST_RETRANS;
-
-		tsock_trace_fast_retrans(tsock, FAST_RETRANS_ENTERING);
-		tcp_reset_retrans(tsock, tsock->snd_una, tsock->txq.una);
-		tcp_fast_retrans(worker, tsock, tsock->snd_mss);
-		if (tsock->ts_ok)
-			tsock->retrans.ts_val = us_to_tcp_ts(worker->ts_us);
+		tcp_enter_fast_retrans(worker, tsock);
+		return;
 	}
 
 	if (tsock->retrans_stage != FAST_RETRANS)
 		return;
 
 	if (acked == 0) {
-		if (tsock->sack_ok)
-			sacked_bytes = tsock->sacked_bytes;
-		else
-			sacked_bytes = tsock->nr_dupack * tsock->snd_mss;
-		sacked_bytes = RTE_MIN(sacked_bytes, tsock->snd_cwnd_orig);
-
 		/* cwnd inflation */
-		cwnd = tsock->snd_cwnd_orig + sacked_bytes;
+		cwnd = tsock->snd_cwnd_orig + fast_retrans_inflation(tsock);
 		set_cwnd(tsock, cwnd);
+
+		if (tsock->rack.recovery && tsock->lost_bytes)
+			tcp_fast_retrans(worker, tsock, 0);
 		return;
 	}
 
@@ -875,13 +1454,62 @@ static inline void handle_fast_retransmit(struct tpa_worker *worker, struct tcp_
 		cwnd = tsock->snd_cwnd - acked;
 		set_cwnd(tsock, RTE_MAX(tsock->snd_cwnd_orig, cwnd));
 
-		if (tsock->sack_ok)
+		if (tsock->rack.recovery)
+			retrans_budget = 0;
+		else if (tsock->sack_ok)
 			retrans_budget = RTE_MIN(tsock->sacked_bytes, tsock->snd_ssthresh);
 		tcp_fast_retrans(worker, tsock, retrans_budget);
 		timer_start(&tsock->timer_rto, worker->ts_us, tsock->rto);
 	} else {
-		leave_fast_retrans(tsock, tsock->snd_ssthresh, FAST_RETRANS_LEAVING);
+		leave_fast_retrans(tsock, tsock->cc->on_recovery_exit(tsock, worker->ts_us),
+				   FAST_RETRANS_LEAVING);
+	}
+}
+
+/*
+ * RFC 2883: the first block is a D-SACK if it's below the cumulative
+ * ack, or if it's covered by the second block.
+ */
+static inline int sack_has_dsack(struct tcp_opts *opts, uint32_t ack)
+{
+	struct tcp_sack_block *blk = &opts->sack_blocks[0];
+
+	if (opts->nr_sack == 0)
+		return 0;
+
+	if (seq_le(blk->end, ack))
+		return 1;
+
+	return opts->nr_sack > 1 && seq_ge(blk->start, opts->sack_blocks[1].start) &&
+	       seq_le(blk->end, opts->sack_blocks[1].end);
+}
+
+/*
+ * The probe has been delivered. If it's a retrans, it might have
+ * repaired a tail loss, which deserves a cwnd reduction as well; unless
+ * it's D-SACKed, which means the original one has been delivered too.
+ *
+ * XXX: the D-SACK could come with a later ACK, which is not awaited.
+ */
+static __rte_noinline void tcp_rcv_tlp_ack(struct tpa_worker *worker, struct tcp_sock *tsock,
+					   struct packet *pkt, struct tcp_opts *opts, int acked)
+{
+	if (seq_lt(TCP_SEG(pkt)->ack, tsock->rack.tlp_high_seq))
+		return;
+
+	tsock->rack.tlp_pending = 0;
+	if (!tsock->rack.tlp_is_retrans || acked <= 0 || tsock->retrans_stage != NONE)
+		return;
+
+	if (sack_has_dsack(opts, TCP_SEG(pkt)->ack) &&
+	    opts->sack_blocks[0].end == tsock->rack.tlp_high_seq) {
+		WORKER_TSOCK_STATS_INC(worker, tsock, TLP_SPURIOUS);
+		return;
 	}
+
+	tsock->snd_ssthresh = tsock->cc->on_loss(tsock, worker->ts_us);
+	set_cwnd(tsock, tsock->snd_ssthresh);
+	WORKER_TSOCK_STATS_INC(worker, tsock, TLP_RECOVERY);
 }
 
 static int sack_block_cmp(const void *__a, const void *__b)
@@ -910,33 +1538,96 @@ static int sort_sack(int nr_sack, struct tcp_sack_block *blocks)
 }
 
 static void mark_desc_sacked(struct tpa_worker *worker, struct tcp_sock *tsock,
-			     struct tx_desc *desc)
+			     struct tx_desc *desc, struct tcp_rate_sample *rs)
 {
 	if (desc->flags & TX_DESC_FLAG_SACKED)
 		return;
 
+	if (desc->flags & TX_DESC_FLAG_LOST) {
+		desc->flags &= ~TX_DESC_FLAG_LOST;
+		tsock->lost_bytes -= desc->len;
+	}
+
 	tsock->sacked_bytes += desc->len;
 	desc->flags |= TX_DESC_FLAG_SACKED;
+	if (!(desc->flags & TX_DESC_FLAG_DELIVERED))
+		tcp_rack_advance(tsock, desc, worker->ts_us);
+	tcp_rate_desc_delivered(tsock, desc, rs, worker->ts_us);
 	trace_tcp_desc_sacked(tsock, desc->seq, desc->len,
 			      worker->ts_us - desc->ts_us, desc->flags);
 }
 
+/*
+ * Marks the descs within @range, a range newly sacked. As a desc is
+ * marked only if it's sacked in whole, it's checked against the block
+ * @range is merged into.
+ */
+static void mark_range_sacked(struct tpa_worker *worker, struct tcp_sock *tsock,
+			      struct tcp_sack_block *range, struct tcp_sack_block *merged,
+			      struct tcp_rate_sample *rs)
+{
+	struct tcp_txq *txq = &tsock->txq;
+	struct tx_desc *desc;
+	uint16_t desc_off;
+
+	desc_off = tcp_txq_search(txq, txq->una, range->start);
+	while (1) {
+		desc = tcp_txq_peek_for_write(txq, txq->una, desc_off++);
+		if (!desc)
+			break;
+
+		if (seq_ge(desc->seq, range->end))
+			break;
+
+		/* not sent in whole yet */
+		if (seq_gt(desc->seq + desc->len, tsock->snd_nxt))
+			break;
+
+		if (seq_ge(desc->seq, merged->start) && seq_le(desc->seq + desc->len, merged->end))
+			mark_desc_sacked(worker, tsock, desc, rs);
+	}
+}
+
+/*
+ * With the scoreboard, only the ranges newly sacked are looked up in
+ * the txq, by binary search. Therefore, the cost is O(log n) plus the
+ * descs newly sacked, instead of all the descs in flight per ACK.
+ */
 static __rte_noinline void tcp_rcv_sack(struct tpa_worker *worker,
 					struct tcp_sock *tsock,
-					struct tcp_opts *opts)
+					struct tcp_opts *opts,
+					struct tcp_rate_sample *rs,
+					uint32_t ack)
 {
-	struct tcp_txq *txq = &tsock->txq;
-	int nr_sack = opts->nr_sack;
+	struct tcp_sack_block news[SACK_SCOREBOARD_SIZE + 1];
 	struct tcp_sack_block blocks[TCP_MAX_NR_SACK_BLOCK];
+	struct tcp_sack_block merged;
 	struct tcp_sack_block *blk;
-	struct tx_desc *desc;
-	uint16_t desc_off = 0;
+	int nr_sack = opts->nr_sack;
+	uint32_t start;
+	int nr_new;
 	int ret;
 	int i;
+	int j;
 
 	memcpy(blocks, opts->sack_blocks, nr_sack * sizeof(struct tcp_sack_block));
 	tsock_trace_sack(tsock, SACK_RCV, blocks, nr_sack);
 
+	if (sack_has_dsack(opts, ack)) {
+		/*
+		 * Something is received twice: either we retransmitted it
+		 * spuriously, or the network duplicated it. Either way, it's
+		 * no loss; don't be that eager to mark losses since then.
+		 */
+		WORKER_TSOCK_STATS_INC(worker, tsock, DSACK_RCV);
+		tsock->rack.reordering_seen = 1;
+
+		nr_sack -= 1;
+		memmove(&blocks[0], &blocks[1], nr_sack * sizeof(struct tcp_sack_block));
+		if (nr_sack == 0)
+			return;
+	}
+
 	ret = sort_sack(nr_sack, blocks);
 	if (ret < 0) {
 		WORKER_TSOCK_STATS_INC(worker, tsock, -ret);
@@ -950,20 +1641,13 @@ static __rte_noinline void tcp_rcv_sack(struct tpa_worker *worker,
 		if (seq_gt(blk->end, tsock->snd_nxt))
 			continue;
 
-		while (1) {
-			desc = tcp_txq_peek_for_write(txq, txq->una, desc_off++);
-			if (!desc)
-				break;
-
-			if (seq_ge(desc->seq + desc->len, tsock->snd_nxt))
-				break;
-
-			if (seq_ge(desc->seq + desc->len, blk->end))
-				break;
+		if (seq_le(blk->end, tsock->snd_una))
+			continue;
 
-			if (seq_ge(desc->seq, blk->start))
-				mark_desc_sacked(worker, tsock, desc);
-		}
+		start = seq_lt(blk->start, tsock->snd_una) ? tsock->snd_una : blk->start;
+		nr_new = sack_scoreboard_add(&tsock->sack_sb, start, blk->end, news, &merged);
+		for (j = 0; j < nr_new; j++)
+			mark_range_sacked(worker, tsock, &news[j], &merged, rs);
 	}
 }
 
@@ -971,6 +1655,7 @@ static inline void tsock_established(struct tpa_worker *worker, struct tcp_sock
 static inline int tcp_rcv_ack(struct tpa_worker *worker, struct tcp_sock *tsock,
 			      struct packet *pkt, struct tcp_opts *opts)
 {
+	struct tcp_rate_sample rs;
 	int acked_len;
 	int err;
 
@@ -1019,6 +1704,7 @@ static inline int tcp_rcv_ack(struct tpa_worker *worker, struct tcp_sock *tsock,
 
 		debug_assert(seq_ge(TCP_SEG(pkt)->ack, tsock->snd_una));
 		acked_len = TCP_SEG(pkt)->ack - tsock->snd_una;
+		tcp_rate_sample_init(&rs);
 
 		/* don't count on SYN */
 		if (unlikely(tsock->closed_at_syn_rcvd))
@@ -1045,26 +1731,42 @@ static inline int tcp_rcv_ack(struct tpa_worker *worker, struct tcp_sock *tsock,
 			}
 		}
 
+		if (unlikely(tsock->rack.tlp_pending))
+			tcp_rcv_tlp_ack(worker, tsock, pkt, opts, acked_len);
+
 		if (acked_len > 0) {
 			uint32_t rtt;
 
-			err = ack_sent_data(worker, tsock, pkt, acked_len, &rtt);
+			err = ack_sent_data(worker, tsock, pkt, acked_len, &rtt, &rs);
 			if (err)
 				return err;
 
 			if (rtt)
 				rtt_update(worker, tsock, rtt);
+			rs.rtt_us = rtt;
 
 			/* per RFC 6298 page 5, reset back off and timer once new data is acked */
 			tsock->zero_wnd_probe_shift = 0;
 			tsock->rto_shift = 0;
 			tsock_rearm_timer_rto(tsock, worker->ts_us);
+			tsock_schedule_tlp(tsock, worker->ts_us);
 
-			update_cwnd(worker, tsock, acked_len);
+			cc_in_ack(worker, tsock, pkt, acked_len);
+			if (!tsock->cc->cong_control)
+				update_cwnd(worker, tsock, acked_len);
 		}
 
+		if (unlikely(tsock->ecn_ok && has_flag_ece(pkt)))
+			tcp_rcv_ece(worker, tsock);
+
 		if (opts->nr_sack)
-			tcp_rcv_sack(worker, tsock, opts);
+			tcp_rcv_sack(worker, tsock, opts, &rs, TCP_SEG(pkt)->ack);
+		if (tsock->sacked_bytes)
+			tcp_rack_detect_loss(worker, tsock);
+
+		tcp_rate_gen(tsock, &rs, worker->ts_us);
+		if (tsock->cc->cong_control)
+			tcp_cong_control(worker, tsock, &rs);
 
 		handle_fast_retransmit(worker, tsock, pkt, acked_len);
 
@@ -1086,8 +1788,12 @@ static inline int tcp_rcv_ack(struct tpa_worker *worker, struct tcp_sock *tsock,
 			}
 		}
 
-		if (tsock->snd_una == tsock->snd_nxt)
+		if (tsock->snd_una == tsock->snd_nxt) {
 			timer_stop(&tsock->timer_rto);
+			timer_stop(&tsock->timer_tlp);
+			timer_stop(&tsock->timer_rack);
+			sack_scoreboard_reset(&tsock->sack_sb);
+		}
 
 		if (seq_lt(tsock->snd_wl1, TCP_SEG(pkt)->seq) ||
 		    (TCP_SEG(pkt)->seq == tsock->snd_wl1 &&
@@ -1114,21 +1820,32 @@ static inline void tcp_rcv_ack_fastpath(struct tpa_worker *worker,
 
 	acked_len = TCP_SEG(pkt)->ack - tsock->snd_una;
 	if (acked_len > 0) {
+		struct tcp_rate_sample rs;
 		uint32_t rtt;
 
-		ack_sent_data(worker, tsock, pkt, acked_len, &rtt);
+		tcp_rate_sample_init(&rs);
+		ack_sent_data(worker, tsock, pkt, acked_len, &rtt, &rs);
 		if (rtt)
 			rtt_update(worker, tsock, rtt);
+		rs.rtt_us = rtt;
 
 		tsock->snd_recover = tsock->snd_una - 1;
 		tsock->nr_dupack = 0;
 
-		if (tsock->snd_una == tsock->snd_nxt)
+		if (tsock->snd_una == tsock->snd_nxt) {
 			timer_stop(&tsock->timer_rto);
-		else
+			timer_stop(&tsock->timer_tlp);
+		} else {
 			tsock_rearm_timer_rto(tsock, worker->ts_us);
+			tsock_schedule_tlp(tsock, worker->ts_us);
+		}
 
-		update_cwnd(worker, tsock, acked_len);
+		cc_in_ack(worker, tsock, pkt, acked_len);
+		tcp_rate_gen(tsock, &rs, worker->ts_us);
+		if (tsock->cc->cong_control)
+			tcp_cong_control(worker, tsock, &rs);
+		else
+			update_cwnd(worker, tsock, acked_len);
 	}
 
 	/* the conditions to update snd_wl1/2 must have been met here */
@@ -1149,6 +1866,7 @@ static inline void update_ts_recent(struct tpa_worker *worker, struct tcp_sock *
 static inline int tcp_rcv_fastpath(struct tpa_worker *worker,
 				   struct tcp_sock *tsock, struct packet *pkt)
 {
+	uint32_t rcv_nxt = tsock->rcv_nxt;
 	int err;
 
 	/* disable fastpath when seq, ack and flags are not expected */
@@ -1158,6 +1876,7 @@ static inline int tcp_rcv_fastpath(struct tpa_worker *worker,
 		     (TCP_SEG(pkt)->flags & ~TCP_FLAG_PSH) != TCP_FLAG_ACK ||
 		     (TCP_SEG(pkt)->len == 0 && TCP_SEG(pkt)->ack == tsock->snd_una) ||
 		     tsock->retrans_stage != NONE ||
+		     tsock->sacked_bytes || tsock->rack.tlp_pending ||
 		     tsock->rcv_wnd == 0))
 		return 0;
 
@@ -1180,7 +1899,8 @@ static inline int tcp_rcv_fastpath(struct tpa_worker *worker,
 			 tsock->ts_recent, tsock->last_ack_sent);
 	tcp_rcv_ack_fastpath(worker, tsock, pkt);
 
-	WORKER_TSOCK_STATS_ADD(worker, tsock, BYTE_RECV_FASTPATH, TCP_SEG(pkt)->len);
+	/* not TCP_SEG(pkt)->len: it's 0 once the pkt is coalesced by copy */
+	WORKER_TSOCK_STATS_ADD(worker, tsock, BYTE_RECV_FASTPATH, tsock->rcv_nxt - rcv_nxt);
 
 	return 1;
 }
@@ -1195,7 +1915,14 @@ static int validate_seq(struct tpa_worker *worker, struct tcp_sock *tsock,
 	if (TCP_SEG(pkt)->len == 0 && seq == tsock->rcv_nxt)
 		return 0;
 
-	if (seq_le(end, tsock->rcv_nxt) || seq_ge(seq, tsock->rcv_nxt + tsock->rcv_wnd))
+	if (seq_le(end, tsock->rcv_nxt)) {
+		/* a retrans of what we have got already */
+		if (TCP_SEG(pkt)->len)
+			sack_update_dsack(worker, tsock, seq, end);
+		return -ERR_TCP_INVALID_SEQ;
+	}
+
+	if (seq_ge(seq, tsock->rcv_nxt + tsock->rcv_wnd))
 		return -ERR_TCP_INVALID_SEQ;
 
 	return 0;
@@ -1237,6 +1964,7 @@ static inline void process_tcp_opt_negotiation(struct tpa_worker *worker, struct
 					       struct packet *pkt)
 {
 	struct tcp_opts opts;
+	uint8_t ecn_flags;
 	int has_ts;
 	int ret;
 
@@ -1264,6 +1992,13 @@ static inline void process_tcp_opt_negotiation(struct tpa_worker *worker, struct
 	}
 
 	tsock->sack_ok = tsock->sack_enabled && opts.has_sack_perm;
+
+	/* RFC 3168 6.1.1 */
+	ecn_flags = TCP_SEG(pkt)->flags & (TCP_FLAG_ECE | TCP_FLAG_CWR);
+	if (tsock->state == TCP_STATE_SYN_SENT)
+		tsock->ecn_ok = tsock_ecn_wanted(tsock) && ecn_flags == TCP_FLAG_ECE;
+	else
+		tsock->ecn_ok = tsock_ecn_wanted(tsock) && ecn_flags == (TCP_FLAG_ECE | TCP_FLAG_CWR);
 }
 
 static inline void tsock_established(struct tpa_worker *worker,
@@ -1284,10 +2019,14 @@ static inline void tsock_established(struct tpa_worker *worker,
 	tsock->snd_cwnd = tcp_cfg.cwnd_init;
 	tsock->snd_cwnd_uncommited = 0;
 	tsock->snd_cwnd_ts_us = worker->ts_us;
+	tsock->snd_cwr_seq = tsock->snd_una;
 	tsock->snd_ssthresh = RTE_MIN((uint32_t)(1<<20), tsock->snd_wnd * 64);
-
 	rtt_update(worker, tsock, worker->ts_us - tsock->init_ts_us);
 
+	/* after the handshake rtt sample: the cc (say, BBR) may seed from it */
+	if (tsock->cc->init)
+		tsock->cc->init(tsock, worker->ts_us);
+
 	tsock->rto_shift = 0;
 	timer_stop(&tsock->timer_rto);
 	tsock_rearm_timer_keepalive(tsock, worker->ts_us);
@@ -1385,6 +2124,7 @@ static inline void passive_tsock_init(struct tpa_worker *worker,
 	sock_key_init(&key, &tsock->remote_ip, ntohs(tsock->remote_port),
 		      &tsock->local_ip, ntohs(tsock->local_port));
 	sock_table_add(&worker->sock_table, &key, tsock);
+	steer_index_add(&key, tsock);
 	tsock_offload_create(tsock);
 
 	/* refresh worker ts_us */
@@ -1417,6 +2157,8 @@ static inline int tsock_accept(struct tpa_worker *worker, struct tcp_sock *liste
 	if (!tsock)
 		return -ERR_TOO_MANY_SOCKS;
 
+	/* before the init, as the ECN negotiation depends on it */
+	tsock->cc = listen_tsock->cc;
 	passive_tsock_init(worker, tsock, pkt, listen_tsock->opts.data);
 
 	return xmit_syn(worker, tsock);
@@ -1664,7 +2406,8 @@ static inline void tcp_rcv_process(struct tpa_worker *worker, struct tcp_sock *t
 {
 	int err;
 
-	vstats_add(&tsock->rx_merge_size, pkt->nr_read_seg);
+	hist_add(&tsock->stats->rx_merge_size, pkt->nr_read_seg);
+	hist_add(&worker->rx_merge_size, pkt->nr_read_seg);
 	/* here we do count only when merge happened; therefore > 1 here */
 	if (pkt->nr_read_seg > 1)
 		WORKER_TSOCK_STATS_ADD(worker, tsock, PKT_RECV_MERGE, pkt->nr_read_seg);
@@ -1695,6 +2438,7 @@ static inline int tcp_can_merge(struct packet *head, struct packet *pkt)
 	return tcp_cfg.enable_rx_merge && has_ts_opt_only(pkt) &&
 	       TCP_SEG(head)->len > 0 && TCP_SEG(pkt)->len > 0 &&
 	       (TCP_SEG(pkt)->flags & ~TCP_FLAG_PSH) == TCP_FLAG_ACK &&
+	       ((head->flags ^ pkt->flags) & PKT_FLAG_ECN_CE) == 0 &&
 	       TCP_SEG(head)->ack == TCP_SEG(pkt)->ack &&
 	       (TCP_SEG(head)->seq + TCP_SEG(head)->len == TCP_SEG(pkt)->seq) &&
 	       TCP_SEG(head)->ts_raw == TCP_SEG(pkt)->ts_raw &&
@@ -1713,6 +2457,9 @@ static inline void tcp_merge(struct tpa_worker *worker, struct tcp_sock *tsock,
 
 			/* we have recv-ed few pkts, return ACK timely */
 			tsock_set_ack_flag(tsock, TSOCK_FLAG_ACK_NOW);
+
+			if (unlikely(head->nr_read_seg >= tcp_cfg.pkt_max_chain))
+				tcp_rcv_process(worker, tsock, head);
 			return;
 		}
 
@@ -1722,18 +2469,176 @@ static inline void tcp_merge(struct tpa_worker *worker, struct tcp_sock *tsock,
 	tsock->rx_merge_head = pkt;
 }
 
+/*
+ * GRO: the merge head is held across rx bursts, so that a flow spanning
+ * bursts (or interleaving with others) still gets merged. It's flushed
+ * on the gro_timeout deadline, or when it's read; and it's not held at
+ * all if the peer asks for a push, or if it's chained to the max.
+ */
+static inline int tcp_gro_hold(struct tpa_worker *worker, struct tcp_sock *tsock,
+			       struct packet *head)
+{
+	if (tcp_cfg.gro_timeout == 0 || !tcp_cfg.enable_rx_merge)
+		return 0;
+
+	if (tsock->state != TCP_STATE_ESTABLISHED || (tsock->flags & TSOCK_FLAG_PUT))
+		return 0;
+
+	if (TCP_SEG(head)->seq != tsock->rcv_nxt || TCP_SEG(head)->len == 0 ||
+	    !has_ts_opt_only(head) || TCP_SEG(head)->flags != TCP_FLAG_ACK ||
+	    TCP_SEG(head->tail)->flags != TCP_FLAG_ACK ||
+	    head->nr_read_seg >= tcp_cfg.pkt_max_chain)
+		return 0;
+
+	/*
+	 * The node might be left there by a head flushed before; the new
+	 * head then inherits its deadline, which is earlier. That's fine.
+	 */
+	if (!node_in_fifo(&tsock->gro_node)) {
+		tsock->gro_ts = worker->ts_us;
+		flex_fifo_push(worker->gro, &tsock->gro_node);
+	}
+
+	return 1;
+}
+
+static inline void tcp_input_tsock_done(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	if (tsock->flags & TSOCK_FLAG_ACK_NEEDED) {
+		if (tsock->flags & TSOCK_FLAG_ACK_NOW) {
+			xmit_flag_packet(worker, tsock);
+		} else {
+			flex_fifo_push_if_not_exist(worker->delayed_ack,
+						    &tsock->delayed_ack_node);
+		}
+	}
+
+	if (unlikely(tsock->flags & TSOCK_FLAG_PUT)) {
+		tsock->flags &= ~TSOCK_FLAG_PUT;
+		tsock_free(tsock);
+	}
+}
+
+static void tcp_gro_flush_one(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	tcp_rcv_process(worker, tsock, tsock->rx_merge_head);
+	tcp_input_tsock_done(worker, tsock);
+}
+
+/*
+ * The held head is flushed at read, while the ACK is left to the worker
+ * output path, as the wnd update at read is: nothing is sent from here.
+ */
+static void tcp_gro_flush_on_read(struct tcp_sock *tsock)
+{
+	struct tpa_worker *worker = tsock->worker;
+
+	tcp_rcv_process(worker, tsock, tsock->rx_merge_head);
+
+	/* a held head is in-order data with ACK only; it never closes the sock */
+	debug_assert(!(tsock->flags & TSOCK_FLAG_PUT));
+
+	if (tsock->flags & TSOCK_FLAG_ACK_NEEDED) {
+		if (tsock->flags & TSOCK_FLAG_ACK_NOW) {
+			output_tsock_enqueue(worker, tsock);
+		} else {
+			flex_fifo_push_if_not_exist(worker->delayed_ack,
+						    &tsock->delayed_ack_node);
+		}
+	}
+}
+
+/* flushes the merge heads held by GRO past the deadline */
+int tcp_gro_flush(struct tpa_worker *worker)
+{
+	struct tcp_sock *tsock;
+	int nr_tsock = 0;
+
+	while (1) {
+		tsock = FLEX_FIFO_PEEK_ENTRY(worker->gro, struct tcp_sock, gro_node);
+		if (!tsock)
+			break;
+
+		if ((uint32_t)worker->ts_us - tsock->gro_ts < tcp_cfg.gro_timeout)
+			break;
+
+		flex_fifo_pop(worker->gro);
+		if (tsock->rx_merge_head) {
+			tcp_gro_flush_one(worker, tsock);
+			nr_tsock += 1;
+		}
+	}
+
+	return nr_tsock;
+}
+
+/*
+ * The pkts without flow mark that miss the local sock table: they are
+ * forwarded to the owner worker if there is one; otherwise, they may
+ * go to a listen sock.
+ */
+static __rte_noinline uint32_t tcp_input_steer(struct tpa_worker *worker,
+					       struct packet **miss_pkts, uint32_t nr_miss,
+					       struct packet **pkts, uint32_t nr_found)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t i;
+	int err;
+
+	nr_miss = steer_pkts(worker, miss_pkts, nr_miss);
+
+	for (i = 0; i < nr_miss; i++) {
+		pkt = miss_pkts[i];
+
+		err = listen_tsock_lookup(pkt, &tsock);
+		if (err) {
+			free_err_pkt(worker, NULL, pkt, err);
+			continue;
+		}
+		pkt->tsock = tsock;
+		TSOCK_STATS_INC(tsock, PKT_RECV);
+
+		parse_ts_opt_fast(pkt);
+		pkts[nr_found++] = pkt;
+	}
+
+	return nr_found;
+}
+
+/* how many pkts ahead the tsock is prefetched at the lookup stage */
+#define TSOCK_PREFETCH_OFF		4
+
+/*
+ * The rx burst goes in three stages: parse all, lookup all, and then
+ * process per tsock. At the lookup stage, the tsock of the pkt a few
+ * slots ahead is prefetched (by the flow mark), so that the tsock miss
+ * is hidden behind the lookups of the pkts in between; it matters when
+ * there are many socks and the rx burst spans many of them.
+ *
+ * It's safe to lookup all before processing any, as the tsock free is
+ * deferred to tcp_input_tsock_done. The exception is the listen tsock:
+ * the pkts resolved to it are looked up again at the process stage.
+ */
 uint32_t tcp_input(struct tpa_worker *worker, uint16_t port_id)
 {
 	struct dev_rxq *rxq = dev_port_rxq(port_id, worker->queue);
 	uint32_t nr_rx_burst = dev_port_rx_burst(port_id);
+	struct packet *pkts[BATCH_SIZE];
+	struct packet *miss_pkts[BATCH_SIZE];
+	struct tcp_sock *child;
 	struct tcp_sock *tsock;
 	struct packet *pkt;
 	uint32_t nr_tsock = 0;
 	uint32_t nr_pkt;
+	uint32_t nr_parsed = 0;
+	uint32_t nr_found = 0;
+	uint32_t nr_miss = 0;
 	uint32_t i;
 	int err;
 
 	nr_pkt = RTE_MIN(nr_rx_burst, rxq->write - rxq->read);
+	nr_pkt = RTE_MIN(nr_pkt, (uint32_t)BATCH_SIZE);
 	WORKER_STATS_ADD(worker, PKT_RECV, nr_pkt);
 
 	for (i = 0; i < nr_pkt; i++) {
@@ -1750,67 +2655,112 @@ uint32_t tcp_input(struct tpa_worker *worker, uint16_t port_id)
 			continue;
 		}
 
+		pkts[nr_parsed++] = pkt;
+	}
+
+	for (i = 0; i < RTE_MIN(nr_parsed, (uint32_t)TSOCK_PREFETCH_OFF); i++)
+		tsock_prefetch(pkts[i]);
+
+	for (i = 0; i < nr_parsed; i++) {
+		pkt = pkts[i];
+
+		if (i + TSOCK_PREFETCH_OFF < nr_parsed)
+			tsock_prefetch(pkts[i + TSOCK_PREFETCH_OFF]);
+
 		err = tsock_lookup(worker, worker->id, pkt, &tsock);
 		if (unlikely(err)) {
-			free_err_pkt(worker, NULL, pkt, err);
+			if (err == -WARN_MISSING_FLOW_MARK)
+				miss_pkts[nr_miss++] = pkt;
+			else
+				free_err_pkt(worker, NULL, pkt, err);
 			continue;
 		}
 		pkt->tsock = tsock;
 		TSOCK_STATS_INC(tsock, PKT_RECV);
 
 		parse_ts_opt_fast(pkt);
+		pkts[nr_found++] = pkt;
+	}
+
+	if (unlikely(nr_miss))
+		nr_found = tcp_input_steer(worker, miss_pkts, nr_miss, pkts, nr_found);
+
+	/*
+	 * The pkts of a tsock are merged in the order they arrive, as
+	 * before. That's not the case across socks, though: the pkts to
+	 * a listen tsock are processed right here, while the others are
+	 * processed per tsock after this loop. And the pkts without flow
+	 * mark left to the listen lookup by tcp_input_steer are appended
+	 * after all the others of the burst.
+	 */
+	for (i = 0; i < nr_found; i++) {
+		pkt = pkts[i];
+		tsock = pkt->tsock;
+
+		/*
+		 * The child may have been created by an earlier SYN of
+		 * this very burst: redo the lookup, or a dup SYN would
+		 * create another one.
+		 */
+		if (unlikely(tsock->state == TCP_STATE_LISTEN)) {
+			if (tsock_lookup_slowpath(worker, pkt, &child) != 0) {
+				queue_input_tsock(worker, tsock, &nr_tsock);
+				tcp_rcv_process(worker, tsock, pkt);
+				continue;
+			}
+
+			tsock = child;
+			pkt->tsock = child;
+		}
+
 		queue_input_tsock(worker, tsock, &nr_tsock);
-		if (tsock->state == TCP_STATE_LISTEN)
-			tcp_rcv_process(worker, tsock, pkt);
-		else
-			tcp_merge(worker, tsock, pkt);
+		tcp_merge(worker, tsock, pkt);
 	}
 
 	for (i = 0; i < nr_tsock; i++) {
 		tsock = worker->tsocks[i];
 
-		if (tsock->rx_merge_head)
-			tcp_rcv_process(worker, tsock, tsock->rx_merge_head);
+		if (tsock->rx_merge_head) {
+			/* the ACK goes when it's flushed */
+			if (tcp_gro_hold(worker, tsock, tsock->rx_merge_head))
+				continue;
 
-		if (tsock->flags & TSOCK_FLAG_ACK_NEEDED) {
-			if (tsock->flags & TSOCK_FLAG_ACK_NOW) {
-				xmit_flag_packet(worker, tsock);
-			} else {
-				flex_fifo_push_if_not_exist(worker->delayed_ack,
-							    &tsock->delayed_ack_node);
-			}
+			tcp_rcv_process(worker, tsock, tsock->rx_merge_head);
 		}
 
-		if (unlikely(tsock->flags & TSOCK_FLAG_PUT)) {
-			tsock->flags &= ~TSOCK_FLAG_PUT;
-			tsock_free(tsock);
-		}
+		tcp_input_tsock_done(worker, tsock);
 	}
 
 	return nr_pkt;
 }
 
+/*
+ * The pkt may come in a mbuf chain, say with rx scatter; hence the l4 is
+ * summed by csum_raw_mbuf, instead of rte_ipv4/6_udptcp_cksum.
+ */
 int verify_csum(struct packet *pkt)
 {
-	uint16_t csum;
+	uint32_t l4_off = pkt->l4_off - pkt->l2_off;
+	uint64_t sum;
 
 	if (pkt->flags & PKT_FLAG_IS_IPV6) {
 		struct rte_ipv6_hdr *ip;
 
 		ip = packet_ip6_hdr(pkt);
-		csum = rte_ipv6_udptcp_cksum(ip, ip + 1);
-		if (csum != 0)
+		sum = rte_ipv6_phdr_cksum(ip, 0) +
+		      csum_raw_mbuf(&pkt->mbuf, l4_off, ntohs(ip->payload_len));
+		if (csum_fold(sum) != 0xffff)
 			return -ERR_BAD_CSUM_TCP;
 	} else {
 		struct rte_ipv4_hdr *ip;
 
 		ip = packet_ip_hdr(pkt);
-		csum = rte_ipv4_cksum(ip);
-		if (csum != 0)
+		if (rte_ipv4_cksum(ip) != 0)
 			return -ERR_BAD_CSUM_IPV4;
 
-		csum = rte_ipv4_udptcp_cksum(ip, ip + 1);
-		if (csum != 0)
+		sum = rte_ipv4_phdr_cksum(ip, 0) +
+		      csum_raw_mbuf(&pkt->mbuf, l4_off, ntohs(ip->total_length) - IP4_HDR_LEN(ip));
+		if (csum_fold(sum) != 0xffff)
 			return -ERR_BAD_CSUM_TCP;
 	}
 
@@ -13,6 +13,7 @@
 #include "worker.h"
 #include "neigh.h"
 #include "tsock_trace.h"
+#include "csum.h"
 
 void calc_csum(struct eth_ip_hdr *net_hdr, struct rte_tcp_hdr *tcp)
 {
@@ -21,10 +22,10 @@ void calc_csum(struct eth_ip_hdr *net_hdr, struct rte_tcp_hdr *tcp)
 		net_hdr->ip4.hdr_checksum = rte_ipv4_cksum(&net_hdr->ip4);
 
 		tcp->cksum = 0;
-		tcp->cksum = rte_ipv4_udptcp_cksum(&net_hdr->ip4, tcp);
+		tcp->cksum = csum_ipv4_tcp(&net_hdr->ip4, tcp);
 	} else {
 		tcp->cksum = 0;
-		tcp->cksum = rte_ipv6_udptcp_cksum(&net_hdr->ip6, tcp);
+		tcp->cksum = csum_ipv6_tcp(&net_hdr->ip6, tcp);
 	}
 }
 
@@ -97,9 +98,9 @@ static inline int calc_tcp_opt_len(struct tcp_sock *tsock, uint16_t flags,
 			opts |= TCP_OPT_SACK_PERM_BIT;
 		}
 	} else {
-		if (tsock->nr_sack_block) {
+		if (tsock->nr_sack_block || (tsock->flags & TSOCK_FLAG_DSACK)) {
 			debug_assert(tsock->sack_ok);
-			len  += TCP_OPT_SACK_SPACE(tsock->nr_sack_block);
+			len  += TCP_OPT_SACK_SPACE(tsock_nr_sack_to_send(tsock));
 			opts |= TCP_OPT_SACK_BIT;
 		}
 	}
@@ -146,6 +147,7 @@ static __rte_noinline void fill_uncommon_opts(const struct tcp_sock *tsock,
 
 	if (opts & TCP_OPT_SACK_BIT) {
 		struct tcp_sack_block *blk;
+		int nr_sack = tsock_nr_sack_to_send(tsock);
 		int i;
 
 		addr[0] = TCP_OPT_NOP_KIND;
@@ -154,10 +156,19 @@ static __rte_noinline void fill_uncommon_opts(const struct tcp_sock *tsock,
 
 		opt = (struct tcp_opt *)addr;
 		opt->type  = TCP_OPT_SACK_KIND;
-		opt->len   = TCP_OPT_SACK_LEN(tsock->nr_sack_block);
+		opt->len   = TCP_OPT_SACK_LEN(nr_sack);
 
 		blk = (struct tcp_sack_block *)opt->u8;
-		for (i = 0; i < tsock->nr_sack_block; i++) {
+		if (tsock->flags & TSOCK_FLAG_DSACK) {
+			/* RFC 2883: D-SACK goes first */
+			blk->start = htonl(tsock->dsack_block.start);
+			blk->end   = htonl(tsock->dsack_block.end);
+
+			blk += 1;
+			nr_sack -= 1;
+		}
+
+		for (i = 0; i < nr_sack; i++) {
 			blk->start = htonl(tsock->sack_blocks[i].start);
 			blk->end   = htonl(tsock->sack_blocks[i].end);
 
@@ -179,6 +190,44 @@ static inline void fill_opts(const struct tcp_sock *tsock, uint32_t opts, uint8_
 		fill_uncommon_opts(tsock, opts, addr);
 }
 
+/*
+ * RFC 3168: ECE|CWR at SYN to request ECN, and ECE alone at SYN-ACK to
+ * accept it. Once it's negotiated, new data segs are sent with ECT(0);
+ * ECE is set on the ACKs to echo CE, and CWR is set on the first new
+ * data seg after the cwnd is reduced on ECE.
+ *
+ * Retransmits (RTO, fast retrans, and the RACK lost-only and TLP ones
+ * alike) are sent as Not-ECT, as RFC 3168 6.1.5 requires.
+ */
+static __rte_noinline uint8_t tcp_ecn_flags(struct tcp_sock *tsock, struct eth_ip_hdr *hdr,
+					    uint8_t tcp_flags, uint16_t payload_len,
+					    int is_retrans)
+{
+	if (tcp_flags & TCP_FLAG_SYN) {
+		if (tsock->state == TCP_STATE_SYN_SENT)
+			return tsock_ecn_wanted(tsock) ? TCP_FLAG_ECE | TCP_FLAG_CWR : 0;
+
+		return tsock->ecn_ok ? TCP_FLAG_ECE : 0;
+	}
+
+	if (!tsock->ecn_ok)
+		return 0;
+
+	if (payload_len && !is_retrans) {
+		net_hdr_set_ecn(hdr, tsock->is_ipv6, IP_ECN_ECT0);
+
+		if (tsock->cwr_pending) {
+			tsock->cwr_pending = 0;
+			tcp_flags |= TCP_FLAG_CWR;
+		}
+	}
+
+	if (tsock->ece_pending && (tcp_flags & TCP_FLAG_ACK))
+		tcp_flags |= TCP_FLAG_ECE;
+
+	return tcp_flags & (TCP_FLAG_ECE | TCP_FLAG_CWR);
+}
+
 static inline int prepend_tcp_hdr(struct tcp_sock *tsock, struct packet *pkt,
 				  uint32_t seq, uint8_t tcp_flags)
 {
@@ -219,6 +268,10 @@ static inline int prepend_tcp_hdr(struct tcp_sock *tsock, struct packet *pkt,
 	}
 
 	*hdr = tsock->net_hdr;
+	if (unlikely(tsock->ecn_ok || (tcp_flags & TCP_FLAG_SYN)))
+		tcp_flags |= tcp_ecn_flags(tsock, hdr, tcp_flags, payload_len,
+					   !!(pkt->flags & PKT_FLAG_RETRANSMIT));
+
 	tcp->src_port = tsock->local_port;
 	tcp->dst_port = tsock->remote_port;
 	tcp->sent_seq = htonl(seq);
@@ -233,8 +286,12 @@ static inline int prepend_tcp_hdr(struct tcp_sock *tsock, struct packet *pkt,
 	TCP_SEG(pkt)->flags = tcp_flags;
 
 	snd_mss = tsock->snd_mss;
-	if (opts & TCP_OPT_SACK_BIT)
-		snd_mss -= TCP_OPT_SACK_SPACE(tsock->nr_sack_block);
+	if (opts & TCP_OPT_SACK_BIT) {
+		snd_mss -= TCP_OPT_SACK_SPACE(tsock_nr_sack_to_send(tsock));
+
+		/* D-SACK is reported once only */
+		tsock->flags &= ~TSOCK_FLAG_DSACK;
+	}
 
 	mbuf_set_offload(pkt, hdr, tcp, tsock->is_ipv6, tcp_hdr_len, payload_len,
 			 tsock->packet_id++, snd_mss);
@@ -281,7 +338,7 @@ int xmit_flag_packet_with_seq(struct tpa_worker *worker, struct tcp_sock *tsock,
 		return -1;
 	}
 
-	pkt = packet_alloc(&worker->hdr_pkt_pool);
+	pkt = packet_cache_alloc(&worker->hdr_pkt_cache);
 	if (!pkt) {
 		err = -ERR_PKT_ALLOC_FAIL;
 		goto err;
@@ -332,7 +389,7 @@ err:
 	WORKER_TSOCK_STATS_INC(worker, tsock, -err);
 	if (pkt) {
 		tsock_trace_xmit_pkt(tsock, pkt, -err);
-		packet_free(pkt);
+		tx_packet_free(worker, pkt);
 	}
 
 	return err;
@@ -371,7 +428,7 @@ int xmit_rst_for_listen(struct tpa_worker *worker, struct tcp_sock *tsock, struc
 
 	debug_assert(tsock->state == TCP_STATE_LISTEN);
 
-	reply_pkt = packet_alloc(&worker->hdr_pkt_pool);
+	reply_pkt = packet_cache_alloc(&worker->hdr_pkt_cache);
 	if (!reply_pkt)
 		return -ERR_PKT_ALLOC_FAIL;
 
@@ -416,7 +473,7 @@ int xmit_rst_for_listen(struct tpa_worker *worker, struct tcp_sock *tsock, struc
 
 err:
 	tsock_trace_xmit_pkt(tsock, reply_pkt, ret);
-	packet_free(reply_pkt);
+	tx_packet_free(worker, reply_pkt);
 	return ret;
 }
 
@@ -492,15 +549,83 @@ static void __rte_noinline tcp_zero_wnd_probe(struct tpa_worker *worker, struct
 	WORKER_TSOCK_STATS_INC(worker, tsock, ZERO_WND_PROBE);
 }
 
+/* snapshot the delivery states into the desc, for rate sampling at ack */
+static inline void tcp_rate_desc_sent(struct tcp_sock *tsock, struct tx_desc *desc, uint64_t now)
+{
+	/* nothing in flight: starts a new sampling interval */
+	if (tsock->snd_una == tsock->snd_nxt) {
+		tsock->first_tx_ts = now;
+		tsock->delivered_ts = now;
+	}
+
+	desc->delivered    = tsock->delivered;
+	desc->delivered_ts = tsock->delivered_ts;
+	desc->first_tx_ts  = tsock->first_tx_ts;
+
+	if (unlikely(tsock->app_limited))
+		desc->flags |= TX_DESC_FLAG_APP_LIMITED;
+	else
+		desc->flags &= ~TX_DESC_FLAG_APP_LIMITED;
+}
+
+/*
+ * The pacing rate, in bytes per sec. It's the one set by the cc if any,
+ * say BBR. Otherwise, it's derived from cwnd / srtt, with a ratio of
+ * 200% in slow start and 120% in congestion avoidance, as Linux does.
+ */
+static inline uint64_t tsock_pacing_rate(struct tcp_sock *tsock)
+{
+	uint64_t rate;
+
+	if (tsock->pacing_rate)
+		return tsock->pacing_rate;
+
+	if (tsock->srtt == 0)
+		return 0;
+
+	/* srtt is scaled by 8 */
+	rate = (uint64_t)tsock->snd_cwnd * 1000000 * 8 / tsock->srtt;
+	if (tsock->snd_cwnd < tsock->snd_ssthresh)
+		rate *= 2;
+	else
+		rate = rate * 12 / 10;
+
+	return rate;
+}
+
 struct xmit_ctx {
 	uint32_t seq;
 	uint32_t seq_max;
 	int      budget;
+	uint32_t seg_max;
 	uint16_t desc_off;
 	uint16_t desc_base;
+	uint16_t lost_only;	/* retrans the descs marked lost only */
 	uint64_t now;
+
+	uint64_t pacing_rate;	/* 0 for not paced */
+	uint64_t pacing_now;	/* in TSC */
 };
 
+/* skips a sacked run at once, to the next hole told by the scoreboard */
+static inline void xmit_skip_sacked(struct tcp_sock *tsock, struct xmit_ctx *ctx,
+				    struct tx_desc *desc)
+{
+	struct tx_desc *next;
+	uint32_t hole;
+
+	hole = sack_scoreboard_next_hole(&tsock->sack_sb, desc->seq);
+	if (seq_le(hole, desc->seq + desc->len)) {
+		ctx->desc_off += 1;
+		ctx->seq = desc->seq + desc->len;
+		return;
+	}
+
+	ctx->desc_off = tcp_txq_search(&tsock->txq, ctx->desc_base, hole);
+	next = tcp_txq_peek_for_write(&tsock->txq, ctx->desc_base, ctx->desc_off);
+	ctx->seq = next ? next->seq : hole;
+}
+
 /*
  * construct one packet with size no longer than the effective mss
  * from the txq and then xmit it.
@@ -523,19 +648,26 @@ static inline int xmit_one_packet(struct tpa_worker *worker, struct tcp_sock *ts
 		if (!desc)
 			return 0;
 
-		if (likely(desc->flags & TX_DESC_FLAG_SACKED) == 0)
+		if (likely(desc->flags & TX_DESC_FLAG_SACKED) == 0 &&
+		    (!ctx->lost_only || (desc->flags & TX_DESC_FLAG_LOST)))
 			break;
 
-		ctx->desc_off += 1;
-		ctx->seq = desc->seq + desc->len;
+		if (desc->flags & TX_DESC_FLAG_SACKED) {
+			xmit_skip_sacked(tsock, ctx, desc);
+		} else {
+			ctx->desc_off += 1;
+			ctx->seq = desc->seq + desc->len;
+		}
+		if (seq_ge(ctx->seq, ctx->seq_max))
+			return 0;
 	}
 
-	hdr_pkt = packet_alloc(&worker->hdr_pkt_pool);
+	hdr_pkt = packet_cache_alloc(&worker->hdr_pkt_cache);
 	if (!hdr_pkt)
 		return -ERR_PKT_ALLOC_FAIL;
 
 	tail = hdr_pkt;
-	budget = RTE_MIN(ctx->budget, tsock_snd_mss(tsock));
+	budget = RTE_MIN(ctx->budget, ctx->seg_max);
 
 	while (budget > 0) {
 		if (unlikely(seq_lt(ctx->seq, tsock->snd_nxt))) {
@@ -544,9 +676,10 @@ static inline int xmit_one_packet(struct tpa_worker *worker, struct tcp_sock *ts
 		}
 		if (unlikely(desc->flags & TX_DESC_FLAG_SACKED))
 			break;
+		if (unlikely(ctx->lost_only) && !(desc->flags & TX_DESC_FLAG_LOST))
+			break;
 
-		/* TODO: bulk allocate */
-		pkt = packet_alloc(&worker->zwrite_pkt_pool);
+		pkt = packet_cache_alloc(&worker->zwrite_pkt_cache);
 		if (!pkt) {
 			err = -ERR_PKT_ALLOC_FAIL;
 			break;
@@ -567,12 +700,21 @@ static inline int xmit_one_packet(struct tpa_worker *worker, struct tcp_sock *ts
 		packet_attach_extbuf(pkt, desc->addr + off, desc->phys_addr + off, len);
 		TCP_SEG(pkt)->seq = ctx->seq;
 		TCP_SEG(pkt)->len = len;
+		if (unlikely(desc->flags & TX_DESC_FLAG_HAS_CSUM) && off == 0 && len == desc->len) {
+			pkt->csum = desc->csum;
+			pkt->flags |= PKT_FLAG_HAS_CSUM;
+		}
 
 		budget -= len;
 		ctx->seq += len;
 		size += len;
 		if (off + len == desc->len) {
 			desc->ts_us = worker->ts_us;
+			tcp_rate_desc_sent(tsock, desc, worker->ts_us);
+			if (unlikely(desc->flags & TX_DESC_FLAG_LOST)) {
+				desc->flags &= ~TX_DESC_FLAG_LOST;
+				tsock->lost_bytes -= desc->len;
+			}
 			if (likely(!(desc->flags & TX_DESC_FLAG_RETRANS))) {
 				if (unlikely(desc->flags & TX_DESC_FLAG_MEASURE_LATENCY)) {
 					if (!ctx->now)
@@ -617,7 +759,7 @@ static inline int xmit_one_packet(struct tpa_worker *worker, struct tcp_sock *ts
 
 error:
 	tsock_trace_xmit_pkt(tsock, hdr_pkt, err);
-	packet_free(hdr_pkt);
+	tx_packet_free(worker, hdr_pkt);
 	return err;
 }
 
@@ -639,6 +781,14 @@ static inline int do_tcp_xmit_data(struct tpa_worker *worker, struct tcp_sock *t
 		}
 
 		size += ret;
+
+		/* the next one leaves after this one is drained at the pacing rate */
+		if (ctx->pacing_rate) {
+			WORKER_TSOCK_STATS_INC(worker, tsock, PKT_PACED);
+			tsock->pacing_node.tsc += (uint64_t)ret * tpa_cfg.hz / ctx->pacing_rate;
+			if (tsock->pacing_node.tsc > ctx->pacing_now)
+				break;
+		}
 	}
 
 	if (likely(size > 0)) {
@@ -658,6 +808,43 @@ static inline int do_tcp_xmit_data(struct tpa_worker *worker, struct tcp_sock *t
 	return size;
 }
 
+/*
+ * Returns 1 if it's not the time yet for the next packet to go; the
+ * tsock is then parked at the pacing queue, until the departure time
+ * arrives.
+ */
+static __rte_noinline int tcp_pacing_check(struct tpa_worker *worker, struct tcp_sock *tsock,
+					   struct xmit_ctx *ctx)
+{
+	uint64_t now = rte_rdtsc();
+
+	ctx->pacing_rate = tsock_pacing_rate(tsock);
+	ctx->pacing_now = now;
+	if (ctx->pacing_rate == 0)
+		return 0;
+
+	/*
+	 * Don't let a TSO packet take more than 1ms worth of the pacing
+	 * rate, otherwise it becomes a burst again; as Linux does.
+	 */
+	ctx->seg_max = RTE_MIN(ctx->seg_max, RTE_MAX(ctx->pacing_rate / 1000, (uint64_t)tsock->snd_mss));
+
+	/* no credits are accumulated while idle */
+	if (tsock->pacing_node.tsc <= now) {
+		pacing_queue_remove(&worker->pacing_queue, &tsock->pacing_node);
+		tsock->pacing_node.tsc = now;
+		return 0;
+	}
+
+	if (unlikely(pacing_queue_push(&worker->pacing_queue, &tsock->pacing_node) < 0)) {
+		WORKER_TSOCK_STATS_INC(worker, tsock, ERR_PACING_ENQUEUE);
+		return 0;
+	}
+
+	WORKER_TSOCK_STATS_INC(worker, tsock, PACING_DEFER);
+	return 1;
+}
+
 /*
  * Try to xmit the data queued in the tcp txq.
  */
@@ -675,11 +862,28 @@ static uint32_t tcp_xmit_data(struct tpa_worker *worker, struct tcp_sock *tsock)
 	ctx.seq = tsock->snd_nxt;
 	ctx.seq_max = tsock->data_seq_nxt;
 	ctx.budget = wnd - (ctx.seq - tsock->snd_una);
+	ctx.seg_max = tsock_snd_mss(tsock);
 	ctx.desc_base = tsock->txq.nxt;
 	ctx.desc_off = 0;
+	ctx.lost_only = 0;
 	ctx.now = 0;
+	ctx.pacing_rate = 0;
+
+	if (unlikely(tcp_cfg.pacing) && ctx.seq != ctx.seq_max && ctx.budget > 0) {
+		if (tcp_pacing_check(worker, tsock, &ctx))
+			return 0;
+	}
 
 	do_tcp_xmit_data(worker, tsock, &ctx);
+
+	/*
+	 * All data is sent out while the window is still open: the rate
+	 * samples are limited by the app, until the data in flight now
+	 * is delivered.
+	 */
+	if (ctx.seq == ctx.seq_max && ctx.budget > 0)
+		tsock->app_limited = RTE_MAX(tsock->delivered + (ctx.seq - tsock->snd_una), 1);
+
 	if (ctx.seq == tsock->snd_nxt)
 		return 0;
 
@@ -687,10 +891,13 @@ static uint32_t tcp_xmit_data(struct tpa_worker *worker, struct tcp_sock *tsock)
 	tcp_txq_update_nxt(&tsock->txq, ctx.desc_off);
 	trace_tcp_update_txq(tsock, tcp_txq_inflight_pkts(&tsock->txq), tcp_txq_to_send_pkts(&tsock->txq));
 
+	tsock_schedule_tlp(tsock, worker->ts_us);
+
 	return 0;
 }
 
-static int do_tcp_retrans(struct tpa_worker *worker, struct tcp_sock *tsock, int budget)
+static int do_tcp_retrans(struct tpa_worker *worker, struct tcp_sock *tsock, int budget,
+			  int lost_only)
 {
 	struct xmit_ctx ctx;
 	int size;
@@ -698,9 +905,12 @@ static int do_tcp_retrans(struct tpa_worker *worker, struct tcp_sock *tsock, int
 	ctx.seq = tsock->retrans.seq;
 	ctx.seq_max = tsock->snd_nxt;
 	ctx.budget = budget;
+	ctx.seg_max = tsock_snd_mss(tsock);
 	ctx.desc_base = tsock->retrans.desc_base;
 	ctx.desc_off = 0;
+	ctx.lost_only = lost_only;
 	ctx.now = 0;
+	ctx.pacing_rate = 0;
 
 	size = do_tcp_xmit_data(worker, tsock, &ctx);
 	tsock->retrans.seq = ctx.seq;
@@ -723,28 +933,123 @@ void tcp_retrans(struct tpa_worker *worker, struct tcp_sock *tsock)
 	wnd = RTE_MIN(tsock->snd_wnd, tsock->snd_cwnd);
 	budget = wnd - (tsock->retrans.seq - tsock->snd_una);
 
-	do_tcp_retrans(worker, tsock, budget);
+	do_tcp_retrans(worker, tsock, budget, 0);
+}
+
+/*
+ * RFC 6675 pipe: the bytes in flight. The sacked ones have left the
+ * network, and so have the ones marked lost, till they are retransmitted.
+ */
+static inline uint32_t tsock_pipe(struct tcp_sock *tsock)
+{
+	uint32_t out = tsock->snd_nxt - tsock->snd_una;
+	uint32_t left = tsock->sacked_bytes + tsock->lost_bytes;
+
+	return out > left ? out - left : 0;
 }
 
+/*
+ * In the RACK recovery, @budget is what goes regardless of the pipe:
+ * the first retrans at the recovery entry (RFC 6675 5 step 4.3).
+ */
 void tcp_fast_retrans(struct tpa_worker *worker, struct tcp_sock *tsock, int budget)
 {
+	uint32_t room;
+	uint32_t pipe;
 	int size;
 
 	/* regulate retrans pointers */
 	if (seq_lt(tsock->retrans.seq, tsock->snd_una))
 		tcp_reset_retrans(tsock, tsock->snd_una, tsock->txq.una);
 
-	budget = budget - (tsock->retrans.seq - tsock->snd_una);
-	if (budget < tsock->snd_mss)
-		budget = tsock->snd_mss;
+	if (tsock->rack.recovery) {
+		/*
+		 * RACK tells exactly what is lost, while how much of it
+		 * could go is what's left of the ssthresh by the pipe
+		 * (RFC 6675 5 (C)): the cwnd is inflated in the recovery
+		 * by the sacked bytes, which the pipe counts out already.
+		 */
+		if (tsock->lost_bytes == 0)
+			return;
+
+		pipe = tsock_pipe(tsock);
+		room = pipe < tsock->snd_ssthresh ? tsock->snd_ssthresh - pipe : 0;
+		budget = RTE_MIN(RTE_MAX((uint32_t)budget, room), tsock->lost_bytes);
+		if (budget == 0)
+			return;
+	} else {
+		budget = budget - (tsock->retrans.seq - tsock->snd_una);
+		if (budget < tsock->snd_mss)
+			budget = tsock->snd_mss;
+	}
 
-	size = do_tcp_retrans(worker, tsock, budget);
+	size = do_tcp_retrans(worker, tsock, budget, tsock->rack.recovery);
 	if (size == 0)
 		WORKER_TSOCK_STATS_INC(tsock->worker, tsock, PKT_FAST_RE_XMIT_ERR);
 	else
 		WORKER_TSOCK_STATS_ADD(tsock->worker, tsock, BYTE_FAST_RE_XMIT, size);
 }
 
+/*
+ * RFC 8985 7.3: send one new seg if the rwnd allows; otherwise, retrans
+ * the last one. Either way, it solicits an ACK (with SACK hopefully)
+ * that lets RACK detect the tail loss.
+ *
+ * Returns the bytes sent.
+ */
+int tcp_xmit_tlp_probe(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	struct xmit_ctx ctx;
+	struct tx_desc *desc;
+	int is_retrans = 0;
+	int size;
+
+	ctx.budget = tsock->snd_mss;
+	ctx.seg_max = tsock->snd_mss;
+	ctx.desc_off = 0;
+	ctx.lost_only = 0;
+	ctx.now = 0;
+	ctx.pacing_rate = 0;
+
+	if (tsock->snd_nxt != tsock->data_seq_nxt &&
+	    tsock->snd_wnd > tsock->snd_nxt - tsock->snd_una) {
+		ctx.seq = tsock->snd_nxt;
+		ctx.seq_max = tsock->data_seq_nxt;
+		ctx.desc_base = tsock->txq.nxt;
+	} else {
+		/* the last desc in flight; it's the one at nxt if it's partially sent */
+		ctx.desc_base = tsock->txq.nxt;
+		desc = tcp_txq_peek_for_write(&tsock->txq, ctx.desc_base, 0);
+		if (!desc || seq_ge(desc->seq, tsock->snd_nxt)) {
+			ctx.desc_base -= 1;
+			desc = tcp_txq_peek_for_write(&tsock->txq, ctx.desc_base, 0);
+		}
+
+		ctx.seq = tsock->snd_nxt - RTE_MIN(tsock->snd_nxt - desc->seq, (uint32_t)tsock->snd_mss);
+		if (seq_lt(ctx.seq, tsock->snd_una))
+			ctx.seq = tsock->snd_una;
+		ctx.seq_max = tsock->snd_nxt;
+		is_retrans = 1;
+	}
+
+	size = do_tcp_xmit_data(worker, tsock, &ctx);
+	if (size <= 0)
+		return 0;
+
+	if (is_retrans) {
+		WORKER_TSOCK_STATS_ADD(worker, tsock, BYTE_RE_XMIT, size);
+	} else {
+		tsock->snd_nxt = ctx.seq;
+		tcp_txq_update_nxt(&tsock->txq, ctx.desc_off);
+	}
+
+	tsock->rack.tlp_pending = 1;
+	tsock->rack.tlp_is_retrans = is_retrans;
+	tsock->rack.tlp_high_seq = tsock->snd_nxt;
+
+	return size;
+}
+
 /*
  * Assume an user just triggers a write for a socket the first time and
  * it fails (say, due to running out of mbufs). The app then watches the
@@ -776,6 +1081,8 @@ struct write_ctx {
 	uint32_t size;
 
 	int nr_fallback;
+	int sw_csum;		/* the port does the tcp csum in software */
+	int deferred;		/* the output enqueue is left to the caller */
 	uint64_t start_tsc;
 };
 
@@ -786,13 +1093,14 @@ static inline void write_commit(struct tcp_sock *tsock, struct write_ctx *ctx)
 	txq->write += ctx->nr_desc;
 	debug_assert((uint16_t)(txq->write - txq->una) <= txq->size);
 
-	vstats_add(&tsock->write_size, ctx->size);
+	vstats_add(&tsock->stats->write_size, ctx->size);
 
 	WORKER_TSOCK_STATS_ADD(tsock->worker, tsock, BYTE_XMIT, ctx->size);
 	WORKER_TSOCK_STATS_ADD(tsock->worker, tsock, PKT_XMIT,  ctx->nr_desc);
 
 	tsock->data_seq_nxt += ctx->size;
-	output_tsock_enqueue(tsock->worker, tsock);
+	if (!ctx->deferred)
+		output_tsock_enqueue(tsock->worker, tsock);
 }
 
 static void write_revoke(struct tcp_sock *tsock, struct write_ctx *ctx)
@@ -804,7 +1112,7 @@ static void write_revoke(struct tcp_sock *tsock, struct write_ctx *ctx)
 	for (i = 0; i < ctx->nr_desc; i++) {
 		desc = txq->descs[(txq->write + i) & txq->mask];
 		if (desc->flags & TX_DESC_FLAG_MEM_FROM_MBUF)
-			packet_free(desc->pkt);
+			tx_packet_free(tsock->worker, desc->pkt);
 
 		tx_desc_free(tsock->worker->tx_desc_pool, desc);
 	}
@@ -860,7 +1168,13 @@ static int write_one_iov(struct tcp_sock *tsock, const struct tpa_iovec *iov,
 			flags = TX_DESC_FLAG_MEM_FROM_MBUF;
 
 			len = RTE_MIN(len, rte_pktmbuf_tailroom(&pkt->mbuf));
-			memcpy(addr, (const char *)iov->iov_base + off, len);
+			if (ctx->sw_csum) {
+				/* sum it while it's copied; it's used by the software GSO */
+				desc->csum = csum_copy(addr, (const char *)iov->iov_base + off, len);
+				flags |= TX_DESC_FLAG_HAS_CSUM;
+			} else {
+				memcpy(addr, (const char *)iov->iov_base + off, len);
+			}
 			pkt->mbuf.data_len = len;
 			pkt->mbuf.pkt_len = len;
 
@@ -918,6 +1232,7 @@ static __rte_noinline ssize_t tsock_zwritev_slowpath(struct tcp_sock *tsock,
 	int i;
 
 	ctx->nr_fallback = 0;
+	ctx->sw_csum = !!(dev.ports[tsock->port_id].sw_tx_offload & PKT_TX_TCP_CKSUM);
 	for (i = ctx->nr_desc; i < nr_iov; i++) {
 		if (write_one_iov(tsock, &iov[i], ctx) < 0)
 			return -1;
@@ -961,7 +1276,8 @@ static __rte_noinline ssize_t tsock_zwritev_slowpath(struct tcp_sock *tsock,
 	}								\
 } while (0)
 
-ssize_t tsock_zwritev(struct tcp_sock *tsock, const struct tpa_iovec *iov, int nr_iov)
+static inline ssize_t do_tsock_zwritev(struct tcp_sock *tsock, const struct tpa_iovec *iov,
+					int nr_iov, int deferred)
 {
 	struct tcp_txq *txq = &tsock->txq;
 	struct write_ctx ctx;
@@ -976,6 +1292,7 @@ ssize_t tsock_zwritev(struct tcp_sock *tsock, const struct tpa_iovec *iov, int n
 	ctx.nr_desc_free = tcp_txq_free_count(&tsock->txq);
 	ctx.nr_desc = 0;
 	ctx.size = 0;
+	ctx.deferred = deferred;
 
 	for (i = 0; i < nr_iov; i++) {
 		if (unlikely(iov[i].iov_phys == 0 || iov[i].iov_len == 0 || iov[i].iov_len > tcp_cfg.write_chunk_size))
@@ -1023,6 +1340,20 @@ fail:
 	return -1;
 }
 
+ssize_t tsock_zwritev(struct tcp_sock *tsock, const struct tpa_iovec *iov, int nr_iov)
+{
+	return do_tsock_zwritev(tsock, iov, nr_iov, 0);
+}
+
+/*
+ * The same as tsock_zwritev, except that the tsock is not queued for
+ * output: it's left to the caller, to do it for many socks at once.
+ */
+ssize_t tsock_zwritev_deferred(struct tcp_sock *tsock, const struct tpa_iovec *iov, int nr_iov)
+{
+	return do_tsock_zwritev(tsock, iov, nr_iov, 1);
+}
+
 int tsock_write(struct tcp_sock *tsock, const void *buf, size_t size)
 {
 	struct tpa_iovec iov;
@@ -1183,7 +1514,9 @@ static inline int tcp_output_one(struct tpa_worker *worker, struct tcp_sock *tso
 	}
 
 	if (tcp_txq_to_send_pkts(&tsock->txq) > 0) {
-		output_tsock_enqueue(tsock->worker, tsock);
+		/* it will be released by the pacing queue */
+		if (!pacing_node_is_queued(&tsock->pacing_node))
+			output_tsock_enqueue(tsock->worker, tsock);
 	} else if (tsock->flags & TSOCK_FLAG_FIN_PENDING) {
 		tsock->snd_nxt = tsock->data_seq_nxt + 1;
 		tsock->flags |= TSOCK_FLAG_FIN_NEEDED | TSOCK_FLAG_ACK_NEEDED |
@@ -1218,12 +1551,31 @@ static inline void tcp_flush_delayed_ack(struct tpa_worker *worker)
 		if ((uint32_t)worker->ts_us - tsock->last_ack_sent_ts < tcp_cfg.delayed_ack)
 			break;
 
+		/*
+		 * ECE goes with it if needed. For DCTCP, tcp_rcv_ecn has
+		 * flushed the delayed ACK already if the CE state changed.
+		 */
 		if (tsock->flags & TSOCK_FLAG_ACK_NEEDED)
 			xmit_flag_packet(worker, tsock);
 		flex_fifo_pop(worker->delayed_ack);
 	}
 }
 
+static inline void tcp_pacing_release(struct tpa_worker *worker)
+{
+	struct pacing_node *node;
+	uint64_t now;
+
+	if (likely(worker->pacing_queue.nr == 0))
+		return;
+
+	now = rte_rdtsc();
+	while ((node = pacing_queue_pop_due(&worker->pacing_queue, now)) != NULL) {
+		vstats_add(&worker->pacing_lag, now - node->tsc);
+		output_tsock_enqueue(worker, container_of(node, struct tcp_sock, pacing_node));
+	}
+}
+
 int tcp_output(struct tpa_worker *worker)
 {
 	struct tcp_sock *tsock;
@@ -1231,6 +1583,7 @@ int tcp_output(struct tpa_worker *worker)
 	uint32_t i;
 	int err;
 
+	tcp_pacing_release(worker);
 	nr_tsock = output_tsock_dequeue(worker);
 
 	for (i = 0; i < nr_tsock; i++) {
@@ -0,0 +1,95 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "tpa.h"
+#include "tcp.h"
+#include "sock.h"
+#include "tcp_queue.h"
+#include "worker.h"
+
+/*
+ * RACK (RFC 8985): a desc is lost if some desc sent after it has been
+ * delivered, and it's not delivered in a reordering window since then:
+ *
+ *     desc->ts_us + rack.rtt + reo_wnd <= now
+ *
+ * where rack.rtt is the rtt of the most recently sent desc delivered.
+ * Unlike the dupack counting, it's time based: it tolerates reordering
+ * of less than reo_wnd, while it's not fooled by the number of packets.
+ */
+#define DUP_THRESH		3
+
+/* RFC 8985 6.2 step 4 */
+static uint32_t tcp_rack_reo_wnd(struct tcp_sock *tsock)
+{
+	if (!tsock->rack.reordering_seen) {
+		if (tsock->retrans_stage != NONE)
+			return 0;
+
+		if (tsock->sacked_bytes >= DUP_THRESH * tsock->snd_mss)
+			return 0;
+	}
+
+	return RTE_MIN(tsock->rack.min_rtt / 4, tsock->srtt >> 3);
+}
+
+static void tcp_rack_mark_lost(struct tpa_worker *worker, struct tcp_sock *tsock,
+			       struct tx_desc *desc, uint16_t off)
+{
+	uint32_t seq;
+
+	desc->flags |= TX_DESC_FLAG_LOST;
+	tsock->lost_bytes += desc->len;
+	WORKER_TSOCK_STATS_INC(worker, tsock, RACK_LOST);
+
+	/* rewind the retrans pointer if it's been retransmitted already */
+	seq = seq_lt(desc->seq, tsock->snd_una) ? tsock->snd_una : desc->seq;
+	if (seq_lt(seq, tsock->retrans.seq))
+		tcp_reset_retrans(tsock, seq, tsock->txq.una + off);
+}
+
+/* RFC 8985 6.2 step 5 */
+void tcp_rack_detect_loss(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	uint64_t now = worker->ts_us;
+	struct tx_desc *desc;
+	uint32_t timeout = 0;
+	uint32_t reo_wnd;
+	int64_t remaining;
+	uint16_t off;
+
+	if (tsock->rack.xmit_ts == 0)
+		return;
+
+	reo_wnd = tcp_rack_reo_wnd(tsock);
+
+	/*
+	 * The descs are not sorted by the send time, due to retrans. Thus
+	 * we go through all of them.
+	 */
+	for (off = 0; ; off++) {
+		desc = tcp_txq_peek_una_before_nxt(&tsock->txq, off);
+		if (!desc)
+			break;
+
+		if (desc->flags & (TX_DESC_FLAG_SACKED | TX_DESC_FLAG_LOST))
+			continue;
+
+		if (!rack_sent_after(tsock->rack.xmit_ts, tsock->rack.end_seq,
+				     desc->ts_us, desc->seq + desc->len))
+			continue;
+
+		remaining = (int64_t)(desc->ts_us + tsock->rack.rtt + reo_wnd - now);
+		if (remaining <= 0)
+			tcp_rack_mark_lost(worker, tsock, desc, off);
+		else
+			timeout = RTE_MAX(timeout, (uint32_t)remaining);
+	}
+
+	if (timeout)
+		timer_start(&tsock->timer_rack, now, timeout);
+}
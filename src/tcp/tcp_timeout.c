@@ -21,6 +21,8 @@
 #define IS_TIMER_RTO(tsock, timer)		(offsetof(struct tcp_sock, timer_rto)  == (uint8_t *)(timer) - (uint8_t *)(tsock))
 #define IS_TIMER_WAIT(tsock, timer)		(offsetof(struct tcp_sock, timer_wait) == (uint8_t *)(timer) - (uint8_t *)(tsock))
 #define IS_TIMER_KEEPALIVE(tsock, timer)	(offsetof(struct tcp_sock, timer_keepalive) == (uint8_t *)(timer) - (uint8_t *)(tsock))
+#define IS_TIMER_RACK(tsock, timer)		(offsetof(struct tcp_sock, timer_rack) == (uint8_t *)(timer) - (uint8_t *)(tsock))
+#define IS_TIMER_TLP(tsock, timer)		(offsetof(struct tcp_sock, timer_tlp)  == (uint8_t *)(timer) - (uint8_t *)(tsock))
 
 /*
  * Per RFC2018 page 6:
@@ -31,18 +33,40 @@
  */
 static void clear_sacked(struct tcp_sock *tsock)
 {
+	struct sack_scoreboard *sb = &tsock->sack_sb;
+	struct tcp_txq *txq = &tsock->txq;
 	struct tx_desc *desc;
 	uint16_t idx = 0;
+	int i;
 
-	while (1) {
-		desc = tcp_txq_peek_for_write(&tsock->txq, tsock->txq.una, idx++);
-		if (!desc)
-			break;
-
-		desc->flags &= ~TX_DESC_FLAG_SACKED;
+	/*
+	 * The scoreboard tells where the sacked descs are; unless it's
+	 * overflowed, or some descs are marked lost: they are in holes.
+	 */
+	if (sb->overflow || tsock->lost_bytes) {
+		while (1) {
+			desc = tcp_txq_peek_for_write(txq, txq->una, idx++);
+			if (!desc)
+				break;
+
+			desc->flags &= ~(TX_DESC_FLAG_SACKED | TX_DESC_FLAG_LOST);
+		}
+	} else {
+		for (i = 0; i < sb->nr; i++) {
+			idx = tcp_txq_search(txq, txq->una, sb->blks[i].start);
+			while (1) {
+				desc = tcp_txq_peek_for_write(txq, txq->una, idx++);
+				if (!desc || seq_ge(desc->seq, sb->blks[i].end))
+					break;
+
+				desc->flags &= ~TX_DESC_FLAG_SACKED;
+			}
+		}
 	}
 
+	sack_scoreboard_reset(sb);
 	tsock->sacked_bytes = 0;
+	tsock->lost_bytes = 0;
 }
 
 static void tcp_timeout_rto(struct tpa_worker *worker, struct tcp_sock *tsock)
@@ -52,7 +76,7 @@ static void tcp_timeout_rto(struct tpa_worker *worker, struct tcp_sock *tsock)
 
 	WORKER_TSOCK_STATS_INC(worker, tsock, TCP_RTO_TIME_OUT);
 	tsock->rto_shift += 1;
-	vstats8_max_add(&tsock->rto_shift_max, tsock->rto_shift);
+	vstats8_max_add(&tsock->stats->rto_shift_max, tsock->rto_shift);
 
 	if (tsock->state == TCP_STATE_SYN_SENT || tsock->state == TCP_STATE_SYN_RCVD)
 		timeout = tsock->rto_shift >= tcp_cfg.syn_retries;
@@ -82,11 +106,15 @@ static void tcp_timeout_rto(struct tpa_worker *worker, struct tcp_sock *tsock)
 	}
 
 	clear_sacked(tsock);
+	timer_stop(&tsock->timer_rack);
+	timer_stop(&tsock->timer_tlp);
+	tsock->rack.tlp_pending = 0;
+	tsock->rack.recovery = 0;
 
 	tsock->retrans_stage = RTO;
 	tsock->snd_recover = tsock->snd_nxt;
 
-	tsock->snd_ssthresh = RTE_MAX(tsock->snd_cwnd / 2, 2 * tsock->snd_mss);
+	tsock->snd_ssthresh = tsock->cc->on_rto(tsock, worker->ts_us);
 	tsock->snd_cwnd = tsock->snd_mss;
 
 	trace_tcp_rto(tsock, tsock->snd_ssthresh, tsock->rto_shift,
@@ -107,6 +135,35 @@ static void tcp_timeout_rto(struct tpa_worker *worker, struct tcp_sock *tsock)
 	output_tsock_enqueue(tsock->worker, tsock);
 }
 
+/* the reorder window is passed: mark the ones still not delivered lost */
+static void tcp_timeout_rack(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	tcp_rack_detect_loss(worker, tsock);
+	if (tsock->lost_bytes == 0)
+		return;
+
+	if (tsock->retrans_stage == NONE)
+		tcp_enter_fast_retrans(worker, tsock);
+	else if (tsock->retrans_stage == FAST_RETRANS)
+		tcp_fast_retrans(worker, tsock, 0);
+}
+
+static void tcp_timeout_tlp(struct tpa_worker *worker, struct tcp_sock *tsock)
+{
+	/* leave it to RTO if it's due as well */
+	if (!timer_is_stopped(&tsock->timer_rto) &&
+	    tsock->timer_rto.expire <= us_to_tick(worker->ts_us))
+		return;
+
+	if (tsock->retrans_stage != NONE || tsock->snd_una == tsock->snd_nxt)
+		return;
+
+	if (tcp_xmit_tlp_probe(worker, tsock) > 0) {
+		WORKER_TSOCK_STATS_INC(worker, tsock, TLP_PROBE);
+		tsock_rearm_timer_rto(tsock, worker->ts_us);
+	}
+}
+
 static void tcp_timeout_wait(struct tpa_worker *worker, struct tcp_sock *tsock)
 {
 	WORKER_TSOCK_STATS_INC(worker, tsock, TCP_WAIT_TIME_OUT);
@@ -164,6 +221,10 @@ void tcp_timeout(struct timer *timer)
 		tcp_timeout_wait(worker, tsock);
 	} else if (IS_TIMER_KEEPALIVE(tsock, timer)) {
 		tcp_timeout_keepalive(worker, tsock);
+	} else if (IS_TIMER_RACK(tsock, timer)) {
+		tcp_timeout_rack(worker, tsock);
+	} else if (IS_TIMER_TLP(tsock, timer)) {
+		tcp_timeout_tlp(worker, tsock);
 	} else {
 		WORKER_TSOCK_STATS_INC(worker, tsock, ERR_TCP_TIMER_INVALID_TYPE);
 	}
@@ -228,6 +228,7 @@ int tpa_init(int nr_worker)
 		return -1;
 
 	shell_init();
+	rcu_init();
 
 	dpdk_init(nr_worker);
 	if (worker_init(nr_worker) < 0)
@@ -240,6 +241,8 @@ int tpa_init(int nr_worker)
 
 	offload_init();
 	sock_init();
+	steer_init();
+	offload_async_init();
 
 	pktfuzz_init();
 
@@ -88,6 +88,7 @@ void tpad_init(void)
 		close(flock_fd);
 
 		env[idx++] = make_env("TPAD_SOCK_FILE", tpa_cfg.sock_file);
+		env[idx++] = make_env("TPAD_SOCK_STATS_FILE", tpa_cfg.sock_stats_file);
 		env[idx++] = make_env("TPAD_SOCK_TRACE_FILE", tpa_cfg.sock_trace_file);
 		env[idx++] = make_env("TPAD_DEV_NAME", dev.name);
 		env[idx++] = make_env("TPAD_ARCHIVE_DIR", tpa_log_root_get());
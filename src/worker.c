@@ -7,10 +7,17 @@
 #define _GNU_SOURCE
 #endif
 #include <stdio.h>
+#include <errno.h>
+#include <string.h>
 #include <sched.h>
+#include <unistd.h>
 #include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 #include <rte_malloc.h>
+#include <rte_interrupts.h>
 
 #include "tpa.h"
 #include "worker.h"
@@ -27,6 +34,26 @@ static uint32_t next_worker;
 
 static const struct shell_cmd worker_cmd;
 
+/*
+ * The fds a worker sleeps on in tpa_worker_wait: the eventfd kicked by
+ * the other threads, the timerfd for the next timer, and the rx queue
+ * interrupts, all in the DPDK per thread epoll set.
+ */
+struct worker_wait {
+	int evfd;
+	int tfd;
+	uint64_t rx_intr_mask;		/* the ports with rx interrupt set up */
+
+	struct rte_epoll_event evfd_event;
+	struct rte_epoll_event tfd_event;
+};
+
+#define WORKER_SPIN_US_MIN		20
+#define WORKER_SPIN_US_MAX		1000
+
+/* not worth a sleep if the next deadline comes sooner than that */
+#define WORKER_SLEEP_US_MIN		(TIMER_TICK_US * 2)
+
 static int init_one_worker(struct tpa_worker *worker, uint8_t id)
 {
 	uint64_t now;
@@ -36,13 +63,17 @@ static int init_one_worker(struct tpa_worker *worker, uint8_t id)
 
 	worker->output      = flex_fifo_create(BATCH_SIZE * 2);
 	worker->delayed_ack = flex_fifo_create(BATCH_SIZE * 2);
+	worker->gro         = flex_fifo_create(BATCH_SIZE * 2);
 	worker->event_queue = flex_fifo_create(BATCH_SIZE * 2);
 	worker->accept      = flex_fifo_create(BATCH_SIZE * 2);
 	worker->neigh_flush_queue = flex_fifo_create(BATCH_SIZE * 2);
-	PANIC_ON(worker->output == NULL || worker->delayed_ack == NULL ||
+	PANIC_ON(worker->output == NULL || worker->delayed_ack == NULL || worker->gro == NULL ||
 		 worker->event_queue == NULL || worker->accept == NULL ||
 		 worker->neigh_flush_queue == NULL,
-		 "failed to create worker %d output/event/accept/neigh fifo", id);
+		 "failed to create worker %d output/gro/event/accept/neigh fifo", id);
+
+	if (pacing_queue_init(&worker->pacing_queue, BATCH_SIZE * 2) < 0)
+		return -1;
 
 	worker->tx_desc_pool = tx_desc_pool_create(TX_DESC_COUNT_PER_WORKER);
 	if (!worker->tx_desc_pool)
@@ -54,14 +85,24 @@ static int init_one_worker(struct tpa_worker *worker, uint8_t id)
 	worker->ts_us = TSC_TO_US(now);
 	timer_ctrl_init(&worker->timer_ctrl, worker->ts_us);
 
-	sock_table_init(&worker->sock_table);
+	if (sock_table_init(&worker->sock_table) < 0)
+		return -1;
+
+	if (rcu_reader_register(&worker->rcu) < 0)
+		return -1;
 
 	if (packet_pool_create(&worker->zwrite_pkt_pool, 25.0 / tpa_cfg.nr_worker,
 			       0, "zwrite-mbuf-mp-%d", worker->id) < 0)
 		return -1;
 
-	return packet_pool_create(&worker->hdr_pkt_pool, 12.5 / tpa_cfg.nr_worker,
-				  RTE_PKTMBUF_HEADROOM, "hdr-mbuf-mp-%d", worker->id);
+	if (packet_pool_create(&worker->hdr_pkt_pool, 12.5 / tpa_cfg.nr_worker,
+			       RTE_PKTMBUF_HEADROOM, "hdr-mbuf-mp-%d", worker->id) < 0)
+		return -1;
+
+	packet_cache_init(&worker->zwrite_pkt_cache, &worker->zwrite_pkt_pool);
+	packet_cache_init(&worker->hdr_pkt_cache, &worker->hdr_pkt_pool);
+
+	return 0;
 }
 
 int worker_init(uint32_t nr_worker)
@@ -104,6 +145,9 @@ static inline int tcp_input_process(struct tpa_worker *worker)
 	uint32_t nr_pkt = 0;
 	uint32_t i;
 
+	if (steer_ctrl.active)
+		steer_recv(worker);
+
 	for (i = 0; i < dev.nr_port; i++) {
 		dev_port_rxq_recv(i, worker->queue);
 		nr_pkt += tcp_input(worker, i);
@@ -123,11 +167,68 @@ static inline int tcp_output_process(struct tpa_worker *worker)
 		pktfuzz_run(dev_port_txq(i, worker->queue));
 	}
 
-	dev_txq_flush(worker->queue);
+	dev_txq_flush_by_mode(worker->queue, worker->ts_us);
 
 	return nr_tsock;
 }
 
+static int worker_epoll_add(int fd, struct rte_epoll_event *event)
+{
+	memset(event, 0, sizeof(*event));
+	event->epdata.event = EPOLLIN;
+
+	return rte_epoll_ctl(RTE_EPOLL_PER_THREAD, EPOLL_CTL_ADD, fd, event);
+}
+
+static void worker_wait_init(struct tpa_worker *worker)
+{
+	struct worker_wait *wait;
+	int i;
+
+	wait = rte_zmalloc(NULL, sizeof(*wait), 64);
+	if (!wait)
+		goto err;
+
+	wait->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	wait->tfd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (wait->evfd < 0 || wait->tfd < 0)
+		goto err;
+
+	if (worker_epoll_add(wait->evfd, &wait->evfd_event) < 0 ||
+	    worker_epoll_add(wait->tfd, &wait->tfd_event) < 0)
+		goto err;
+
+	for (i = 0; i < dev.nr_port; i++) {
+		if (!dev.ports[i].rx_intr)
+			continue;
+
+		if (rte_eth_dev_rx_intr_ctl_q(i, worker->queue, RTE_EPOLL_PER_THREAD,
+					      RTE_INTR_EVENT_ADD, NULL) < 0) {
+			LOG_WARN("worker %d: failed to set up rx interrupt for port %d",
+				 worker->id, i);
+			continue;
+		}
+
+		wait->rx_intr_mask |= 1ull << i;
+	}
+
+	worker->spin_us = WORKER_SPIN_US_MIN;
+	worker->wait = wait;
+
+	return;
+
+err:
+	LOG_ERR("worker %d: failed to init wait: %s; tpa_worker_wait falls back to polling",
+		worker->id, strerror(errno));
+	if (wait) {
+		if (wait->evfd >= 0)
+			close(wait->evfd);
+		if (wait->tfd >= 0)
+			close(wait->tfd);
+		rte_free(wait);
+	}
+}
+
 struct tpa_worker *tpa_worker_init(void)
 {
 	struct tpa_worker *worker;
@@ -155,6 +256,9 @@ struct tpa_worker *tpa_worker_init(void)
 	worker = &workers[id];
 	worker->tid = syscall(SYS_gettid);
 
+	/* the DPDK per thread epoll set has to be set up in the worker thread */
+	worker_wait_init(worker);
+
 	tls_worker = worker;
 
 	return worker;
@@ -162,16 +266,11 @@ struct tpa_worker *tpa_worker_init(void)
 
 static __rte_noinline void do_drop_ooo_mbufs(struct tpa_worker *worker)
 {
-	struct sock_entry_list *list;
 	struct sock_entry *entry;
-	int i;
-
-	for (i = 0; i < SOCK_TABLE_SIZE; i++) {
-		list = &worker->sock_table.lists[i];
+	uint32_t i;
 
-		TAILQ_FOREACH(entry, list, node) {
-			tsock_drop_ooo_mbufs(entry->tsock);
-		}
+	SOCK_TABLE_FOREACH(&worker->sock_table, i, entry) {
+		tsock_drop_ooo_mbufs(entry->tsock);
 	}
 }
 
@@ -186,18 +285,225 @@ void tpa_worker_run(struct tpa_worker *worker)
 	int busy = 0;
 
 	cycles_update_begin(worker);
+	rcu_quiescent(&worker->rcu);
 
 	busy += flush_neigh_queue(worker);
 
 	busy += timer_process(&worker->timer_ctrl, worker->ts_us);
 	busy += tcp_input_process(worker);
+	busy += tcp_gro_flush(worker);
 	busy += tcp_output_process(worker);
 
 	drop_ooo_mbufs(worker);
 
+	worker->busy = busy;
 	cycles_update_end(worker, busy);
 }
 
+void worker_wakeup(struct tpa_worker *worker)
+{
+	uint64_t val = 1;
+	ssize_t ret;
+
+	/* EAGAIN means it has been kicked already */
+	ret = write(worker->wait->evfd, &val, sizeof(val));
+	RTE_SET_USED(ret);
+}
+
+static int rxq_pending(struct tpa_worker *worker)
+{
+	struct dev_rxq *rxq;
+	int i;
+
+	for (i = 0; i < dev.nr_port; i++) {
+		rxq = dev_port_rxq(i, worker->queue);
+		if (rxq->write != rxq->read)
+			return 1;
+	}
+
+	return 0;
+}
+
+static int worker_has_pending_work(struct tpa_worker *worker)
+{
+	int i;
+
+	if (flex_fifo_count(worker->output) || flex_fifo_count(worker->delayed_ack) ||
+	    flex_fifo_count(worker->gro) || flex_fifo_count(worker->event_queue) ||
+	    flex_fifo_count(worker->accept) || flex_fifo_count(worker->neigh_flush_queue))
+		return 1;
+
+	for (i = 0; i < dev.nr_port; i++) {
+		if (dev_port_txq(i, worker->queue)->nr_pkt)
+			return 1;
+	}
+
+	return rxq_pending(worker) || steer_pending(worker);
+}
+
+/* the earliest time (in us) the worker has something to do */
+static uint64_t worker_next_deadline(struct tpa_worker *worker)
+{
+	uint64_t deadline = UINT64_MAX;
+
+	if (worker->timer_ctrl.next_run != UINT64_MAX)
+		deadline = worker->timer_ctrl.next_run * TIMER_TICK_US;
+
+	if (worker->pacing_queue.nr)
+		deadline = RTE_MIN(deadline, TSC_TO_US(worker->pacing_queue.heap[0]->tsc));
+
+	return deadline;
+}
+
+/*
+ * Arms the rx interrupts. Returns 1 if there are pkts already: the ones
+ * arrived before the interrupt is armed don't trigger it.
+ */
+static int rx_intr_enable(struct tpa_worker *worker)
+{
+	int i;
+
+	for (i = 0; i < dev.nr_port; i++) {
+		if (!(worker->wait->rx_intr_mask & (1ull << i)))
+			continue;
+
+		rte_eth_dev_rx_intr_enable(i, worker->queue);
+		dev_port_rxq_recv(i, worker->queue);
+	}
+
+	return rxq_pending(worker);
+}
+
+static void rx_intr_disable(struct tpa_worker *worker)
+{
+	int i;
+
+	for (i = 0; i < dev.nr_port; i++) {
+		if (worker->wait->rx_intr_mask & (1ull << i))
+			rte_eth_dev_rx_intr_disable(i, worker->queue);
+	}
+}
+
+/*
+ * Returns 1 if it's woken up by rx pkts or by other threads, 0 on
+ * timeout, and -1 if it doesn't sleep at all.
+ */
+static int worker_sleep(struct tpa_worker *worker, uint64_t sleep_us)
+{
+	struct rte_epoll_event events[MAX_PORT_NR + 2];
+	struct worker_wait *wait = worker->wait;
+	struct itimerspec its;
+	uint64_t val;
+	int nr_event;
+	int woken = -1;
+	int i;
+
+	__atomic_store_n(&worker->sleeping, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	/* the work queued by the others before they could see us sleeping */
+	if (flex_fifo_count(worker->output) || flex_fifo_count(worker->neigh_flush_queue) ||
+	    steer_pending(worker))
+		goto out;
+
+	if (rx_intr_enable(worker))
+		goto out_intr;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec  = sleep_us / 1000000;
+	its.it_value.tv_nsec = (sleep_us % 1000000) * 1000;
+	if (timerfd_settime(wait->tfd, 0, &its, NULL) < 0)
+		goto out_intr;
+
+	rcu_offline(&worker->rcu);
+	nr_event = rte_epoll_wait(RTE_EPOLL_PER_THREAD, events, RTE_DIM(events), -1);
+	rcu_quiescent(&worker->rcu);
+
+	woken = 0;
+	for (i = 0; i < nr_event; i++) {
+		if (events[i].fd == wait->tfd)
+			continue;
+
+		woken = 1;
+		if (events[i].fd == wait->evfd) {
+			if (read(wait->evfd, &val, sizeof(val)) == sizeof(val))
+				WORKER_STATS_INC(worker, WORKER_WAKEUP_KICK);
+		} else {
+			WORKER_STATS_INC(worker, WORKER_WAKEUP_RX);
+		}
+	}
+
+out_intr:
+	rx_intr_disable(worker);
+out:
+	__atomic_store_n(&worker->sleeping, 0, __ATOMIC_RELAXED);
+
+	return woken;
+}
+
+/*
+ * It spins (returns directly) for spin_us once the worker goes idle,
+ * and then sleeps till the next deadline. The spin time adapts: it's
+ * doubled when a sleep is interrupted sooner than that, as the sleep
+ * and wakeup cost is then paid for nothing; and halved otherwise.
+ */
+int tpa_worker_wait(struct tpa_worker *worker, uint32_t timeout_us)
+{
+	uint64_t deadline;
+	uint64_t slept;
+	uint64_t start;
+	uint64_t now;
+	int woken;
+	int i;
+
+	if (worker->busy || !worker->wait)
+		goto busy;
+
+	/* don't hold the pkts in the txq while sleeping */
+	for (i = 0; i < dev.nr_port; i++) {
+		if (dev_port_txq(i, worker->queue)->nr_pkt)
+			dev_port_txq_flush(i, worker->queue);
+	}
+
+	if (worker_has_pending_work(worker))
+		goto busy;
+
+	now = TSC_TO_US(rte_rdtsc());
+	if (worker->idle_since_us == 0)
+		worker->idle_since_us = now;
+	if (now - worker->idle_since_us < worker->spin_us)
+		return 0;
+
+	deadline = RTE_MIN(worker_next_deadline(worker), now + timeout_us);
+	if (deadline < now + WORKER_SLEEP_US_MIN)
+		return 0;
+
+	start = rte_rdtsc();
+	woken = worker_sleep(worker, deadline - now);
+	if (woken < 0)
+		goto busy;
+
+	now = rte_rdtsc();
+	slept = now - start;
+
+	/* the sleep is not starvation */
+	worker->cycles.sleep += slept;
+	worker->cycles.end = now;
+	WORKER_STATS_INC(worker, WORKER_SLEEP);
+
+	if (woken && TSC_TO_US(slept) < worker->spin_us)
+		worker->spin_us = RTE_MIN(worker->spin_us * 2, WORKER_SPIN_US_MAX);
+	else
+		worker->spin_us = RTE_MAX(worker->spin_us / 2, WORKER_SPIN_US_MIN);
+
+	worker->idle_since_us = 0;
+	return 1;
+
+busy:
+	worker->idle_since_us = 0;
+	return 0;
+}
+
 static void print_stats(struct shell_buf *reply, uint64_t *stats)
 {
 	int i;
@@ -210,6 +516,21 @@ static void print_stats(struct shell_buf *reply, uint64_t *stats)
 
 #define _US(cycles)                     ((double)(cycles) / (tpa_cfg.hz / 1e6))
 
+static void dump_packet_cache(struct shell_buf *reply, const char *name,
+			      struct packet_cache *cache)
+{
+	char buf[64];
+
+	tpa_snprintf(buf, sizeof(buf), "%s.nr_pkt", name);
+	shell_append_reply(reply, "\t%-32s: %u\n", buf, cache->nr_pkt);
+
+	tpa_snprintf(buf, sizeof(buf), "%s.hit", name);
+	shell_append_reply(reply, "\t%-32s: %lu\n", buf, cache->nr_hit);
+
+	tpa_snprintf(buf, sizeof(buf), "%s.miss", name);
+	shell_append_reply(reply, "\t%-32s: %lu\n", buf, cache->nr_miss);
+}
+
 static void dump_worker(struct tpa_worker *worker, struct shell_buf *reply, int reset_starvation)
 {
 	int i;
@@ -221,6 +542,7 @@ static void dump_worker(struct tpa_worker *worker, struct shell_buf *reply, int
 				  "\t%-32s: %lu\n"
 				  "\t%-32s: %lu\n"
 				  "\t%-32s: %lu\n"
+				  "\t%-32s: %lu\n"
 				  "\t%-32s: %.6fs ago\n"
 				  "\t%-32s: %.6fs ago\n"
 				  "\t%-32s: %.1fus\n"
@@ -232,11 +554,15 @@ static void dump_worker(struct tpa_worker *worker, struct shell_buf *reply, int
 				  "\t%-32s: %hu\n"
 				  "\t%-32s: %u\n"
 				  "\t%-32s: %u\n"
-				  "\t%-32s: %u\n",
+				  "\t%-32s: %u\n"
+				  "\t%-32s: %u\n"
+				  "\t%-32s: %.1fus\n"
+				  "\t%-32s: %.1fus\n",
 			   "tid", worker->tid,
 			   "cycles.busy", worker->cycles.busy,
 			   "cycles.outside_worker", worker->cycles.outside_worker,
 			   "cycles.total", worker->cycles.total,
+			   "cycles.sleep", worker->cycles.sleep,
 			   "last_run",  (double)TSC_TO_US(TS_DIFF(rte_rdtsc(), worker->cycles.end)) / 1e6,
 			   "last_poll", (double)TSC_TO_US(TS_DIFF(rte_rdtsc(), worker->cycles.start)) / 1e6,
 			   "avg_runtime", _US(vstats_avg(&worker->runtime)),
@@ -248,13 +574,35 @@ static void dump_worker(struct tpa_worker *worker, struct shell_buf *reply, int
 			   "dev_txq.size", TXQ_BUF_SIZE,
 			   "nr_ooo_mbuf", worker->nr_ooo_mbuf,
 			   "nr_in_process_mbuf", worker->nr_in_process_mbuf,
-			   "nr_write_mbuf", worker->nr_write_mbuf);
+			   "nr_write_mbuf", worker->nr_write_mbuf,
+			   "pacing.nr_tsock", worker->pacing_queue.nr,
+			   "pacing.avg_lag", _US(vstats_avg(&worker->pacing_lag)),
+			   "pacing.max_lag", _US(worker->pacing_lag.max));
+
+	shell_append_reply(reply, "\t%-32s: %u\n"
+				  "\t%-32s: %s\n",
+			   "gro.nr_tsock", flex_fifo_count(worker->gro),
+			   "rx_merge_size", hist_fmt(&worker->rx_merge_size, buf, sizeof(buf)));
+
+	shell_append_reply(reply, "\t%-32s: %uus\n", "wait.spin_us", worker->spin_us);
+
+	dump_packet_cache(reply, "hdr_pkt_cache", &worker->hdr_pkt_cache);
+	dump_packet_cache(reply, "zwrite_pkt_cache", &worker->zwrite_pkt_cache);
 
 	for (i = 0; i < dev.nr_port; i++) {
 		tpa_snprintf(buf, sizeof(buf), "dev_txq[%d].nr_pkt", i);
 		shell_append_reply(reply, "\t%-32s: %hu\n", buf, dev_port_txq(i, worker->queue)->nr_pkt);
 	}
 
+	for (i = 0; i < dev.nr_port; i++) {
+		char hist_buf[256];
+
+		tpa_snprintf(buf, sizeof(buf), "dev_txq[%d].burst_size", i);
+		shell_append_reply(reply, "\t%-32s: %s\n", buf,
+				   hist_fmt(&dev_port_txq(i, worker->queue)->burst_size,
+					    hist_buf, sizeof(hist_buf)));
+	}
+
 	for (i = 0; i < dev.nr_port; i++) {
 		tpa_snprintf(buf, sizeof(buf), "dev_rxq[%d].nr_pkt", i);
 		shell_append_reply(reply, "\t%-32s: %u\n", buf,
@@ -102,38 +102,67 @@ static void test_arp_evict_basic(void)
 	}
 }
 
-static void test_arp_evict_full(void)
+#define NR_NEIGH_MANY		2048
+
+/* there is no cap: nothing is evicted */
+static void test_arp_many(void)
 {
 	struct packet *pkt;
 	struct neigh_entry *entry;
 	uint8_t mac[6] = { 0, };
-	uint32_t ip;
+	uint32_t ips[NR_NEIGH_MANY];
+	int len = get_neigh_cache_len();
+	int i;
 
 	printf("testing %s\n", __func__);
 
 	mac[0] = 0x2;
-	while (get_neigh_cache_len() != MAX_NEIGH_ENTRY) {
-		ip = rand();
-		pkt = make_arp_rsp_pkt(ip, mac);
-		ut_arp_input(pkt); {
-			entry = neigh_find_ip4(ip);
-			assert(entry != NULL);
-			assert(memcmp(mac, entry->mac.addr_bytes, sizeof(mac)) == 0);
-		}
+	for (i = 0; i < NR_NEIGH_MANY; i++) {
+		do {
+			ips[i] = rand();
+		} while (neigh_find_ip4(ips[i]));
+
+		pkt = make_arp_rsp_pkt(ips[i], mac);
+		ut_arp_input(pkt);
 	}
-	assert(get_neigh_cache_len() == MAX_NEIGH_ENTRY);
+	assert(get_neigh_cache_len() == len + NR_NEIGH_MANY);
 
-	mac[0] = 0x4;
-	do {
-		ip = rand();
-	} while (neigh_find_ip4(ip));
-	pkt = make_arp_rsp_pkt(ip, mac);
-	ut_arp_input(pkt); {
-		entry = neigh_find_ip4(ip);
+	for (i = 0; i < NR_NEIGH_MANY; i++) {
+		entry = neigh_find_ip4(ips[i]);
 		assert(entry != NULL);
 		assert(memcmp(mac, entry->mac.addr_bytes, sizeof(mac)) == 0);
-		/* evict an old one, keep the maximum size */
-		assert(get_neigh_cache_len() == MAX_NEIGH_ENTRY);
+	}
+}
+
+static void test_arp_worker_cache(void)
+{
+	struct rte_ether_hdr eth;
+	struct packet *pkt;
+	struct tpa_ip ip;
+	uint8_t mac[6] = { 0x2, 1, 2, 3, 4, 5 };
+	uint64_t nr_hit;
+
+	printf("testing %s\n", __func__);
+
+	pkt = make_arp_rsp_pkt(SERVER_IP, mac);
+	ut_arp_input(pkt);
+
+	tpa_ip_set_ipv4(&ip, SERVER_IP);
+	assert(eth_lookup(worker, &ip, &eth) == 0);
+
+	nr_hit = worker->neigh_wcache->nr_hit;
+	assert(eth_lookup(worker, &ip, &eth) == 0); {
+		assert(worker->neigh_wcache->nr_hit == nr_hit + 1);
+		assert(memcmp(mac, ETH_DST_ADDR(&eth), sizeof(mac)) == 0);
+	}
+
+	/* a mac change invalidates the cache */
+	mac[5] = 6;
+	pkt = make_arp_rsp_pkt(SERVER_IP, mac);
+	ut_arp_input(pkt);
+	assert(eth_lookup(worker, &ip, &eth) == 0); {
+		assert(worker->neigh_wcache->nr_hit == nr_hit + 1);
+		assert(memcmp(mac, ETH_DST_ADDR(&eth), sizeof(mac)) == 0);
 	}
 }
 
@@ -201,7 +230,7 @@ static void test_timeout_try_update_eth_hdr(void)
 
 	assert(ut_tcp_output(NULL, -1) == 1); {
 		assert(memcmp(&eth_hdr, &tsock->net_hdr.eth, sizeof(eth_hdr)) == 0);
-		assert(tsock->stats_base[WARN_NEIGH_CHANGED] == 1);
+		assert(tsock->stats->stats_base[WARN_NEIGH_CHANGED] == 1);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -257,7 +286,8 @@ int main(int argc, char *argv[])
 
 	test_arp_missing_basic();
 	test_arp_evict_basic();
-	test_arp_evict_full();
+	test_arp_many();
+	test_arp_worker_cache();
 	test_gw_arp_missing();
 	test_zero_mac_update();
 	test_timeout_try_update_eth_hdr();
@@ -0,0 +1,195 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_utils.h"
+#include "csum.h"
+
+#define BUF_SIZE		(70 * 1024)
+
+static uint8_t src[BUF_SIZE];
+static uint8_t dst[BUF_SIZE];
+
+/* every kernel the cpu supports should agree with rte_raw_cksum */
+static void test_csum_kernels(void)
+{
+	const struct csum_ops *ops;
+	uint32_t off;
+	uint32_t len;
+	uint16_t sum;
+	int i;
+	int j;
+
+	printf("testing %s ...\n", __func__);
+
+	for (i = 0; i < BUF_SIZE; i++)
+		src[i] = rand();
+
+	for (i = 0; i < csum_ops_count; i++) {
+		ops = csum_ops_list[i];
+		if (!ops->supported())
+			continue;
+
+		for (j = 0; j < 10000; j++) {
+			off = rand() % 64;
+			len = rand() % (j < 100 ? 64 * 1024 : 2048);
+			sum = rte_raw_cksum(src + off, len);
+
+			assert(ops->sum(src + off, len) == sum);
+
+			memset(dst, 0, len + 64);
+			assert(ops->copy_sum(dst + 1, src + off, len) == sum); {
+				assert(memcmp(dst + 1, src + off, len) == 0);
+				assert(dst[len + 1] == 0);
+			}
+		}
+
+		/* all ones, to make sure the lanes don't overflow */
+		memset(dst, 0xff, BUF_SIZE);
+		assert(ops->sum(dst, BUF_SIZE) == rte_raw_cksum(dst, BUF_SIZE));
+	}
+}
+
+static struct packet *make_chain(int nr_seg, uint16_t *seg_len)
+{
+	struct packet *head = NULL;
+	struct packet *pkt;
+	uint32_t off = 0;
+	int i;
+
+	for (i = 0; i < nr_seg; i++) {
+		pkt = packet_alloc(generic_pkt_pool);
+		assert(pkt != NULL);
+
+		memcpy(rte_pktmbuf_mtod(&pkt->mbuf, void *), src + off, seg_len[i]);
+		pkt->mbuf.data_len = seg_len[i];
+		pkt->mbuf.pkt_len  = seg_len[i];
+		off += seg_len[i];
+
+		if (head)
+			assert(rte_pktmbuf_chain(&head->mbuf, &pkt->mbuf) == 0);
+		else
+			head = pkt;
+	}
+
+	return head;
+}
+
+/* odd seg lens, to make sure the byte swap is right */
+static void test_csum_raw_mbuf(void)
+{
+	uint16_t seg_len[] = { 1, 333, 1448, 7, 1000, 2 };
+	uint32_t total = 0;
+	struct packet *pkt;
+	uint32_t off;
+	uint32_t len;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	for (i = 0; i < RTE_DIM(seg_len); i++)
+		total += seg_len[i];
+
+	pkt = make_chain(RTE_DIM(seg_len), seg_len);
+	for (i = 0; i < 1000; i++) {
+		off = rand() % total;
+		len = rand() % (total - off + 1);
+
+		assert(csum_raw_mbuf(&pkt->mbuf, off, len) == rte_raw_cksum(src + off, len));
+	}
+
+	packet_free(pkt);
+}
+
+static void set_csum(struct packet *pkt)
+{
+	struct rte_mbuf *m = &pkt->mbuf;
+	uint16_t cksum;
+
+	if (ut_test_opts.with_ipv6) {
+		struct rte_ipv6_hdr *ip = rte_pktmbuf_mtod_offset(m, struct rte_ipv6_hdr *, 14);
+		struct rte_tcp_hdr *tcp = (struct rte_tcp_hdr *)(ip + 1);
+
+		tcp->cksum = 0;
+		cksum = rte_ipv6_udptcp_cksum(ip, tcp);
+		tcp->cksum = csum_ipv6_tcp(ip, tcp);
+		assert(tcp->cksum == cksum);
+	} else {
+		struct rte_ipv4_hdr *ip = rte_pktmbuf_mtod_offset(m, struct rte_ipv4_hdr *, 14);
+		struct rte_tcp_hdr *tcp = (struct rte_tcp_hdr *)(ip + 1);
+
+		ip->hdr_checksum = 0;
+		ip->hdr_checksum = rte_ipv4_cksum(ip);
+
+		tcp->cksum = 0;
+		cksum = rte_ipv4_udptcp_cksum(ip, tcp);
+		tcp->cksum = csum_ipv4_tcp(ip, tcp);
+		assert(tcp->cksum == cksum);
+	}
+
+	m->ol_flags &= ~(PKT_RX_IP_CKSUM_GOOD | PKT_RX_L4_CKSUM_GOOD);
+}
+
+/* moves the last @len bytes to a new pkt */
+static void split_tail(struct packet *pkt, uint16_t len)
+{
+	struct packet *tail;
+
+	tail = packet_alloc(generic_pkt_pool);
+	assert(tail != NULL);
+
+	memcpy(rte_pktmbuf_mtod(&tail->mbuf, void *),
+	       rte_pktmbuf_mtod_offset(&pkt->mbuf, void *, pkt->mbuf.data_len - len), len);
+	tail->mbuf.data_len = len;
+	tail->mbuf.pkt_len  = len;
+
+	pkt->mbuf.data_len -= len;
+	pkt->mbuf.pkt_len  -= len;
+	assert(rte_pktmbuf_chain(&pkt->mbuf, &tail->mbuf) == 0);
+}
+
+/* the rx csum verification, with the pkt in a chain or not */
+static void test_csum_verify(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint8_t *payload;
+	int chain;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	for (chain = 0; chain <= 1; chain++) {
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
+		set_csum(pkt);
+		if (chain)
+			split_tail(pkt, 333);
+
+		assert(parse_tcp_packet(pkt) == 0);
+
+		/* and a corrupted one */
+		payload = rte_pktmbuf_mtod_offset(&pkt->mbuf, uint8_t *, pkt->hdr_len);
+		payload[0] ^= 0x1;
+		assert(parse_tcp_packet(pkt) == -ERR_BAD_CSUM_TCP);
+
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_csum_kernels();
+	test_csum_raw_mbuf();
+	test_csum_verify();
+
+	return 0;
+}
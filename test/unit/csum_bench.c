@@ -0,0 +1,80 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_utils.h"
+#include "csum.h"
+
+#define BUF_SIZE		(64 * 1024)
+#define BENCH_BYTES		(256ull << 20)
+
+static uint8_t src[BUF_SIZE];
+static uint8_t dst[BUF_SIZE];
+
+/* to keep the sums from being optimized out */
+static volatile uint16_t sink;
+
+static double bench_sum(const struct csum_ops *ops, uint32_t len)
+{
+	uint64_t nr = BENCH_BYTES / len;
+	uint64_t start;
+	uint64_t i;
+
+	start = rte_rdtsc();
+	for (i = 0; i < nr; i++)
+		sink = ops->sum(src, len);
+
+	return (double)(rte_rdtsc() - start) / (nr * len);
+}
+
+static double bench_copy_sum(const struct csum_ops *ops, uint32_t len)
+{
+	uint64_t nr = BENCH_BYTES / len;
+	uint64_t start;
+	uint64_t i;
+
+	start = rte_rdtsc();
+	for (i = 0; i < nr; i++)
+		sink = ops->copy_sum(dst, src, len);
+
+	return (double)(rte_rdtsc() - start) / (nr * len);
+}
+
+/* in cycles per byte */
+static void test_csum_bench(void)
+{
+	uint32_t sizes[] = { 64, 1460, 9000, 64 * 1024 };
+	const struct csum_ops *ops;
+	int i;
+	int j;
+
+	printf("testing %s ...\n", __func__);
+
+	for (i = 0; i < BUF_SIZE; i++)
+		src[i] = rand();
+
+	for (i = 0; i < csum_ops_count; i++) {
+		ops = csum_ops_list[i];
+		if (!ops->supported())
+			continue;
+
+		for (j = 0; j < RTE_DIM(sizes); j++) {
+			printf("\t%-8s %6u bytes: sum %.3f, copy_sum %.3f cycles/byte\n",
+			       ops->name, sizes[j], bench_sum(ops, sizes[j]),
+			       bench_copy_sum(ops, sizes[j]));
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_csum_bench();
+
+	return 0;
+}
@@ -28,9 +28,152 @@ static void test_parse_bonding_proc_file(void)
 	dev.nr_port = 1;
 }
 
+/* the pkts come out in order when the dev txq ring wraps */
+static void test_dev_txq_ring_wrap(void)
+{
+	struct dev_txq *txq = dev_port_txq(0, worker->queue);
+	struct packet *pkts[8];
+	struct tcp_sock *tsock;
+	uint16_t nr_pkt;
+	uint32_t seq;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	seq = tsock->snd_nxt;
+
+	txq->head = TXQ_BUF_SIZE - 3;
+	for (i = 0; i < 8; i++)
+		ut_write_assert(tsock, tsock->snd_mss);
+	tsock->snd_cwnd = 8 * tsock->snd_mss;
+
+	nr_pkt = ut_tcp_output(pkts, 8); {
+		assert(nr_pkt >= 1 && nr_pkt <= 8);
+		assert(txq->nr_pkt == 0);
+		assert((txq->head & TXQ_BUF_MASK) == ((TXQ_BUF_SIZE - 3 + nr_pkt) & TXQ_BUF_MASK));
+
+		for (i = 0; i < nr_pkt; i++) {
+			assert(TCP_SEG(pkts[i])->seq == seq);
+			seq += pkts[i]->mbuf.pkt_len - pkts[i]->hdr_len;
+			packet_free(pkts[i]);
+		}
+		assert(seq == tsock->snd_nxt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* a burst never goes across the ring end */
+static void test_dev_txq_burst_count(void)
+{
+	struct dev_txq txq;
+
+	printf("testing %s ...\n", __func__);
+
+	memset(&txq, 0, sizeof(txq));
+
+	txq.nr_pkt = 8;
+	assert(dev_txq_burst_count(&txq) == 8);
+
+	txq.nr_pkt = BATCH_SIZE + 1;
+	assert(dev_txq_burst_count(&txq) == BATCH_SIZE);
+
+	/* clamped at the ring end */
+	txq.head = TXQ_BUF_SIZE - 3;
+	txq.nr_pkt = 8;
+	assert(dev_txq_burst_count(&txq) == 3);
+
+	/* and the rest goes with the next burst, from the ring start */
+	txq.head += 3;
+	txq.nr_pkt -= 3;
+	assert((txq.head & TXQ_BUF_MASK) == 0);
+	assert(dev_txq_burst_count(&txq) == 5);
+
+	/* the head keeps counting up across the uint16_t wrap */
+	txq.head = UINT16_MAX;
+	txq.nr_pkt = 8;
+	assert(dev_txq_burst_count(&txq) == 1);
+}
+
+static void test_dev_txq_flush_latency(void)
+{
+	int mode = dev.tx_flush_mode;
+	struct packet pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	/* the defaults survive net_dev_init_early */
+	assert(dev.tx_flush_mode == DEV_TXQ_FLUSH_DEFAULT);
+	assert(dev.tx_flush_timeout == DEV_TXQ_FLUSH_TIMEOUT_DEFAULT);
+
+	memset(&pkt, 0, sizeof(pkt));
+
+	dev.tx_flush_mode = DEV_TXQ_FLUSH_LATENCY;
+	pkt.mbuf.pkt_len = 66;
+	assert(dev_txq_flush_now(&pkt) == 1);
+	pkt.mbuf.pkt_len = DEV_TXQ_SMALL_PKT_LEN;
+	assert(dev_txq_flush_now(&pkt) == 1);
+	pkt.mbuf.pkt_len = DEV_TXQ_SMALL_PKT_LEN + 1;
+	assert(dev_txq_flush_now(&pkt) == 0);
+
+	/* small pkts wait for the loop end in the other modes */
+	pkt.mbuf.pkt_len = 66;
+	dev.tx_flush_mode = DEV_TXQ_FLUSH_DEFAULT;
+	assert(dev_txq_flush_now(&pkt) == 0);
+	dev.tx_flush_mode = DEV_TXQ_FLUSH_THROUGHPUT;
+	assert(dev_txq_flush_now(&pkt) == 0);
+
+	dev.tx_flush_mode = mode;
+}
+
+static void test_dev_txq_flush_throughput(void)
+{
+	uint32_t timeout = dev.tx_flush_timeout;
+	int mode = dev.tx_flush_mode;
+	struct dev_txq txq;
+	uint64_t now = 1000;
+
+	printf("testing %s ...\n", __func__);
+
+	memset(&txq, 0, sizeof(txq));
+	txq.nr_pkt = 1;
+
+	/* the default and latency modes flush at each loop end */
+	dev.tx_flush_mode = DEV_TXQ_FLUSH_DEFAULT;
+	assert(dev_txq_flush_due(&txq, now) == 1);
+	dev.tx_flush_mode = DEV_TXQ_FLUSH_LATENCY;
+	assert(dev_txq_flush_due(&txq, now) == 1);
+	assert(txq.holding == 0);
+
+	/* the throughput mode holds a partial batch till the timeout */
+	dev.tx_flush_mode = DEV_TXQ_FLUSH_THROUGHPUT;
+	dev.tx_flush_timeout = 20;
+	assert(dev_txq_flush_due(&txq, now) == 0); {
+		assert(txq.holding == 1);
+		assert(txq.hold_ts_us == now);
+	}
+	assert(dev_txq_flush_due(&txq, now + 19) == 0);
+	assert(txq.hold_ts_us == now);
+	assert(dev_txq_flush_due(&txq, now + 20) == 1);
+
+	/* a full batch goes right away */
+	memset(&txq, 0, sizeof(txq));
+	txq.nr_pkt = BATCH_SIZE;
+	assert(dev_txq_flush_due(&txq, now) == 1);
+	assert(txq.holding == 0);
+
+	dev.tx_flush_timeout = timeout;
+	dev.tx_flush_mode = mode;
+}
+
 int main(int argc, char **argv)
 {
 	ut_init(argc, argv);
 
 	test_parse_bonding_proc_file();
+	test_dev_txq_ring_wrap();
+	test_dev_txq_burst_count();
+	test_dev_txq_flush_latency();
+	test_dev_txq_flush_throughput();
 }
\ No newline at end of file
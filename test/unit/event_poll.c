@@ -115,7 +115,7 @@ static void test_tcp_event_poll_first_write_egain(void)
 	ut_event_ctrl(tsock, TPA_EVENT_CTRL_ADD, TPA_EVENT_IN | TPA_EVENT_OUT);
 
 	/* exhausts mbufs */
-	while (packet_alloc(&worker->zwrite_pkt_pool))
+	while (packet_cache_alloc(&worker->zwrite_pkt_cache))
 		;
 	while (packet_alloc(generic_pkt_pool))
 		;
@@ -0,0 +1,179 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_utils.h"
+
+#define NR_BENCH_BLOCK		512
+
+static struct port_block blocks[NR_BENCH_BLOCK];
+
+static void block_init(struct port_block *block, uint16_t start)
+{
+	memset(block, 0, sizeof(*block));
+
+	block->start = start;
+	block->size  = 64;
+	block->end   = start + block->size - 1;
+	block->port_mask = ~(block->size - 1);
+	block->worker = worker;
+	offload_list_init(&block->offload_list);
+}
+
+static void wait_for(volatile uint64_t *counter, uint64_t val)
+{
+	uint64_t start = TSC_TO_US(rte_rdtsc());
+
+	while (__atomic_load_n(counter, __ATOMIC_ACQUIRE) < val)
+		assert(TSC_TO_US(rte_rdtsc()) - start < 5 * 1000 * 1000);
+}
+
+static void test_offload_async_apply(void)
+{
+	struct port_block *block = &blocks[0];
+	uint64_t nr_create = flow_mock.nr_create;
+	uint64_t nr_apply = offload_stats.nr_apply;
+	uint64_t nr_release = offload_stats.nr_release;
+
+	printf("testing %s ...\n", __func__);
+
+	block_init(block, 50000);
+	assert(port_block_offload_create(block) == 0); {
+		assert(block->offload_list.group != NULL);
+		wait_for(&offload_stats.nr_apply, nr_apply + 1);
+		assert(flow_mock.nr_create > nr_create);
+	}
+
+	port_block_offload_destroy(block); {
+		assert(block->offload_list.group == NULL);
+		assert(offload_stats.nr_release == nr_release + 1);
+		wait_for(&offload_stats.nr_cached, 1);
+	}
+}
+
+/* the released rule is parked, and taken back with no NIC access */
+static void test_offload_async_cache(void)
+{
+	struct port_block *block = &blocks[0];
+	uint64_t nr_cache_hit = offload_stats.nr_cache_hit;
+	uint64_t nr_cached = offload_stats.nr_cached;
+	uint64_t nr_apply = offload_stats.nr_apply;
+	uint64_t nr_create;
+
+	printf("testing %s ...\n", __func__);
+
+	block_init(block, 50064);
+	assert(port_block_offload_create(block) == 0);
+	wait_for(&offload_stats.nr_apply, nr_apply + 1);
+
+	port_block_offload_destroy(block);
+	wait_for(&offload_stats.nr_cached, nr_cached + 1);
+
+	nr_create = flow_mock.nr_create;
+	block_init(block, 50064);
+	assert(port_block_offload_create(block) == 0); {
+		assert(offload_stats.nr_cache_hit == nr_cache_hit + 1);
+		assert(flow_mock.nr_create == nr_create);
+	}
+
+	port_block_offload_destroy(block);
+}
+
+static void test_offload_async_apply_failure(void)
+{
+	struct port_block *block = &blocks[0];
+	uint64_t nr_failure = offload_stats.nr_apply_failure;
+	uint64_t nr_flow = flow_mock.nr_flow;
+
+	printf("testing %s ...\n", __func__);
+
+	flow_mock.fail = 1;
+	block_init(block, 50128);
+	assert(port_block_offload_create(block) == 0);
+	wait_for(&offload_stats.nr_apply_failure, nr_failure + 1); {
+		assert(flow_mock.nr_flow == nr_flow);
+	}
+	flow_mock.fail = 0;
+
+	port_block_offload_destroy(block);
+}
+
+/* a failed group is retried by the ctrl thread later */
+static void test_offload_async_apply_retry(void)
+{
+	struct port_block *block = &blocks[0];
+	uint64_t nr_failure = offload_stats.nr_apply_failure;
+	uint64_t nr_retry = offload_stats.nr_apply_retry;
+	uint64_t nr_apply = offload_stats.nr_apply;
+	uint64_t nr_flow = flow_mock.nr_flow;
+
+	printf("testing %s ...\n", __func__);
+
+	flow_mock.fail = 1;
+	block_init(block, 50192);
+	assert(port_block_offload_create(block) == 0);
+	wait_for(&offload_stats.nr_apply_failure, nr_failure + 1);
+	flow_mock.fail = 0;
+
+	wait_for(&offload_stats.nr_apply, nr_apply + 1); {
+		assert(offload_stats.nr_apply_retry > nr_retry);
+		assert(flow_mock.nr_flow > nr_flow);
+	}
+
+	port_block_offload_destroy(block);
+}
+
+/*
+ * With a cost of 20us per rule, the connect path (the submit) should
+ * be barely affected, while the rules are applied in the background.
+ */
+static void test_offload_async_bench(void)
+{
+	uint64_t nr_apply = offload_stats.nr_apply;
+	uint64_t start;
+	uint64_t submit_us;
+	uint64_t apply_us;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	flow_mock.delay_us = 20;
+
+	start = TSC_TO_US(rte_rdtsc());
+	for (i = 0; i < NR_BENCH_BLOCK; i++) {
+		block_init(&blocks[i], 1024 + i * 64);
+		assert(port_block_offload_create(&blocks[i]) == 0);
+	}
+	submit_us = TSC_TO_US(rte_rdtsc()) - start;
+
+	wait_for(&offload_stats.nr_apply, nr_apply + NR_BENCH_BLOCK);
+	apply_us = TSC_TO_US(rte_rdtsc()) - start;
+
+	printf("\tsubmit: %.3f Krules/s\n", (double)NR_BENCH_BLOCK * 1000 / RTE_MAX(submit_us, 1));
+	printf("\tapply : %.3f Krules/s (%lu batches)\n",
+	       (double)NR_BENCH_BLOCK * 1000 / apply_us, offload_stats.nr_batch);
+
+	for (i = 0; i < NR_BENCH_BLOCK; i++)
+		port_block_offload_destroy(&blocks[i]);
+
+	flow_mock.delay_us = 0;
+}
+
+int main(int argc, char *argv[])
+{
+	setenv("TPA_CFG", "offload { async = 1; flow_mock = 1; }", 1);
+
+	ut_init(argc, argv);
+
+	test_offload_async_apply();
+	test_offload_async_cache();
+	test_offload_async_apply_failure();
+	test_offload_async_apply_retry();
+	test_offload_async_bench();
+
+	return 0;
+}
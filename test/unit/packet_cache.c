@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "test_utils.h"
+
+/* the free mbufs, in the mempool and in the cache */
+static uint32_t nr_free_mbuf(struct packet_cache *cache)
+{
+	return rte_mempool_avail_count(cache->mempool) + cache->nr_pkt;
+}
+
+static void test_packet_cache_hit_miss(void)
+{
+	struct packet_cache *cache = &worker->hdr_pkt_cache;
+	struct packet *pkts[PACKET_CACHE_SIZE + 1];
+	uint32_t nr_free = nr_free_mbuf(cache);
+	uint64_t nr_hit = cache->nr_hit;
+	uint32_t nr_pkt = cache->nr_pkt;
+	uint32_t i;
+
+	printf("testing %s ...\n", __func__);
+
+	for (i = 0; i < nr_pkt; i++)
+		pkts[i] = packet_cache_alloc(cache);
+	assert(cache->nr_pkt == 0);
+	assert(cache->nr_hit == nr_hit + nr_pkt);
+
+	pkts[i++] = packet_cache_alloc(cache); {
+		assert(pkts[i - 1] != NULL);
+		assert(cache->nr_miss > 0);
+		assert(cache->nr_pkt == PACKET_CACHE_BATCH - 1);
+	}
+
+	tx_packet_free_batch(worker, pkts, i);
+	assert(cache->nr_pkt <= PACKET_CACHE_SIZE);
+	assert(nr_free_mbuf(cache) == nr_free);
+}
+
+/* the free goes to the cache the mbuf belongs to, seg by seg */
+static void test_packet_cache_chain_free(void)
+{
+	struct packet_cache *hdr_cache = &worker->hdr_pkt_cache;
+	struct packet_cache *zwrite_cache = &worker->zwrite_pkt_cache;
+	uint32_t nr_hdr_free = nr_free_mbuf(hdr_cache);
+	uint32_t nr_zwrite_free = nr_free_mbuf(zwrite_cache);
+	struct packet *hdr;
+	struct packet *pkt;
+	struct packet *tail;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	hdr = packet_cache_alloc(hdr_cache);
+	tail = hdr;
+	for (i = 0; i < 3; i++) {
+		pkt = packet_cache_alloc(zwrite_cache);
+		tail->mbuf.next = &pkt->mbuf;
+		tail = pkt;
+		hdr->mbuf.nb_segs += 1;
+	}
+
+	/* the cache is not full here, as it's just allocated from */
+	tx_packet_free(worker, hdr); {
+		assert(nr_free_mbuf(hdr_cache) == nr_hdr_free);
+		assert(nr_free_mbuf(zwrite_cache) == nr_zwrite_free);
+	}
+
+	/* the one reset at alloc */
+	pkt = packet_cache_alloc(zwrite_cache); {
+		assert(pkt->mbuf.next == NULL);
+		assert(pkt->mbuf.nb_segs == 1);
+		assert(pkt->flags == 0);
+		tx_packet_free(worker, pkt);
+	}
+}
+
+static void test_packet_cache_refcnt(void)
+{
+	struct packet_cache *cache = &worker->hdr_pkt_cache;
+	uint32_t nr_free = nr_free_mbuf(cache);
+	struct packet *pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	pkt = packet_cache_alloc(cache);
+	rte_mbuf_refcnt_update(&pkt->mbuf, 1);
+
+	tx_packet_free(worker, pkt); {
+		assert(nr_free_mbuf(cache) == nr_free - 1);
+	}
+
+	tx_packet_free(worker, pkt); {
+		assert(nr_free_mbuf(cache) == nr_free);
+	}
+}
+
+static void test_packet_cache_bulk(void)
+{
+	struct packet_cache *cache = &worker->zwrite_pkt_cache;
+	struct packet *pkts[PACKET_CACHE_SIZE];
+	uint32_t nr_free = nr_free_mbuf(cache);
+	int nr_pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	for (nr_pkt = 1; nr_pkt <= PACKET_CACHE_SIZE; nr_pkt *= 2) {
+		assert(packet_cache_alloc_bulk(cache, pkts, nr_pkt) == 0);
+		assert(nr_free_mbuf(cache) == nr_free - nr_pkt);
+
+		tx_packet_free_batch(worker, pkts, nr_pkt);
+		assert(nr_free_mbuf(cache) == nr_free);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_packet_cache_hit_miss();
+	test_packet_cache_chain_free();
+	test_packet_cache_refcnt();
+	test_packet_cache_bulk();
+
+	return 0;
+}
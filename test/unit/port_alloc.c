@@ -16,17 +16,16 @@ static struct tcp_sock dummy_tsock;
 
 static void dump_bind_list_distribution(void)
 {
-	struct sock_entry *entry;
-	uint64_t n;
-	int i;
+	struct sock_table *table = &worker->sock_table;
+	struct sock_bucket *bucket;
+	uint32_t i;
+	int n;
 
-	for (i = 0; i < SOCK_TABLE_SIZE; i++) {
-		n = 0;
-		TAILQ_FOREACH(entry, &worker->sock_table.lists[i], node) {
-			n += 1;
-		}
+	for (i = 0; i < table->nr_bucket; i++) {
+		bucket = &table->buckets[i];
+		n = SOCK_BUCKET_SIZE - __builtin_popcount(sock_bucket_match(bucket, 0));
 
-		fprintf(stderr, "%d %lu\n", i, n);
+		fprintf(stderr, "%u %d %u\n", i, n, bucket->nr_overflow);
 	}
 }
 
@@ -62,7 +61,7 @@ static int reserve_port(uint16_t port)
 /* this should run first to make sure no port block is allocated */
 static void test_port_alloc_all_fail(void)
 {
-	uint16_t *fds = malloc(sizeof(int) * (1<<16));
+	int *fds = malloc(sizeof(int) * (1<<16));
 	struct sock_key key;
 	int nr_fd = 0;
 	int fd;
@@ -92,6 +91,45 @@ static void test_port_alloc_all_fail(void)
 
 	for (i = 0; i < nr_fd; i++)
 		close(fds[i]);
+	free(fds);
+
+	assert_port_block_refcnt();
+}
+
+/*
+ * Every port of a block is kernel bound: a kernel bind on the last
+ * port of each block fails them all, just like one on the first port.
+ * This should also run with no port block.
+ */
+static void test_port_alloc_kernel_bind(void)
+{
+	int *fds = malloc(sizeof(int) * (1<<16));
+	uint16_t min;
+	struct sock_key key;
+	int nr_fd = 0;
+	int fd;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	min = (ut_port_min + DEFAULT_PORT_BLOCK_MASK) & ~DEFAULT_PORT_BLOCK_MASK;
+	for (i = min + DEFAULT_PORT_BLOCK_MASK; i < ut_port_max; i += DEFAULT_PORT_BLOCK_SIZE) {
+		fd = reserve_port(i);
+		if (fd < 0) {
+			printf("it seems port %hu is already taken?\n", i);
+			continue;
+		}
+
+		fds[nr_fd++] = fd;
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.remote_ip = default_remote_ip;
+	assert(port_bind(worker, &key, &dummy_tsock) == 0);
+
+	for (i = 0; i < nr_fd; i++)
+		close(fds[i]);
+	free(fds);
 
 	assert_port_block_refcnt();
 }
@@ -319,6 +357,60 @@ static void test_port_alloc_stress(void)
 	assert_port_block_refcnt();
 }
 
+#define NR_BENCH_PORT		(1024 * 7)
+#define NR_BENCH_REMOTE		64
+
+static double bench_bind(int nr_remote)
+{
+	uint16_t *ports = malloc(sizeof(uint16_t) * NR_BENCH_PORT);
+	struct sock_key key;
+	uint64_t start;
+	uint64_t cycles;
+	int i;
+
+	memset(&key, 0, sizeof(key));
+
+	start = rte_rdtsc();
+	for (i = 0; i < NR_BENCH_PORT; i++) {
+		tpa_ip_set_ipv4(&key.remote_ip, 0x0a000100 + i % nr_remote);
+		key.local_port = 0;
+		ports[i] = port_bind(worker, &key, &dummy_tsock);
+		assert(ports[i] >= ut_port_min && ports[i] < ut_port_max);
+	}
+	cycles = rte_rdtsc() - start;
+
+	for (i = 0; i < NR_BENCH_PORT; i++) {
+		tpa_ip_set_ipv4(&key.remote_ip, 0x0a000100 + i % nr_remote);
+		key.local_port = ports[i];
+		assert(port_unbind(worker, &key) == 0);
+	}
+	free(ports);
+
+	return (double)NR_BENCH_PORT / ((double)cycles / rte_get_tsc_hz());
+}
+
+/*
+ * Measures the connect rate at the port level: it starts with no port
+ * block, thus the block reservation is counted in.
+ */
+static void test_port_alloc_bench(void)
+{
+	double rate;
+
+	printf("testing %s ...\n", __func__);
+
+	assert(worker->nr_port_block == 0);
+	rate = bench_bind(1);
+	printf("\t%-16s: %.2f Kconnects/s; %d port blocks\n", "1 remote",
+	       rate / 1e3, worker->nr_port_block);
+
+	rate = bench_bind(NR_BENCH_REMOTE);
+	printf("\t%-16s: %.2f Kconnects/s; %d port blocks\n", "64 remotes",
+	       rate / 1e3, worker->nr_port_block);
+
+	assert_port_block_refcnt();
+}
+
 static void test_port_block_free(void)
 {
 	printf("testing %s ...\n", __func__);
@@ -360,6 +452,7 @@ int main(int argc, char *argv[])
 	tpa_ip_set_ipv4(&default_remote_ip, 0x0a000021);
 
 	test_port_alloc_all_fail();
+	test_port_alloc_kernel_bind();
 	test_port_alloc_basic();
 	test_port_alloc_addrinuse();
 	test_port_alloc_exhaust();
@@ -381,5 +474,7 @@ int main(int argc, char *argv[])
 		test_port_block_free();
 	}
 
+	test_port_alloc_bench();
+
 	return 0;
 }
@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "test_utils.h"
+
+static void test_sock_burst_zwritev(void)
+{
+	struct tcp_sock *tsock0;
+	struct tcp_sock *tsock1;
+	struct tpa_iovec iov[3];
+	struct tpa_sock_iov reqs[4];
+
+	printf("testing %s ...\n", __func__);
+
+	tsock0 = ut_tcp_connect();
+	tsock1 = ut_tcp_connect();
+	ut_tcp_output(NULL, -1);
+
+	setup_tpa_iovec(&iov[0], 100, 1);
+	setup_tpa_iovec(&iov[1], 100, 1);
+	setup_tpa_iovec(&iov[2], 200, 1);
+
+	reqs[0].sid = tsock0->sid;
+	reqs[0].iov = &iov[0];
+	reqs[0].nr_iov = 1;
+
+	reqs[1].sid = -1;
+	reqs[1].iov = NULL;
+	reqs[1].nr_iov = 1;
+
+	reqs[2].sid = tsock1->sid;
+	reqs[2].iov = &iov[1];
+	reqs[2].nr_iov = 2;
+
+	reqs[3].sid = tsock1->sid;
+	reqs[3].iov = NULL;
+	reqs[3].nr_iov = 0;
+
+	assert(tpa_zwritev_burst(reqs, 4) == 3); {
+		assert(reqs[0].ret == 100);
+		assert(reqs[1].ret == -1 && reqs[1].err == EINVAL);
+		assert(reqs[2].ret == 300);
+		assert(reqs[3].ret == 0);
+
+		/* both are queued for output, by one go */
+		assert(tsock0->output_node.node.tqe_prev != NULL);
+		assert(tsock1->output_node.node.tqe_prev != NULL);
+	}
+
+	assert(ut_tcp_output(NULL, -1) >= 2);
+
+	ut_close(tsock0, CLOSE_TYPE_RESET);
+	ut_close(tsock1, CLOSE_TYPE_RESET);
+}
+
+static void test_sock_burst_zreadv(void)
+{
+	struct tcp_sock *tsock0;
+	struct tcp_sock *tsock1;
+	struct tpa_iovec iov[2][2];
+	struct tpa_sock_iov reqs[4];
+	struct packet *pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock0 = ut_tcp_connect();
+	tsock1 = ut_tcp_connect();
+
+	pkt = ut_inject_data_packet(tsock0, tsock0->rcv_nxt, 1000);
+	ut_tcp_input(tsock0, &pkt, 1);
+
+	reqs[0].sid = tsock0->sid;
+	reqs[0].iov = iov[0];
+	reqs[0].nr_iov = 2;
+
+	reqs[1].sid = tsock1->sid;
+	reqs[1].iov = iov[1];
+	reqs[1].nr_iov = 2;
+
+	reqs[2].sid = tsock0->sid;
+	reqs[2].iov = NULL;
+	reqs[2].nr_iov = 0;
+
+	reqs[3].sid = tsock0->sid;
+	reqs[3].iov = NULL;
+	reqs[3].nr_iov = -1;
+
+	assert(tpa_zreadv_burst(reqs, 4) == 2); {
+		assert(reqs[0].ret == 1000);
+		assert(reqs[1].ret == -1 && reqs[1].err == EAGAIN);
+		assert(reqs[2].ret == 0);
+		assert(reqs[3].ret == -1 && reqs[3].err == EINVAL);
+
+		iov[0][0].iov_read_done(iov[0][0].iov_base, iov[0][0].iov_param);
+	}
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock0, CLOSE_TYPE_RESET);
+	ut_close(tsock1, CLOSE_TYPE_RESET);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_sock_burst_zwritev();
+	test_sock_burst_zreadv();
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "test_utils.h"
+
+/*
+ * It's run with 2 workers (see ut_init): the socks are created at
+ * worker 0, while the pkts without flow mark land on worker 1.
+ */
+static struct tpa_worker *other;
+
+static struct packet *make_unmarked_packet(struct tcp_sock *tsock, int len)
+{
+	struct packet *pkt;
+
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, len);
+	pkt->mbuf.ol_flags &= ~PKT_RX_FDIR_ID;
+
+	return pkt;
+}
+
+static void worker_input(struct tpa_worker *w, struct packet *pkt)
+{
+	struct dev_rxq *rxq = dev_port_rxq(0, w->queue);
+
+	if (pkt)
+		rxq->pkts[(rxq->write++) & DEV_RXQ_MASK] = pkt;
+
+	cycles_update_begin(w);
+	while (tcp_input(w, 0))
+		;
+}
+
+static void test_steer_to_owner(void)
+{
+	uint64_t nr_steer = other->stats_base[PKT_STEER];
+	uint64_t nr_recv = worker->stats_base[PKT_STEER_RECV];
+	struct tcp_sock *tsock;
+	uint32_t rcv_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	assert(steer_ctrl.active == 1);
+
+	tsock = ut_tcp_connect();
+	rcv_nxt = tsock->rcv_nxt;
+
+	worker_input(other, make_unmarked_packet(tsock, 1000)); {
+		assert(other->stats_base[PKT_STEER] == nr_steer + 1);
+		assert(steer_pending(worker) == 1);
+		assert(tsock->rcv_nxt == rcv_nxt);
+	}
+
+	assert(steer_recv(worker) == 1);
+	worker_input(worker, NULL); {
+		assert(worker->stats_base[PKT_STEER_RECV] == nr_recv + 1);
+		assert(steer_pending(worker) == 0);
+		assert(tsock->rcv_nxt == rcv_nxt + 1000);
+	}
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock, CLOSE_TYPE_RESET);
+}
+
+/*
+ * A pkt forwarded already that misses again is not forwarded any more,
+ * even if the steer index still tells another owner: it goes to the
+ * listen lookup instead, and is dropped here.
+ */
+static void test_steer_no_loop(void)
+{
+	uint64_t nr_steer = other->stats_base[PKT_STEER];
+	uint64_t nr_no_sock = other->stats_base[ERR_NO_SOCK];
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t rcv_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	rcv_nxt = tsock->rcv_nxt;
+
+	pkt = make_unmarked_packet(tsock, 1000);
+	pkt->flags |= PKT_FLAG_STEERED;
+	worker_input(other, pkt); {
+		assert(other->stats_base[PKT_STEER] == nr_steer);
+		assert(other->stats_base[ERR_NO_SOCK] == nr_no_sock + 1);
+		assert(steer_pending(worker) == 0);
+		assert(steer_pending(other) == 0);
+		assert(tsock->rcv_nxt == rcv_nxt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	other = &workers[1];
+
+	test_steer_to_owner();
+	test_steer_no_loop();
+
+	return 0;
+}
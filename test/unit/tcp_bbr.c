@@ -0,0 +1,330 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+#define DATA_SIZE		10000
+#define ACK_DELAY		(10 * 1000)	/* us */
+
+static void test_tcp_rate_sample(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	assert(tsock->delivered == 0);
+
+	ut_write_assert(tsock, DATA_SIZE);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == DATA_SIZE);
+	}
+
+	usleep(ACK_DELAY);
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->delivered == DATA_SIZE);
+
+		/* it takes no less than ACK_DELAY to deliver them */
+		assert(tsock->delivery_rate <= (uint64_t)DATA_SIZE * 1000000 / ACK_DELAY);
+		assert(tsock->delivery_rate >= (uint64_t)DATA_SIZE * 1000000 / ACK_DELAY / 10);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_rate_sample_sack(void)
+{
+	struct tcp_sack_block blocks[1];
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	for (i = 0; i < 4; i++)
+		ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1);
+
+	blocks[0] = (struct tcp_sack_block) { tsock->snd_una + 1000, tsock->snd_una + 3000 };
+	pkt = ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->delivered == 2000);
+	}
+
+	/* the sacked ones are not counted again */
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->delivered == 4000);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_rate_app_limited(void)
+{
+	struct tcp_sock *tsock;
+	struct tx_desc *desc;
+	struct packet *pkt;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->snd_cwnd = 4000;
+
+	/* cwnd limited */
+	for (i = 0; i < 8; i++)
+		ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == 4000);
+	}
+
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->delivered == 4000);
+		assert(tsock->app_limited == 0);
+	}
+
+	tsock->snd_cwnd = 4000;
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == 4000);
+		desc = tcp_txq_peek_una(&tsock->txq, 0);
+		assert((desc->flags & TX_DESC_FLAG_APP_LIMITED) == 0);
+		assert(desc->delivered == 4000);
+	}
+
+	/* all is sent with the window open: app limited */
+	tsock->snd_cwnd = 16000;
+	ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->app_limited == tsock->delivered + 5000);
+	}
+
+	ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1); {
+		desc = tcp_txq_peek_una(&tsock->txq, 5);
+		assert(desc->flags & TX_DESC_FLAG_APP_LIMITED);
+	}
+
+	/* until the data in flight then is delivered */
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->delivered == 10000);
+		assert(tsock->app_limited == 10000);
+	}
+
+	tsock->snd_cwnd = 2000;
+	ut_write_assert(tsock, 1000);
+	ut_write_assert(tsock, 1000);
+	ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1);
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->delivered == 12000);
+		assert(tsock->app_limited == 0);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* a path of 1Gbps and 1ms rtt */
+#define BW		125		/* bytes per us */
+#define RTT		1000		/* us */
+#define BDP		(BW * RTT)
+
+/*
+ * Feeds BBR with one round of fluid model: all in flight is delivered
+ * in one rtt, at the bottleneck rate at most. The inflight is bounded
+ * by both cwnd and pacing rate.
+ */
+static uint64_t bbr_run_round(struct tcp_sock *tsock, uint64_t now)
+{
+	struct tcp_rate_sample rs;
+	uint32_t inflight;
+	uint64_t paced;
+
+	paced = tsock->pacing_rate ? tsock->pacing_rate * RTT / 1000000 : tsock->snd_cwnd;
+	inflight = RTE_MIN((uint64_t)tsock->snd_cwnd, paced);
+
+	memset(&rs, 0, sizeof(rs));
+	rs.prior_delivered = tsock->delivered;
+	rs.prior_ts = now;
+	rs.is_app_limited = !!tsock->app_limited;
+	rs.interval_us = RTE_MAX(RTT, inflight / BW);
+	rs.rtt_us = rs.interval_us;
+	rs.delivered = inflight;
+	rs.acked_sacked = inflight;
+
+	now += rs.interval_us;
+	tsock->delivered += inflight;
+	if (tsock->app_limited && tsock->delivered > tsock->app_limited)
+		tsock->app_limited = 0;
+
+	tsock->snd_una += inflight;
+	tsock->snd_nxt = tsock->snd_una + RTE_MIN((uint64_t)tsock->snd_cwnd, paced);
+	tsock->snd_cwnd = tsock->cc->cong_control(tsock, &rs, now);
+
+	return now;
+}
+
+static uint64_t bbr_run(struct tcp_sock *tsock, uint64_t now, int nr_round)
+{
+	while (nr_round--)
+		now = bbr_run_round(tsock, now);
+
+	return now;
+}
+
+static void assert_bbr_steady(struct tcp_sock *tsock)
+{
+	/* cwnd is capped at 2 BDP, with a few segs of headroom */
+	assert(tsock->snd_cwnd >= 2 * BDP * 99 / 100);
+	assert(tsock->snd_cwnd <= 2 * BDP + 4 * tsock->snd_mss);
+
+	/* and it paces at the bottleneck bw, with a gain of 0.75 ~ 1.25 */
+	assert(tsock->pacing_rate >= BW * 1000000ull * 3 / 4 * 99 / 100);
+	assert(tsock->pacing_rate <= BW * 1000000ull * 5 / 4 * 101 / 100);
+}
+
+static void test_tcp_bbr_model(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t snd_una;
+	uint32_t snd_nxt;
+	uint32_t cwnd;
+	uint64_t now;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	snd_una = tsock->snd_una;
+	snd_nxt = tsock->snd_nxt;
+
+	now = worker->ts_us;
+	tsock->cc = &tcp_cc_bbr;
+	tsock->srtt = RTT << 3;
+	tsock->snd_cwnd = tcp_cfg.cwnd_init;
+	tsock->cc->init(tsock, now);
+	assert(tsock->pacing_rate > 0);
+
+	/* STARTUP: doubles cwnd each round */
+	cwnd = tsock->snd_cwnd;
+	now = bbr_run(tsock, now, 1); {
+		assert(tsock->snd_cwnd == 2 * cwnd);
+	}
+
+	/* the BDP is found, without growing the cwnd any further */
+	now = bbr_run(tsock, now, 40); {
+		assert_bbr_steady(tsock);
+	}
+	for (i = 0; i < 100; i++) {
+		now = bbr_run_round(tsock, now);
+		assert(tsock->snd_cwnd <= 2 * BDP + 4 * tsock->snd_mss);
+	}
+
+	/* PROBE_RTT: min rtt expires after 10s */
+	now = bbr_run(tsock, now + 10 * 1000 * 1000, 1); {
+		assert(tsock->snd_cwnd == 4 * tsock->snd_mss);
+	}
+
+	/* the low rate samples there don't hurt the model */
+	now = bbr_run(tsock, now, 20); {
+		assert(tsock->snd_cwnd == 4 * tsock->snd_mss);
+		assert(tsock->pacing_rate >= BW * 1000000ull * 99 / 100);
+	}
+
+	/* and it's restored after 200ms */
+	now = bbr_run(tsock, now, 300); {
+		assert_bbr_steady(tsock);
+	}
+
+	/* no back off on loss; the cwnd is restored after recovery */
+	cwnd = tsock->snd_cwnd;
+	assert(tsock->cc->on_loss(tsock, now) == cwnd);
+	tsock->snd_cwnd = cwnd / 2;
+	tsock->retrans_stage = FAST_RETRANS;
+	assert(tsock->cc->on_recovery_exit(tsock, now) == cwnd);
+	tsock->retrans_stage = NONE;
+
+	tsock->snd_una = snd_una;
+	tsock->snd_nxt = snd_nxt;
+	tsock->app_limited = 0;
+	tsock->pacing_rate = 0;
+	tsock->cc = &tcp_cc_reno;
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_bbr_select(void)
+{
+	struct tcp_sock *tsock;
+
+	printf("testing %s ...\n", __func__);
+
+	assert(tcp_cc_set(NULL, "bbr") == 0);
+	tsock = ut_tcp_connect(); {
+		assert(tsock->cc == &tcp_cc_bbr);
+	}
+
+	ut_write_assert(tsock, DATA_SIZE);
+	ut_tcp_output(NULL, -1);
+	usleep(ACK_DELAY);
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->delivered == DATA_SIZE);
+		assert(tsock->pacing_rate > 0);
+		assert(tsock->snd_cwnd >= 4 * tsock->snd_mss);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	assert(tcp_cc_set(NULL, "reno") == 0);
+}
+
+/* BBR is seeded from the handshake rtt: it paces the very first flight */
+static void test_tcp_bbr_init_handshake_rtt(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	assert(tcp_cc_set(NULL, "bbr") == 0);
+	tsock = ut_trigger_connect();
+	assert(ut_tcp_output(&pkt, 1) == 1);
+	packet_free(pkt);
+
+	usleep(RTT);
+	pkt = make_synack_packet(tsock, 1, 1448, 10, 1);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->state == TCP_STATE_ESTABLISHED);
+		assert(tsock->srtt >= RTT << 3);
+		assert(tsock->pacing_rate > 0);
+		assert(tsock->pacing_rate <= (uint64_t)tsock->snd_cwnd * 1000000 / RTT * 3);
+	}
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	assert(tcp_cc_set(NULL, "reno") == 0);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_tcp_rate_sample();
+	test_tcp_rate_sample_sack();
+	test_tcp_rate_app_limited();
+	test_tcp_bbr_model();
+	test_tcp_bbr_select();
+	test_tcp_bbr_init_handshake_rtt();
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+static void test_tcp_cc_select(void)
+{
+	struct tpa_sock_opts opts;
+	struct tcp_sock *tsock;
+	int sid;
+
+	printf("testing %s ...\n", __func__);
+
+	assert(tcp_cc_default == &tcp_cc_reno);
+	assert(tcp_cc_find("cubic") == &tcp_cc_cubic);
+	assert(tcp_cc_find("foo") == NULL);
+	assert(tcp_cc_set(NULL, "foo") == -1);
+
+	/* global */
+	assert(tcp_cc_set(NULL, "cubic") == 0);
+	tsock = ut_tcp_connect(); {
+		assert(tsock->cc == &tcp_cc_cubic);
+	}
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	assert(tcp_cc_set(NULL, "reno") == 0);
+
+	/* per sock */
+	memset(&opts, 0, sizeof(opts));
+	strcpy(opts.cc, "cubic");
+	sid = ut_connect_to(SERVER_IP_STR, SERVER_PORT, &opts);
+	assert(sid >= 0); {
+		assert(sock_ctrl->socks[sid].cc == &tcp_cc_cubic);
+	}
+	ut_close(&sock_ctrl->socks[sid], CLOSE_TYPE_CLOSE_DIRECTLY);
+
+	strcpy(opts.cc, "foo");
+	assert(ut_connect_to(SERVER_IP_STR, SERVER_PORT, &opts) == -1); {
+		assert(errno == ENOENT);
+	}
+}
+
+static void test_tcp_cc_reno_loss(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t cwnd;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	cwnd = 100 * tsock->snd_mss;
+	tsock->snd_cwnd = cwnd;
+	assert(tsock->cc->on_loss(tsock, worker->ts_us) == cwnd / 2);
+	assert(tsock->cc->on_rto(tsock, worker->ts_us) == cwnd / 2);
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* a long rtt, where cubic differs from reno most */
+#define RTT		(100 * 1000)	/* us */
+#define SEC		(1000 * 1000)
+
+/* feeds the cc with a full cwnd acked each rtt, for the given duration */
+static uint64_t cc_run(struct tcp_sock *tsock, uint64_t now, uint64_t duration)
+{
+	uint64_t end = now + duration;
+
+	for (; now < end; now += RTT)
+		tsock->snd_cwnd = tsock->cc->on_ack(tsock, tsock->snd_cwnd, now);
+
+	return now;
+}
+
+static void test_tcp_cc_cubic(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t w_max;
+	uint32_t cwnd;
+	uint64_t now;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->cc = &tcp_cc_cubic;
+	tsock->cc->init(tsock, worker->ts_us);
+	tsock->srtt = RTT << 3;
+
+	/* a single loss at 100 segs */
+	w_max = 100 * tsock->snd_mss;
+	tsock->snd_cwnd = w_max;
+	tsock->snd_ssthresh = tsock->cc->on_loss(tsock, worker->ts_us); {
+		assert(tsock->snd_ssthresh == w_max * 7 / 10);
+	}
+	tsock->snd_cwnd = tsock->cc->on_recovery_exit(tsock, worker->ts_us);
+
+	/*
+	 * K = cbrt(100 * 0.3 / 0.4) = 4.2s. The cwnd should be close to
+	 * w_max at K, while staying below it before.
+	 */
+	now = cc_run(tsock, worker->ts_us, 2 * SEC); {
+		cwnd = tsock->snd_cwnd;
+		assert(cwnd > w_max * 7 / 10 && cwnd < w_max);
+	}
+
+	now = cc_run(tsock, now, 2 * SEC + 200 * 1000); {
+		assert(tsock->snd_cwnd > cwnd);
+		assert(tsock->snd_cwnd >= w_max * 98 / 100 &&
+		       tsock->snd_cwnd <= w_max * 102 / 100);
+	}
+
+	/* and probes beyond w_max faster and faster after that */
+	now = cc_run(tsock, now, 4 * SEC); {
+		assert(tsock->snd_cwnd > w_max * 120 / 100);
+	}
+
+	/* the second loss below the last w_max triggers fast convergence */
+	tsock->snd_cwnd = w_max / 2;
+	tsock->snd_ssthresh = tsock->cc->on_loss(tsock, now); {
+		assert(tsock->snd_ssthresh == w_max / 2 * 7 / 10);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* cubic should recover much faster than reno after a loss at a large cwnd */
+static void test_tcp_cc_cubic_vs_reno(void)
+{
+	const struct tcp_cc_ops *ccs[] = { &tcp_cc_reno, &tcp_cc_cubic };
+	uint32_t cwnd[RTE_DIM(ccs)];
+	struct tcp_sock *tsock;
+	uint32_t w_max;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	for (i = 0; i < RTE_DIM(ccs); i++) {
+		tsock = ut_tcp_connect();
+		tsock->cc = ccs[i];
+		if (tsock->cc->init)
+			tsock->cc->init(tsock, worker->ts_us);
+		tsock->srtt = RTT << 3;
+
+		w_max = 1000 * tsock->snd_mss;
+		tsock->snd_cwnd = w_max;
+		tsock->snd_ssthresh = tsock->cc->on_loss(tsock, worker->ts_us);
+		tsock->snd_cwnd = tsock->cc->on_recovery_exit(tsock, worker->ts_us);
+
+		cc_run(tsock, worker->ts_us, 10 * SEC);
+		cwnd[i] = tsock->snd_cwnd;
+
+		ut_close(tsock, CLOSE_TYPE_4WAY);
+	}
+
+	printf("\tcwnd 10s after loss at %u: reno=%u cubic=%u\n", w_max, cwnd[0], cwnd[1]);
+	assert(cwnd[1] > cwnd[0]);
+	assert(cwnd[1] >= w_max);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_tcp_cc_select();
+	test_tcp_cc_reno_loss();
+	test_tcp_cc_cubic();
+	test_tcp_cc_cubic_vs_reno();
+
+	return 0;
+}
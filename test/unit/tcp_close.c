@@ -22,8 +22,8 @@ static void test_tcp_close_half(void)
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
 		assert((uint32_t)(TCP_SEG(pkt)->seq - tsock->snd_isn) == 1);
-		assert(tsock->stats_base[FIN_XMIT] == 1);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 1);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		packet_free(pkt);
 	}
@@ -49,8 +49,8 @@ static void test_tcp_close_wrong_ack(void)
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
 		assert((uint32_t)(TCP_SEG(pkt)->seq - tsock->snd_isn) == 1);
-		assert(tsock->stats_base[FIN_XMIT] == 1);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 1);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 
 		fin_seq = TCP_SEG(pkt)->seq;
@@ -171,8 +171,8 @@ static void test_tcp_close_fin_retry(void)
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
 		assert((uint32_t)(TCP_SEG(pkt)->seq - tsock->snd_isn) == 1);
-		assert(tsock->stats_base[FIN_XMIT] == 1);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 1);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		packet_free(pkt);
 	}
@@ -183,8 +183,8 @@ static void test_tcp_close_fin_retry(void)
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
 		assert((uint32_t)(TCP_SEG(pkt)->seq - tsock->snd_isn) == 1);
-		assert(tsock->stats_base[FIN_XMIT] == 2);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 2);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		packet_free(pkt);
 	}
@@ -210,8 +210,8 @@ static void test_tcp_close_fin_retry_with_pending_send(void)
 	pkt = ut_drain_send_buff_at_close(tsock); {
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
-		assert(tsock->stats_base[FIN_XMIT] == 1);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 1);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		packet_free(pkt);
 	}
@@ -221,8 +221,8 @@ static void test_tcp_close_fin_retry_with_pending_send(void)
 	pkt = ut_drain_send_buff_at_close(tsock); {
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
-		assert(tsock->stats_base[FIN_XMIT] == 2);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 2);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		packet_free(pkt);
 	}
@@ -253,8 +253,8 @@ static void test_tcp_close_fin_timeout(void)
 	pkt = ut_drain_send_buff_at_close(tsock); {
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 		assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
-		assert(tsock->stats_base[FIN_XMIT] == 1);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 1);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		packet_free(pkt);
 	}
@@ -276,7 +276,7 @@ static void test_tcp_close_fin_timeout(void)
 		pkt = ut_drain_send_buff_at_close(tsock); {
 			assert(TCP_SEG(pkt)->flags & TCP_FLAG_FIN);
 			assert(TCP_SEG(pkt)->flags & TCP_FLAG_ACK);
-			assert(tsock->stats_base[RST_XMIT] == 0);
+			assert(tsock->stats->stats_base[RST_XMIT] == 0);
 			assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 			packet_free(pkt);
 		}
@@ -506,7 +506,7 @@ static void test_tcp_close_fin_wait2_hang(void)
 		assert(tsock->state == TCP_STATE_FIN_WAIT_2);
 	}
 
-	usleep(tcp_cfg.time_wait + GRAGNULARITY * 1.1);
+	usleep(tcp_cfg.time_wait + TIMER_TICK_US * 2);
 	ut_tcp_output(NULL, -1); {
 		assert(tsock->state == TCP_STATE_CLOSED);
 	}
@@ -71,11 +71,100 @@ static void test_tcp_connect_crr_basic2(void)
 	assert(rss_after - rss_before < 100);
 }
 
+/* a just freed sid should be reused first, while it's still cache hot */
+static void test_tcp_connect_crr_sid_reuse(void)
+{
+	struct tcp_sock *tsocks[NR_OPEN_SOCK];
+	struct tcp_sock *tsock;
+	int sid;
+	int i;
+	int j;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	sid = tsock->sid;
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+
+	tsock = ut_tcp_connect(); {
+		assert(tsock->sid == sid);
+	}
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+
+	/* sids should stay unique when going beyond the magazine size */
+	for (i = 0; i < NR_OPEN_SOCK; i++) {
+		tsocks[i] = ut_tcp_connect();
+		assert(tsocks[i]->sid >= 0 && tsocks[i]->sid < tcp_cfg.nr_max_sock);
+	}
+
+	for (i = 0; i < NR_OPEN_SOCK; i++) {
+		for (j = i + 1; j < NR_OPEN_SOCK; j++)
+			assert(tsocks[i]->sid != tsocks[j]->sid);
+	}
+
+	for (i = 0; i < NR_OPEN_SOCK; i++)
+		ut_close(tsocks[i], CLOSE_TYPE_4WAY);
+}
+
+#define NR_LIFO_SOCK		(SID_MAGAZINE_SIZE + SID_MAGAZINE_BATCH)
+
+/*
+ * The sids come back in the reverse order they are freed; the coldest
+ * half flushed from a full magazine comes back from the depot, with
+ * no sock array enlarging.
+ */
+static void test_tcp_connect_crr_sid_lifo(void)
+{
+	struct sid_magazine *mag = &worker->sid_magazine;
+	struct tcp_sock *tsocks[NR_LIFO_SOCK];
+	struct tcp_sock *drained[SID_MAGAZINE_SIZE];
+	uint32_t nr_expand_times;
+	uint32_t nr_batch;
+	int sids[NR_LIFO_SOCK];
+	int nr_drained = 0;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	for (i = 0; i < NR_LIFO_SOCK; i++) {
+		tsocks[i] = ut_tcp_connect();
+		sids[i] = tsocks[i]->sid;
+	}
+
+	/* start with an empty magazine */
+	while (mag->nr_sid)
+		drained[nr_drained++] = ut_tcp_connect();
+
+	nr_batch = sid_depot.nr_batch;
+	assert(nr_batch < SID_DEPOT_SIZE);
+
+	/* the first half overflows to the depot */
+	for (i = 0; i < NR_LIFO_SOCK; i++)
+		ut_close(tsocks[i], CLOSE_TYPE_4WAY);
+	assert(mag->nr_sid == SID_MAGAZINE_SIZE);
+	assert(sid_depot.nr_batch == nr_batch + 1);
+
+	nr_expand_times = sock_ctrl->nr_expand_times;
+	for (i = NR_LIFO_SOCK - 1; i >= 0; i--) {
+		tsocks[i] = ut_tcp_connect();
+		assert(tsocks[i]->sid == sids[i]);
+	}
+	assert(sid_depot.nr_batch == nr_batch);
+	assert(sock_ctrl->nr_expand_times == nr_expand_times);
+
+	for (i = 0; i < NR_LIFO_SOCK; i++)
+		ut_close(tsocks[i], CLOSE_TYPE_4WAY);
+	for (i = 0; i < nr_drained; i++)
+		ut_close(drained[i], CLOSE_TYPE_4WAY);
+}
+
 int main(int argc, char *argv[])
 {
 	ut_init(argc, argv);
 	ut_test_opts.silent = 1;
 
+	test_tcp_connect_crr_sid_lifo();
+	test_tcp_connect_crr_sid_reuse();
 	test_tcp_connect_crr_basic();
 	test_tcp_connect_crr_basic2();
 
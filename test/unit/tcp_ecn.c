@@ -0,0 +1,500 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+#include "pktfuzz.h"
+
+#define ECN_FLAGS		(TCP_FLAG_ECE | TCP_FLAG_CWR)
+
+static uint8_t pkt_get_ecn(struct packet *pkt)
+{
+	struct eth_ip_hdr *hdr = rte_pktmbuf_mtod(&pkt->mbuf, struct eth_ip_hdr *);
+
+	return net_hdr_get_ecn(hdr, hdr->eth.ether_type == htons(RTE_ETHER_TYPE_IPV6));
+}
+
+static void pkt_set_ecn(struct packet *pkt, uint8_t ecn)
+{
+	struct eth_ip_hdr *hdr = rte_pktmbuf_mtod(&pkt->mbuf, struct eth_ip_hdr *);
+
+	net_hdr_set_ecn(hdr, ut_test_opts.with_ipv6, ecn);
+}
+
+static struct packet *make_data_packet(struct tcp_sock *tsock, int len, uint8_t ecn, uint8_t flags)
+{
+	struct packet *pkt;
+
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, len);
+	pkt_set_ecn(pkt, ecn);
+	ut_packet_tcp_hdr(pkt)->tcp_flags |= flags;
+
+	return pkt;
+}
+
+static struct tcp_sock *ecn_connect(int synack_ece)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+
+	tsock = ut_trigger_connect();
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert((TCP_SEG(pkt)->flags & ECN_FLAGS) == ECN_FLAGS);
+		assert(pkt_get_ecn(pkt) == IP_ECN_NOT_ECT);
+		packet_free(pkt);
+	}
+
+	pkt = make_synack_packet(tsock, 1, 1448, 10, 1);
+	if (synack_ece)
+		ut_packet_tcp_hdr(pkt)->tcp_flags |= TCP_FLAG_ECE;
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->state == TCP_STATE_ESTABLISHED);
+		assert(tsock->ecn_ok == !!synack_ece);
+	}
+
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert((TCP_SEG(pkt)->flags & ECN_FLAGS) == 0);
+		assert(pkt_get_ecn(pkt) == IP_ECN_NOT_ECT);
+		packet_free(pkt);
+	}
+
+	return tsock;
+}
+
+static void test_tcp_ecn_negotiation(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	int synack_ece;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.ecn = 0;
+	tsock = ut_tcp_connect(); {
+		assert(tsock->ecn_ok == 0);
+	}
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+
+	tcp_cfg.ecn = 1;
+	for (synack_ece = 0; synack_ece <= 1; synack_ece++) {
+		tsock = ecn_connect(synack_ece);
+
+		/* only data segs are sent with ECT */
+		ut_write_assert(tsock, 1000);
+		assert(ut_tcp_output(&pkt, 1) == 1); {
+			assert(TCP_SEG(pkt)->len == 1000);
+			assert((TCP_SEG(pkt)->flags & ECN_FLAGS) == 0);
+			assert(pkt_get_ecn(pkt) == (synack_ece ? IP_ECN_ECT0 : IP_ECN_NOT_ECT));
+			packet_free(pkt);
+		}
+
+		ut_close(tsock, CLOSE_TYPE_4WAY);
+	}
+	tcp_cfg.ecn = 0;
+}
+
+/* RFC 3168: ECE is latched until CWR is received */
+static void test_tcp_ecn_echo(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.ecn = 1;
+	tsock = ecn_connect(1);
+
+	pkt = make_data_packet(tsock, 1000, IP_ECN_CE, 0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_ACK | TCP_FLAG_ECE));
+		assert(pkt_get_ecn(pkt) == IP_ECN_NOT_ECT);
+		packet_free(pkt);
+	}
+	assert(tsock->stats->stats_base[ECN_CE_RCV] == 1);
+
+	pkt = make_data_packet(tsock, 1000, IP_ECN_ECT0, 0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_ACK | TCP_FLAG_ECE));
+		packet_free(pkt);
+	}
+
+	pkt = make_data_packet(tsock, 1000, IP_ECN_ECT0, TCP_FLAG_CWR);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
+		packet_free(pkt);
+	}
+
+	/* a CE seg with CWR set latches ECE again */
+	pkt = make_data_packet(tsock, 1000, IP_ECN_CE, TCP_FLAG_CWR);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_ACK | TCP_FLAG_ECE));
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	tcp_cfg.ecn = 0;
+}
+
+/*
+ * DCTCP: ECE tells the CE state of the segs being acked; the delayed ACK
+ * is flushed at CE state change.
+ */
+static void test_tcp_ecn_dctcp_echo(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t rcv_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	/* dctcp requests ECN by itself */
+	assert(tcp_cc_set(NULL, "dctcp") == 0);
+	tsock = ecn_connect(1);
+	tsock->quickack = 0;
+	tcp_cfg.delayed_ack = 500 * 1000;
+
+	/* delayed */
+	rcv_nxt = tsock->rcv_nxt;
+	pkt = make_data_packet(tsock, 500, IP_ECN_ECT0, 0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(NULL, -1) == 0);
+
+	/* CE 0 -> 1: the pending ACK goes out with no ECE */
+	pkt = make_data_packet(tsock, 500, IP_ECN_CE, 0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
+		assert(TCP_SEG(pkt)->ack == rcv_nxt + 500);
+		packet_free(pkt);
+	}
+
+	/* CE 1 -> 0: the pending ACK goes out with ECE */
+	pkt = make_data_packet(tsock, 500, IP_ECN_ECT0, 0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_ACK | TCP_FLAG_ECE));
+		assert(TCP_SEG(pkt)->ack == rcv_nxt + 1000);
+		packet_free(pkt);
+	}
+
+	/* the last seg has no CE; so does the delayed ACK */
+	usleep(tcp_cfg.delayed_ack + 100 * 1000);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
+		assert(TCP_SEG(pkt)->ack == rcv_nxt + 1500);
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	tcp_cfg.delayed_ack = TCP_DELAYED_ACK_DEFAULT;
+	assert(tcp_cc_set(NULL, "reno") == 0);
+}
+
+/* the CE mark of a seg that is not accepted is not counted */
+static void test_tcp_ecn_dropped(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t rcv_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.ecn = 1;
+	tsock = ecn_connect(1);
+	rcv_nxt = tsock->rcv_nxt;
+
+	pkt = ut_inject_data_packet(tsock, rcv_nxt + 1000, 1000);
+	pkt_set_ecn(pkt, IP_ECN_ECT0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
+		packet_free(pkt);
+	}
+
+	/* the same ooo seg again, CE marked: dropped as a dup */
+	pkt = ut_inject_data_packet(tsock, rcv_nxt + 1000, 1000);
+	pkt_set_ecn(pkt, IP_ECN_CE);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
+		packet_free(pkt);
+	}
+	assert(tsock->ce_state == 0);
+	assert(tsock->stats->stats_base[ECN_CE_RCV] == 0);
+
+	/* while a CE seg filling the hole is */
+	pkt = make_data_packet(tsock, 1000, IP_ECN_CE, 0);
+	ut_tcp_input_one(tsock, pkt);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_ACK | TCP_FLAG_ECE));
+		assert(TCP_SEG(pkt)->ack == rcv_nxt + 2000);
+		packet_free(pkt);
+	}
+	assert(tsock->stats->stats_base[ECN_CE_RCV] == 1);
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	tcp_cfg.ecn = 0;
+}
+
+static struct packet *make_ece_ack(struct tcp_sock *tsock, uint32_t ack)
+{
+	struct packet *pkt;
+
+	pkt = ut_inject_ack_packet(tsock, ack);
+	ut_packet_tcp_hdr(pkt)->tcp_flags |= TCP_FLAG_ECE;
+
+	return pkt;
+}
+
+static void test_tcp_ecn_cwnd_reduce(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t cwnd;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.ecn = 1;
+	tsock = ecn_connect(1);
+
+	ut_write_assert(tsock, 1000);
+	assert(ut_tcp_output(NULL, -1) == 1);
+
+	cwnd = 100 * tsock->snd_mss;
+	tsock->snd_cwnd = cwnd;
+	pkt = make_ece_ack(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->snd_una == tsock->snd_nxt);
+		assert(tsock->snd_cwnd == cwnd / 2);
+		assert(tsock->snd_ssthresh == cwnd / 2);
+		assert(tsock->stats->stats_base[ECN_CWND_REDUCE] == 1);
+	}
+
+	/* at most once per window */
+	ut_write_assert(tsock, 1000);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_ACK | TCP_FLAG_CWR));
+		assert(pkt_get_ecn(pkt) == IP_ECN_ECT0);
+		packet_free(pkt);
+	}
+
+	pkt = make_ece_ack(tsock, tsock->snd_una);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->snd_cwnd == cwnd / 2);
+		assert(tsock->stats->stats_base[ECN_CWND_REDUCE] == 1);
+	}
+
+	/* CWR is set once only */
+	ut_write_assert(tsock, 1000);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
+		packet_free(pkt);
+	}
+
+	/* a new window, with ECE again */
+	pkt = make_ece_ack(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->snd_cwnd == cwnd / 4);
+		assert(tsock->stats->stats_base[ECN_CWND_REDUCE] == 2);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	tcp_cfg.ecn = 0;
+}
+
+/* RFC 3168 6.1.5: retransmits are not ECN capable */
+static void test_tcp_ecn_retrans(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.ecn = 1;
+	tsock = ecn_connect(1);
+
+	ut_write_assert(tsock, 1000);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(pkt_get_ecn(pkt) == IP_ECN_ECT0);
+		packet_free(pkt);
+	}
+
+	/* RTO */
+	ut_simulate_rto_timeout(tsock);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->seq == tsock->snd_una);
+		assert(pkt_get_ecn(pkt) == IP_ECN_NOT_ECT);
+		packet_free(pkt);
+	}
+
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt);
+
+	/* a TLP probe re-sending the last seg */
+	ut_write_assert(tsock, 1000);
+	assert(ut_tcp_output(NULL, -1) == 1);
+	assert(tcp_xmit_tlp_probe(worker, tsock) > 0);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(tsock->rack.tlp_is_retrans == 1);
+		assert(pkt_get_ecn(pkt) == IP_ECN_NOT_ECT);
+		packet_free(pkt);
+	}
+
+	/* new data still goes with ECT(0) */
+	ut_write_assert(tsock, 1000);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(pkt_get_ecn(pkt) == IP_ECN_ECT0);
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	tcp_cfg.ecn = 0;
+}
+
+#define DCTCP_MSS		1000
+#define DCTCP_CWND		(2048 * DCTCP_MSS)
+
+/* with cwnd being 2048 mss, the cwnd reduction tells alpha, in 1/1024 */
+static uint32_t dctcp_alpha(struct tcp_sock *tsock)
+{
+	tsock->snd_cwnd = DCTCP_CWND;
+
+	return (DCTCP_CWND - tsock->cc->on_ecn(tsock, worker->ts_us)) / DCTCP_MSS;
+}
+
+/*
+ * acks a window of 100 bytes, with @ce_pct of them having ECE; the next
+ * window is sent before that.
+ */
+static void dctcp_ack_window(struct tcp_sock *tsock, int ce_pct)
+{
+	tsock->snd_nxt += 100;
+
+	if (ce_pct < 100) {
+		tsock->snd_una += 100 - ce_pct;
+		tsock->cc->in_ack(tsock, 100 - ce_pct, 0, worker->ts_us);
+	}
+
+	if (ce_pct > 0) {
+		tsock->snd_una += ce_pct;
+		tsock->cc->in_ack(tsock, ce_pct, 1, worker->ts_us);
+	}
+}
+
+static void test_tcp_dctcp_alpha(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t snd_una;
+	uint32_t snd_nxt;
+	uint32_t snd_mss;
+	uint32_t alpha;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	snd_una = tsock->snd_una;
+	snd_nxt = tsock->snd_nxt;
+	snd_mss = tsock->snd_mss;
+
+	tsock->cc = &tcp_cc_dctcp;
+	tsock->snd_mss = DCTCP_MSS;
+	tsock->snd_nxt = tsock->snd_una + 100;
+	tsock->cc->init(tsock, worker->ts_us);
+	assert(dctcp_alpha(tsock) == 1024);
+
+	/* alpha = alpha * 15/16 + F / 16 */
+	dctcp_ack_window(tsock, 0);
+	assert(dctcp_alpha(tsock) == 960);
+
+	dctcp_ack_window(tsock, 100);
+	assert(dctcp_alpha(tsock) == 960 - 60 + 64);
+
+	/* it decays to zero without CE */
+	for (i = 0; i < 200; i++)
+		dctcp_ack_window(tsock, 0);
+	assert(dctcp_alpha(tsock) == 0);
+
+	/* and converges to F */
+	for (i = 0; i < 200; i++)
+		dctcp_ack_window(tsock, 25);
+	alpha = dctcp_alpha(tsock);
+	assert(alpha >= 256 - 16 && alpha <= 256 + 16);
+
+	/* loss is handled as reno does */
+	tsock->snd_cwnd = DCTCP_CWND;
+	assert(tsock->cc->on_loss(tsock, worker->ts_us) == DCTCP_CWND / 2);
+
+	tsock->snd_una = snd_una;
+	tsock->snd_nxt = snd_nxt;
+	tsock->snd_mss = snd_mss;
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_ecn_fuzz(void)
+{
+	struct packet *pkts[1];
+	struct tcp_sock *tsock;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.ecn = 1;
+	tsock = ecn_connect(1);
+
+	pktfuzz_enabled = 1;
+	memset(&fuzz_cfg.ecn, 0, sizeof(fuzz_cfg.ecn));
+	fuzz_cfg.ecn.rate.rate = 100;
+	fuzz_cfg.ecn.count.num = 1;
+	fuzz_cfg.ecn.enabled = 1;
+
+	for (i = 0; i < 3; i++) {
+		ut_write_assert(tsock, 1000);
+		assert(ut_tcp_output(pkts, 1) == 1); {
+			assert(TCP_SEG(pkts[0])->len == 1000);
+			assert(pkt_get_ecn(pkts[0]) == IP_ECN_CE);
+			assert(pkts[0]->flags & PKT_FLAG_ECN_CE);
+			packet_free(pkts[0]);
+		}
+	}
+
+	/* not-ECT pkts are left untouched */
+	pkts[0] = make_data_packet(tsock, 1000, IP_ECN_NOT_ECT, 0);
+	ut_tcp_input_one(tsock, pkts[0]);
+	assert(ut_tcp_output(pkts, 1) == 1); {
+		assert(TCP_SEG(pkts[0])->len == 0);
+		assert(pkt_get_ecn(pkts[0]) == IP_ECN_NOT_ECT);
+		packet_free(pkts[0]);
+	}
+	assert(fuzz_cfg.ecn.stats.marked == 3);
+
+	fuzz_cfg.ecn.enabled = 0;
+	pktfuzz_enabled = 0;
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	tcp_cfg.ecn = 0;
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_tcp_ecn_negotiation();
+	test_tcp_ecn_echo();
+	test_tcp_ecn_dctcp_echo();
+	test_tcp_ecn_dropped();
+	test_tcp_ecn_cwnd_reduce();
+	test_tcp_ecn_retrans();
+	test_tcp_dctcp_alpha();
+	test_tcp_ecn_fuzz();
+
+	return 0;
+}
@@ -25,7 +25,7 @@ static void test_tcp_input_fastpath_basic(void)
 	pkts[1] = ut_inject_data_packet(tsock, tsock->rcv_nxt + off, 1000); off += 1000;
 	pkts[2] = ut_inject_data_packet(tsock, tsock->rcv_nxt + off, 1000); off += 1000;
 	ut_tcp_input(tsock, pkts, 3); {
-		assert(tsock->stats_base[BYTE_RECV_FASTPATH] == off);
+		assert(tsock->stats->stats_base[BYTE_RECV_FASTPATH] == off);
 		ret = tpa_zreadv(tsock->sid, iov, 3);
 		assert(ret == off);
 		iov[0].iov_read_done(iov[0].iov_base, iov[0].iov_param);
@@ -39,7 +39,7 @@ static void test_tcp_input_fastpath_basic(void)
 	pkts[2] = ut_inject_data_packet(tsock, tsock->rcv_nxt + off, 1000); off += 1000;
 	ut_packet_tcp_hdr(pkts[0])->tcp_flags |= TCP_FLAG_PSH;
 	ut_tcp_input(tsock, pkts, 3); {
-		assert(tsock->stats_base[BYTE_RECV_FASTPATH] == 6000);
+		assert(tsock->stats->stats_base[BYTE_RECV_FASTPATH] == 6000);
 		ret = tpa_zreadv(tsock->sid, iov, 3);
 		assert(ret == off);
 		iov[0].iov_read_done(iov[0].iov_base, iov[0].iov_param);
@@ -65,15 +65,15 @@ static void test_tcp_input_fastpath_no_ack(void)
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
 	ut_packet_tcp_hdr(pkt)->tcp_flags = TCP_FLAG_PSH;
 	ut_tcp_input_one(tsock, pkt); {
-		assert(tsock->stats_base[BYTE_RECV_FASTPATH] == 0);
-		assert(tsock->stats_base[BYTE_RECV] == 0);
+		assert(tsock->stats->stats_base[BYTE_RECV_FASTPATH] == 0);
+		assert(tsock->stats->stats_base[BYTE_RECV] == 0);
 	}
 
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
 	ut_packet_tcp_hdr(pkt)->tcp_flags = TCP_FLAG_FIN | TCP_FLAG_ACK;
 	ut_tcp_input_one_and_drain(tsock, pkt); {
-		assert(tsock->stats_base[BYTE_RECV_FASTPATH] == 0);
-		assert(tsock->stats_base[BYTE_RECV] == 1000);
+		assert(tsock->stats->stats_base[BYTE_RECV_FASTPATH] == 0);
+		assert(tsock->stats->stats_base[BYTE_RECV] == 1000);
 	}
 
 	ut_dump_tsock_stats(tsock);
@@ -94,15 +94,15 @@ static void test_tcp_input_fastpath_wrong_ack(void)
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
 	ut_packet_tcp_hdr(pkt)->recv_ack = htonl(tsock->snd_nxt  + 1);
 	ut_tcp_input_one(tsock, pkt); {
-		assert(tsock->stats_base[BYTE_RECV_FASTPATH] == 0);
-		assert(tsock->stats_base[BYTE_RECV] == 0);
+		assert(tsock->stats->stats_base[BYTE_RECV_FASTPATH] == 0);
+		assert(tsock->stats->stats_base[BYTE_RECV] == 0);
 	}
 
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
 	ut_packet_tcp_hdr(pkt)->recv_ack = htonl(tsock->snd_una  - 1);
 	ut_tcp_input_one_and_drain(tsock, pkt); {
-		assert(tsock->stats_base[BYTE_RECV_FASTPATH] == 0);
-		assert(tsock->stats_base[BYTE_RECV] == 1000);
+		assert(tsock->stats->stats_base[BYTE_RECV_FASTPATH] == 0);
+		assert(tsock->stats->stats_base[BYTE_RECV] == 1000);
 	}
 
 	ut_dump_tsock_stats(tsock);
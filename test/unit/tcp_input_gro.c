@@ -0,0 +1,166 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+#define GRO_TIMEOUT		1000
+
+static void gro_input_one(struct tcp_sock *tsock, int len, uint8_t flags)
+{
+	struct packet *pkt;
+	uint32_t seq = tsock->rcv_nxt;
+
+	if (tsock->rx_merge_head)
+		seq += TCP_SEG(tsock->rx_merge_head)->len;
+
+	pkt = ut_inject_data_packet(tsock, seq, len);
+	ut_packet_tcp_hdr(pkt)->tcp_flags |= flags;
+
+	ut_tcp_input_one(tsock, pkt);
+}
+
+/* the merge head is held across bursts, until it's read */
+static void test_tcp_input_gro_across_bursts(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t rcv_nxt;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	rcv_nxt = tsock->rcv_nxt;
+
+	for (i = 0; i < 3; i++) {
+		gro_input_one(tsock, 1000, 0); {
+			assert(tsock->rcv_nxt == rcv_nxt);
+			assert(tsock->rx_merge_head != NULL);
+			assert(tsock->rx_merge_head->nr_read_seg == i + 1);
+		}
+	}
+
+	/* the ACK goes after the flush only */
+	assert(ut_tcp_output(NULL, 0) == 0);
+
+	assert(ut_readv(tsock, 3) == 3000); {
+		assert(tsock->rcv_nxt == rcv_nxt + 3000);
+		assert(tsock->rx_merge_head == NULL);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 3);
+		assert(tsock->stats->rx_merge_size.buckets[1] == 1);
+
+		/* no ACK is sent from the read path ... */
+		assert(dev_port_txq(0, worker->queue)->nr_pkt == 0);
+	}
+
+	/* ... but from the worker output path */
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->len == 0);
+		assert(TCP_SEG(pkt)->ack == tsock->rcv_nxt);
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_input_gro_timeout(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t rcv_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	rcv_nxt = tsock->rcv_nxt;
+
+	gro_input_one(tsock, 1000, 0);
+	gro_input_one(tsock, 1000, 0); {
+		assert(tsock->rcv_nxt == rcv_nxt);
+		assert(tcp_gro_flush(worker) == 0);
+	}
+
+	usleep(GRO_TIMEOUT);
+	cycles_update_begin(worker);
+	assert(tcp_gro_flush(worker) == 1); {
+		assert(tsock->rcv_nxt == rcv_nxt + 2000);
+		assert(tsock->rx_merge_head == NULL);
+	}
+
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->ack == tsock->rcv_nxt);
+		packet_free(pkt);
+	}
+
+	assert(ut_readv(tsock, 2) == 2000);
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_input_gro_psh(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t rcv_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	rcv_nxt = tsock->rcv_nxt;
+
+	gro_input_one(tsock, 1000, 0);
+	gro_input_one(tsock, 1000, TCP_FLAG_PSH); {
+		assert(tsock->rcv_nxt == rcv_nxt + 2000);
+		assert(tsock->rx_merge_head == NULL);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 2);
+	}
+
+	assert(ut_readv(tsock, 2) == 2000);
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_input_gro_max_chain(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t rcv_nxt;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.pkt_max_chain = 4;
+	tsock = ut_tcp_connect();
+	rcv_nxt = tsock->rcv_nxt;
+
+	for (i = 0; i < 4; i++)
+		gro_input_one(tsock, 100, 0);
+	assert(tsock->rcv_nxt == rcv_nxt + 400);
+	assert(tsock->rx_merge_head == NULL);
+
+	/* and a new head is held */
+	gro_input_one(tsock, 100, 0); {
+		assert(tsock->rcv_nxt == rcv_nxt + 400);
+		assert(tsock->rx_merge_head != NULL);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_RESET);
+	tcp_cfg.pkt_max_chain = PKT_MAX_CHAIN;
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	tcp_cfg.gro_timeout = GRO_TIMEOUT;
+
+	test_tcp_input_gro_across_bursts();
+	test_tcp_input_gro_timeout();
+	test_tcp_input_gro_psh();
+	test_tcp_input_gro_max_chain();
+
+	return 0;
+}
@@ -21,7 +21,7 @@ static void test_tcp_input_merge_basic(void)
 
 	ut_make_input_pkt_bulk(tsock, pkts, 4, (int []){100, 200, 150, 250});
 	ut_tcp_input(tsock, pkts, 4); {
-		assert(tsock->stats_base[PKT_RECV_MERGE] == 4);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 4);
 		assert(ut_readv(tsock, 4) == 700);
 	}
 
@@ -61,13 +61,13 @@ static void test_tcp_input_merge_ooo_reverse_order(void)
 
 	ut_tcp_input(tsock, pkts, 2); {
 		assert(ut_readv(tsock, 1) == -1 && errno == EAGAIN);
-		assert(tsock->stats_base[PKT_RECV_MERGE] == 0);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 0);
 	}
 
 	ut_tcp_input_one(tsock, pkts[2]); {
 		assert(ut_readv(tsock, 1) == 1000);
 		assert(ut_readv(tsock, 2) == 2000);
-		assert(tsock->stats_base[PKT_RECV_MERGE] == 0);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 0);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -107,7 +107,7 @@ static void test_tcp_input_merge_ooo_interleaved(void)
 
 	ut_tcp_input(tsock, pkts, 30); {
 		assert(ut_readv(tsock, 30) == 30 * 1000);
-		assert(tsock->stats_base[PKT_RECV_MERGE] == (10 + 5));
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == (10 + 5));
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -133,7 +133,7 @@ static void test_tcp_input_merge_ooo_partial_mergeable(void)
 
 	ut_tcp_input(tsock, pkts, 8); {
 		assert(ut_readv(tsock, 8) == 8000);
-		assert(tsock->stats_base[PKT_RECV_MERGE] == 2 + 2);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 2 + 2);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -195,7 +195,7 @@ static void test_tcp_input_merge_seq_overlap(void)
 		}
 
 		/* no merge is enabled for ooo pkts */
-		assert(tsock->stats_base[PKT_RECV_MERGE] == 0);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 0);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -308,7 +308,7 @@ static void test_tcp_input_merge_ts_opt(void)
 		assert(ut_readv(tsock, 2) == 2000);
 
 		/* pkt has diff ts, should not be merged */
-		assert(tsock->stats_base[PKT_RECV_MERGE] == 0);
+		assert(tsock->stats->stats_base[PKT_RECV_MERGE] == 0);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -345,8 +345,8 @@ static void test_tcp_input_merge_multi_sock(void)
 		assert(ut_readv(tsock1, 4) == 4000);
 		assert(ut_readv(tsock2, 4) == 4000);
 
-		assert(tsock1->stats_base[PKT_RECV_MERGE] == 0);
-		assert(tsock2->stats_base[PKT_RECV_MERGE] == 4);
+		assert(tsock1->stats->stats_base[PKT_RECV_MERGE] == 0);
+		assert(tsock2->stats->stats_base[PKT_RECV_MERGE] == 4);
 	}
 
 	ut_close(tsock1, CLOSE_TYPE_4WAY);
@@ -0,0 +1,103 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_utils.h"
+
+/*
+ * The rx pps when each burst spans many socks: each pkt goes to a
+ * different sock, picked in a random order, so that the tsock is
+ * (most likely) a cache miss once there are enough socks.
+ */
+
+#define NR_SOCK_MAX		10000
+#define DATA_SIZE		64
+
+static struct tcp_sock *socks[NR_SOCK_MAX];
+static int nr_sock_connected;
+static int order[NR_SOCK_MAX];
+
+static void connect_socks(int nr_sock)
+{
+	for (; nr_sock_connected < nr_sock; nr_sock_connected++)
+		socks[nr_sock_connected] = ut_tcp_connect();
+}
+
+static void shuffle_order(int nr_sock)
+{
+	int i, j, tmp;
+
+	for (i = 0; i < nr_sock; i++)
+		order[i] = i;
+
+	for (i = nr_sock - 1; i > 0; i--) {
+		j = rand() % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+}
+
+static void tcp_input_multi_bench(int nr_sock)
+{
+	struct packet *pkts[BATCH_SIZE];
+	struct tcp_sock *tsock;
+	uint64_t nr_pkt = 0;
+	uint64_t cycles = 0;
+	uint64_t start;
+	int cursor = 0;
+	int i;
+
+	printf("testing tcp rcv bench [%d socks] ...\n", nr_sock);
+
+	connect_socks(nr_sock);
+	shuffle_order(nr_sock);
+
+	WHILE_NOT_TIME_UP() {
+		cycles_update_begin(worker);
+		ut_timer_process();
+
+		for (i = 0; i < BATCH_SIZE; i++) {
+			tsock = socks[order[(cursor + i) % nr_sock]];
+			pkts[i] = ut_inject_data_packet(tsock, tsock->rcv_nxt, DATA_SIZE);
+		}
+
+		start = rte_rdtsc();
+		ut_tcp_input_raw(NULL, pkts, BATCH_SIZE);
+		cycles += rte_rdtsc() - start;
+		nr_pkt += BATCH_SIZE;
+
+		for (i = 0; i < BATCH_SIZE; i++) {
+			tsock = socks[order[(cursor + i) % nr_sock]];
+			assert(ut_readv(tsock, 1) == DATA_SIZE);
+		}
+		cursor = (cursor + BATCH_SIZE) % nr_sock;
+
+		ut_tcp_output_skip_csum_verify(NULL, -1);
+	}
+
+	printf(":: %d socks: %.3f Mpps (%.1f cycles/pkt)\n", nr_sock,
+	       (double)nr_pkt * rte_get_tsc_hz() / cycles / 1e6,
+	       (double)cycles / nr_pkt);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	/* no GRO hold: each pkt is read right after the burst */
+	tcp_cfg.gro_timeout = 0;
+
+	tcp_input_multi_bench(BATCH_SIZE);
+	tcp_input_multi_bench(1000);
+	tcp_input_multi_bench(NR_SOCK_MAX);
+
+	ut_tcp_output(NULL, -1);
+	ut_assert_mbuf_count();
+
+	return 0;
+}
@@ -11,16 +11,37 @@
 
 static void ooo_queue_sanity_check(struct tcp_sock *tsock)
 {
+	struct ooo_index *idx = &tsock->ooo_index;
 	struct packet *prev = NULL;
 	struct packet *pkt;
+	uint32_t i = 0;
 
 	TAILQ_FOREACH(pkt, &tsock->rcv_ooo_queue, node) {
 		if (prev) {
 			assert(seq_lt(TCP_SEG(prev)->seq, TCP_SEG(pkt)->seq));
 			assert(seq_lt(TCP_SEG(prev)->seq + TCP_SEG(prev)->len - 1, TCP_SEG(pkt)->seq));
 		}
+
+		/* a new run starts at each hole */
+		if (!prev || TCP_SEG(prev)->seq + TCP_SEG(prev)->len != TCP_SEG(pkt)->seq) {
+			if (prev) {
+				assert(idx->runs[i].tail == prev);
+				assert(idx->runs[i].end == TCP_SEG(prev)->seq + TCP_SEG(prev)->len);
+				i += 1;
+			}
+
+			assert(i < idx->nr);
+			assert(idx->runs[i].head == pkt);
+			assert(idx->runs[i].start == TCP_SEG(pkt)->seq);
+		}
 		prev = pkt;
 	}
+
+	if (prev) {
+		assert(idx->runs[i].tail == prev);
+		i += 1;
+	}
+	assert(i == idx->nr);
 }
 
 static void test_tcp_input_ooo_basic(void)
@@ -155,33 +176,39 @@ static void test_tcp_input_ooo_tcp_rxq_enqueue_failure(void)
 
 	tsock = ut_tcp_connect();
 
+	/*
+	 * The rxq holds all the wnd we advertise. Therefore, to fill the
+	 * rxq, pretend we have advertised more than that.
+	 */
+	tsock->rcv_wnd = (tsock->rxq.size + 2) * 1400;
+
 	/* make sure tcp_cfg.rcv_ooo_limit equal to rxq size */
 	tcp_cfg.rcv_ooo_limit = tsock->rxq.size;
 	for (i = 0; i < tsock->rxq.size; i++) {
-		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + (i + 1) * 1000, 1000);
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + (i + 1) * 1400, 1400);
 		ut_tcp_input_one(tsock, pkt); {
 			assert(tsock->nr_ooo_pkt == i + 1);
 		}
 	}
 
 	/* fill the hole */
-	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
 	ut_tcp_input_one(tsock, pkt); {
 		/*
 		 * the rxq is full; we have one more IN-ORDER pkt left
 		 * in the ooo queue
 		 */
 		assert(tsock->nr_ooo_pkt == 1);
-		assert(tsock->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
+		assert(tsock->stats->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
 	}
 
 	/* drain the tcp rxq */
-	assert(ut_readv(tsock, tsock->rxq.size) == tsock->rxq.size * 1000);
+	assert(ut_readv(tsock, tsock->rxq.size) == tsock->rxq.size * 1400);
 
 	/* reject last pkt should deliver above IN-ORDER pkt in ooo queue to tsock rxq */
-	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
 	ut_tcp_input_one(tsock, pkt); {
-		assert(ut_readv(tsock, tsock->rxq.size) == 1000);
+		assert(ut_readv(tsock, tsock->rxq.size) == 1400);
 		assert(tsock->nr_ooo_pkt == 0);
 		assert(tsock->nr_sack_block == 0);
 	}
@@ -199,33 +226,39 @@ static void test_tcp_input_ooo_tcp_rxq_enqueue_failure2(void)
 
 	tsock = ut_tcp_connect();
 
+	/*
+	 * The rxq holds all the wnd we advertise. Therefore, to fill the
+	 * rxq, pretend we have advertised more than that.
+	 */
+	tsock->rcv_wnd = (tsock->rxq.size + 2) * 1400;
+
 	/* make sure tcp_cfg.rcv_ooo_limit equal to rxq size */
 	tcp_cfg.rcv_ooo_limit = tsock->rxq.size;
 	for (i = 0; i < tsock->rxq.size; i++) {
-		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + (i + 1) * 1000, 1000);
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + (i + 1) * 1400, 1400);
 		ut_tcp_input_one(tsock, pkt); {
 			assert(tsock->nr_ooo_pkt == i + 1);
 		}
 	}
 
 	/* fill the hole */
-	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
 	ut_tcp_input_one(tsock, pkt); {
 		/*
 		 * the rxq is full; we have one more IN-ORDER pkt left
 		 * in the ooo queue
 		 */
 		assert(tsock->nr_ooo_pkt == 1);
-		assert(tsock->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
+		assert(tsock->stats->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
 	}
 
 	/* drain the tcp rxq */
-	assert(ut_readv(tsock, tsock->rxq.size) == tsock->rxq.size * 1000);
+	assert(ut_readv(tsock, tsock->rxq.size) == tsock->rxq.size * 1400);
 
 	/* inject a new data should deliver above IN-ORDER pkt in ooo queue to tsock rxq */
-	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000, 1000);
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1400, 1400);
 	ut_tcp_input_one(tsock, pkt); {
-		assert(ut_readv(tsock, tsock->rxq.size) == 1000 * 2);
+		assert(ut_readv(tsock, tsock->rxq.size) == 1400 * 2);
 		assert(tsock->nr_ooo_pkt == 0);
 		assert(tsock->nr_sack_block == 0);
 	}
@@ -243,33 +276,39 @@ static void test_tcp_input_ooo_tcp_rxq_enqueue_failure3(void)
 
 	tsock = ut_tcp_connect();
 
+	/*
+	 * The rxq holds all the wnd we advertise. Therefore, to fill the
+	 * rxq, pretend we have advertised more than that.
+	 */
+	tsock->rcv_wnd = (tsock->rxq.size + 2) * 1400;
+
 	/* make sure tcp_cfg.rcv_ooo_limit equal to rxq size */
 	tcp_cfg.rcv_ooo_limit = tsock->rxq.size;
 	for (i = 0; i < tsock->rxq.size; i++) {
-		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + (i + 1) * 1000, 1000);
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + (i + 1) * 1400, 1400);
 		ut_tcp_input_one(tsock, pkt); {
 			assert(tsock->nr_ooo_pkt == i + 1);
 		}
 	}
 
 	/* fill the hole */
-	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
 	ut_tcp_input_one(tsock, pkt); {
 		/*
 		 * the rxq is full; we have one more IN-ORDER pkt left
 		 * in the ooo queue
 		 */
 		assert(tsock->nr_ooo_pkt == 1);
-		assert(tsock->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
+		assert(tsock->stats->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
 	}
 
 	/* drain the tcp rxq */
-	assert(ut_readv(tsock, tsock->rxq.size) == tsock->rxq.size * 1000);
+	assert(ut_readv(tsock, tsock->rxq.size) == tsock->rxq.size * 1400);
 
 	/* reject (partial of) last pkt should deliver above IN-ORDER pkt in ooo queue to tsock rxq */
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1);
 	ut_tcp_input_one(tsock, pkt); {
-		assert(ut_readv(tsock, tsock->rxq.size) == 1000);
+		assert(ut_readv(tsock, tsock->rxq.size) == 1400);
 		assert(tsock->nr_ooo_pkt == 0);
 	}
 
@@ -285,22 +324,23 @@ static void test_tcp_input_ooo_predict(void)
 
 	tsock = ut_tcp_connect();
 
-	pkts[0] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000, 1001);
-	pkts[1] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 2001, 1002);
-	pkts[2] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 3003, 1003);
-	pkts[3] = ut_inject_data_packet(tsock, tsock->rcv_nxt,        1000);
+	/* no smaller than TSOCK_RCV_SLOT_BYTES: each takes a rxq slot */
+	pkts[0] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1400, 1401);
+	pkts[1] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 2801, 1402);
+	pkts[2] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 4203, 1403);
+	pkts[3] = ut_inject_data_packet(tsock, tsock->rcv_nxt,        1400);
 
 	ut_tcp_input(tsock, pkts, 4); {
 		assert(tcp_rxq_readable_count(&tsock->rxq) == 4);
 		assert(tsock->nr_ooo_pkt == 0);
 		assert(tsock->nr_sack_block == 0);
 		assert(tsock->last_ooo_pkt == NULL);
-		assert(tsock->stats_base[PKT_RECV_OOO_PREDICT] == 2);
+		assert(tsock->stats->stats_base[PKT_RECV_OOO_PREDICT] == 2);
 
-		assert(ut_readv(tsock, 1) == 1000);
-		assert(ut_readv(tsock, 1) == 1001);
-		assert(ut_readv(tsock, 1) == 1002);
-		assert(ut_readv(tsock, 1) == 1003);
+		assert(ut_readv(tsock, 1) == 1400);
+		assert(ut_readv(tsock, 1) == 1401);
+		assert(ut_readv(tsock, 1) == 1402);
+		assert(ut_readv(tsock, 1) == 1403);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -323,7 +363,7 @@ static void test_tcp_input_ooo_predict_overlap(void)
 	ut_tcp_input(tsock, pkts, 3); {
 		assert(tcp_rxq_readable_count(&tsock->rxq) == 0);
 		assert(tsock->nr_ooo_pkt == 3);
-		assert(tsock->stats_base[PKT_RECV_OOO_PREDICT] == 0);
+		assert(tsock->stats->stats_base[PKT_RECV_OOO_PREDICT] == 0);
 
 		pkt = TAILQ_FIRST(&tsock->rcv_ooo_queue);
 		assert(TCP_SEG(pkt)->seq == tsock->rcv_nxt + 1000 && TCP_SEG(pkt)->len == 500);
@@ -338,12 +378,81 @@ static void test_tcp_input_ooo_predict_overlap(void)
 	ut_close(tsock, CLOSE_TYPE_4WAY);
 }
 
+static void test_tcp_input_ooo_run_merge(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkts[3];
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	pkts[0] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000, 1000);
+	pkts[1] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 3000, 1000);
+	pkts[2] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 2000, 1000);
+
+	ut_tcp_input(tsock, pkts, 2); {
+		ooo_queue_sanity_check(tsock);
+		assert(tsock->ooo_index.nr == 2);
+		assert(tsock->nr_sack_block == 2);
+	}
+
+	/* the hole between the 2 runs is filled */
+	ut_tcp_input(tsock, &pkts[2], 1); {
+		ooo_queue_sanity_check(tsock);
+		assert(tsock->nr_ooo_pkt == 3);
+		assert(tsock->ooo_index.nr == 1);
+		assert(tsock->nr_sack_block == 1);
+		assert(tsock->sack_blocks[0].start == tsock->rcv_nxt + 1000);
+		assert(tsock->sack_blocks[0].end   == tsock->rcv_nxt + 4000);
+	}
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* the sack blocks never report the ooo pkts have been dropped */
+static void test_tcp_input_ooo_drop_sack(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkts[2];
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	pkts[0] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000, 1000);
+	pkts[1] = ut_inject_data_packet(tsock, tsock->rcv_nxt + 3000, 1000);
+
+	ut_tcp_input(tsock, pkts, 2); {
+		assert(tsock->nr_sack_block == 2);
+	}
+
+	tsock_drop_ooo_mbufs(tsock); {
+		ooo_queue_sanity_check(tsock);
+		assert(tsock->nr_ooo_pkt == 1);
+		assert(tsock->nr_sack_block == 1);
+		assert(tsock->sack_blocks[0].start == tsock->rcv_nxt + 1000);
+		assert(tsock->sack_blocks[0].end   == tsock->rcv_nxt + 2000);
+	}
+
+	tsock_drop_ooo_mbufs(tsock); {
+		assert(tsock->nr_ooo_pkt == 0);
+		assert(tsock->ooo_index.nr == 0);
+		assert(tsock->nr_sack_block == 0);
+	}
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
 static void test_tcp_input_ooo_stress(void)
 {
 	struct tcp_sock *tsock;
 	struct packet *pkt;
 	struct packet *p;
 	struct tpa_iovec iov;
+	uint32_t rcv_wnd;
 	uint32_t seq;
 	uint32_t end;
 	uint16_t len;
@@ -352,6 +461,7 @@ static void test_tcp_input_ooo_stress(void)
 	printf("stressing tcp_input with out of order rcv ...\n");
 
 	tsock = ut_tcp_connect();
+	rcv_wnd = tsock->rcv_wnd;
 
 	for (i = 0; i < 8192; i++) {
 		seq = rand() % tsock->rcv_wnd;
@@ -408,7 +518,7 @@ static void test_tcp_input_ooo_stress(void)
 
 	assert(tsock->nr_ooo_pkt == 0);
 	assert(tsock->nr_sack_block == 0);
-	assert(tsock->stats_base[BYTE_RECV] == TSOCK_RCV_WND_DEFAULT(tsock));
+	assert(tsock->stats->stats_base[BYTE_RECV] == rcv_wnd);
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
 }
@@ -461,6 +571,8 @@ int main(int argc, char *argv[])
 	test_tcp_input_ooo_tcp_rxq_enqueue_failure3();
 	test_tcp_input_ooo_predict();
 	test_tcp_input_ooo_predict_overlap();
+	test_tcp_input_ooo_run_merge();
+	test_tcp_input_ooo_drop_sack();
 	test_tcp_input_ooo_stress();
 	test_tcp_input_ooo_stress_harder();
 
@@ -0,0 +1,115 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "test_utils.h"
+
+#define NR_SEG			1024
+#define SEG_SIZE		1000
+
+enum {
+	REORDER_INTERLEAVE,	/* odd segs first, then the even ones backward */
+	REORDER_SHUFFLE,
+};
+
+static void gen_order(int *order, int type)
+{
+	int nr = 0;
+	int tmp;
+	int i;
+	int j;
+
+	/* seg 0 is always the last one: it drains the whole ooo queue */
+	if (type == REORDER_INTERLEAVE) {
+		for (i = 1; i < NR_SEG; i += 2)
+			order[nr++] = i;
+		for (i = (NR_SEG - 1) & ~1; i > 0; i -= 2)
+			order[nr++] = i;
+	} else {
+		for (i = 1; i < NR_SEG; i++)
+			order[nr++] = i;
+		for (i = nr - 1; i > 0; i--) {
+			j = rand() % (i + 1);
+			tmp = order[i];
+			order[i] = order[j];
+			order[j] = tmp;
+		}
+	}
+	order[nr++] = 0;
+
+	assert(nr == NR_SEG);
+}
+
+/*
+ * A window of NR_SEG segs is received in a reorder heavy way per round;
+ * the ooo queue grows up to NR_SEG - 1 pkts, with up to NR_SEG / 2 holes.
+ */
+static void tcp_input_ooo_bench(const char *name, int type)
+{
+	static int order[NR_SEG];
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint64_t cycles = 0;
+	uint64_t nr_pkt = 0;
+	uint64_t start;
+	uint32_t base;
+	int i;
+
+	printf("testing tcp_input bench [ooo: %s] ...\n", name);
+
+	tcp_cfg.rcv_ooo_limit = NR_SEG;
+	tsock = ut_tcp_connect();
+
+	WHILE_NOT_TIME_UP() {
+		gen_order(order, type);
+
+		base = tsock->rcv_nxt;
+		for (i = 0; i < NR_SEG; i++) {
+			pkt = ut_inject_data_packet(tsock, base + order[i] * SEG_SIZE, SEG_SIZE);
+
+			start = rte_rdtsc();
+			ut_tcp_input_one(tsock, pkt);
+			cycles += rte_rdtsc() - start;
+			nr_pkt += 1;
+
+			/* drain acks */
+			ut_tcp_output(NULL, -1);
+		}
+
+		assert(tsock->rcv_nxt == base + NR_SEG * SEG_SIZE);
+		assert(tsock->nr_ooo_pkt == 0);
+		assert(tsock->ooo_index.nr == 0);
+		assert(tsock->nr_sack_block == 0);
+		assert(ut_readv(tsock, NR_SEG) == NR_SEG * SEG_SIZE);
+
+		ut_measure_rate(tsock, 1000 * 1000);
+	}
+
+	printf("\t%-16s: %.1f cycles/pkt\n", name, (double)cycles / RTE_MAX(nr_pkt, 1ul));
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	tcp_cfg.rcv_ooo_limit = TSOCK_RCV_OOO_LIMIT;
+}
+
+static void test_tcp_input_ooo_bench_interleave(void)
+{
+	tcp_input_ooo_bench("interleave", REORDER_INTERLEAVE);
+}
+
+static void test_tcp_input_ooo_bench_shuffle(void)
+{
+	tcp_input_ooo_bench("shuffle", REORDER_SHUFFLE);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_tcp_input_ooo_bench_interleave();
+	test_tcp_input_ooo_bench_shuffle();
+
+	return 0;
+}
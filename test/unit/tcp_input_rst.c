@@ -22,7 +22,7 @@ static void test_tcp_input_rst_at_CLOSED(void)
 
 	pkt = ut_inject_rst_packet(tsock);
 	ut_tcp_input_one(tsock, pkt); {
-		assert(tsock->stats_base[PKT_RECV_AFTER_CLOSE] == 1);
+		assert(tsock->stats->stats_base[PKT_RECV_AFTER_CLOSE] == 1);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_CLOSE_DIRECTLY);
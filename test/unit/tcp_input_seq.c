@@ -32,10 +32,10 @@ static uint32_t wnd;
 	struct packet *pkt;						\
 									\
 	pkt = ut_inject_data_packet(tsock, seq, payload_len);		\
-	tsock->stats_base[ERR_TCP_INVALID_SEQ] = 0;			\
+	tsock->stats->stats_base[ERR_TCP_INVALID_SEQ] = 0;			\
 	ut_tcp_input_one(tsock, pkt);					\
 									\
-	assert(tsock->stats_base[ERR_TCP_INVALID_SEQ] == err);		\
+	assert(tsock->stats->stats_base[ERR_TCP_INVALID_SEQ] == err);		\
 	/* reset rcv_nxt and rcv_wnd*/					\
 	tsock->rcv_nxt = UINT32_MAX;					\
 	tsock->rcv_wnd = wnd;						\
@@ -6,46 +6,84 @@
 #include <stdio.h>
 #include <getopt.h>
 #include <sys/uio.h>
+#include <unistd.h>
 
 #include "test_utils.h"
 
+/* the advertised right edge of the rcv wnd never moves left (RFC 9293 3.8.6) */
+#define assert_right_edge(tsock, edge)	do {				\
+	uint32_t __edge = (tsock)->rcv_nxt + (tsock)->rcv_wnd;		\
+	assert(seq_ge(__edge, edge));					\
+	edge = __edge;							\
+} while (0)
+
 static void test_tcp_input_wnd_basic(void)
 {
 	struct tcp_sock *tsock;
 	struct packet *pkt;
-	struct tpa_iovec iov[3];
-	int sum = 0;
+	uint32_t rcv_nxt;
+	uint32_t edge;
+	uint32_t wnd;
 	int i;
 
 	printf("testing tcp rcv wnd basic ...\n");
 
 	tsock = ut_tcp_connect();
-
+	wnd = tsock->rcv_wnd;
+	edge = tsock->rcv_nxt + tsock->rcv_wnd;
+	assert(wnd == tsock->rxq.size * TSOCK_RCV_SLOT_BYTES);
+
+	/*
+	 * More tiny segs than the rxq slots: they are all within the wnd,
+	 * and they are packed into the rxq instead of being dropped.
+	 */
 	for (i = 0; i < TSOCK_RXQ_LEN_DEFAULT + 1; i++) {
 		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1);
 		ut_tcp_input_one(tsock, pkt); {
-			assert(tsock->rcv_wnd > 0);
-			assert(tsock->rcv_wnd < TCP_WINDOW_MAX);
+			assert(tsock->rcv_wnd == wnd - i - 1);
+			assert_right_edge(tsock, edge);
 
 			/* drain */
 			ut_tcp_output(NULL, -1);
 		}
 	}
-	assert(tcp_rxq_free_count(&tsock->rxq) == 0);
-	assert(tsock->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 1);
+	assert(tcp_rxq_readable_count(&tsock->rxq) == 2);
+	assert(tsock->stats->stats_base[RXQ_COALESCE] == TSOCK_RXQ_LEN_DEFAULT - 1);
 
-	while (sum < TSOCK_RXQ_LEN_DEFAULT) {
-		int size;
+	/* keep sending till the wnd is closed: the rxq holds it all */
+	while (tsock->rcv_wnd) {
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
+		ut_tcp_input_one(tsock, pkt); {
+			assert(tsock->rcv_wnd < TCP_WINDOW_MAX);
+			assert_right_edge(tsock, edge);
 
-		size = tpa_zreadv(tsock->sid, iov, 3);
-		assert(size > 0 && size <= 3);
+			ut_tcp_output(NULL, -1);
+		}
+	}
+	assert(tsock->rcv_nxt == edge);
+	assert(tcp_rxq_free_count(&tsock->rxq) == 0);
+	assert(tsock->stats->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 0);
 
-		for (i = 0; i < size; i++)
-			iov[i].iov_read_done(iov[i].iov_base, iov[i].iov_param);
+	/* the peer is held back by the zero wnd */
+	rcv_nxt = tsock->rcv_nxt;
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
+	ut_tcp_input_one(tsock, pkt); {
+		assert(tsock->rcv_nxt == rcv_nxt);
+		assert(tsock->stats->stats_base[ERR_TCP_RXQ_ENQUEUE_FAIL] == 0);
 
-		sum += size;
+		assert(ut_tcp_output(&pkt, 1) == 1); {
+			assert(TCP_SEG(pkt)->len == 0);
+			assert(ut_packet_tcp_hdr(pkt)->rx_win == 0);
+			packet_free(pkt);
+		}
+	}
+
+	assert(ut_readv(tsock, TSOCK_RXQ_LEN_DEFAULT * 2) == wnd); {
+		assert(tsock->rcv_wnd == wnd);
+		assert_right_edge(tsock, edge);
 	}
 
+	ut_tcp_output(NULL, -1);
 	ut_close(tsock, CLOSE_TYPE_4WAY);
 	printf("\trcv_wnd: %u\n", tsock->rcv_wnd);
 }
@@ -55,16 +93,19 @@ static void test_tcp_input_wnd_full(void)
 	struct tcp_sock *tsock;
 	struct packet *pkt;
 	struct tpa_iovec iov;
+	uint32_t edge;
 	int i;
 
 	printf("testing tcp rcv wnd full ...\n");
 
 	tsock = ut_tcp_connect();
+	edge = tsock->rcv_nxt + tsock->rcv_wnd;
 
 	for (i = 0; i < TSOCK_RXQ_LEN_DEFAULT; i++) {
 		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
 		ut_tcp_input_one(tsock, pkt); {
 			assert(tsock->rcv_wnd < TCP_WINDOW_MAX);
+			assert_right_edge(tsock, edge);
 
 			/* drain */
 			ut_tcp_output(NULL, -1);
@@ -77,11 +118,12 @@ static void test_tcp_input_wnd_full(void)
 	/* test window update */
 	tpa_zreadv(tsock->sid, &iov, 1); {
 		iov.iov_read_done(iov.iov_base, iov.iov_param);
+		assert_right_edge(tsock, edge);
 
 		assert(ut_tcp_output(&pkt, 1) == 1); {
 			assert(TCP_SEG(pkt)->len == 0);
 			assert(TCP_SEG(pkt)->flags == TCP_FLAG_ACK);
-			assert(tsock->stats_base[WND_UPDATE] == 1);
+			assert(tsock->stats->stats_base[WND_UPDATE] == 1);
 
 			packet_free(pkt);
 		}
@@ -91,12 +133,83 @@ static void test_tcp_input_wnd_full(void)
 	printf("\trcv_wnd: %u\n", tsock->rcv_wnd);
 }
 
+/* the app drains fast: the rxq is grown, and so is the wnd */
+static void test_tcp_input_wnd_autotune(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t threshold;
+	uint32_t edge;
+	uint32_t wnd;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->srtt = 1000 << 3;
+	wnd = tsock->rcv_wnd;
+	edge = tsock->rcv_nxt + tsock->rcv_wnd;
+
+	for (i = 0; i < TSOCK_RXQ_LEN_DEFAULT; i++) {
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
+		ut_tcp_input_one(tsock, pkt);
+		ut_tcp_output(NULL, -1);
+		assert_right_edge(tsock, edge);
+	}
+
+	/* an rtt later, the whole wnd is read */
+	usleep(2 * 1000);
+	ut_tcp_output(NULL, -1);
+	assert(ut_readv(tsock, TSOCK_RXQ_LEN_DEFAULT) == TSOCK_RXQ_LEN_DEFAULT * 1400); {
+		assert(tsock->rxq.size == TSOCK_RXQ_LEN_DEFAULT * 2);
+		assert(tsock->stats->stats_base[RXQ_GROW] == 1);
+		assert(tsock->rcv_wnd == 2 * wnd);
+		assert_right_edge(tsock, edge);
+	}
+
+	/*
+	 * It's shrunk back under mbuf pressure; but not while the wnd we
+	 * have advertised takes more than the half of the rxq.
+	 */
+	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
+	ut_tcp_input_one(tsock, pkt);
+	threshold = tcp_cfg.drop_ooo_threshold;
+	tcp_cfg.drop_ooo_threshold = 0;
+	assert(ut_readv(tsock, 1) == 1400); {
+		assert(tsock->rxq.size == TSOCK_RXQ_LEN_DEFAULT * 2);
+		assert(tsock->stats->stats_base[RXQ_SHRINK] == 0);
+		assert_right_edge(tsock, edge);
+	}
+	tcp_cfg.drop_ooo_threshold = threshold;
+
+	/* the peer takes the first half of the wnd */
+	for (i = 0; i < TSOCK_RXQ_LEN_DEFAULT; i++) {
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1400);
+		ut_tcp_input_one(tsock, pkt);
+		ut_tcp_output(NULL, -1);
+	}
+	assert(tsock->rcv_wnd == wnd);
+
+	tcp_cfg.drop_ooo_threshold = 0;
+	assert(ut_readv(tsock, TSOCK_RXQ_LEN_DEFAULT) == TSOCK_RXQ_LEN_DEFAULT * 1400); {
+		assert(tsock->rxq.size == TSOCK_RXQ_LEN_DEFAULT);
+		assert(tsock->stats->stats_base[RXQ_SHRINK] == 1);
+		assert(tsock->rcv_wnd == wnd);
+		assert_right_edge(tsock, edge);
+	}
+	tcp_cfg.drop_ooo_threshold = threshold;
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
 int main(int argc, char **argv)
 {
 	ut_init(argc, argv);
 
 	test_tcp_input_wnd_basic();
 	test_tcp_input_wnd_full();
+	test_tcp_input_wnd_autotune();
 
 	return 0;
 }
@@ -248,7 +248,7 @@ static void test_tcp_listen_invalid_pkt(void)
 		assert(listen_tsock->state == TCP_STATE_LISTEN);
 
 		assert(ut_tcp_output(NULL, 1) == 0);
-		assert(listen_tsock->stats_base[WARN_INVLIAD_PKT_AT_LISTEN] == 1);
+		assert(listen_tsock->stats->stats_base[WARN_INVLIAD_PKT_AT_LISTEN] == 1);
 	}
 
 	ut_close(listen_tsock, CLOSE_TYPE_CLOSE_DIRECTLY);
@@ -293,6 +293,59 @@ static void test_tcp_listen_dup_syn(void)
 	ut_close(listen_tsock, CLOSE_TYPE_CLOSE_DIRECTLY);
 }
 
+/*
+ * The same SYN a few times in one rx burst: all of them are looked up
+ * to the listen tsock before the first one creates the child.
+ */
+static void test_tcp_listen_dup_syn_in_burst(void)
+{
+	struct tcp_sock *listen_tsock;
+	struct tcp_sock *tsock;
+	struct packet *pkts[3];
+	int nr_sock;
+	int nr_pkt;
+	int sid;
+	int i;
+
+	printf(":: %s\n", __func__);
+
+	sid = listen_random_port(NULL, NULL); {
+		assert(sid >= 0 && sid < tcp_cfg.nr_max_sock);
+		listen_tsock = &sock_ctrl->socks[sid];
+	}
+
+	nr_sock = rte_atomic32_read(&sock_ctrl->nr_sock);
+
+	pkts[0] = inject_syn_packet(listen_tsock);
+	pkts[1] = inject_syn_packet(listen_tsock);
+	pkts[2] = inject_syn_packet(listen_tsock);
+	ut_tcp_input(listen_tsock, pkts, 3); {
+		/* one child only */
+		assert(rte_atomic32_read(&sock_ctrl->nr_sock) == nr_sock + 1);
+
+		nr_pkt = ut_tcp_output(pkts, 3);
+		assert(nr_pkt >= 1); {
+			tsock = find_tsock_by_synack_pkt(pkts[0]);
+
+			/* the rest are the ACKs for the dup SYNs */
+			for (i = 1; i < nr_pkt; i++)
+				assert(TCP_SEG(pkts[i])->flags == TCP_FLAG_ACK);
+
+			for (i = 0; i < nr_pkt; i++)
+				packet_free(pkts[i]);
+		}
+	}
+
+	pkts[0] = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkts[0]); {
+		assert(tsock->state == TCP_STATE_ESTABLISHED);
+		assert(accept_one_tsock(tsock->sid, NULL) == tsock);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	ut_close(listen_tsock, CLOSE_TYPE_CLOSE_DIRECTLY);
+}
+
 static void test_tcp_listen_port(void)
 {
 	struct tcp_sock *listen_tsock;
@@ -478,7 +531,7 @@ static void test_tcp_listen_recv_ack(void)
 		assert(ut_tcp_output(&pkt, 1) == 1); {
 			assert(TCP_SEG(pkt)->flags == TCP_FLAG_RST);
 			assert(TCP_SEG(pkt)->len == 0);
-			assert(listen_tsock->stats_base[WARN_ACK_AT_LISTEN] == 1);
+			assert(listen_tsock->stats->stats_base[WARN_ACK_AT_LISTEN] == 1);
 		}
 	}
 
@@ -635,6 +688,7 @@ int main(int argc, char *argv[])
 	test_tcp_listen_synack_data_before_offload();
 	test_tcp_listen_invalid_pkt();
 	test_tcp_listen_dup_syn();
+	test_tcp_listen_dup_syn_in_burst();
 	test_tcp_listen_port();
 	test_tcp_listen_port2();
 	test_tcp_listen_synack_retry();
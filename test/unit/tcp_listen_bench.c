@@ -0,0 +1,153 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+/*
+ * Simulates a SYN flood: many workers looking up the listen table
+ * concurrently. The spinlock protected table is measured as well,
+ * as a baseline.
+ */
+
+#define MAX_NR_THREAD		8
+#define NR_LOOKUP_PER_ROUND	1024
+
+struct lookup_arg {
+	struct rcu_reader rcu;
+	int locked;
+	uint64_t nr_lookup;
+} __rte_cache_aligned;
+
+static volatile int quit;
+static struct packet *syn_pkt;
+static struct tcp_sock *listen_tsock;
+static struct sock_table locked_table;
+static struct sock_key listen_key;
+
+static void *do_lookup(void *_arg)
+{
+	struct lookup_arg *arg = _arg;
+	struct tcp_sock *tsock;
+	int i;
+
+	assert(rcu_reader_register(&arg->rcu) == 0);
+
+	while (!quit) {
+		for (i = 0; i < NR_LOOKUP_PER_ROUND; i++) {
+			if (arg->locked) {
+				tsock = sock_table_lookup_lock(&locked_table, &listen_key);
+			} else {
+				tsock = NULL;
+				assert(listen_tsock_lookup(syn_pkt, &tsock) == 0);
+			}
+			assert(tsock == listen_tsock);
+		}
+
+		arg->nr_lookup += NR_LOOKUP_PER_ROUND;
+		rcu_quiescent(&arg->rcu);
+	}
+
+	rcu_reader_unregister(&arg->rcu);
+
+	return NULL;
+}
+
+static void listen_and_close(void)
+{
+	struct tcp_sock *tsock;
+	int sid;
+
+	sid = tpa_listen_on(NULL, SERVER_PORT + 1 + (rand() % 1000), NULL);
+	if (sid < 0)
+		return;
+
+	/* not ut_close: the syn pkt is still held */
+	tsock = &sock_ctrl->socks[sid];
+	tpa_close(sid);
+	ut_tcp_output(NULL, -1);
+	assert(tsock->state == TCP_STATE_CLOSED);
+}
+
+static void bench_listen_lookup(int nr_thread, int locked, int with_update)
+{
+	struct lookup_arg args[MAX_NR_THREAD];
+	pthread_t tids[MAX_NR_THREAD];
+	uint64_t nr_lookup = 0;
+	uint64_t nr_update = 0;
+	uint64_t start;
+	uint64_t cycles;
+	int i;
+
+	printf("testing listen lookup bench [%d threads, %s%s] ...\n", nr_thread,
+	       locked ? "spinlock" : "rcu", with_update ? ", with update" : "");
+
+	quit = 0;
+	memset(args, 0, sizeof(args));
+	start = rte_rdtsc();
+	for (i = 0; i < nr_thread; i++) {
+		args[i].locked = locked;
+		ut_spawn_thread(&tids[i], do_lookup, &args[i]);
+	}
+
+	WHILE_NOT_TIME_UP() {
+		if (with_update) {
+			listen_and_close();
+			nr_update += 1;
+		}
+
+		rcu_quiescent(&worker->rcu);
+		rcu_reclaim();
+	}
+
+	quit = 1;
+	for (i = 0; i < nr_thread; i++) {
+		pthread_join(tids[i], NULL);
+		nr_lookup += args[i].nr_lookup;
+	}
+	cycles = rte_rdtsc() - start;
+
+	printf("\t%-16s: %.2f Mlookups/s; %lu updates\n", "total",
+	       (double)nr_lookup * rte_get_tsc_hz() / cycles / 1e6, nr_update);
+}
+
+int main(int argc, char *argv[])
+{
+	int sid;
+	int n;
+
+	ut_init(argc, argv);
+
+	ut_test_opts.duration = 1;
+	ut_test_opts.silent = 1;
+
+	sid = tpa_listen_on(NULL, SERVER_PORT, NULL);
+	assert(sid >= 0);
+	listen_tsock = &sock_ctrl->socks[sid];
+
+	syn_pkt = ut_make_packet(1, listen_tsock->local_port, INVALID_FLOW_ID);
+	ut_tcp_set_hdr(syn_pkt, 0, 0, TCP_FLAG_SYN, 65535);
+	ut_ip_set_hdr(syn_pkt, 0, 0);
+	assert(parse_tcp_packet(syn_pkt) == 0);
+
+	memset(&listen_key, 0, sizeof(listen_key));
+	listen_key.local_port = SERVER_PORT;
+	assert(sock_table_init_with_size(&locked_table, 16) == 0);
+	assert(sock_table_add(&locked_table, &listen_key, listen_tsock) == 0);
+
+	for (n = 1; n <= MAX_NR_THREAD; n *= 2) {
+		bench_listen_lookup(n, 1, 0);
+		bench_listen_lookup(n, 0, 0);
+	}
+	bench_listen_lookup(MAX_NR_THREAD, 0, 1);
+
+	sock_table_destroy(&locked_table);
+	packet_free(syn_pkt);
+	ut_close(listen_tsock, CLOSE_TYPE_CLOSE_DIRECTLY);
+
+	return 0;
+}
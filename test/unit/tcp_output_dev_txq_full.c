@@ -32,7 +32,7 @@ static void test_tcp_output_dev_txq_full(void)
 	}
 
 	ut_tcp_output(NULL, 0);
-	assert(tsock->stats_base[ERR_DEV_TXQ_FULL] == 1);
+	assert(tsock->stats->stats_base[ERR_DEV_TXQ_FULL] == 1);
 	for (i = 0; i < tcp_txq_unfinished_pkts(&tsock->txq); i++) {
 		pkt = tcp_txq_peek_una(tsock, i); {
 			assert(TCP_SEG(pkt)->len <= tsock->snd_mss);
@@ -49,8 +49,8 @@ static void test_tcp_output_dev_txq_full(void)
 		}
 		packet_free_seg(pkt);
 	}
-	assert(tsock->stats_base[BYTE_XMIT] == NR_PKT * sizeof(buf));
-	assert(tsock->stats_base[PKT_XMIT]  == NR_PKT);
+	assert(tsock->stats->stats_base[BYTE_XMIT] == NR_PKT * sizeof(buf));
+	assert(tsock->stats->stats_base[PKT_XMIT]  == NR_PKT);
 	assert((uint32_t)(tsock->snd_nxt - tsock->snd_una) == NR_PKT * sizeof(buf));
 
 	ut_dump_tsock_stats(tsock);
@@ -344,7 +344,7 @@ static void test_tcp_output_fast_retrans_dev_txq_full(void)
 		}
 	}
 	assert(tcp_txq_unfinished_pkts(&tsock->txq) == 1);
-	assert(tsock->stats_base[PKT_FAST_RE_XMIT_ERR] == 1);
+	assert(tsock->stats->stats_base[PKT_FAST_RE_XMIT_ERR] == 1);
 
 	/* TODO: we should really not enter recovery state when fast rexmit failed */
 	assert(tsock->retrans_stage == FAST_RETRANS);
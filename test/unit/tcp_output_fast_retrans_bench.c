@@ -51,11 +51,83 @@ static void test_tcp_output_fast_retrans_bench(void)
 	ut_close(tsock, CLOSE_TYPE_4WAY);
 }
 
+/*
+ * One seg is lost per round, and the segs after it are sacked one by
+ * one, as a receiver does. It measures the cost of the SACK processing
+ * and the recovery, till all is acked.
+ */
+static void test_tcp_output_sack_recovery_bench(void)
+{
+	struct tcp_sack_block blocks[1];
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint64_t sack_cycles = 0;
+	uint64_t cycles = 0;
+	uint64_t nr_sack = 0;
+	uint64_t nr_round = 0;
+	uint64_t start;
+	uint32_t inflight;
+	uint32_t lost;
+	uint32_t seq;
+	int ret;
+
+	printf("testing tcp_output bench [with sack recovery] ...\n");
+
+	tsock = ut_tcp_connect();
+
+	WHILE_NOT_TIME_UP() {
+		do {
+			ret = ut_write_assert(tsock, MESSAGE_SIZE);
+		} while (ret == MESSAGE_SIZE);
+		ut_tcp_output_skip_csum_verify(NULL, -1);
+
+		inflight = tsock->snd_nxt - tsock->snd_una;
+		if (inflight >= 4 * tsock->snd_mss) {
+			lost = tsock->snd_una + (rand() % (inflight / tsock->snd_mss - 2)) * tsock->snd_mss;
+
+			for (seq = lost + tsock->snd_mss; seq_lt(seq, tsock->snd_nxt); seq += tsock->snd_mss) {
+				blocks[0].start = lost + tsock->snd_mss;
+				blocks[0].end   = seq + tsock->snd_mss;
+				if (seq_gt(blocks[0].end, tsock->snd_nxt))
+					blocks[0].end = tsock->snd_nxt;
+
+				pkt = ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1);
+
+				start = rte_rdtsc();
+				ut_tcp_input_one(tsock, pkt);
+				sack_cycles += rte_rdtsc() - start;
+				nr_sack += 1;
+			}
+
+			/* the retrans */
+			start = rte_rdtsc();
+			ut_tcp_output_skip_csum_verify(NULL, -1);
+			cycles += rte_rdtsc() - start;
+			nr_round += 1;
+		}
+
+		pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+		ut_tcp_input_one(tsock, pkt); {
+			assert(tsock->snd_nxt == tsock->snd_una);
+			assert(tsock->sacked_bytes == 0);
+		}
+
+		ut_measure_rate(tsock, 1000 * 1000);
+	}
+
+	printf("\t%-16s: %lu rounds, %.1f cycles/sack, %.1f cycles/round\n", "sack recovery",
+	       nr_round, (double)sack_cycles / RTE_MAX(nr_sack, 1ul),
+	       (double)(sack_cycles + cycles) / RTE_MAX(nr_round, 1ul));
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
 int main(int argc, char *argv[])
 {
 	ut_init(argc, argv);
 
 	test_tcp_output_fast_retrans_bench();
+	test_tcp_output_sack_recovery_bench();
 
 	return 0;
 }
@@ -0,0 +1,146 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "test_utils.h"
+
+#define DATA_SIZE		1000
+#define NR_DATA			32
+
+static void verify_sw_csum(struct packet *pkt)
+{
+	char buf[2048];
+	const void *data;
+	struct rte_tcp_hdr *tcp;
+	uint16_t cksum;
+
+	data = rte_pktmbuf_read(&pkt->mbuf, 0, pkt->mbuf.pkt_len, buf);
+	if (data != buf)
+		memcpy(buf, data, pkt->mbuf.pkt_len);
+
+	if (pkt->mbuf.ol_flags & PKT_TX_IPV6) {
+		struct rte_ipv6_hdr *ip = (struct rte_ipv6_hdr *)(buf + pkt->mbuf.l2_len);
+
+		tcp = (struct rte_tcp_hdr *)(ip + 1);
+		cksum = tcp->cksum;
+		tcp->cksum = 0;
+		assert(rte_ipv6_udptcp_cksum(ip, tcp) == cksum);
+	} else {
+		struct rte_ipv4_hdr *ip = (struct rte_ipv4_hdr *)(buf + pkt->mbuf.l2_len);
+
+		assert(rte_ipv4_cksum(ip) == 0);
+
+		tcp = (struct rte_tcp_hdr *)(ip + 1);
+		cksum = tcp->cksum;
+		tcp->cksum = 0;
+		assert(rte_ipv4_udptcp_cksum(ip, tcp) == cksum);
+	}
+}
+
+/* random data, to make the csum verification meaningful */
+static void gso_write(struct tcp_sock *tsock)
+{
+	char buf[DATA_SIZE];
+	int i;
+
+	if (ut_test_opts.with_zerocopy) {
+		ut_write_assert(tsock, DATA_SIZE);
+		return;
+	}
+
+	for (i = 0; i < DATA_SIZE; i++)
+		buf[i] = rand();
+	assert(tpa_write(tsock->sid, buf, DATA_SIZE) == DATA_SIZE);
+}
+
+/*
+ * 32 writes of 1000 bytes go as one super seg, which is then split into
+ * mss sized segs by the software GSO; most of the seg boundaries cross
+ * the payload pkts.
+ */
+static void tcp_output_gso(uint64_t sw_tx_offload)
+{
+	struct packet *pkts[TXQ_BUF_SIZE];
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint32_t total = NR_DATA * DATA_SIZE;
+	uint16_t nr_pkt;
+	uint32_t seq;
+	int sw_csum = !!(sw_tx_offload & PKT_TX_TCP_CKSUM);
+	int i;
+
+	dev.ports[0].sw_tx_offload = sw_tx_offload;
+
+	tsock = ut_tcp_connect();
+	tsock->tso_enabled = 1;
+	tsock->snd_cwnd = total * 4;
+
+	for (i = 0; i < NR_DATA; i++)
+		gso_write(tsock);
+
+	seq = tsock->snd_nxt;
+	if (sw_csum)
+		nr_pkt = ut_tcp_output_skip_csum_verify(pkts, TXQ_BUF_SIZE);
+	else
+		nr_pkt = ut_tcp_output(pkts, TXQ_BUF_SIZE);
+
+	assert(tsock->snd_nxt == seq + total);
+	assert(nr_pkt == (total + tsock->snd_mss - 1) / tsock->snd_mss);
+	assert(tsock->stats->stats_base[PKT_XMIT_GSO] == 1);
+	assert(tsock->stats->stats_base[PKT_XMIT_GSO_SEG] == nr_pkt);
+
+	for (i = 0; i < nr_pkt; i++) {
+		pkt = pkts[i];
+
+		assert(pkt->mbuf.pkt_len <= 1514);
+		assert((pkt->mbuf.ol_flags & PKT_TX_TCP_SEG) == 0);
+		assert(TCP_SEG(pkt)->seq == seq);
+		if (i < nr_pkt - 1)
+			assert(pkt->mbuf.pkt_len - pkt->hdr_len == tsock->snd_mss);
+
+		if (sw_csum) {
+			assert((pkt->mbuf.ol_flags & (PKT_TX_IP_CKSUM | PKT_TX_TCP_CKSUM)) == 0);
+			verify_sw_csum(pkt);
+		}
+
+		seq += pkt->mbuf.pkt_len - pkt->hdr_len;
+	}
+	assert(seq == tsock->snd_nxt);
+	packet_free_batch(pkts, nr_pkt);
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->snd_una == tsock->snd_nxt);
+		assert(tcp_txq_unfinished_pkts(&tsock->txq) == 0);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	dev.ports[0].sw_tx_offload = 0;
+}
+
+static void test_tcp_output_gso(void)
+{
+	printf("testing %s ...\n", __func__);
+
+	tcp_output_gso(PKT_TX_TCP_SEG);
+}
+
+static void test_tcp_output_gso_sw_csum(void)
+{
+	printf("testing %s ...\n", __func__);
+
+	tcp_output_gso(PKT_TX_TCP_SEG | PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_tcp_output_gso();
+	test_tcp_output_gso_sw_csum();
+
+	return 0;
+}
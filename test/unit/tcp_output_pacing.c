@@ -0,0 +1,173 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+
+#define NR_NODE			1024
+
+static void test_pacing_queue(void)
+{
+	static struct pacing_node nodes[NR_NODE];
+	struct pacing_queue pq;
+	struct pacing_node *node;
+	uint64_t last = 0;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	/* start small, to make sure it expands */
+	assert(pacing_queue_init(&pq, 4) == 0);
+
+	for (i = 0; i < NR_NODE; i++) {
+		nodes[i].tsc = rand() % 100000 + 1;
+		assert(pacing_queue_push(&pq, &nodes[i]) == 0);
+	}
+	assert(pq.nr == NR_NODE);
+
+	/* a queued node is not queued again; it's re-positioned instead */
+	nodes[0].tsc = 0;
+	assert(pacing_queue_push(&pq, &nodes[0]) == 0);
+	assert(pq.nr == NR_NODE);
+	assert(pacing_queue_pop_due(&pq, 0) == &nodes[0]);
+	assert(pacing_node_is_queued(&nodes[0]) == 0);
+
+	for (i = 1; i < NR_NODE; i += 2)
+		pacing_queue_remove(&pq, &nodes[i]);
+	assert(pq.nr == NR_NODE / 2 - 1);
+
+	/* nothing is due yet */
+	assert(pacing_queue_pop_due(&pq, 0) == NULL);
+
+	/* the rest are popped in time order */
+	while ((node = pacing_queue_pop_due(&pq, UINT64_MAX)) != NULL) {
+		assert((node - nodes) % 2 == 0);
+		assert(node->tsc >= last);
+		last = node->tsc;
+	}
+	assert(pq.nr == 0);
+
+	free(pq.heap);
+}
+
+static void test_tcp_pacing_off(void)
+{
+	struct tcp_sock *tsock;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->pacing_rate = 1000 * 1000;
+
+	/* it's a burst without pacing */
+	ut_write_assert(tsock, 8 * tsock->snd_mss);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == 8 * tsock->snd_mss);
+		assert(worker->pacing_queue.nr == 0);
+	}
+
+	tsock->pacing_rate = 0;
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_pacing_rate(void)
+{
+	struct tcp_sock *tsock;
+	uint32_t inflight;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.pacing = 1;
+	tsock = ut_tcp_connect();
+
+	/* a pkt per 10ms */
+	tsock->pacing_rate = tsock->snd_mss * 100;
+
+	ut_write_assert(tsock, 8 * tsock->snd_mss);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == tsock->snd_mss);
+	}
+
+	/* it's parked at the pacing queue until the departure time */
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == tsock->snd_mss);
+		assert(worker->pacing_queue.nr == 1);
+		assert(pacing_node_is_queued(&tsock->pacing_node));
+		assert(tsock->pacing_node.tsc > rte_rdtsc());
+	}
+
+	usleep(12 * 1000);
+	ut_tcp_output(NULL, -1); {
+		inflight = tsock->snd_nxt - tsock->snd_una;
+		assert(inflight >= 2 * tsock->snd_mss);
+		assert(inflight <= 3 * tsock->snd_mss);
+		assert(worker->pacing_lag.count > 0);
+	}
+
+	/* a write doesn't bypass the pacing */
+	ut_write_assert(tsock, tsock->snd_mss);
+	ut_tcp_output(NULL, -1);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == inflight);
+	}
+
+	tcp_cfg.pacing = 0;
+	tsock->pacing_rate = 0;
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	assert(worker->pacing_queue.nr == 0);
+}
+
+/* the rate is derived from cwnd / srtt, when cc doesn't set one */
+static void test_tcp_pacing_rate_by_cwnd(void)
+{
+	struct tcp_sock *tsock;
+
+	printf("testing %s ...\n", __func__);
+
+	tcp_cfg.pacing = 1;
+	tsock = ut_tcp_connect();
+
+	/* no rtt sample yet: not paced */
+	tsock->srtt = 0;
+	ut_write_assert(tsock, 4 * tsock->snd_mss);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == 4 * tsock->snd_mss);
+	}
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt));
+
+	/* 10 pkts per 1s rtt, in congestion avoidance: 12 pkts per sec */
+	tsock->srtt = (1000 * 1000) << 3;
+	tsock->snd_cwnd = 10 * tsock->snd_mss;
+	tsock->snd_ssthresh = tsock->snd_cwnd;
+	ut_write_assert(tsock, 4 * tsock->snd_mss);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == tsock->snd_mss);
+		assert(tsock->pacing_node.tsc - rte_rdtsc() > tpa_cfg.hz / 12 * 9 / 10);
+		assert(tsock->pacing_node.tsc - rte_rdtsc() < tpa_cfg.hz / 12);
+	}
+
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == tsock->snd_mss);
+		assert(tsock->stats->stats_base[PACING_DEFER] == 1);
+	}
+
+	tcp_cfg.pacing = 0;
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+	assert(worker->pacing_queue.nr == 0);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_pacing_queue();
+	test_tcp_pacing_off();
+	test_tcp_pacing_rate();
+	test_tcp_pacing_rate_by_cwnd();
+
+	return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "test_utils.h"
+
+#define DATA_SIZE		1000
+#define NR_PKT			8
+
+/* 2 srtt, plus the delayed ack as there is one seg only */
+#define TLP_SRTT		(10 * 1000)
+#define TLP_PTO			(2 * TLP_SRTT + tcp_cfg.delayed_ack)
+
+/*
+ * Drives the worker, and thus the timers, until some pkts go out or
+ * @max_us passes by the worker clock; it's the worker clock, instead
+ * of a sleep, that tells whether a timer is due. Returns the number
+ * of pkts, and the us it took at @elapsed.
+ */
+static uint16_t output_within(struct packet **pkts, uint16_t count, uint64_t max_us,
+			      uint64_t *elapsed)
+{
+	uint64_t start = worker->ts_us;
+	uint16_t nr_pkt;
+
+	do {
+		nr_pkt = ut_tcp_output(pkts, count);
+	} while (nr_pkt == 0 && worker->ts_us - start < max_us);
+
+	if (elapsed)
+		*elapsed = worker->ts_us - start;
+
+	return nr_pkt;
+}
+
+static uint32_t retrans_size(uint32_t *seq, uint64_t max_us)
+{
+	struct packet *pkts[TXQ_BUF_SIZE];
+	uint32_t size = 0;
+	uint16_t nr_pkt;
+	int i;
+
+	nr_pkt = output_within(pkts, TXQ_BUF_SIZE, max_us, NULL);
+	for (i = 0; i < nr_pkt; i++) {
+		if (i == 0)
+			*seq = TCP_SEG(pkts[i])->seq;
+		size += TCP_SEG(pkts[i])->len;
+	}
+	packet_free_batch(pkts, nr_pkt);
+
+	return size;
+}
+
+/* a large rtt makes a large reorder window, and keeps TLP away */
+static struct tcp_sock *rack_connect(uint32_t rtt)
+{
+	struct tcp_sock *tsock;
+	int i;
+
+	tsock = ut_tcp_connect();
+	tsock->srtt = rtt << 3;
+	tsock->rack.min_rtt = rtt;
+
+	for (i = 0; i < NR_PKT; i++)
+		ut_write_assert(tsock, DATA_SIZE);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == NR_PKT * DATA_SIZE);
+	}
+
+	return tsock;
+}
+
+/* 3+ segs sacked after the hole: the hole is lost, without waiting */
+static void test_tcp_rack_lost(void)
+{
+	struct tcp_sack_block blocks[1];
+	struct tcp_sock *tsock;
+	uint32_t seq = 0;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = rack_connect(40 * 1000);
+
+	blocks[0] = (struct tcp_sack_block) { tsock->snd_una + 2 * DATA_SIZE, tsock->snd_una + 7 * DATA_SIZE };
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1)); {
+		assert(tsock->sacked_bytes == 5 * DATA_SIZE);
+		assert(tsock->stats->stats_base[RACK_LOST] == 2);
+		assert(tsock->retrans_stage == FAST_RETRANS);
+		assert(tsock->rack.recovery == 1);
+	}
+
+	/* only the lost ones are retransmitted */
+	assert(retrans_size(&seq, 0) == 2 * DATA_SIZE); {
+		assert(seq == tsock->snd_una);
+		assert(tsock->lost_bytes == 0);
+	}
+
+	/* and they are not retransmitted again on more dupacks */
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1)); {
+		assert(ut_tcp_output(NULL, 0) == 0);
+	}
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->retrans_stage == NONE);
+		assert(tsock->rack.recovery == 0);
+		assert(tsock->sacked_bytes == 0);
+		assert(timer_is_stopped(&tsock->timer_rack));
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/*
+ * RFC 6675: the lost ones are retransmitted as far as the pipe leaves
+ * room in the ssthresh, instead of all at once.
+ */
+static void test_tcp_rack_pipe(void)
+{
+	struct tcp_sack_block blocks[1];
+	struct tcp_sock *tsock;
+	uint32_t mss;
+	uint32_t una;
+	uint32_t seq = 0;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->srtt = (40 * 1000) << 3;
+	tsock->rack.min_rtt = 40 * 1000;
+	/* the ssthresh is then half of the cwnd: 20 segs */
+	tsock->cc = &tcp_cc_reno;
+	tsock->snd_cwnd = 40 * DATA_SIZE;
+	mss = tsock->snd_mss;
+
+	for (i = 0; i < 40; i++)
+		ut_write_assert(tsock, DATA_SIZE);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == 40 * DATA_SIZE);
+	}
+	una = tsock->snd_una;
+
+	/* 4 segs lost and 14 sacked: the pipe is 22 segs */
+	blocks[0] = (struct tcp_sack_block) { una + 4 * DATA_SIZE, una + 18 * DATA_SIZE };
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, una, blocks, 1)); {
+		assert(tsock->rack.recovery == 1);
+		assert(tsock->snd_ssthresh == 20 * DATA_SIZE);
+	}
+
+	/* there is no room; the first retrans goes anyway */
+	assert(retrans_size(&seq, 0) == mss); {
+		assert(seq == una);
+	}
+
+	/* still no room: nothing goes on a plain dupack */
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, una, blocks, 1)); {
+		assert(ut_tcp_output(NULL, 0) == 0);
+	}
+
+	/* 5 more sacked: the pipe drops to 18 segs, with 3 segs still lost */
+	blocks[0].end = una + 23 * DATA_SIZE;
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, una, blocks, 1)); {
+		assert(tsock->sacked_bytes == 19 * DATA_SIZE);
+	}
+	assert(retrans_size(&seq, 0) == 2 * DATA_SIZE); {
+		assert(seq == una + mss);
+	}
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->retrans_stage == NONE);
+		assert(tsock->rack.recovery == 0);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* a single seg sacked: it might be reordering; wait for the reorder window */
+static void test_tcp_rack_reo_wnd(void)
+{
+	struct tcp_sack_block blocks[1];
+	struct tcp_sock *tsock;
+	uint32_t seq = 0;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	/* reo_wnd is min_rtt / 4: 10ms */
+	tsock = rack_connect(40 * 1000);
+
+	blocks[0] = (struct tcp_sack_block) { tsock->snd_una + 2 * DATA_SIZE, tsock->snd_una + 3 * DATA_SIZE };
+	for (i = 0; i < 3; i++) {
+		ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1));
+	}
+
+	/* the dupack counting doesn't apply with SACK */
+	assert(tsock->nr_dupack == 3);
+	assert(tsock->retrans_stage == NONE);
+	assert(tsock->lost_bytes == 0);
+	assert(!timer_is_stopped(&tsock->timer_rack));
+
+	/* the rack timer fires once the reorder window passes */
+	assert(retrans_size(&seq, 4 * 10 * 1000) == 2 * DATA_SIZE); {
+		assert(seq == tsock->snd_una);
+		assert(tsock->stats->stats_base[RACK_LOST] == 2);
+		assert(tsock->retrans_stage == FAST_RETRANS);
+	}
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->retrans_stage == NONE);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_rack_reordering_seen(void)
+{
+	struct tcp_sack_block blocks[1];
+	struct tcp_sock *tsock;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = rack_connect(40 * 1000);
+
+	blocks[0] = (struct tcp_sack_block) { tsock->snd_una + 2 * DATA_SIZE, tsock->snd_una + 3 * DATA_SIZE };
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1)); {
+		assert(tsock->rack.reordering_seen == 0);
+		assert(tsock->rack.fack == tsock->snd_una + 3 * DATA_SIZE);
+	}
+
+	/* the hole is filled by the original transmit */
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_una + 2 * DATA_SIZE)); {
+		assert(tsock->rack.reordering_seen == 1);
+		assert(tsock->lost_bytes == 0);
+		assert(tsock->retrans_stage == NONE);
+	}
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt));
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* the last seg of a request is lost: it's probed in about 2 srtt */
+static void test_tcp_tlp_retrans(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint64_t elapsed;
+	uint32_t cwnd;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->srtt = TLP_SRTT << 3;
+	cwnd = tsock->snd_cwnd;
+
+	ut_write_assert(tsock, DATA_SIZE);
+	ut_tcp_output(NULL, -1); {
+		assert(!timer_is_stopped(&tsock->timer_tlp));
+		assert(tsock->timer_tlp.expire < tsock->timer_rto.expire);
+	}
+
+	/* the tlp timer is armed at the output above, at the current worker clock */
+	assert(output_within(&pkt, 1, 2 * TLP_PTO, &elapsed) == 1); {
+		assert(elapsed + TIMER_TICK_US >= TLP_PTO);
+		assert(TCP_SEG(pkt)->seq == tsock->snd_una);
+		assert(TCP_SEG(pkt)->len == DATA_SIZE);
+		assert(tsock->stats->stats_base[TLP_PROBE] == 1);
+		assert(tsock->rack.tlp_pending == 1);
+		assert(tsock->rack.tlp_is_retrans == 1);
+		assert(tsock->retrans_stage == NONE);
+		packet_free(pkt);
+	}
+
+	/* no more probes until the ack comes */
+	assert(output_within(NULL, 0, 2 * TLP_PTO, NULL) == 0);
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->rack.tlp_pending == 0);
+		assert(tsock->stats->stats_base[TLP_RECOVERY] == 1);
+		assert(tsock->snd_cwnd < cwnd);
+		assert(timer_is_stopped(&tsock->timer_tlp));
+		assert(timer_is_stopped(&tsock->timer_rto));
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+/* new data is probed, if there is any */
+static void test_tcp_tlp_new_data(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	uint64_t elapsed;
+	uint32_t snd_nxt;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	tsock->srtt = TLP_SRTT << 3;
+	tsock->snd_cwnd = DATA_SIZE;
+
+	ut_write_assert(tsock, DATA_SIZE);
+	ut_write_assert(tsock, DATA_SIZE);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->snd_nxt - tsock->snd_una == DATA_SIZE);
+	}
+
+	snd_nxt = tsock->snd_nxt;
+	assert(output_within(&pkt, 1, 2 * TLP_PTO, &elapsed) == 1); {
+		assert(elapsed + TIMER_TICK_US >= TLP_PTO);
+		assert(TCP_SEG(pkt)->seq == snd_nxt);
+		assert(TCP_SEG(pkt)->len == DATA_SIZE);
+		assert(tsock->snd_nxt == snd_nxt + DATA_SIZE);
+		assert(tsock->rack.tlp_is_retrans == 0);
+		packet_free(pkt);
+	}
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt)); {
+		assert(tsock->rack.tlp_pending == 0);
+		assert(tsock->stats->stats_base[TLP_RECOVERY] == 0);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_tcp_rack_lost();
+	test_tcp_rack_pipe();
+	test_tcp_rack_reo_wnd();
+	test_tcp_rack_reordering_seen();
+	test_tcp_tlp_retrans();
+	test_tcp_tlp_new_data();
+
+	return 0;
+}
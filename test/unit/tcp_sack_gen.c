@@ -202,6 +202,88 @@ static void test_tcp_sack_gen_with_tso(void)
 	ut_close(tsock, CLOSE_TYPE_4WAY);
 }
 
+/* it's 4 blocks at most without TS */
+static void test_tcp_sack_gen_without_ts(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	struct tcp_opts opts;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = do_ut_tcp_connect(0, 1448, 10, 1);
+
+	for (i = 1; i <= 5; i++) {
+		pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000 * i, 500);
+		ut_tcp_input_one(tsock, pkt);
+	}
+
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(parse_tcp_opts(&opts, pkt) == 0);
+		assert(opts.has_ts == 0);
+		assert(opts.nr_sack == 4);
+		assert(opts.sack_blocks[0].start == tsock->rcv_nxt + 5000);
+		assert(opts.sack_blocks[3].start == tsock->rcv_nxt + 2000);
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_sack_gen_dsack(void)
+{
+	struct tcp_sock *tsock;
+	struct packet *pkt;
+	struct tcp_opts opts;
+	uint32_t seq;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	seq = tsock->rcv_nxt;
+	ut_tcp_input_one(tsock, ut_inject_data_packet(tsock, seq, 500));
+	ut_tcp_output(NULL, -1);
+	ut_readv(tsock, 1);
+
+	/* a dup below rcv_nxt: the D-SACK alone */
+	ut_tcp_input_one(tsock, ut_inject_data_packet(tsock, seq, 500));
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(parse_tcp_opts(&opts, pkt) == 0);
+		assert(opts.nr_sack == 1);
+		assert(opts.sack_blocks[0].start == seq);
+		assert(opts.sack_blocks[0].end   == seq + 500);
+		assert(tsock->stats->stats_base[DSACK_SENT] == 1);
+		packet_free(pkt);
+	}
+
+	/* it's reported once only */
+	ut_tcp_input_one(tsock, ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000, 500));
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(parse_tcp_opts(&opts, pkt) == 0);
+		assert(opts.nr_sack == 1);
+		assert(opts.sack_blocks[0].start == tsock->rcv_nxt + 1000);
+		packet_free(pkt);
+	}
+
+	/* an ooo dup: the D-SACK goes first, then the block holding it */
+	ut_tcp_input_one(tsock, ut_inject_data_packet(tsock, tsock->rcv_nxt + 3000, 500));
+	ut_tcp_output(NULL, -1);
+	ut_tcp_input_one(tsock, ut_inject_data_packet(tsock, tsock->rcv_nxt + 1000, 500));
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(parse_tcp_opts(&opts, pkt) == 0);
+		assert(opts.nr_sack == 3);
+		assert(opts.sack_blocks[0].start == tsock->rcv_nxt + 1000);
+		assert(opts.sack_blocks[0].end   == tsock->rcv_nxt + 1500);
+		assert(opts.sack_blocks[1].start == tsock->rcv_nxt + 1000);
+		assert(opts.sack_blocks[2].start == tsock->rcv_nxt + 3000);
+		packet_free(pkt);
+	}
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
 int main(int argc, char *argv[])
 {
 	ut_init(argc, argv);
@@ -211,6 +293,8 @@ int main(int argc, char *argv[])
 	test_tcp_sack_gen_rfc2018_case3();
 
 	test_tcp_sack_gen_with_tso();
+	test_tcp_sack_gen_without_ts();
+	test_tcp_sack_gen_dsack();
 
 	return 0;
 }
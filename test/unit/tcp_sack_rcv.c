@@ -4,6 +4,7 @@
  * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
  */
 #include <stdio.h>
+#include <unistd.h>
 
 #include "test_utils.h"
 
@@ -41,17 +42,186 @@ static void test_tcp_sack_rcv_basic(void)
 		assert(!!(descs[6]->flags & TX_DESC_FLAG_SACKED) == 0);
 		assert(!!(descs[7]->flags & TX_DESC_FLAG_SACKED) == 0);
 		assert(!!(descs[8]->flags & TX_DESC_FLAG_SACKED) == 1);
-		assert(!!(descs[9]->flags & TX_DESC_FLAG_SACKED) == 0);
+		assert(!!(descs[9]->flags & TX_DESC_FLAG_SACKED) == 1);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
 }
 
+static void test_sack_scoreboard(void)
+{
+	struct tcp_sack_block news[SACK_SCOREBOARD_SIZE + 1];
+	struct tcp_sack_block merged;
+	struct sack_scoreboard sb;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	sack_scoreboard_reset(&sb);
+
+	assert(sack_scoreboard_add(&sb, 1000, 2000, news, &merged) == 1);
+	assert(sack_scoreboard_add(&sb, 3000, 4000, news, &merged) == 1);
+	assert(sb.nr == 2);
+
+	/* nothing new */
+	assert(sack_scoreboard_add(&sb, 1200, 1800, news, &merged) == 0); {
+		assert(merged.start == 1000 && merged.end == 2000);
+	}
+
+	/* fills the hole in between, and the one before */
+	assert(sack_scoreboard_add(&sb, 500, 3500, news, &merged) == 2); {
+		assert(news[0].start == 500  && news[0].end == 1000);
+		assert(news[1].start == 2000 && news[1].end == 3000);
+		assert(merged.start == 500 && merged.end == 4000);
+		assert(sb.nr == 1);
+	}
+
+	assert(sack_scoreboard_next_hole(&sb, 100)  == 100);
+	assert(sack_scoreboard_next_hole(&sb, 600)  == 4000);
+	assert(sack_scoreboard_next_hole(&sb, 4000) == 4000);
+
+	sack_scoreboard_cut(&sb, 2000); {
+		assert(sb.nr == 1);
+		assert(sb.blks[0].start == 2000);
+	}
+	sack_scoreboard_cut(&sb, 4000); {
+		assert(sb.nr == 0);
+	}
+
+	/* seq wraps */
+	assert(sack_scoreboard_add(&sb, UINT32_MAX - 99, 100, news, &merged) == 1);
+	assert(sack_scoreboard_next_hole(&sb, UINT32_MAX) == 100);
+	sack_scoreboard_reset(&sb);
+
+	/* the highest one is dropped when it's full */
+	for (i = 0; i <= SACK_SCOREBOARD_SIZE; i++)
+		assert(sack_scoreboard_add(&sb, 10000 + i * 1000, 10000 + i * 1000 + 100, news, &merged) == 1);
+	assert(sb.nr == SACK_SCOREBOARD_SIZE);
+	assert(sb.overflow == 1);
+
+	assert(sack_scoreboard_add(&sb, 1000, 1100, news, &merged) == 1); {
+		assert(sb.nr == SACK_SCOREBOARD_SIZE);
+		assert(sb.blks[0].start == 1000);
+		assert(sb.blks[SACK_SCOREBOARD_SIZE - 1].start == 10000 + (SACK_SCOREBOARD_SIZE - 2) * 1000);
+	}
+}
+
+/* the scoreboard remembers more blocks than an ACK could carry */
+static void test_tcp_sack_rcv_scoreboard(void)
+{
+	struct tcp_sack_block blocks[3];
+	struct tcp_sock *tsock;
+	struct tx_desc **descs;
+	struct packet *pkt;
+	uint32_t una;
+	int i;
+	int j;
+
+	printf("testing %s ...\n", __func__);
+
+	/* keeps RACK away for 10ms */
+	tsock = ut_tcp_connect();
+	tsock->srtt = (40 * 1000) << 3;
+	tsock->rack.min_rtt = 40 * 1000;
+	tsock->rack.reordering_seen = 1;
+
+	for (i = 0; i < 16; i++)
+		ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1);
+
+	/* sack the odd ones, by 3 ACKs */
+	una = tsock->snd_una;
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < 3; j++) {
+			blocks[j].start = una + 1000 * (6 * i + 2 * j + 1);
+			blocks[j].end   = blocks[j].start + 1000;
+		}
+		ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, una, blocks, i < 2 ? 3 : 1));
+	}
+
+	descs = (struct tx_desc **)tsock->txq.descs;
+	assert(tsock->sack_sb.nr == 7); {
+		assert(tsock->sacked_bytes == 7 * 1000);
+		for (i = 0; i < 16; i++)
+			assert(!!(descs[i]->flags & TX_DESC_FLAG_SACKED) == (i % 2 == 1 && i < 14));
+	}
+
+	/* the holes are filled by one block; only the holes are looked up */
+	blocks[0] = (struct tcp_sack_block) { una + 1000, una + 14000 };
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, una, blocks, 1)); {
+		assert(tsock->sack_sb.nr == 1);
+		assert(tsock->sacked_bytes == 13 * 1000);
+	}
+
+	/* the first one is lost; the sacked run is skipped at once */
+	usleep(12 * 1000);
+	assert(ut_tcp_output(&pkt, 1) == 1); {
+		assert(TCP_SEG(pkt)->seq == una);
+		assert(TCP_SEG(pkt)->len == 1000);
+		packet_free(pkt);
+		assert(ut_tcp_output(NULL, -1) == 0);
+	}
+
+	/* RFC 2018: the sacked bits are cleared on RTO */
+	ut_simulate_rto_timeout(tsock);
+	ut_tcp_output(NULL, -1); {
+		assert(tsock->stats->stats_base[TCP_RTO_TIME_OUT] == 1);
+		assert(tsock->sacked_bytes == 0);
+		assert(tsock->sack_sb.nr == 0);
+		for (i = 0; i < 16; i++)
+			assert((descs[i]->flags & TX_DESC_FLAG_SACKED) == 0);
+	}
+
+	pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
+	ut_tcp_input_one(tsock, pkt);
+
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
+static void test_tcp_sack_rcv_dsack(void)
+{
+	struct tcp_sack_block blocks[2];
+	struct tcp_sock *tsock;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+
+	for (i = 0; i < 4; i++)
+		ut_write_assert(tsock, 1000);
+	ut_tcp_output(NULL, -1);
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_una + 1000));
+
+	/* below the cumulative ack */
+	blocks[0] = (struct tcp_sack_block) { tsock->snd_una - 1000, tsock->snd_una };
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 1)); {
+		assert(tsock->stats->stats_base[DSACK_RCV] == 1);
+		assert(tsock->rack.reordering_seen == 1);
+		assert(tsock->sacked_bytes == 0);
+	}
+
+	/* covered by the 2nd block */
+	blocks[0] = (struct tcp_sack_block) { tsock->snd_una + 1000, tsock->snd_una + 2000 };
+	blocks[1] = (struct tcp_sack_block) { tsock->snd_una + 1000, tsock->snd_una + 2000 };
+	ut_tcp_input_one(tsock, ut_inject_sack_packet(tsock, tsock->snd_una, blocks, 2)); {
+		assert(tsock->stats->stats_base[DSACK_RCV] == 2);
+		assert(tsock->stats->stats_base[ERR_TCP_SACK_INTERSECT] == 0);
+		assert(tsock->sacked_bytes == 1000);
+	}
+
+	ut_tcp_input_one(tsock, ut_inject_ack_packet(tsock, tsock->snd_nxt));
+	ut_close(tsock, CLOSE_TYPE_4WAY);
+}
+
 int main(int argc, char *argv[])
 {
 	ut_init(argc, argv);
 
 	test_tcp_sack_rcv_basic();
+	test_sack_scoreboard();
+	test_tcp_sack_rcv_scoreboard();
+	test_tcp_sack_rcv_dsack();
 
 	return 0;
 }
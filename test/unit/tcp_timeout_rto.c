@@ -268,7 +268,7 @@ static void test_tcp_timeout_rto_ack_nxt(void)
 		assert(tsock->snd_una == tsock->snd_nxt);
 		assert(tsock->txq.una == tsock->txq.nxt);
 		assert(timer_is_stopped(&tsock->timer_rto));
-		assert(tsock->stats_base[BYTE_XMIT] == sizeof(buf) * NR_PKT);
+		assert(tsock->stats->stats_base[BYTE_XMIT] == sizeof(buf) * NR_PKT);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_4WAY);
@@ -19,14 +19,14 @@ static void test_tcp_ts_basic(void)
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
 	fill_opt_ts((uint8_t *)(ut_packet_tcp_hdr(pkt) + 1), tsock->ts_recent, tsock->snd_ts);
 	ut_tcp_input_one(tsock, pkt); {
-		assert(tsock->stats_base[ERR_TCP_INVALID_TS] == 0);
+		assert(tsock->stats->stats_base[ERR_TCP_INVALID_TS] == 0);
 	}
 
 	pkt = ut_inject_data_packet(tsock, tsock->rcv_nxt, 1000);
 	fill_opt_ts((uint8_t *)(ut_packet_tcp_hdr(pkt) + 1), tsock->ts_recent - 1, tsock->snd_ts);
 	/* XXX: can't use ut_tcp_input_one here; as it asserts no invalid ts pkt is injected */
 	ut_tcp_input_raw(tsock, &pkt, 1); {
-		assert(tsock->stats_base[ERR_TCP_INVALID_TS] == 1);
+		assert(tsock->stats->stats_base[ERR_TCP_INVALID_TS] == 1);
 	}
 
 	ut_close(tsock, CLOSE_TYPE_RESET);
@@ -52,7 +52,7 @@ static void test_tcp_ts_wrap(void)
 	 */
 	worker->ts_us += TCP_PAWS_IDLE_MAX * 1e6;
 	ut_tcp_input_raw(tsock, &pkt, 1); {
-		assert(tsock->stats_base[ERR_TCP_INVALID_TS] == 0);
+		assert(tsock->stats->stats_base[ERR_TCP_INVALID_TS] == 0);
 		assert(tsock->ts_recent == ts);
 		assert(tsock->ts_recent_in_sec == now_in_sec(worker));
 	}
@@ -81,7 +81,7 @@ static void test_tcp_ts_paws_reset(void)
 	fill_opt_ts((uint8_t *)(ut_packet_tcp_hdr(pkt) + 1), ts, tsock->snd_ts);
 
 	ut_tcp_input_one(tsock, pkt); {
-		assert(tsock->stats_base[ERR_TCP_INVALID_TS] == 0);
+		assert(tsock->stats->stats_base[ERR_TCP_INVALID_TS] == 0);
 		assert(tsock->ts_recent != ts);
 		assert(tsock->ts_recent_in_sec == now_in_sec(worker));
 		assert(tsock->state == TCP_STATE_CLOSED);
@@ -26,7 +26,7 @@ static void test_tcp_zwritev_mixed(void)
 		assert(ret == tsock->snd_mss * 2 + 2);
 
 		ut_tcp_output(NULL, -1); {
-			assert(tsock->stats_base[PKT_XMIT] == 2);
+			assert(tsock->stats->stats_base[PKT_XMIT] == 2);
 		}
 
 		pkt = ut_inject_ack_packet(tsock, tsock->snd_nxt);
@@ -43,7 +43,7 @@ static void test_tcp_zwritev_mixed(void)
 		assert(ret == tsock->snd_mss * 2 + 2);
 
 		ut_tcp_output(NULL, -1); {
-			assert(tsock->stats_base[PKT_XMIT] == 4);
+			assert(tsock->stats->stats_base[PKT_XMIT] == 4);
 		}
 	}
 
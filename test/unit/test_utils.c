@@ -175,8 +175,8 @@ void ut_dump_tsock_stats(struct tcp_sock *tsock)
 	int i;
 
 	for (i = 0; i < STATS_MAX; i++) {
-		if (tsock->stats_base[i])
-			printf("\t%-32s: %lu\n", stats_name(i), tsock->stats_base[i]);
+		if (tsock->stats->stats_base[i])
+			printf("\t%-32s: %lu\n", stats_name(i), tsock->stats->stats_base[i]);
 	}
 }
 
@@ -194,8 +194,8 @@ void ut_measure_rate(struct tcp_sock *tsock, int interval)
 	if (worker->ts_us - last.ts_us < interval)
 		return;
 
-	bytes_read  = tsock->stats_base[BYTE_RECV] - last.bytes_read;
-	bytes_write = tsock->stats_base[BYTE_XMIT] - last.bytes_write;
+	bytes_read  = tsock->stats->stats_base[BYTE_RECV] - last.bytes_read;
+	bytes_write = tsock->stats->stats_base[BYTE_XMIT] - last.bytes_write;
 
 	if (last.ts_us) {
 		printf(":: %d read %.3f Gb/s   write %.3f Gb/s\n",
@@ -204,8 +204,8 @@ void ut_measure_rate(struct tcp_sock *tsock, int interval)
 			(double)(bytes_write * 8 * 1e6 / interval / (1<<30)));
 	}
 
-	last.bytes_read  = tsock->stats_base[BYTE_RECV];
-	last.bytes_write = tsock->stats_base[BYTE_XMIT];
+	last.bytes_read  = tsock->stats->stats_base[BYTE_RECV];
+	last.bytes_write = tsock->stats->stats_base[BYTE_XMIT];
 	last.ts_us = worker->ts_us;
 }
 
@@ -486,6 +486,7 @@ void ut_ip_set_hdr(struct packet *pkt, uint16_t tcp_opt_len, uint16_t tcp_payloa
 
 		ip = rte_pktmbuf_mtod_offset(&pkt->mbuf, struct rte_ipv4_hdr *,  14);
 		ip->version_ihl   = 0x45;
+		ip->type_of_service = 0;
 		ip->total_length  = htons(ip_len);
 		ip->time_to_live  = 64;
 		ip->next_proto_id = IPPROTO_TCP;
@@ -663,18 +664,36 @@ struct packet *make_synack_packet(struct tcp_sock *tsock, int has_ts, int mss, i
  * below pair is for "fixing" the timer speedup made at ut_close
  */
 
-static struct timer_ctrl saved_timer_ctrl;
+static uint64_t saved_timer_clock;
 
 static void ut_timer_ctrl_save(void)
 {
-	saved_timer_ctrl = worker->timer_ctrl;
+	saved_timer_clock = worker->timer_ctrl.clock;
 }
 
+/* rewind the clock and requeue all timers against it */
 static void ut_timer_ctrl_restore(void)
 {
-	worker->timer_ctrl.next_run = saved_timer_ctrl.next_run;
-	worker->timer_ctrl.last_run = saved_timer_ctrl.last_run;
-	worker->timer_ctrl.curr_slot_idx = saved_timer_ctrl.curr_slot_idx;
+	struct timer_ctrl *timer_ctrl = &worker->timer_ctrl;
+	struct timer_slot timers;
+	struct timer *timer;
+	int i;
+
+	TAILQ_INIT(&timers);
+	for (i = 0; i < NR_SLOT; i++) {
+		while ((timer = TAILQ_FIRST(&timer_ctrl->slots[i])) != NULL) {
+			timer_dequeue(timer_ctrl, timer);
+			TAILQ_INSERT_TAIL(&timers, timer, node);
+		}
+	}
+
+	timer_ctrl->clock = saved_timer_clock;
+	timer_ctrl->next_run = UINT64_MAX;
+
+	while ((timer = TAILQ_FIRST(&timers)) != NULL) {
+		TAILQ_REMOVE(&timers, timer, node);
+		timer_enqueue(timer_ctrl, timer);
+	}
 }
 
 int ut_timer_process(void)
@@ -733,7 +752,7 @@ void ut_tcp_input(struct tcp_sock *tsock, struct packet **pkts, uint16_t nr_pkt)
 
 	ut_tcp_input_raw(tsock, pkts, nr_pkt);
 
-	assert(tsock->stats_base[ERR_TCP_INVALID_TS] == 0);
+	assert(tsock->stats->stats_base[ERR_TCP_INVALID_TS] == 0);
 	assert(tsock->rcv_wnd < TCP_WINDOW_MAX);
 
 	/*
@@ -867,7 +886,7 @@ static uint16_t do_ut_tcp_output(struct packet **pkts, uint16_t count, int skip_
 
 	nr_pkt = txq->nr_pkt;
 	for (i = 0; i < nr_pkt; i++) {
-		pkt = txq->pkts[i];
+		pkt = dev_txq_pkt(txq, i);
 
 		pkt_type = parse_output_pkt(pkt);
 		if (pkt_type == RTE_ETHER_TYPE_ARP || pkt_type == IPPROTO_ICMPV6)
@@ -917,6 +936,7 @@ static uint16_t do_ut_tcp_output(struct packet **pkts, uint16_t count, int skip_
 	}
 
 	last_nr_output_pkt = nr_pkt;
+	txq->head  += nr_pkt;
 	txq->nr_pkt = 0;
 
 	return nr_pkt;
@@ -1100,8 +1120,8 @@ void ut_close(struct tcp_sock *tsock, int close_type)
 		nr_pkt = ut_tcp_output(pkts, TXQ_BUF_SIZE); {
 			assert(nr_pkt > 0);
 			assert(tsock->state == TCP_STATE_CLOSED);
-			assert(tsock->stats_base[RST_XMIT] == 1);
-			assert(tsock->stats_base[FIN_XMIT] == 0);
+			assert(tsock->stats->stats_base[RST_XMIT] == 1);
+			assert(tsock->stats->stats_base[FIN_XMIT] == 0);
 
 			pkt = pkts[nr_pkt - 1];
 			assert(TCP_SEG(pkt)->flags == (TCP_FLAG_RST | TCP_FLAG_ACK));
@@ -1116,8 +1136,8 @@ void ut_close(struct tcp_sock *tsock, int close_type)
 		       tsock->state == TCP_STATE_CLOSED);
 		assert(ut_tcp_output(NULL, 1) == 0); {
 			assert(tsock->state == TCP_STATE_CLOSED);
-			assert(tsock->stats_base[RST_XMIT] == 0);
-			assert(tsock->stats_base[FIN_XMIT] == 0);
+			assert(tsock->stats->stats_base[RST_XMIT] == 0);
+			assert(tsock->stats->stats_base[FIN_XMIT] == 0);
 		}
 		goto closed;
 	}
@@ -1133,8 +1153,8 @@ void ut_close(struct tcp_sock *tsock, int close_type)
 	pkt = ut_drain_send_buff_at_close(tsock); {
 		assert(tsock->state == TCP_STATE_FIN_WAIT_1);
 		assert(TCP_SEG(pkt)->flags == (TCP_FLAG_FIN | TCP_FLAG_ACK));
-		assert(tsock->stats_base[FIN_XMIT] == 1);
-		assert(tsock->stats_base[RST_XMIT] == 0);
+		assert(tsock->stats->stats_base[FIN_XMIT] == 1);
+		assert(tsock->stats->stats_base[RST_XMIT] == 0);
 		fin_seq = TCP_SEG(pkt)->seq;
 		packet_free(pkt);
 	}
@@ -1327,6 +1347,7 @@ void ut_init(int argc, char **argv)
 	char cfg[1024];
 	int mem_size = 80; /* MB */
 	int nr_sock = 4; /* let's start small and it will be enlarged dynamically */
+	int nr_worker = 1;
 
 	parse_test_opts(argc, argv);
 
@@ -1336,12 +1357,21 @@ void ut_init(int argc, char **argv)
 	if (strstr(argv[0], "tcp_connect_crr") || strstr(argv[0], "arp"))
 		mem_size = 256;
 
+	/* the sw steering needs a peer worker */
+	if (strstr(argv[0], "steer"))
+		nr_worker = 2;
+
 	ut_port_min = 54000;
 	ut_port_max = 64000 - 1;
 	if (strstr(argv[0], "port_alloc")) {
 		ut_port_min = 42000;
 		ut_port_max = 50000;
 	}
+	if (strstr(argv[0], "tcp_input_multi_bench")) {
+		/* room for 10K socks */
+		ut_port_min = 40000;
+		ut_port_max = 64000 - 1;
+	}
 
 	tpa_snprintf(dpdk_params, sizeof(dpdk_params), "--no-huge -m %d --no-pci %s",
 		 mem_size, getenv("TPA_LOG_DISABLE") ? "--log-level 0" : "");
@@ -1354,6 +1384,7 @@ void ut_init(int argc, char **argv)
 				   "      trace = %d; trace_size = 16KB; "
 				   "      more_trace = 1; rto_min = 1s; "
 				   "      local_port_range = %d %d; "
+				   "      gro_timeout = 0; "
 				   "} "
 				   "archive { flush_interval = 1;} "
 				   "%s",
@@ -1374,7 +1405,7 @@ void ut_init(int argc, char **argv)
 		 ut_root_prefix, ut_id, ut_root_prefix, ut_id);
 	system(cmd);
 
-	assert(tpa_init(1) == 0);
+	assert(tpa_init(nr_worker) == 0);
 	init_arp_cache();
 
 	worker = tpa_worker_init();
@@ -162,7 +162,7 @@ void ut_measure_rate(struct tcp_sock *tsock, int interval);
 
 static inline void ut_simulate_rto_timeout(struct tcp_sock *tsock)
 {
-	usleep((tsock->rto << tsock->rto_shift) + GRAGNULARITY * 1.1);
+	usleep((tsock->rto << tsock->rto_shift) + TIMER_TICK_US * 2);
 }
 
 static inline struct rte_tcp_hdr *ut_packet_tcp_hdr(struct packet *pkt)
@@ -215,21 +215,21 @@ struct ndp_advert_hdr {
 
 
 struct timer_snapshot {
-	int slot_idx;
+	uint64_t expire;
 	uint32_t active;
 	uint32_t closed;
 };
 
 static inline void ut_take_timer_snapshot(struct timer *timer, struct timer_snapshot *snapshot)
 {
-	snapshot->slot_idx = timer->slot_idx;
+	snapshot->expire   = timer->expire;
 	snapshot->active   = timer->active;
 	snapshot->closed   = timer->closed;
 }
 
 static inline int ut_time_not_changed(struct timer *timer, struct timer_snapshot *snapshot)
 {
-	return snapshot->slot_idx == timer->slot_idx &&
+	return snapshot->expire   == timer->expire   &&
 	       snapshot->active   == timer->active   &&
 	       snapshot->closed   == timer->closed;
 }
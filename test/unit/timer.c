@@ -30,8 +30,12 @@ static void test_timer_basic(void)
 	timer_init(&timer, &timer_ctrl, ut_timeout, &alarmed, FAKE_NOW);
 	timer_start(&timer, FAKE_NOW, 200 * 1000);
 
-	/* timer now as 100ms granularity */
-	timer_process(&timer_ctrl, now + (200 + 100)* 1000); {
+	timer_process(&timer_ctrl, now + 200 * 1000 - 1); {
+		assert(alarmed == 0);
+	}
+
+	/* timer now as 10us granularity */
+	timer_process(&timer_ctrl, now + 200 * 1000 + TIMER_TICK_US); {
 		assert(alarmed == 1);
 	}
 }
@@ -58,18 +62,145 @@ static void test_timer_stop_again_in_timeout(void)
 	timer_init(&timer, &timer_ctrl, ut_timeout_stop, &alarmed, FAKE_NOW);
 	timer_start(&timer, FAKE_NOW, 200 * 1000);
 
-	/* timer now as 100ms granularity */
 	timer_process(&timer_ctrl, now + (200 + 100)* 1000); {
 		assert(alarmed == 1);
 	}
 }
 
+static void ut_timeout_count(struct timer *timer)
+{
+	uint64_t *nr_timeout = timer->arg;
+
+	*nr_timeout += 1;
+}
+
+/* timers at every level should fire at the exact tick, even with big clock jumps */
+static void test_timer_levels(void)
+{
+	uint64_t timeouts[] = { 1, 50, 1000, 1280, 1290, 100 * 1000, 163840,
+				3 * 1000 * 1000, 120 * 1000 * 1000 };
+	struct timer timers[RTE_DIM(timeouts)];
+	struct timer_ctrl timer_ctrl;
+	uint64_t nr_timeout = 0;
+	uint64_t now = FAKE_NOW;
+	int i;
+
+	printf("testing %s ...\n", __func__);
+
+	timer_ctrl_init(&timer_ctrl, now);
+	for (i = 0; i < RTE_DIM(timeouts); i++) {
+		timer_init(&timers[i], &timer_ctrl, ut_timeout_count, &nr_timeout, now);
+		timer_start(&timers[i], now, timeouts[i]);
+	}
+
+	for (i = 0; i < RTE_DIM(timeouts); i++) {
+		timer_process(&timer_ctrl, FAKE_NOW + timeouts[i] - 1); {
+			assert(nr_timeout == i);
+			assert(!timer_is_stopped(&timers[i]));
+		}
+
+		timer_process(&timer_ctrl, FAKE_NOW + timeouts[i] + TIMER_TICK_US); {
+			assert(nr_timeout == i + 1);
+			assert(timer_is_stopped(&timers[i]));
+		}
+	}
+}
+
+static void test_timer_max_timeout(void)
+{
+	struct timer_ctrl timer_ctrl;
+	struct timer timer;
+	uint64_t now = FAKE_NOW;
+	uint32_t alarmed = 0;
+
+	printf("testing %s ...\n", __func__);
+
+	timer_ctrl_init(&timer_ctrl, now);
+	timer_init(&timer, &timer_ctrl, ut_timeout, &alarmed, now);
+	timer_start(&timer, now, UINT64_MAX / 2); {
+		assert(timer.expire - timer_ctrl.clock == TIMER_MAX_TICK);
+	}
+
+	timer_process(&timer_ctrl, now + (TIMER_MAX_TICK + 2) * TIMER_TICK_US); {
+		assert(alarmed == 1);
+	}
+}
+
+#define NR_BENCH_TIMER		(1u << 20)
+
+static void test_timer_bench(void)
+{
+	struct timer_ctrl *timer_ctrl;
+	struct timer *timers;
+	uint64_t nr_timeout = 0;
+	uint64_t nr_process = 0;
+	uint64_t nr_start = 0;
+	uint64_t now = FAKE_NOW;
+	uint64_t start;
+	uint64_t cycles;
+	uint32_t i;
+
+	printf("testing %s [%u timers] ...\n", __func__, NR_BENCH_TIMER);
+
+	timer_ctrl = malloc(sizeof(*timer_ctrl));
+	timers = malloc(sizeof(struct timer) * NR_BENCH_TIMER);
+	assert(timer_ctrl && timers);
+
+	timer_ctrl_init(timer_ctrl, now);
+	for (i = 0; i < NR_BENCH_TIMER; i++)
+		timer_init(&timers[i], timer_ctrl, ut_timeout_count, &nr_timeout, now);
+
+	/* 1M active timers, with timeouts spread between 1ms and 10s */
+	start = rte_rdtsc();
+	for (i = 0; i < NR_BENCH_TIMER; i++)
+		timer_start(&timers[i], now, 1000 + rand() % (10 * 1000 * 1000));
+	cycles = rte_rdtsc() - start;
+	printf("\t%-16s: %.1f cycles/op\n", "start", (double)cycles / NR_BENCH_TIMER);
+
+	/* re-arm them, as what RTO does on every ack */
+	start = rte_rdtsc();
+	WHILE_NOT_TIME_UP() {
+		i = rand() % NR_BENCH_TIMER;
+		timer_start(&timers[i], now, 1000 + rand() % (10 * 1000 * 1000));
+		nr_start += 1;
+	}
+	cycles = rte_rdtsc() - start;
+	printf("\t%-16s: %.1f cycles/op\n", "restart", (double)cycles / nr_start);
+
+	/* what the worker loop does most of the time: nothing expires */
+	start = rte_rdtsc();
+	for (i = 0; i < 1000000; i++)
+		assert(timer_process(timer_ctrl, now + i % TIMER_TICK_US) == 0);
+	cycles = rte_rdtsc() - start;
+	printf("\t%-16s: %.1f cycles/op\n", "process idle", (double)cycles / 1000000);
+
+	/* run the clock until all fired, by 1us steps */
+	start = rte_rdtsc();
+	while (nr_timeout < NR_BENCH_TIMER) {
+		now += 1;
+		timer_process(timer_ctrl, now);
+		nr_process += 1;
+	}
+	cycles = rte_rdtsc() - start;
+	printf("\t%-16s: %.1f cycles/timeout, %.1f cycles/process\n", "process",
+	       (double)cycles / NR_BENCH_TIMER, (double)cycles / nr_process);
+
+	for (i = 0; i < NR_BENCH_TIMER; i++)
+		assert(timer_is_stopped(&timers[i]));
+
+	free(timers);
+	free(timer_ctrl);
+}
+
 int main(int argc, char *argv[])
 {
 	ut_init(argc, argv);
 
 	test_timer_basic();
 	test_timer_stop_again_in_timeout();
+	test_timer_levels();
+	test_timer_max_timeout();
+	test_timer_bench();
 
 	return 0;
 }
@@ -26,8 +26,59 @@ static void test_sock_table_basic(void)
 	assert(sock_table_del(&worker->sock_table, &key) == 0);
 }
 
+static void test_sock_table_grow(void)
+{
+	struct sock_table table;
+	struct tcp_sock tsock;
+	struct sock_key key;
+	struct tpa_ip local_ip;
+	struct tpa_ip remote_ip;
+	int nr_entry = 64 * 1024;
+	int i;
+
+	printf("testing sock table [grow] ...\n");
+
+	tpa_ip_set_ipv4(&local_ip, CLIENT_IP);
+	tpa_ip_set_ipv4(&remote_ip, SERVER_IP);
+
+	assert(sock_table_init_with_size(&table, 16) == 0);
+	for (i = 0; i < nr_entry; i++) {
+		sock_key_init(&key, &remote_ip, 80, &local_ip, i);
+		assert(sock_table_add(&table, &key, &tsock) == 0);
+		assert(sock_table_add(&table, &key, &tsock) == -1);
+	}
+	assert(table.nr_entry == nr_entry);
+	assert(table.nr_grow > 0);
+
+	for (i = 0; i < nr_entry; i++) {
+		sock_key_init(&key, &remote_ip, 80, &local_ip, i);
+		assert(sock_table_lookup(&table, &key) == &tsock);
+
+		/* delete every other one */
+		if (i & 1)
+			assert(sock_table_del(&table, &key) == 0);
+	}
+
+	for (i = 0; i < nr_entry; i++) {
+		sock_key_init(&key, &remote_ip, 80, &local_ip, i);
+		if (i & 1) {
+			assert(sock_table_lookup(&table, &key) == NULL);
+			assert(sock_table_del(&table, &key) == -1);
+		} else {
+			assert(sock_table_lookup(&table, &key) == &tsock);
+			assert(sock_table_del(&table, &key) == 0);
+		}
+	}
+	assert(table.nr_entry == 0);
+	assert(table.nr_free == table.max_entry);
+
+	for (i = 0; i < table.nr_bucket; i++)
+		assert(table.buckets[i].nr_overflow == 0);
+
+	sock_table_destroy(&table);
+}
+
 /* TODO:
- * - full size test: make sure tcp_cfg.nr_max_sock entry can be stored
  * - stress test
  */
 
@@ -36,6 +87,7 @@ int main(int argc, char *argv[])
 	ut_init(argc, argv);
 
 	test_sock_table_basic();
+	test_sock_table_grow();
 
 	return 0;
 }
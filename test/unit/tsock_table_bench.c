@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+
+#include "test_utils.h"
+
+#define NR_LOOKUP_PER_ROUND	(1<<20)
+
+static void make_key(struct sock_key *key, uint32_t i)
+{
+	struct tpa_ip local_ip;
+	struct tpa_ip remote_ip;
+
+	tpa_ip_set_ipv4(&local_ip, CLIENT_IP);
+	tpa_ip_set_ipv4(&remote_ip, SERVER_IP + htonl(i >> 16));
+
+	sock_key_init(key, &remote_ip, 80 + (i & 0xff), &local_ip, 1024 + ((i >> 8) & 0xff));
+}
+
+static void bench_sock_table_lookup(uint32_t nr_entry)
+{
+	struct tcp_sock tsock;
+	struct sock_table table;
+	struct sock_key *keys;
+	uint64_t nr_lookup = 0;
+	uint64_t start;
+	uint64_t cycles;
+	uint32_t idx = 0;
+	uint32_t i;
+
+	printf("testing sock table lookup bench [%u entries] ...\n", nr_entry);
+
+	keys = malloc(sizeof(struct sock_key) * nr_entry);
+	assert(keys != NULL);
+
+	assert(sock_table_init(&table) == 0);
+	for (i = 0; i < nr_entry; i++) {
+		make_key(&keys[i], i);
+		assert(sock_table_add(&table, &keys[i], &tsock) == 0);
+	}
+	assert(table.nr_entry == nr_entry);
+
+	start = rte_rdtsc();
+	WHILE_NOT_TIME_UP() {
+		for (i = 0; i < NR_LOOKUP_PER_ROUND; i++) {
+			/* a prime stride to defeat the cache a bit */
+			idx = (idx + 7919) % nr_entry;
+			assert(sock_table_lookup(&table, &keys[idx]) == &tsock);
+		}
+		nr_lookup += NR_LOOKUP_PER_ROUND;
+	}
+	cycles = rte_rdtsc() - start;
+
+	printf("\t%-16s: %.2f Mlookups/s, %.1f cycles/lookup, %u buckets, %u grows\n",
+	       "hit", (double)nr_lookup * rte_get_tsc_hz() / cycles / 1e6,
+	       (double)cycles / nr_lookup, table.nr_bucket, table.nr_grow);
+
+	for (i = 0; i < nr_entry; i++)
+		assert(sock_table_del(&table, &keys[i]) == 0);
+	assert(table.nr_entry == 0);
+	for (i = 0; i < table.nr_bucket; i++)
+		assert(table.buckets[i].nr_overflow == 0);
+
+	sock_table_destroy(&table);
+	free(keys);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	ut_test_opts.duration = 1;
+
+	bench_sock_table_lookup(1<<10);
+	bench_sock_table_lookup(1<<16);
+	bench_sock_table_lookup(1<<20);
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * SPDX-License-Identifier: BSD-3-Clause
+ * Copyright (c) 2023, ByteDance Ltd. and/or its Affiliates
+ * Author: Yuanhan Liu <liuyuanhan.131@bytedance.com>
+ */
+#include <stdio.h>
+#include <pthread.h>
+
+#include "test_utils.h"
+
+/* keeps waiting until it really sleeps, or @max_us passes */
+static int wait_till_sleep(uint32_t timeout_us, uint64_t max_us)
+{
+	uint64_t start = TSC_TO_US(rte_rdtsc());
+
+	worker->busy = 0;
+	while (TSC_TO_US(rte_rdtsc()) - start < max_us) {
+		if (tpa_worker_wait(worker, timeout_us) == 1)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void test_worker_wait_busy(void)
+{
+	printf("testing %s ...\n", __func__);
+
+	worker->busy = 1;
+	assert(tpa_worker_wait(worker, 1000) == 0);
+	assert(worker->idle_since_us == 0);
+	worker->busy = 0;
+}
+
+static void test_worker_wait_pending_output(void)
+{
+	struct tcp_sock *tsock;
+	uint64_t nr_sleep = worker->stats_base[WORKER_SLEEP];
+	uint64_t start;
+
+	printf("testing %s ...\n", __func__);
+
+	tsock = ut_tcp_connect();
+	ut_write_assert(tsock, 100);
+
+	start = TSC_TO_US(rte_rdtsc());
+	while (TSC_TO_US(rte_rdtsc()) - start < 100 * 1000)
+		assert(tpa_worker_wait(worker, 1000) == 0);
+	assert(worker->stats_base[WORKER_SLEEP] == nr_sleep);
+
+	ut_tcp_output(NULL, -1);
+	ut_close(tsock, CLOSE_TYPE_RESET);
+}
+
+static void test_worker_wait_timeout(void)
+{
+	uint64_t nr_sleep = worker->stats_base[WORKER_SLEEP];
+	uint64_t sleep = worker->cycles.sleep;
+
+	printf("testing %s ...\n", __func__);
+
+	assert(wait_till_sleep(10 * 1000, 1000 * 1000) == 1); {
+		assert(worker->stats_base[WORKER_SLEEP] == nr_sleep + 1);
+		assert(worker->cycles.sleep > sleep);
+		assert(worker->sleeping == 0);
+		assert(worker->idle_since_us == 0);
+	}
+}
+
+static void *kick_worker(void *arg)
+{
+	volatile int *done = arg;
+
+	while (!*done) {
+		if (__atomic_load_n(&worker->sleeping, __ATOMIC_ACQUIRE))
+			worker_kick(worker);
+	}
+
+	return NULL;
+}
+
+static void test_worker_wait_kick(void)
+{
+	uint64_t nr_kick = worker->stats_base[WORKER_WAKEUP_KICK];
+	volatile int done = 0;
+	uint64_t start;
+	pthread_t tid;
+
+	printf("testing %s ...\n", __func__);
+
+	ut_spawn_thread(&tid, kick_worker, (void *)&done);
+
+	/* it may wake up for a timer first; keep going till it's kicked */
+	start = TSC_TO_US(rte_rdtsc());
+	while (worker->stats_base[WORKER_WAKEUP_KICK] == nr_kick) {
+		assert(TSC_TO_US(rte_rdtsc()) - start < 2 * 1000 * 1000);
+		wait_till_sleep(10 * 1000 * 1000, 1000 * 1000);
+	}
+
+	done = 1;
+	pthread_join(tid, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	ut_init(argc, argv);
+
+	test_worker_wait_busy();
+	test_worker_wait_pending_output();
+	test_worker_wait_timeout();
+	test_worker_wait_kick();
+
+	return 0;
+}
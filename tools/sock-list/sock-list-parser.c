@@ -15,6 +15,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <signal.h>
+#include <libgen.h>
 
 #include <tpa.h>
 #include <packet.h>
@@ -34,6 +35,9 @@ static int show_dot;
 static int last_sid;
 static int show_summary;
 static char *socks_file;
+static char *stats_file;
+static struct tsock_stats *stats_base;
+static uint64_t nr_stats;
 static uint8_t *sid_dump_mask;
 static int has_dump_mask;
 
@@ -160,12 +164,23 @@ static char *get_sid(struct tcp_sock *tsock)
 	}									\
 } while (0)
 
-#define SHOW_VSTATS(field, u)	__SHOW_VSTATS(field, "%lu", (uint64_t)(vstats_avg(&tsock->field)), (uint64_t)(tsock->field.max), \
-					      "%lu", u,     (uint64_t)(vstats_avg(&tsock->field)), (uint64_t)(tsock->field.max))
-#define SHOW_LAT_VSTATS(field)	__SHOW_VSTATS(field, "%.7f", _S(vstats_avg(&tsock->field)),  _S(tsock->field.max), \
-					      "%.1f", "us", _US(vstats_avg(&tsock->field)), _US(tsock->field.max))
-#define SHOW_SIZE_VSTATS(field)	__SHOW_VSTATS(field, "%lu", vstats_avg(&tsock->field), (uint64_t)(tsock->field.max), \
-					      "%.3f", "KB", (double)(vstats_avg(&tsock->field)) / 1024, (double)tsock->field.max / 1024)
+#define SHOW_VSTATS(field, u)	__SHOW_VSTATS(field, "%lu", (uint64_t)(vstats_avg(&stats->field)), (uint64_t)(stats->field.max), \
+					      "%lu", u,     (uint64_t)(vstats_avg(&stats->field)), (uint64_t)(stats->field.max))
+#define SHOW_LAT_VSTATS(field)	__SHOW_VSTATS(field, "%.7f", _S(vstats_avg(&stats->field)),  _S(stats->field.max), \
+					      "%.1f", "us", _US(vstats_avg(&stats->field)), _US(stats->field.max))
+#define SHOW_SIZE_VSTATS(field)	__SHOW_VSTATS(field, "%lu", vstats_avg(&stats->field), (uint64_t)(stats->field.max), \
+					      "%.3f", "KB", (double)(vstats_avg(&stats->field)) / 1024, (double)stats->field.max / 1024)
+
+/* the stats are located by the sock index, as the stats ptr is not valid here */
+static struct tsock_stats *get_tsock_stats(struct tcp_sock *tsock)
+{
+	uint64_t idx = tsock - sock_ctrl->socks;
+
+	if (!stats_base || idx >= nr_stats)
+		return NULL;
+
+	return &stats_base[idx];
+}
 
 static char *get_mac_addr(const struct rte_ether_addr *addr)
 {
@@ -187,6 +202,8 @@ static void dump_sock(struct tcp_sock *tsock, int verbose)
 	char local_ip[INET6_ADDRSTRLEN];
 	char remote_ip[INET6_ADDRSTRLEN];
 	char connection[1024];
+	char hist[128];
+	struct tsock_stats *stats = get_tsock_stats(tsock);
 	uint32_t snd_inflight;
 	uint32_t snd_avail;
 	uint64_t now = rte_rdtsc();
@@ -225,7 +242,8 @@ static void dump_sock(struct tcp_sock *tsock, int verbose)
 	SHOW_FIELD(nr_dupack,      "%hu");
 	SHOW_FIELD(retrans_stage,  "%hhu");
 	SHOW_FIELD(rto_shift,      "%hhu");
-	SHOW_FIELD2(rto_shift_max, "%hhu", vstats8_max_get(&tsock->rto_shift_max));
+	if (stats)
+		SHOW_FIELD2(rto_shift_max, "%hhu", vstats8_max_get(&stats->rto_shift_max));
 	SHOW_FIELD(keepalive_shift, "%hhu");
 	SHOW_FIELD(quickack,       "%hhu");
 	SHOW_FIELD(close_issued,   "%hhu");
@@ -260,6 +278,10 @@ static void dump_sock(struct tcp_sock *tsock, int verbose)
 	SHOW_FIELD(snd_mss,      "%hu");
 	SHOW_FIELD(snd_wscale,   "%hhu");
 
+	SHOW_FIELD(delivered,     "%lu");
+	SHOW_FIELD(delivery_rate, "%lu");
+	SHOW_FIELD(pacing_rate,   "%lu");
+
 	SHOW_FIELD2_QUOTED(interested_events, "%s", event_to_str(tsock->interested_events));
 	SHOW_FIELD2_QUOTED(last_events,       "%s", event_to_str(tsock->last_events));
 	SHOW_FIELD2_QUOTED(events,            "%s", event_to_str(tsock->event.events));
@@ -296,6 +318,9 @@ static void dump_sock(struct tcp_sock *tsock, int verbose)
 
 	SHOW_FIELD(zero_wnd_probe_shift, "%hhu");
 
+	if (!stats)
+		goto out;
+
 	SHOW_LAT_VSTATS(write_lat.submit);
 	SHOW_LAT_VSTATS(write_lat.xmit);
 	SHOW_LAT_VSTATS(write_lat.complete);
@@ -308,8 +333,11 @@ static void dump_sock(struct tcp_sock *tsock, int verbose)
 	SHOW_SIZE_VSTATS(write_size);
 
 	SHOW_VSTATS(ooo_recover_time, "us");
+	SHOW_FIELD2_QUOTED(rx_merge_size, "%s", hist_fmt(&stats->rx_merge_size, hist, sizeof(hist)));
+
+	print_stats(stats->stats_base, print_field_comma);
 
-	print_stats(tsock->stats_base, print_field_comma);
+out:
 	if (show_json)
 		printf("\n\t}");
 }
@@ -352,9 +380,30 @@ static void dump_summary(void)
 	printf("expand_failed: %hhu\n", sock_ctrl->expand_failed);
 }
 
+static void map_stats_file(void)
+{
+	struct mem_file *mem_file;
+
+	if (!stats_file) {
+		static char path[PATH_MAX];
+
+		snprintf(path, sizeof(path), "%s/%s", dirname(strdup(socks_file)), "sock-stats");
+		stats_file = path;
+	}
+
+	mem_file = mem_file_map(stats_file, NULL, 0);
+	if (!mem_file) {
+		fprintf(stderr, "warn: failed to map sock stats file %s; stats are not shown\n", stats_file);
+		return;
+	}
+
+	stats_base = mem_file_data(mem_file);
+	nr_stats = mem_file_data_size(mem_file) / sizeof(struct tsock_stats);
+}
+
 static void usage(void)
 {
-	fprintf(stderr, "usage: sock-list [-v] [-j] [-a] [-s] [-f socks-file] [sid1] [sid2..n]\n");
+	fprintf(stderr, "usage: sock-list [-v] [-j] [-a] [-s] [-f socks-file] [-S sock-stats-file] [sid1] [sid2..n]\n");
 
 	exit(1);
 }
@@ -363,12 +412,16 @@ static void parse_args(int argc, char **argv)
 {
 	int opt;
 
-	while ((opt = getopt(argc, argv, "f:advjs")) != -1) {
+	while ((opt = getopt(argc, argv, "f:S:advjs")) != -1) {
 		switch (opt) {
 		case 'f':
 			socks_file = optarg;
 			break;
 
+		case 'S':
+			stats_file = optarg;
+			break;
+
 		case 'a':
 			list_all = 1;
 			break;
@@ -405,6 +458,8 @@ static void parse_args(int argc, char **argv)
 	if (!sock_ctrl)
 		exit(1);
 
+	map_stats_file();
+
 	sid_dump_mask = malloc(sizeof(uint8_t) * sock_ctrl->nr_max_sock);
 	if (!sid_dump_mask) {
 		fprintf(stderr, "failed to allocate sid dump mask: nr_max_sock=%u: %s\n",
@@ -86,6 +86,7 @@ int main(int argc, char **argv)
 	tpad.name = argv[1];
 
 	tpad.sock_file = getenv("TPAD_SOCK_FILE");
+	tpad.sock_stats_file = getenv("TPAD_SOCK_STATS_FILE");
 	tpad.sock_trace_file = getenv("TPAD_SOCK_TRACE_FILE");
 	tpad.eth_dev = getenv("TPAD_DEV_NAME");
 	tpad.archive_dir = getenv("TPAD_ARCHIVE_DIR");
@@ -9,6 +9,7 @@
 struct tpad {
 	char *name;
 	char *sock_file;
+	char *sock_stats_file;
 	char *sock_trace_file;
 	char *eth_dev;
 	char *archive_dir;
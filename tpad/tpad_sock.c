@@ -77,6 +77,27 @@ static void tpad_symlink(const char *target, const char *linkpath)
 	}
 }
 
+static void sock_stats_archive(void)
+{
+	struct archive_ctx ctx;
+	struct mem_file *mem_file;
+	uint64_t id;
+
+	if (!tpad.sock_stats_file)
+		return;
+
+	mem_file = mem_file_map(tpad.sock_stats_file, NULL, MEM_FILE_READ);
+	if (!mem_file)
+		return;
+
+	archive_ctx_init(&ctx, tpad.archive_dir, "sock-stats", 16);
+	id = archive_raw(&ctx, mem_file->hdr, mem_file->hdr->size);
+	unlink(tpad.sock_stats_file);
+
+	if (id != UINT64_MAX)
+		tpad_symlink(archive_path(&ctx, id), tpad.sock_stats_file);
+}
+
 void sock_termination(void)
 {
 	struct archive_ctx ctx;
@@ -98,6 +119,8 @@ void sock_termination(void)
 	if (id != UINT64_MAX)
 		tpad_symlink(archive_path(&ctx, id), tpad.sock_file);
 
+	sock_stats_archive();
+
 	ifindex = if_nametoindex(tpad.eth_dev);
 	if (ifindex == 0) {
 		LOG_WARN("skip sock termination due to failed to get ifindex for %s: %s",